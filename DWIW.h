@@ -42,6 +42,14 @@ extern "C" {
 #endif
 #endif
 
+/* Newx() and Newxz() showed up in 5.9.3 */
+#ifndef Newx
+#define Newx(v, n, t) New(0, v, n, t)
+#endif
+#ifndef Newxz
+#define Newxz(v, n, t) Newz(0, v, n, t)
+#endif
+
 #define DEBUG_UTF8 0
 #define JSON_DO_DEBUG 0
 #define JSON_DO_TRACE 0
@@ -19,6 +19,8 @@ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
 
 #include "DWIW.h"
 #include "old_common.h"
+#include "libjsonevt/scan.h"
+#include "libjsonevt/number.h"
 
 /*
 #include "old_parse.h"
@@ -120,8 +122,54 @@ print_hex_line(FILE * fp, const unsigned char * buf, STRLEN buf_len) {
 #endif
 
 
-static SV * to_json(self_context * self, SV * data_ref, int indent_level, unsigned int cur_level);
+static int to_json(self_context * self, SV * data_ref, int indent_level, unsigned int cur_level);
 static SV * get_ref_addr(SV * ref);
+static int hash_key_can_be_bare(self_context * self, const char *key, STRLEN key_len);
+#ifdef IS_PERL_5_8
+static int cmp_hash_entries(const void * a, const void * b);
+#endif
+
+/* The cache_keys entries are kept for as long as the interpreter is
+   around, in the buffer of an SV so that they go away with it (e.g.,
+   when a thread exits). */
+#define MY_CXT_KEY "JSON::DWIW::_key_cache" XS_VERSION
+
+typedef struct {
+    SV * key_cache_sv;
+} my_cxt_t;
+
+START_MY_CXT
+
+static void
+init_key_cache_globals(void) {
+    MY_CXT_INIT;
+
+    MY_CXT.key_cache_sv = Nullsv;
+}
+
+#ifdef USE_ITHREADS
+/* called from CLONE, in the new thread */
+static void
+clone_key_cache_globals(void) {
+    MY_CXT_CLONE;
+
+    /* the parent's, so a new one is made on first use */
+    MY_CXT.key_cache_sv = Nullsv;
+}
+#endif
+
+static key_cache_entry *
+get_key_cache(void) {
+    dMY_CXT;
+    STRLEN size = KEY_CACHE_SIZE * sizeof(key_cache_entry);
+
+    UNLESS (MY_CXT.key_cache_sv) {
+        MY_CXT.key_cache_sv = newSV(size);
+        memzero(SvPVX(MY_CXT.key_cache_sv), size);
+    }
+
+    return (key_cache_entry *)SvPVX(MY_CXT.key_cache_sv);
+}
 
 
 #define JsSvLen(val) sv_len(val)
@@ -178,7 +226,12 @@ deserialize_json_sv (SV * self, SV * data_sv) {
 
     data_str = SvPV(data_sv, data_str_len);
 
-    return deserialize_json(self, data_str, data_str_len);
+    if (data_str_len == 0) {
+        return deserialize_json(self, data_str, data_str_len);
+    }
+
+    /* so the line and char stats can be counted from data_sv later */
+    return do_json_parse(self, data_sv);
 }
 
 /*
@@ -243,67 +296,418 @@ _safe_dup_buf(char *buf, uint32_t buf_len) {
     return dest;
 }
 
-static SV *
-escape_json_str(self_context * self, SV * sv_str) {
-    U8 * data_str;
-    STRLEN data_str_len;
-    STRLEN needed_len = 0;
+/*
+  The encoder appends everything to one output SV, self->out, as it
+  walks the data, instead of building an SV for each value and
+  concatenating it onto its parent's on the way back up.
+
+  When writing to a filehandle (self->out_fp), out is instead written
+  out and emptied each time it fills up, so it stays about the size
+  of write_size no matter how big the JSON is.
+*/
+
+/* Write what's in out to out_fp and empty it.  After a write fails,
+   the rest of the output is thrown away. */
+static void
+out_flush(self_context * self) {
+    SV * out = self->out;
+    STRLEN len = SvCUR(out);
+
+    if (len == 0) {
+        return;
+    }
+
+    UNLESS (self->error) {
+        if (PerlIO_write(self->out_fp, SvPVX(out), len) != (SSize_t)len) {
+            self->error = JSON_ENCODE_ERROR(self, "couldn't write output: %s",
+                Strerror(errno));
+        }
+    }
+
+    SvCUR_set(out, 0);
+}
+
+static void
+out_grow(self_context * self, STRLEN len) {
+    SV * out = self->out;
+    STRLEN size;
+
+    if (self->out_fp) {
+        out_flush(self);
+        if (len < SvLEN(out)) {
+            return;
+        }
+    }
+
+    size = SvLEN(out) * 2;
+    if (size < SvCUR(out) + len + 1) {
+        size = SvCUR(out) + len + 1;
+    }
+
+    SvGROW(out, size);
+}
+
+#define OUT_RESERVE(self, len) \
+    if (SvCUR((self)->out) + (len) >= SvLEN((self)->out)) { out_grow((self), (len)); }
+
+static void
+out_catpvn(self_context * self, const char * str, STRLEN len) {
+    SV * out = self->out;
+
+    OUT_RESERVE(self, len);
+    Copy(str, SvPVX(out) + SvCUR(out), len, char);
+    SvCUR_set(out, SvCUR(out) + len);
+}
+
+static void
+out_catc(self_context * self, char c) {
+    SV * out = self->out;
+
+    OUT_RESERVE(self, 1);
+    SvPVX(out)[SvCUR(out)] = c;
+    SvCUR_set(out, SvCUR(out) + 1);
+}
+
+/* for pretty printing */
+static void
+out_newline(self_context * self, int num_spaces) {
+    SV * out = self->out;
+
+    OUT_RESERVE(self, num_spaces + 1);
+    SvPVX(out)[SvCUR(out)] = '\n';
+    memset(SvPVX(out) + SvCUR(out) + 1, ' ', num_spaces);
+    SvCUR_set(out, SvCUR(out) + num_spaces + 1);
+}
+
+#define REF_SET_INIT_SIZE 64
+
+/* SV heads are at least 8-byte aligned, so drop the low bits, then
+   spread the rest over the slots. */
+#define REF_SET_SLOT(set, ptr) \
+    ((STRLEN)((PTR2UV(ptr) >> 3) * (UV)2654435761U) & (set)->mask)
+
+static void
+ref_set_grow(ref_set * set) {
+    void ** old_slots = set->slots;
+    STRLEN old_size = old_slots ? set->mask + 1 : 0;
+    STRLEN new_size = old_size ? old_size * 2 : REF_SET_INIT_SIZE;
+    STRLEN i;
+    STRLEN slot;
+
+    Newxz(set->slots, new_size, void *);
+    set->mask = new_size - 1;
+
+    for (i = 0; i < old_size; i++) {
+        if (old_slots[i]) {
+            slot = REF_SET_SLOT(set, old_slots[i]);
+            while (set->slots[slot]) {
+                slot = (slot + 1) & set->mask;
+            }
+            set->slots[slot] = old_slots[i];
+        }
+    }
+
+    if (old_slots) {
+        Safefree(old_slots);
+    }
+}
+
+/* Returns 1 if ptr was added, or 0 if it was already there. */
+static int
+ref_set_add(ref_set * set, void * ptr) {
+    STRLEN slot;
+
+    if (! set->slots || 2 * (set->count + 1) > set->mask + 1) {
+        ref_set_grow(set);
+    }
+
+    slot = REF_SET_SLOT(set, ptr);
+    while (set->slots[slot]) {
+        if (set->slots[slot] == ptr) {
+            return 0;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+
+    set->slots[slot] = ptr;
+    set->count++;
+
+    return 1;
+}
+
+static void
+ref_set_free(ref_set * set) {
+    if (set->slots) {
+        Safefree(set->slots);
+    }
+
+    memzero((void *)set, sizeof(ref_set));
+}
+
+/* With detect_circular_refs, an array or hash that has already been
+   output (anywhere, not just above this one) is written as a string
+   instead.  Only arrays and hashes are tracked, since nothing else is
+   followed. */
+#define CIRCULAR_REF(self, data) \
+    (((self)->flags & kDetectCircularRefs) && ! ref_set_add(&(self)->ref_track, (void *)(data)))
+
+static int
+encode_circular_ref(self_context * self, SV * data_ref) {
+    out_catpvn(self, "\"circular ref: ", 15);
+    sv_catsv(self->out, data_ref);
+    out_catc(self, '"');
+
+    return 1;
+}
+
+#define CLASS_CACHE_INIT_SIZE 16
+
+#define CLASS_CACHE_SLOT(cache, stash) \
+    ((STRLEN)((PTR2UV(stash) >> 3) * (UV)2654435761U) & (cache)->mask)
+
+static void
+class_cache_grow(class_cache * cache) {
+    class_dispatch * old_slots = cache->slots;
+    STRLEN old_size = old_slots ? cache->mask + 1 : 0;
+    STRLEN new_size = old_size ? old_size * 2 : CLASS_CACHE_INIT_SIZE;
+    STRLEN i;
+    STRLEN slot;
+
+    Newxz(cache->slots, new_size, class_dispatch);
+    cache->mask = new_size - 1;
+
+    for (i = 0; i < old_size; i++) {
+        if (old_slots[i].stash) {
+            slot = CLASS_CACHE_SLOT(cache, old_slots[i].stash);
+            while (cache->slots[slot].stash) {
+                slot = (slot + 1) & cache->mask;
+            }
+            cache->slots[slot] = old_slots[i];
+        }
+    }
+
+    if (old_slots) {
+        Safefree(old_slots);
+    }
+}
+
+/* Returns how objects of the class data_ref is blessed into are
+   output.  The class's ISA and methods are only looked at the first
+   time one of its objects is seen in a call; after that, it's found by
+   its stash. */
+static class_dispatch *
+get_class_dispatch(self_context * self, SV * data_ref) {
+    class_cache * cache = &self->classes;
+    HV * stash = SvSTASH(SvRV(data_ref));
+    class_dispatch * entry;
+    GV * method;
+    STRLEN slot;
+
+    if (cache->slots) {
+        slot = CLASS_CACHE_SLOT(cache, stash);
+        while (cache->slots[slot].stash) {
+            if (cache->slots[slot].stash == stash) {
+                return &cache->slots[slot];
+            }
+            slot = (slot + 1) & cache->mask;
+        }
+    }
+
+    if (! cache->slots || 2 * (cache->count + 1) > cache->mask + 1) {
+        class_cache_grow(cache);
+    }
+
+    slot = CLASS_CACHE_SLOT(cache, stash);
+    while (cache->slots[slot].stash) {
+        slot = (slot + 1) & cache->mask;
+    }
+
+    entry = &cache->slots[slot];
+    entry->stash = stash;
+    entry->kind = kClassPlain;
+    entry->to_json_cv = NULL;
+    cache->count++;
+
+    if (sv_isa(data_ref, "JSON::DWIW::Boolean")) {
+        entry->kind = kClassBool;
+    }
+    else if (sv_derived_from(data_ref, "Math::BigInt")
+        || sv_derived_from(data_ref, "Math::BigFloat")) {
+        entry->kind = kClassBigNum;
+    }
+    else if (self->flags & kConvertBlessed) {
+        method = gv_fetchmethod_autoload(stash, "TO_JSON", 0);
+        if (method && isGV(method) && GvCV(method)) {
+            entry->kind = kClassToJSON;
+            entry->to_json_cv = (CV *)SvREFCNT_inc((SV *)GvCV(method));
+        }
+    }
+
+    return entry;
+}
+
+static void
+class_cache_free(class_cache * cache) {
+    STRLEN i;
+
+    if (cache->slots) {
+        for (i = 0; i <= cache->mask; i++) {
+            if (cache->slots[i].to_json_cv) {
+                SvREFCNT_dec((SV *)cache->slots[i].to_json_cv);
+            }
+        }
+        Safefree(cache->slots);
+    }
+    memzero((void *)cache, sizeof(class_cache));
+}
+
+/* For convert_blessed -- outputs what the object's TO_JSON method
+   returns.  If the method dies, that's an encoding error, and $@ is
+   left as it was. */
+static int
+encode_with_to_json(self_context * self, SV * data_ref, CV * method, int indent_level,
+    unsigned int cur_level) {
+    dSP;
+    SV * result;
+    const char * err;
+    STRLEN err_len;
+    int count;
+    int rv;
+
+    ENTER;
+    SAVETMPS;
+    save_scalar(PL_errgv);
+
+    PUSHMARK(SP);
+    XPUSHs(data_ref);
+    PUTBACK;
+
+    count = call_sv((SV *)method, G_SCALAR | G_EVAL);
+
+    SPAGAIN;
+    result = count > 0 ? POPs : &PL_sv_undef;
+    PUTBACK;
+
+    if (SvTRUE(ERRSV)) {
+        err = SvPV(ERRSV, err_len);
+        if (err_len > 0 && err[err_len - 1] == '\n') {
+            err_len--;
+        }
+        self->error = JSON_ENCODE_ERROR(self, "%s::TO_JSON died: %.*s",
+            HvNAME(SvSTASH(SvRV(data_ref))), (int)err_len, err);
+        rv = 0;
+    }
+    else if (SvROK(result) && SvRV(result) == SvRV(data_ref)) {
+        self->error = JSON_ENCODE_ERROR(self,
+            "%s::TO_JSON returned the object it was called on",
+            HvNAME(SvSTASH(SvRV(data_ref))));
+        rv = 0;
+    }
+    else {
+        /* The result is freed at the FREETMPS below, and the next one
+           could be put at the same address.  With detect_circular_refs,
+           that would look like the same array or hash output again, so
+           they're all kept until run_encoder() is done. */
+        if ((self->flags & kDetectCircularRefs) && SvROK(result)) {
+            UNLESS (self->to_json_results) {
+                self->to_json_results = newAV();
+            }
+            av_push(self->to_json_results, SvREFCNT_inc(result));
+        }
+
+        rv = to_json(self, result, indent_level, cur_level);
+    }
+
+    FREETMPS;
+    LEAVE;
+
+    return rv;
+}
+
+/* Strings are written as utf-8, so the output has to be flagged (and
+   anything already in it upgraded, as sv_catsv() would do) before the
+   first one goes in. */
+#define OUT_SET_UTF8(self) UNLESS (SvUTF8((self)->out)) { sv_utf8_upgrade((self)->out); }
+
+/* What the bytes passed to escape_json_buf() are */
+#define kStrBytes 0  /* could be anything -- checked as utf-8 per bad_char_policy */
+#define kStrUTF8 1   /* from a string Perl has flagged as utf-8, so already good */
+#define kStrLatin1 2 /* each byte is a code point (e.g., see HeKWASUTF8) */
+
+/* Appends the JSON string for the bytes in data_str.  Returns 0 on error. */
+static int
+escape_json_buf(self_context * self, const U8 * data_str, STRLEN data_str_len, int str_type) {
     STRLEN sv_pos = 0;
+    STRLEN run_len = 0;
     uint32_t len = 0;
     U8 tmp_char = 0x00;
-    SV * rv;
     UV this_uv = 0;
     U8 unicode_bytes[5];
+    char hex_buf[32];
     int escape_unicode = 0;
     int pass_bad_char = 0;
     uint32_t len32 = 0;
+    uint scan_flags = 0;
     char *err_str = Nullch;
 
     memzero(unicode_bytes, 5); /* memzero macro provided by Perl */
 
-    UNLESS (SvOK(sv_str)) {
-        return newSVpv("null", 4);
-    }
-
-    data_str = (U8 *)SvPV(sv_str, data_str_len);
-    UNLESS (data_str) {
-        return newSVpv("null", 4);
-    }
-
     self->string_count++;
 
     if (data_str_len == 0) {
         /* empty string */
-        return newSVpv("\"\"", 2);
+        out_catpvn(self, "\"\"", 2);
+        return 1;
     }
 
     if (self->flags & kEscapeMultiByte) {
         escape_unicode = 1;
     }
 
-    /* get a better estimate of needed buffer size */
-    needed_len = data_str_len * 2 + 2;
+    /* Only the bytes the scan stops at go through the loop below.
+       Multi-byte characters can be copied as they are unless they have
+       to be checked or escaped. */
+    if (escape_unicode || str_type != kStrUTF8) {
+        scan_flags |= JSONEVT_SCAN_ESC_HIGH;
+    }
+    UNLESS (self->flags & (kBareSolidus | kMinimalEscaping)) {
+        scan_flags |= JSONEVT_SCAN_ESC_SOLIDUS;
+    }
 
-    rv = newSV(needed_len);
-    SvUTF8_on(rv);
-    sv_setpvn(rv, "\"", 1);
+    OUT_SET_UTF8(self);
+
+    /* room for the string if nothing needs to be escaped */
+    OUT_RESERVE(self, data_str_len + 2);
+    out_catc(self, '"');
 
-    /* printf("\tencoding string %s\n", data_str); */
-    
 #if DEBUG_UTF8
     fprintf(stderr, "\tencoding string ");
     print_hex_line(stderr, data_str, data_str_len);
-    /* if (data_str[0] == 0xe4) { */
-    sv_dump(sv_str);
-        /* } */
     fprintf(stderr, "==========\n");
 #endif
     
-    for (sv_pos = 0; sv_pos < data_str_len; sv_pos++) {
+    while (sv_pos < data_str_len) {
+        run_len = jsonevt_scan_escape((const char *)data_str + sv_pos, data_str_len - sv_pos,
+            scan_flags);
+        if (run_len) {
+            out_catpvn(self, (const char *)data_str + sv_pos, run_len);
+            sv_pos += run_len;
+
+            if (sv_pos >= data_str_len) {
+                break;
+            }
+        }
+
         pass_bad_char = 0;
 
-        /* this_uv = convert_utf8_to_uv(&data_str[sv_pos], &len); */
-        this_uv = (UV)utf8_bytes_to_unicode((uint8_t *)(&data_str[sv_pos]), data_str_len - sv_pos, &len);
+        if (str_type == kStrLatin1) {
+            this_uv = (UV)data_str[sv_pos];
+            len = 1;
+        }
+        else {
+            this_uv = (UV)utf8_bytes_to_unicode((uint8_t *)(&data_str[sv_pos]),
+                data_str_len - sv_pos, &len);
+        }
             
         if (len == 0) {
             len = 1;
@@ -315,7 +719,7 @@ escape_json_str(self_context * self, SV * sv_str) {
                     err_str = _safe_dup_buf((char *)data_str, data_str_len);
                     self->error = JSON_ENCODE_ERROR(self,
                         "bad utf8 sequence starting with %#02"UVxf" - %s",
-                        this_uv, (char *)data_str);
+                        this_uv, err_str);
                     free(err_str);
                 }
                 else {
@@ -323,8 +727,8 @@ escape_json_str(self_context * self, SV * sv_str) {
                         "bad utf8 sequence starting with %#02"UVxf, this_uv);
                 }
                     
-                sv_catpvn(rv, "\"", 1);
-                return rv;
+                out_catc(self, '"');
+                return 0;
             }
             else if (self->bad_char_policy & kBadCharConvert) {
                 this_uv = (UV)data_str[sv_pos];
@@ -335,114 +739,384 @@ escape_json_str(self_context * self, SV * sv_str) {
             }
         }
             
-        sv_pos += len - 1;
+        sv_pos += len;
 
         switch (this_uv) {
           case '\\':
-              sv_catpvn(rv, "\\\\", 2);
+              out_catpvn(self, "\\\\", 2);
               break;
           case '"':
-              sv_catpvn(rv, "\\\"", 2);
+              out_catpvn(self, "\\\"", 2);
               break;
-              /* 
-          case '\'':
-              sv_catpvn(rv, "\\'", 2);
-              break;
-              */
 
           case '/':
               if (self->flags & (kBareSolidus | kMinimalEscaping)) {
-                  sv_catpvn(rv, "/", 1);
+                  out_catc(self, '/');
               }
               else {
-                  sv_catpvn(rv, "\\/", 2);
+                  out_catpvn(self, "\\/", 2);
               }
 
               break;
               
           case 0x08:
               if (self->flags & kMinimalEscaping) {
-                  sv_catpvn(rv, "\x08", 1);
+                  out_catc(self, '\x08');
               }
               else {
-                  sv_catpvn(rv, "\\b", 2);
+                  out_catpvn(self, "\\b", 2);
               }
               break;
               
           case 0x0c:
               if (self->flags & kMinimalEscaping) {
-                  sv_catpvn(rv, "\x0c", 1);
+                  out_catc(self, '\x0c');
               }
               else {
-                  sv_catpvn(rv, "\\f", 2);
+                  out_catpvn(self, "\\f", 2);
               }
               break;
               
           case 0x0a:
               if (self->flags & kMinimalEscaping) {
-                  sv_catpvn(rv, "\x0a", 1);
+                  out_catc(self, '\x0a');
               }
               else {
-                  sv_catpvn(rv, "\\n", 2);
+                  out_catpvn(self, "\\n", 2);
               }
               break;
               
           case 0x0d:
               if (self->flags & kMinimalEscaping) {
-                  sv_catpvn(rv, "\x0d", 1);
+                  out_catc(self, '\x0d');
               }
               else {
-                  sv_catpvn(rv, "\\r", 2);
+                  out_catpvn(self, "\\r", 2);
               }
               break;
               
           case 0x09:
               if (self->flags & kMinimalEscaping) {
-                  sv_catpvn(rv, "\x09", 1);
+                  out_catc(self, '\x09');
               }
               else {
-                  sv_catpvn(rv, "\\t", 2);
+                  out_catpvn(self, "\\t", 2);
               }
               break;
               
           default:
-              if (this_uv < 0x1f) {
-                  sv_catpvf(rv, "\\u%04"UVxf, this_uv);
-              }
-              else if (escape_unicode && ! UTF8_IS_INVARIANT(this_uv)) {
-                  sv_catpvf(rv, "\\u%04"UVxf, this_uv);
+              if (this_uv < 0x1f || (escape_unicode && ! UTF8_IS_INVARIANT(this_uv))) {
+                  out_catpvn(self, hex_buf, jsonevt_u_escape((uint32_t)this_uv, hex_buf));
               }
               else if (!pass_bad_char) {
                   len32 = common_utf8_unicode_to_bytes((uint32_t)this_uv, (uint8_t *)unicode_bytes);
-                  if (len32 > 1) {
-                      SvUTF8_on(rv);
-                  }
-                  sv_catpvn(rv, (char *)unicode_bytes, len32);
+                  out_catpvn(self, (char *)unicode_bytes, len32);
               }
               else {
                   tmp_char = (U8)this_uv;
-                  sv_catpvn(rv, (char *)&tmp_char, 1);
+                  out_catc(self, (char)tmp_char);
               }
 
               break;              
         }
     }
     
-    sv_catpvn(rv, "\"", 1);
+    out_catc(self, '"');
     
-    return rv;
+    return 1;
 }
 
-static SV *
+/* Appends the string value of sv as a JSON string.  Returns 0 on error. */
+static int
+escape_json_str(self_context * self, SV * sv_str) {
+    U8 * data_str;
+    STRLEN data_str_len;
+
+    data_str = (U8 *)SvPV(sv_str, data_str_len);
+
+    return escape_json_buf(self, data_str, data_str_len,
+        (SvUTF8(sv_str) && ! SvROK(sv_str)) ? kStrUTF8 : kStrBytes);
+}
+
+#ifdef IS_PERL_5_8
+
+/*
+  When an array has hashes with the same keys in a row (e.g., rows
+  from a database), the JSON for the keys -- with the commas, and the
+  newlines and indentation for pretty printing -- is made once, from
+  the first of them, and the hashes that match are output by filling
+  in their values.  Each row's keys are matched to the template by
+  their shared HEK pointers, so nothing is escaped, compared, or
+  sorted again.  The keys of every matching row come out in the same
+  order (sorted, with sort_keys).
+*/
+
+#define HASH_TEMPLATE_MAX_MISSES 8
+
+typedef struct {
+    I32 num_keys;
+    HEK ** keys;          /* in the order they're output */
+    STRLEN * frag_end;    /* where each key's JSON ends in json */
+    SV * json;
+    unsigned int string_keys; /* how many of the keys aren't bare */
+
+    I32 * key_slots;      /* index + 1 of the key hashed to each slot, or 0 */
+    STRLEN key_slots_mask;
+
+    SV ** vals;           /* the values of the row being output */
+    unsigned int misses;
+} hash_template;
+
+#define HASH_TEMPLATE_SLOT(tmpl, hek) \
+    ((STRLEN)((PTR2UV(hek) >> 3) * (UV)2654435761U) & (tmpl)->key_slots_mask)
+
+/* Whether the value in element could be output with a template */
+#define HASH_TEMPLATE_CANDIDATE(sv) \
+    (SvROK(sv) && SvTYPE(SvRV(sv)) == SVt_PVHV && ! SvOBJECT(SvRV(sv)) \
+        && ! SvRMAGICAL(SvRV(sv)) && HvSHAREKEYS(SvRV(sv)) && HvUSEDKEYS((HV *)SvRV(sv)) > 0)
+
+/* Called from the save stack -- see new_hash_template() */
+static void
+free_hash_template(void * ptr) {
+    hash_template * tmpl = (hash_template *)ptr;
+
+    if (tmpl->json) {
+        SvREFCNT_dec(tmpl->json);
+    }
+    if (tmpl->keys) {
+        Safefree(tmpl->keys);
+    }
+    if (tmpl->frag_end) {
+        Safefree(tmpl->frag_end);
+    }
+    if (tmpl->key_slots) {
+        Safefree(tmpl->key_slots);
+    }
+    if (tmpl->vals) {
+        Safefree(tmpl->vals);
+    }
+
+    Safefree(tmpl);
+}
+
+/* Makes the template from the keys of hash, which is output at
+   hash_indent.  Returns NULL if a key can't be output (the hash is
+   then output the usual way, which reports the error).
+
+   The template is freed at the caller's next LEAVE, whether that's
+   reached by returning or by dying, so the caller has to ENTER first,
+   and LEAVE when it's done with the template (or got NULL). */
+static hash_template *
+new_hash_template(self_context * self, HV * hash, int hash_indent) {
+    hash_template * tmpl;
+    I32 num_keys = HvUSEDKEYS(hash);
+    HE ** entries;
+    HE * entry;
+    I32 count = 0;
+    I32 i;
+    STRLEN slot;
+    STRLEN num_slots;
+    SV * saved_out = self->out;
+    PerlIO * saved_out_fp = self->out_fp;
+    unsigned int saved_string_count = self->string_count;
+    int key_type;
+    int ok = 1;
+
+    Newxz(tmpl, 1, hash_template);
+    SAVEDESTRUCTOR(free_hash_template, tmpl);
+
+    Newx(entries, num_keys, HE *);
+    SAVEFREEPV(entries);
+
+    (void)hv_iterinit(hash);
+    while (count < num_keys && (entry = hv_iternext(hash))) {
+        entries[count++] = entry;
+    }
+
+    if (self->flags & kSortKeys) {
+        qsort(entries, count, sizeof(HE *), cmp_hash_entries);
+    }
+
+    tmpl->num_keys = count;
+    Newx(tmpl->keys, count, HEK *);
+    Newx(tmpl->frag_end, count, STRLEN);
+    Newx(tmpl->vals, count, SV *);
+
+    /* write the keys to the template instead of the output */
+    tmpl->json = newSVpvn("", 0);
+    self->out = tmpl->json;
+    self->out_fp = NULL;
+
+    for (i = 0; i < count; i++) {
+        entry = entries[i];
+        tmpl->keys[i] = HeKEY_hek(entry);
+
+        if (i > 0) {
+            out_catc(self, ',');
+        }
+
+        if (self->flags & kPrettyPrint) {
+            out_newline(self, (hash_indent + 1) * 4);
+        }
+
+        if (hash_key_can_be_bare(self, HeKEY(entry), HeKLEN(entry))) {
+            out_catpvn(self, HeKEY(entry), HeKLEN(entry));
+        }
+        else {
+            if (HeKWASUTF8(entry)) {
+                key_type = kStrLatin1;
+            }
+            else if (HeKUTF8(entry)) {
+                key_type = kStrUTF8;
+            }
+            else {
+                key_type = kStrBytes;
+            }
+
+            UNLESS (escape_json_buf(self, (const U8 *)HeKEY(entry), HeKLEN(entry), key_type)) {
+                ok = 0;
+                break;
+            }
+            tmpl->string_keys++;
+        }
+
+        out_catc(self, ':');
+        tmpl->frag_end[i] = SvCUR(tmpl->json);
+    }
+
+    self->out = saved_out;
+    self->out_fp = saved_out_fp;
+    self->string_count = saved_string_count;
+
+    UNLESS (ok) {
+        SvREFCNT_dec(self->error);
+        self->error = Nullsv;
+        if (self->error_data) {
+            SvREFCNT_dec(self->error_data);
+            self->error_data = Nullsv;
+        }
+
+        return NULL;
+    }
+
+    for (num_slots = 8; num_slots < (STRLEN)count * 2; num_slots *= 2) { }
+    Newxz(tmpl->key_slots, num_slots, I32);
+    tmpl->key_slots_mask = num_slots - 1;
+
+    for (i = 0; i < count; i++) {
+        slot = HASH_TEMPLATE_SLOT(tmpl, tmpl->keys[i]);
+        while (tmpl->key_slots[slot]) {
+            slot = (slot + 1) & tmpl->key_slots_mask;
+        }
+        tmpl->key_slots[slot] = i + 1;
+    }
+
+    return tmpl;
+}
+
+/* Puts the values of hash into tmpl->vals in the template's order.
+   Returns 0 if hash doesn't have the same keys as the template.  The
+   buckets are walked directly rather than with hv_iternext(), since
+   the order doesn't matter here. */
+static int
+match_hash_template(hash_template * tmpl, HV * hash) {
+    HE * entry;
+    HEK * hek;
+    STRLEN slot;
+    STRLEN bucket;
+    I32 i;
+
+    if (HvUSEDKEYS(hash) != tmpl->num_keys) {
+        return 0;
+    }
+
+    Zero(tmpl->vals, tmpl->num_keys, SV *);
+
+    for (bucket = 0; bucket <= HvMAX(hash); bucket++) {
+        for (entry = HvARRAY(hash)[bucket]; entry; entry = HeNEXT(entry)) {
+            if (HeVAL(entry) == &PL_sv_placeholder) {
+                /* deleted from a restricted hash */
+                continue;
+            }
+
+            hek = HeKEY_hek(entry);
+            slot = HASH_TEMPLATE_SLOT(tmpl, hek);
+            while ((i = tmpl->key_slots[slot]) && tmpl->keys[i - 1] != hek) {
+                slot = (slot + 1) & tmpl->key_slots_mask;
+            }
+
+            if (i == 0 || tmpl->vals[i - 1]) {
+                return 0;
+            }
+            tmpl->vals[i - 1] = HeVAL(entry);
+        }
+    }
+
+    return 1;
+}
+
+/* Does what to_json() and encode_hash() would for a hash that matched
+   the template. */
+static int
+encode_hash_from_template(self_context * self, hash_template * tmpl, int hash_indent,
+    unsigned int cur_level) {
+    const char * json = SvPVX(tmpl->json);
+    STRLEN frag_start = 0;
+    SV * val;
+    I32 i;
+
+    cur_level++;
+    UPDATE_CUR_LEVEL(self, cur_level);
+
+    self->hash_count++;
+
+    if (self->flags & kPrettyPrint) {
+        out_newline(self, hash_indent * 4);
+    }
+    out_catc(self, '{');
+
+    if (tmpl->string_keys) {
+        self->string_count += tmpl->string_keys;
+        OUT_SET_UTF8(self);
+    }
+
+    for (i = 0; i < tmpl->num_keys; i++) {
+        out_catpvn(self, json + frag_start, tmpl->frag_end[i] - frag_start);
+        frag_start = tmpl->frag_end[i];
+
+        val = tmpl->vals[i];
+        if (SvTYPE(val) == SVt_PVMG) {
+            SvGETMAGIC(val);
+        }
+
+        UNLESS (to_json(self, val, hash_indent + 2, cur_level)) {
+            return 0;
+        }
+    }
+
+    if (self->flags & kPrettyPrint) {
+        out_newline(self, hash_indent * 4);
+    }
+    out_catc(self, '}');
+
+    return 1;
+}
+
+#endif
+
+static int
 encode_array(self_context * self, AV * array, int indent_level, unsigned int cur_level) {
-    SV * rsv = NULL;
-    SV * tmp_sv = NULL;
     I32 max_i = av_len(array); /* max index, not length */
     I32 i;
-    I32 j;
     SV ** element = NULL;
+    SV ** next_element = NULL;
     I32 num_spaces = 0;
     MAGIC * magic_ptr = NULL;
+    int rv = 1;
+#ifdef IS_PERL_5_8
+    hash_template * tmpl = NULL;
+    int use_templates;
+#endif
 
     JsDumpSv((SV *)array, self->flags);
 
@@ -451,28 +1125,19 @@ encode_array(self_context * self, AV * array, int indent_level, unsigned int cur
 
     self->array_count++;
 
-    if (self->flags & kPrettyPrint) {
-        if (indent_level == 0) {
-            rsv = newSVpv("[", 1);
-        }
-        else {
-            num_spaces = indent_level * 4;
-            rsv = newSV(num_spaces + 3);
-            sv_setpvn(rsv, "\n", 1);
-            for (i = 0; i < num_spaces; i++) {
-                sv_catpvn(rsv, " ", 1);
-            }
-            sv_catpvn(rsv, "[", 1);
-        }
-    }
-    else {
-        rsv = newSVpv("[", 1);
+    if ((self->flags & kPrettyPrint) && indent_level != 0) {
+        out_newline(self, indent_level * 4);
     }
+    out_catc(self, '[');
 
     num_spaces = (indent_level + 1) * 4;
 
     magic_ptr = mg_find((SV *)array, PERL_MAGIC_tied);
 
+#ifdef IS_PERL_5_8
+    use_templates = ! magic_ptr && ! (self->flags & kDumpVars) && max_i > 0;
+#endif
+
     for (i = 0; i <= max_i; i++) {
         element = av_fetch(array, i, 0);
         if (element && *element) {
@@ -487,43 +1152,86 @@ encode_array(self_context * self, AV * array, int indent_level, unsigned int cur
                 SvGETMAGIC(*element);
             }
 
-            tmp_sv = to_json(self, *element, indent_level + 1, cur_level);
-
             if (self->flags & kPrettyPrint) {
-                sv_catpvn(rsv, "\n", 1);
-                for (j = 0; j < num_spaces; j++) {
-                    sv_catpvn(rsv, " ", 1);
+                out_newline(self, num_spaces);
+            }
+
+#ifdef IS_PERL_5_8
+            if (use_templates && HASH_TEMPLATE_CANDIDATE(*element)) {
+                /* only worth making a template if the next one looks like
+                   it has the same keys */
+                UNLESS (tmpl) {
+                    next_element = i < max_i ? av_fetch(array, i + 1, 0) : NULL;
+                    if (next_element && *next_element && SvTYPE(*next_element) != SVt_PVMG
+                        && HASH_TEMPLATE_CANDIDATE(*next_element)
+                        && HvUSEDKEYS((HV *)SvRV(*next_element))
+                        == HvUSEDKEYS((HV *)SvRV(*element))) {
+                        ENTER;
+                        tmpl = new_hash_template(self, (HV *)SvRV(*element), indent_level + 1);
+                        UNLESS (tmpl) {
+                            LEAVE;
+                        }
+                    }
+                }
+
+                if (tmpl) {
+                    if (match_hash_template(tmpl, (HV *)SvRV(*element))) {
+                        if (CIRCULAR_REF(self, SvRV(*element))) {
+                            encode_circular_ref(self, *element);
+                        }
+                        else {
+                            UNLESS (encode_hash_from_template(self, tmpl, indent_level + 1,
+                                        cur_level)) {
+                                rv = 0;
+                                break;
+                            }
+                        }
+
+                        goto next;
+                    }
+
+                    /* the template stays around until the LEAVE below */
+                    if (++tmpl->misses >= HASH_TEMPLATE_MAX_MISSES) {
+                        use_templates = 0;
+                    }
                 }
             }
+#endif
 
-            sv_catsv(rsv, tmp_sv);
-            SvREFCNT_dec(tmp_sv);
-            if (self->error) {
-                SvREFCNT_dec(rsv);
-                return (SV *)&PL_sv_undef;
+            UNLESS (to_json(self, *element, indent_level + 1, cur_level)) {
+                rv = 0;
+                break;
             }
-            tmp_sv = NULL;
         }
         else {
             /* error? */
-            sv_catpvn(rsv, "null", 4);
+            out_catpvn(self, "null", 4);
         }
 
+#ifdef IS_PERL_5_8
+      next:
+#endif
         if (i != max_i) {
-            sv_catpvn(rsv, ",", 1);
+            out_catc(self, ',');
         }
     }
 
+#ifdef IS_PERL_5_8
+    if (tmpl) {
+        LEAVE;
+    }
+#endif
+
+    UNLESS (rv) {
+        return 0;
+    }
+
     if (self->flags & kPrettyPrint) {
-        sv_catpvn(rsv, "\n", 1);
-        num_spaces = indent_level * 4;
-        for (j = 0; j < num_spaces; j++) {
-            sv_catpvn(rsv, " ", 1);
-        }
+        out_newline(self, indent_level * 4);
     }
-    sv_catpvn(rsv, "]", 1);
+    out_catc(self, ']');
 
-    return rsv;
+    return 1;
 }
 
 static void
@@ -581,7 +1289,7 @@ setup_self_context(SV *self_sv, self_context *self) {
 
     ptr = hv_fetch((HV *)self_hash, "detect_circular_refs", 20, 0);
     if (ptr && SvTRUE(*ptr)) {
-        self->ref_track = newHV();
+        self->flags |= kDetectCircularRefs;
     }
 
     ptr = hv_fetch((HV *)self_hash, "bare_solidus", 12, 0);
@@ -599,6 +1307,16 @@ setup_self_context(SV *self_sv, self_context *self) {
         self->flags |= kSortKeys;
     }
 
+    ptr = hv_fetch((HV *)self_hash, "convert_blessed", 15, 0);
+    if (ptr && SvTRUE(*ptr)) {
+        self->flags |= kConvertBlessed;
+    }
+
+    ptr = hv_fetch((HV *)self_hash, "cache_keys", 10, 0);
+    if (ptr && SvTRUE(*ptr)) {
+        self->key_cache = get_key_cache();
+    }
+
 
 #if JSON_DUMP_OPTIONS
     {
@@ -677,81 +1395,241 @@ hash_key_can_be_bare(self_context * self, const char *key, STRLEN key_len) {
     return 1;
 }
 
-static SV *
-_encode_hash_entry(self_context *self, int first, HE * entry, const char *key, I32 key_len,
-    SV *key_sv, SV *val, SV *rsv,
-    int indent_level, unsigned int cur_level) {
+/* everything that changes how a key is output */
+#define KEY_CACHE_OPTIONS(self) \
+    (((self)->flags & (kEscapeMultiByte | kBareSolidus | kMinimalEscaping)) \
+        | ((self)->bare_keys ? (1 << 16) : 0) | ((int)(self)->bad_char_policy << 17))
 
-    SV * tmp_sv = NULL;
-    SV * tmp_sv2 = NULL;
-    int i = 0;
-    int num_spaces;
+/* key_type is kStrBytes, kStrUTF8, or kStrLatin1 (see escape_json_buf()).
+
+   With cache_keys, the JSON for a key (quotes, escapes, and the ':')
+   is kept in the entry of self->key_cache picked by key_hash, and
+   copied from there the next time the same key comes along.  key_hash
+   is 0 for a key that doesn't come from a hash entry's HEK (e.g., in
+   a tied hash), which isn't cached. */
+static int
+_encode_hash_entry(self_context *self, const char *key, I32 key_len, int key_type,
+    U32 key_hash, SV *val, int indent_level, unsigned int cur_level) {
+    key_cache_entry * cached = NULL;
+    STRLEN start = 0;
+    STRLEN json_len;
+    int is_string = 0;
 
-    num_spaces = (indent_level + 1) * 4;
-    
     if (self->flags & kDumpVars) {
         fprintf(stderr, "hash key = %s\nval:\n", key);
     }
     
     if (self->flags & kPrettyPrint) {
-        sv_catpvn(rsv, "\n", 1);
-        for (i = 0; i < num_spaces; i++) {
-            sv_catpvn(rsv, " ", 1);
+        out_newline(self, (indent_level + 1) * 4);
+    }
+
+    if (self->key_cache && key_hash && key_len <= KEY_CACHE_MAX_KEY) {
+        cached = &self->key_cache[key_hash & (KEY_CACHE_SIZE - 1)];
+
+        if (cached->hash == key_hash && cached->key_len == key_len
+            && cached->key_type == key_type && cached->options == KEY_CACHE_OPTIONS(self)
+            && memcmp(cached->key, key, key_len) == 0) {
+            if (cached->is_string) {
+                self->string_count++;
+                OUT_SET_UTF8(self);
+            }
+            out_catpvn(self, cached->json, cached->json_len);
+
+            return to_json(self, val, indent_level + 2, cur_level);
         }
     }
 
-    if (hash_key_can_be_bare(self, key, key_len)) {
+    is_string = ! hash_key_can_be_bare(self, key, key_len);
+
+    if (cached) {
+        /* The worst case is a \u escape for each byte.  Reserving it
+           up front means out can't be written to out_fp part way
+           through the key, and upgrading it now (as escaping would)
+           means what's already in it doesn't move. */
+        if (is_string) {
+            OUT_SET_UTF8(self);
+        }
+        OUT_RESERVE(self, key_len * 6 + 3);
+        start = SvCUR(self->out);
+    }
+
+    UNLESS (is_string) {
         /* if the key can be bare, then it cannot have any hi-bits
            set, so no need to upgrade to utf-8
         */
-        sv_catpvn(rsv, (char *)key, key_len);
+        out_catpvn(self, key, key_len);
     }
     else {
-        tmp_sv = newSVpv((char *)key, key_len);
+        /* a key that was utf-8 but was given to us as the decoded
+           bytes (e.g., utf-8 => latin1) is converted back to utf-8 as
+           it is escaped
+        */
+        UNLESS (escape_json_buf(self, (const U8 *)key, key_len, key_type)) {
+            return 0;
+        }
+    }
+
+    out_catc(self, ':');
+
+    if (cached) {
+        json_len = SvCUR(self->out) - start;
+        if (json_len <= KEY_CACHE_MAX_JSON) {
+            cached->hash = key_hash;
+            cached->options = KEY_CACHE_OPTIONS(self);
+            cached->key_type = (U8)key_type;
+            cached->is_string = (U8)is_string;
+            cached->key_len = (U8)key_len;
+            cached->json_len = (U8)json_len;
+            Copy(key, cached->key, key_len, char);
+            Copy(SvPVX(self->out) + start, cached->json, json_len, char);
+        }
+    }
+
+    return to_json(self, val, indent_level + 2, cur_level);
+}
 
 #ifdef IS_PERL_5_8
-        if (HeKWASUTF8(entry)) {
-            /* The hash key was utf-8 encoding, but the char * was
 
-            given to us with as the decoded bytes (e.g., utf-8 =>
-            latin1), so convert back to utf-8
+/* Compares a Latin-1 key with a utf-8 one by code point.  Everything
+   in Latin-1 is less than a character that takes a 0xc4 or higher
+   lead byte in utf-8, so only two-byte sequences need decoding. */
+static int
+cmp_latin1_utf8_keys(const U8 * latin1, STRLEN latin1_len, const U8 * utf8, STRLEN utf8_len) {
+    STRLEN i = 0;
+    STRLEN j = 0;
+    UV c;
 
-            */
-            sv_utf8_upgrade(tmp_sv);
+    while (i < latin1_len && j < utf8_len) {
+        c = utf8[j];
+        if (c < 0x80) {
+            j++;
+        }
+        else if (c < 0xc4 && j + 1 < utf8_len) {
+            c = ((c & 0x1f) << 6) | (utf8[j + 1] & 0x3f);
+            j += 2;
+        }
+        else {
+            return -1;
         }
-#endif
 
-        tmp_sv2 = escape_json_str(self, tmp_sv);
-        if (self->error) {
-            SvREFCNT_dec(tmp_sv);
-            SvREFCNT_dec(tmp_sv2);
-            SvREFCNT_dec(rsv);
-            return (SV *)&PL_sv_no;
+        if (latin1[i] != c) {
+            return latin1[i] < c ? -1 : 1;
+        }
+        i++;
+    }
+
+    if (i < latin1_len) {
+        return 1;
+    }
+
+    return j < utf8_len ? -1 : 0;
+}
+
+/* qsort() comparison for sort_keys.  Keys are ordered by code point,
+   which is the order of the utf-8 they're output as, and the same
+   order sv_cmp() gives for the key SVs.  A key not flagged as utf-8
+   (including a HeKWASUTF8 one) has one byte per code point. */
+static int
+cmp_hash_entries(const void * a, const void * b) {
+    HEK * hek_a = HeKEY_hek(*(HE * const *)a);
+    HEK * hek_b = HeKEY_hek(*(HE * const *)b);
+    const U8 * key_a = (const U8 *)HEK_KEY(hek_a);
+    const U8 * key_b = (const U8 *)HEK_KEY(hek_b);
+    STRLEN len_a = HEK_LEN(hek_a);
+    STRLEN len_b = HEK_LEN(hek_b);
+    int utf8_a = HEK_UTF8(hek_a) ? 1 : 0;
+    int utf8_b = HEK_UTF8(hek_b) ? 1 : 0;
+    int rv;
+
+    if (utf8_a == utf8_b) {
+        rv = memcmp(key_a, key_b, len_a < len_b ? len_a : len_b);
+        if (rv) {
+            return rv;
+        }
+
+        return len_a < len_b ? -1 : (len_a > len_b ? 1 : 0);
+    }
+
+    if (utf8_a) {
+        return -cmp_latin1_utf8_keys(key_b, len_b, key_a, len_a);
+    }
+
+    return cmp_latin1_utf8_keys(key_a, len_a, key_b, len_b);
+}
+
+#define SORT_ENTRIES_ON_STACK 32
+
+/* Writes out the entries of an untied hash sorted by key, taking the
+   keys and values straight from the entries instead of copying the
+   keys to SVs, sorting those, and looking each one up again. */
+static int
+encode_sorted_hash_entries(self_context * self, HV * hash, int indent_level,
+    unsigned int cur_level) {
+    HE * stack_entries[SORT_ENTRIES_ON_STACK];
+    HE ** entries = stack_entries;
+    HE * entry;
+    STRLEN num_entries = HvUSEDKEYS(hash);
+    STRLEN count = 0;
+    STRLEN i;
+    SV * val;
+    int key_type;
+    int rv = 1;
+
+    /* freed at the LEAVE below, or as the stack unwinds if a value's
+       magic or TO_JSON method dies */
+    if (num_entries > SORT_ENTRIES_ON_STACK) {
+        ENTER;
+        Newx(entries, num_entries, HE *);
+        SAVEFREEPV(entries);
+    }
+
+    (void)hv_iterinit(hash);
+    while (count < num_entries && (entry = hv_iternext(hash))) {
+        entries[count++] = entry;
+    }
+
+    qsort(entries, count, sizeof(HE *), cmp_hash_entries);
+
+    for (i = 0; i < count; i++) {
+        entry = entries[i];
+        val = HeVAL(entry);
+
+        if (SvTYPE(val) == SVt_PVMG) {
+            SvGETMAGIC(val);
+        }
+
+        if (i > 0) {
+            out_catc(self, ',');
+        }
+
+        if (HeKWASUTF8(entry)) {
+            key_type = kStrLatin1;
+        }
+        else if (HeKUTF8(entry)) {
+            key_type = kStrUTF8;
+        }
+        else {
+            key_type = kStrBytes;
         }
 
-        sv_catsv(rsv, tmp_sv2);
-        SvREFCNT_dec(tmp_sv);
-        SvREFCNT_dec(tmp_sv2);
+        UNLESS (_encode_hash_entry(self, HeKEY(entry), HeKLEN(entry), key_type, HeHASH(entry), val,
+                    indent_level, cur_level)) {
+            rv = 0;
+            break;
+        }
     }
 
-    sv_catpvn(rsv, ":", 1);
-
-    tmp_sv = to_json(self, val, indent_level + 2, cur_level);
-    if (self->error) {
-        SvREFCNT_dec(tmp_sv);
-        SvREFCNT_dec(rsv);
-        return (SV *)&PL_sv_no;
+    if (entries != stack_entries) {
+        LEAVE;
     }
 
-    sv_catsv(rsv, tmp_sv);
-    SvREFCNT_dec(tmp_sv);
-
-    return (SV *)&PL_sv_yes;
+    return rv;
 }
 
-static SV *
+#endif
+
+static int
 encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_level) {
-    SV * rsv = NULL;
     SV * sv = Nullsv;
     SV * key_sv = Nullsv;
     const char * key;
@@ -759,10 +1637,9 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
     SV * val;
     int first = 1;
     int i;
-    int num_spaces = 0;
+    int key_type = kStrBytes;
     MAGIC * magic_ptr = NULL;
     HE * entry;
-    SV * success = Nullsv;
     AV * keys = Nullav;
     SV ** svp = (SV **)0;
     STRLEN tmp_strlen = 0;
@@ -775,33 +1652,25 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
 
     self->hash_count++;
 
-    if (self->flags & kPrettyPrint) {
-        if (indent_level == 0) {
-            rsv = newSVpv("{", 1);
-        }
-        else {
-            num_spaces = indent_level * 4;
-            rsv = newSV(num_spaces + 3);
-            sv_setpvn(rsv, "\n", 1);
-            for (i = 0; i < num_spaces; i++) {
-                sv_catpvn(rsv, " ", 1);
-            }
-            sv_catpvn(rsv, "{", 1);
-
-        }
-
-    }
-    else {
-        rsv = newSVpv("{", 1);
+    if ((self->flags & kPrettyPrint) && indent_level != 0) {
+        out_newline(self, indent_level * 4);
     }
+    out_catc(self, '{');
 
     JsDumpSv((SV *)hash, self->flags);
 
     magic_ptr = mg_find((SV *)hash, PERL_MAGIC_tied);
     
-    num_spaces = (indent_level + 1) * 4;
-    
+#ifdef IS_PERL_5_8
+    if ((self->flags & kSortKeys) && ! magic_ptr) {
+        UNLESS (encode_sorted_hash_entries(self, hash, indent_level, cur_level)) {
+            return 0;
+        }
+    }
+    else
+#endif
     if (self->flags & kSortKeys) {
+        /* tied hashes, and Perl 5.6 */
 #if PERL_VERSION < 8
         /* old-style -- work around not ahveing sortsv() */
         sort_keys = sv_2mortal(newSVpvn("JSON::DWIW::_sort_keys", 22));
@@ -842,15 +1711,12 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
             svp = av_fetch(keys, i, FALSE);
             key_sv = svp ? *svp : sv_mortalcopy(&PL_sv_undef);
             
+            /* hv_iterkeysv() has already turned a key that was utf-8
+               back into utf-8, so it isn't upgraded again */
             key = SvPV(key_sv, tmp_strlen);
             key_len = tmp_strlen;
             entry = hv_fetch_ent(hash, key_sv, 0, 0);
-            /* key = (unsigned char *)hv_iterkey(entry, &key_len); */
-            
-            /*
-            svp = hv_fetch(hash, key, SvUTF8(keysv) ? -key_len : keylen, 0); 
-		    val = svp ? *svp : sv_mortalcopy(&PL_sv_undef);
-            */
+
             val = hv_iterval(hash, entry);
 
             if (magic_ptr || SvTYPE(val) == SVt_PVMG) {
@@ -859,17 +1725,14 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
             }
 
             UNLESS (first) {
-                sv_catpvn(rsv, ",", 1);
+                out_catc(self, ',');
             }
 
-            /* ref cnt for rsv is decremented in encode_hash_entry() if there is an error */
-            success = _encode_hash_entry(self, first, entry, key, key_len, key_sv, val, rsv,
-                indent_level, cur_level);
-
-            if (success != &PL_sv_yes) {
+            UNLESS (_encode_hash_entry(self, key, key_len, SvUTF8(key_sv) ? kStrUTF8 : kStrBytes, 0,
+                        val, indent_level, cur_level)) {
                 SvREFCNT_dec(keys);
 
-                return &PL_sv_undef;
+                return 0;
             }
 
             first = 0;
@@ -881,16 +1744,13 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
 
         /* non-sorted keys */
         hv_iterinit(hash);
-        /* while ( (val = hv_iternextsv(hash, (char **)&key, &key_len)) ) { */
         while (1) {
             entry = hv_iternext(hash);
             UNLESS (entry) {
                 break;
             }
 
-            /* key_sv = HeSVKEY(entry); */
             key = hv_iterkey(entry, &key_len);
-            /* key = (U8 *)HePV(entry, key_len); */
             val = hv_iterval(hash, entry);
 
             /* need to call mg_get(val) to get the actual value if this is a tied hash */
@@ -901,14 +1761,25 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
             }
 
             UNLESS (first) {
-                sv_catpvn(rsv, ",", 1);
+                out_catc(self, ',');
+            }
+
+#ifdef IS_PERL_5_8
+            if (HeKWASUTF8(entry)) {
+                key_type = kStrLatin1;
+            }
+            else if (HeKUTF8(entry)) {
+                key_type = kStrUTF8;
+            }
+            else {
+                key_type = kStrBytes;
             }
+#endif
 
-            /* ref cnt for rsv is decremented in encode_hash_entry() if there is an error */
-            success = _encode_hash_entry(self, first, entry, key, key_len, Nullsv, val, rsv,
-                indent_level, cur_level);
-            if (success != &PL_sv_yes) {
-                return &PL_sv_undef;
+            UNLESS (_encode_hash_entry(self, key, key_len, key_type,
+                        magic_ptr ? 0 : HeHASH(entry), val,
+                        indent_level, cur_level)) {
+                return 0;
             }
 
             first = 0;
@@ -916,15 +1787,11 @@ encode_hash(self_context * self, HV * hash, int indent_level, unsigned int cur_l
     }
 
     if (self->flags & kPrettyPrint) {
-        sv_catpvn(rsv, "\n", 1);
-        num_spaces = indent_level * 4;
-        for (i = 0; i < num_spaces; i++) {
-            sv_catpvn(rsv, " ", 1);
-        }
+        out_newline(self, indent_level * 4);
     }
-    sv_catpvn(rsv, "}", 1);
+    out_catc(self, '}');
 
-    return rsv;
+    return 1;
 }
 
 #if 0
@@ -1078,23 +1945,17 @@ old_encode_hash(self_context * self, HV * hash, int indent_level, unsigned int c
 }
 #endif
 
-static SV *
+/* Appends the JSON for data_ref to self->out.  Returns 0 on error. */
+static int
 to_json(self_context * self, SV * data_ref, int indent_level, unsigned int cur_level) {
     SV * data;
+    class_dispatch * dispatch;
     int type;
-    SV * rsv = newSVpv("", 0);
-    SV * tmp = NULL;
     STRLEN before_len = 0;
     U8 * data_str = NULL;
     STRLEN start = 0;
     STRLEN len = 0;
-    SV * ref_tmp = NULL;
-    IV int_val = 0;
-    UV uint_val = 0;
-    /*
-    NV float_val = 0;
-    STRLEN pvlen = 0;
-    */
+    char num_buf[64];
 
     JsDumpSv(data_ref, self->flags);
 
@@ -1108,154 +1969,128 @@ to_json(self_context * self, SV * data_ref, int indent_level, unsigned int cur_l
             switch (type) {
               case SVt_NULL:
                 /* undef? */
-                sv_setpvn(rsv, "null", 4);
-                return rsv;
+                out_catpvn(self, "null", 4);
+                return 1;
                 break;
 
               case SVt_IV:
               case SVt_NV:
-                  before_len = JsSvLen(rsv);
+                  self->number_count++;
 
                   if (type == SVt_IV) {
                       if (SvIsUV(data)) {
-                          uint_val = SvUVX(data);
-                          sv_catpvf(rsv, "%"UVuf, uint_val);
+                          out_catpvn(self, num_buf, jsonevt_format_uint((uint64_t)SvUVX(data),
+                                         num_buf));
                       }
                       else {
-                          int_val = SvIVX(data);
-                          sv_catpvf(rsv, "%"IVdf, int_val);
+                          out_catpvn(self, num_buf, jsonevt_format_int((int64_t)SvIVX(data),
+                                         num_buf));
                       }
                       
+                      return 1;
                   }
-                  else {
-                      tmp = newSVsv(data);
-                      sv_catsv(rsv, tmp);
-                      SvREFCNT_dec(tmp);
-                      /*
-                      float_val = SvNVX(data);
-                      sv_catpvf(rsv, "%"NVgf, float_val);
-                      */
-                  }
-
-                  self->number_count++;
 
-                  if (JsSvLen(rsv) == before_len) {
-                      sv_catpvn(rsv, "\"\"", 2);
+#if NVSIZE == 8
+                  /* shortest digits that read back as the same value,
+                     instead of Perl's 15 significant digits */
+                  if (SvNOK(data)) {
+                      len = jsonevt_format_double((double)SvNVX(data), num_buf);
+                      if (len) {
+                          out_catpvn(self, num_buf, len);
+                          return 1;
+                      }
                   }
-                  return rsv;
-                  break;
+#endif
 
-              case SVt_PV:
-                  sv_catsv(rsv, data);
-                  tmp = rsv;
-                  rsv = escape_json_str(self, tmp);
-                  SvREFCNT_dec(tmp);
-                  return rsv; /* this works for the error case as well */
-                  break;
-                  
-              case SVt_PVIV:
-              case SVt_PVNV:
-                  sv_catsv(rsv, data);
-                  tmp = rsv;
-                  rsv = escape_json_str(self, tmp);
-                  SvREFCNT_dec(tmp);
-                  return rsv;
-                  break;
+                  /* Anything else (e.g., inf and nan) is stringified
+                     the way Perl does it.  Stringify a copy, so data
+                     doesn't get a string value (and so get output as a
+                     string next time). */
+                  sv_setsv(self->scratch, data);
+                  data_str = (U8 *)SvPV(self->scratch, len);
+                  if (len == 0) {
+                      out_catpvn(self, "\"\"", 2);
+                  }
+                  else {
+                      out_catpvn(self, (char *)data_str, len);
+                  }
 
-              case SVt_PVLV:
-                  sv_catsv(rsv, data);
-                  tmp = rsv;
-                  rsv = escape_json_str(self, tmp);
-                  SvREFCNT_dec(tmp);
-                  return rsv;
+                  return 1;
                   break;
 
               default:
-                  /* now what? */
-                  sv_catsv(rsv, data);
-                  tmp = rsv;
-                  rsv = escape_json_str(self, tmp);
-                  SvREFCNT_dec(tmp);
-                  return rsv;
+                  return escape_json_str(self, data);
                   break;
             }
         }
         else {
             /* undef */
-            sv_setpvn(rsv, "null", 4);
-            return rsv;
-        }
-    }
-
-    if (self->ref_track) {
-        ref_tmp = get_ref_addr(data_ref);
-        if (hv_exists_ent(self->ref_track, ref_tmp, 0)) {
-            SvREFCNT_dec(ref_tmp);
-            /* return a stringified version */
-            sv_catpvn(rsv, "\"circular ref: ", 15);
-            sv_catsv(rsv, data_ref);
-            sv_catpvn(rsv, "\"", 1);
-            return rsv;
-        }
-        else {
-            IGNORE_RV(hv_store_ent(self->ref_track, ref_tmp, newSV(0), 0));
-            SvREFCNT_dec(ref_tmp);
+            out_catpvn(self, "null", 4);
+            return 1;
         }
     }
 
     if (sv_isobject(data_ref)) {
-        if (sv_isa(data_ref, "JSON::DWIW::Boolean")) {
-            if (SvTRUE(data_ref)) {
-                sv_setpvn(rsv, "true", 4);
-                self->bool_count++;
-                return rsv;
-            }
-            else {
-                sv_setpvn(rsv, "false", 5);
-                self->bool_count++;
-                return rsv;
-            }
-        }
-        else if (sv_derived_from(data_ref, "Math::BigInt")
-            || sv_derived_from(data_ref, "Math::BigFloat")) {
-            tmp = newSVpv("", 0);
-            sv_catsv(tmp, data_ref);
-            data_str = (U8 *)SvPV(tmp, before_len);
-
-            if (before_len > 0) {
-                start = 0;
-                len = before_len;
-                if (data_str[0] == '+') {
-                    start++;
-                    len--;
-                }
+        dispatch = get_class_dispatch(self, data_ref);
 
-                if (data_str[before_len - 1] == '.') {
-                    len--;
-                }
+        switch (dispatch->kind) {
+          case kClassBool:
+              self->bool_count++;
 
-                sv_catpvn(rsv, (char *)data_str + start, len);
+              /* what its bool overloading would return, without
+                 calling it */
+              if (SvTRUE(SvRV(data_ref))) {
+                  out_catpvn(self, "true", 4);
+              }
+              else {
+                  out_catpvn(self, "false", 5);
+              }
 
-            }
-            else {
-                sv_setpvn(rsv, "\"\"", 2);
-            }
+              return 1;
+              break;
+
+          case kClassBigNum:
+              sv_setpvn(self->scratch, "", 0);
+              sv_catsv(self->scratch, data_ref);
+              data_str = (U8 *)SvPV(self->scratch, before_len);
+
+              if (before_len > 0) {
+                  start = 0;
+                  len = before_len;
+                  if (data_str[0] == '+') {
+                      start++;
+                      len--;
+                  }
+
+                  if (data_str[before_len - 1] == '.') {
+                      len--;
+                  }
+
+                  out_catpvn(self, (char *)data_str + start, len);
+
+              }
+              else {
+                  out_catpvn(self, "\"\"", 2);
+              }
 
-            SvREFCNT_dec(tmp);
+              return 1;
+              break;
+
+          case kClassToJSON:
+              return encode_with_to_json(self, data_ref, dispatch->to_json_cv, indent_level,
+                  cur_level);
+              break;
 
-            return rsv;
+          default:
+              /* output whatever it refers to */
+              break;
         }
     }
     
     data = SvRV(data_ref);
     if (SvROK(data)) {
         /* reference to a referrence */
-        sv_catsv(rsv, data_ref);
-        tmp = rsv;
-        rsv = escape_json_str(self, tmp);
-        SvREFCNT_dec(tmp);
-        
-        return rsv;
+        return escape_json_str(self, data_ref);
     }
 
     type = SvTYPE(data);
@@ -1263,115 +2098,48 @@ to_json(self_context * self, SV * data_ref, int indent_level, unsigned int cur_l
     switch (type) {
       case SVt_NULL:
         /* undef ? */
-        sv_setpvn(rsv, "null", 4);
-        return rsv;
+        out_catpvn(self, "null", 4);
+        return 1;
         break;
 
       case SVt_IV:
       case SVt_NV:
-          before_len = JsSvLen(rsv);
-          sv_catsv(rsv, data);
-          if (JsSvLen(rsv) == before_len) {
-              sv_catpvn(rsv, "\"\"", 2);
+          before_len = SvCUR(self->out);
+          sv_catsv(self->out, data);
+          if (SvCUR(self->out) == before_len) {
+              out_catpvn(self, "\"\"", 2);
           }
 
-        return rsv;
-        break;
-
-      case SVt_PV:
-        sv_catsv(rsv, data);
-        tmp = rsv;
-        rsv = escape_json_str(self, tmp);
-        SvREFCNT_dec(tmp);
-        return rsv;
+        return 1;
         break;
 
-      case SVt_PVIV:
-      case SVt_PVNV:
-          sv_catsv(rsv, data);
-          tmp = rsv;
-          rsv = escape_json_str(self, tmp);
-          SvREFCNT_dec(tmp);
-          return rsv;
-          break;
-
       case SVt_PVAV: /* array */
-          SvREFCNT_dec(rsv);
+          if (CIRCULAR_REF(self, data)) {
+              return encode_circular_ref(self, data_ref);
+          }
           return encode_array(self, (AV *)data, indent_level, cur_level);
         break;
 
       case SVt_PVHV: /* hash */
-          SvREFCNT_dec(rsv);
+          if (CIRCULAR_REF(self, data)) {
+              return encode_circular_ref(self, data_ref);
+          }
           return encode_hash(self, (HV *)data, indent_level, cur_level);
           break;
 
       case SVt_PVCV: /* code */
-          sv_catsv(rsv, data_ref);
-          tmp = rsv;
-          rsv = escape_json_str(self, tmp);
-          SvREFCNT_dec(tmp);
-
-          return rsv;
-          /*
-            sv_setpvn(rsv, "\"code\"", 6);
-            return rsv;
-          */
-
-        break;
-
       case SVt_PVGV: /* glob */
-          sv_catsv(rsv, data_ref);
-          tmp = rsv;
-          rsv = escape_json_str(self, tmp);
-          SvREFCNT_dec(tmp);
-
-          return rsv;
-          break;
-
-      case SVt_PVIO:
-          sv_catsv(rsv, data);
-          tmp = rsv;
-          rsv = escape_json_str(self, tmp);
-          SvREFCNT_dec(tmp);
-          return rsv;
+          return escape_json_str(self, data_ref);
           break;
 
-      case SVt_PVMG: /* blessed or magical scalar */
-          if (sv_isobject(data_ref)) {
-              sv_catsv(rsv, data);
-              tmp = rsv;
-              rsv = escape_json_str(self, tmp);
-              SvREFCNT_dec(tmp);
-              
-              return rsv;
-          }
-          else {
-              sv_catsv(rsv, data);
-              tmp = rsv;
-              rsv = escape_json_str(self, tmp);
-              SvREFCNT_dec(tmp);
-              
-              return rsv;
-          }
-          break;
-          
       default:
-          sv_catsv(rsv, data);
-          tmp = rsv;
-          rsv = escape_json_str(self, tmp);
-          SvREFCNT_dec(tmp);
-          
-          return rsv;
-          
-/*        sv_setpvn(rsv, "unknown type", 12); */
-/*        return rsv; */
-              
+          /* strings, numbers with string values, blessed or magical
+             scalars, etc. */
+          return escape_json_str(self, data);
           break;
     }
 
-    sv_setpvn(rsv, "unknown type 2", 14);
-    return rsv;
-
+    return 1;
 }
 
 static int
@@ -1496,10 +2264,107 @@ get_ref_type(SV * ref) {
 }
 
 
+#define DEFAULT_WRITE_SIZE 65536
+
+static STRLEN
+get_write_size(SV * self_sv) {
+    SV ** ptr;
+    IV size;
+
+    UNLESS (self_sv && SvROK(self_sv) && SvTYPE(SvRV(self_sv)) == SVt_PVHV) {
+        return DEFAULT_WRITE_SIZE;
+    }
+
+    ptr = hv_fetch((HV *)SvRV(self_sv), "write_size", 10, 0);
+    if (ptr && SvOK(*ptr)) {
+        size = SvIV(*ptr);
+        if (size > 0) {
+            return (STRLEN)size;
+        }
+    }
+
+    return DEFAULT_WRITE_SIZE;
+}
+
+/* Frees what run_encoder() sets up for a call.  It's run from the save
+   stack, so this also happens if something called while encoding (a
+   tied hash, a TO_JSON method, a __WARN__ handler) dies. */
+static void
+free_encoder_state(void * ptr) {
+    self_context * self = (self_context *)ptr;
+
+    if (self->scratch) {
+        SvREFCNT_dec(self->scratch);
+        self->scratch = Nullsv;
+    }
+    if (self->to_json_results) {
+        SvREFCNT_dec((SV *)self->to_json_results);
+        self->to_json_results = NULL;
+    }
+    ref_set_free(&self->ref_track);
+    class_cache_free(&self->classes);
+}
+
+/* Encode data into self->out (and to self->out_fp, if set), then pass
+   back the stats and any error.  Returns 0 on error.
+
+   If something dies partway through, the caller never gets control
+   back to free self->out, so the save stack holds the caller's
+   reference until then. */
+static int
+run_encoder(self_context * self, SV * data, SV * error_msg_ref, SV * error_data_ref,
+    SV * stats_ref) {
+    int ok;
+
+    ENTER;
+    SAVEDESTRUCTOR(free_encoder_state, self);
+    SAVEFREESV(self->out);
+
+    self->scratch = newSV(0);
+
+    ok = to_json(self, data, 0, 0);
+    if (ok && self->out_fp) {
+        out_flush(self);
+    }
+
+    if (SvOK(stats_ref)) {
+        set_encode_stats(self, stats_ref);
+    }
+
+    if (self->error) {
+        ok = 0;
+        sv_setsv(SvRV(error_msg_ref), self->error);
+
+        if (SvOK(error_data_ref) && SvROK(error_data_ref) && self->error_data) {
+            sv_setsv(SvRV(error_data_ref), self->error_data);
+        }
+    }
+
+    /* for the one the LEAVE drops */
+    SvREFCNT_inc(self->out);
+    LEAVE;
+
+    return ok;
+}
+
 MODULE = JSON::DWIW  PACKAGE = JSON::DWIW
 
 PROTOTYPES: DISABLE
 
+BOOT:
+    do_json_init_globals();
+    init_key_cache_globals();
+
+#ifdef USE_ITHREADS
+
+void
+CLONE(...)
+    CODE:
+    items = items;
+    do_json_clone_globals();
+    clone_key_cache_globals();
+
+#endif
 
 SV *
 do_dummy_parse(SV *self, SV *str)
@@ -1565,43 +2430,87 @@ deserialize_file(SV * file, ...)
     OUTPUT:
     RETVAL
 
+SV *
+deserialize_fh(SV * fh, ...)
+    ALIAS:
+        JSON::DWIW::load_fh = 1
+
+    PREINIT:
+    SV * self = Nullsv;
+    SV * rv;
+
+    CODE:
+    if (items > 1) {
+        self = (SV *)ST(1);
+    }
+    
+    /* avoid compiler warnings about unused variable */
+    ix = ix;
+
+    rv = do_json_parse_fh(self, fh);
+
+    RETVAL = rv;
+
+    OUTPUT:
+    RETVAL
+
 
 SV *
 _xs_to_json(SV * self, SV * data, SV * error_msg_ref, SV * error_data_ref, SV * stats_ref)
      PREINIT:
      self_context self_context;
      SV * rv;
-     int indent_level = 0;
-     SV * passed_error_data_sv = Nullsv;
 
      CODE:
      setup_self_context(self, &self_context);
-     rv = to_json(&self_context, data, indent_level, 0);
-
-    if (SvOK(stats_ref)) {
-        set_encode_stats(&self_context, stats_ref);
-    }
 
-    if (self_context.error) {
-        sv_setsv(SvRV(error_msg_ref), self_context.error);
-        
-        if (SvOK(error_data_ref) && SvROK(error_data_ref) && self_context.error_data) {
-            passed_error_data_sv = SvRV(error_data_ref);
-            sv_setsv(passed_error_data_sv, self_context.error_data);
-        }
-        
-    }
+     /* everything is written into this -- see out_catpvn() */
+     self_context.out = newSV(256);
+     sv_setpvn(self_context.out, "", 0);
 
-    if (self_context.ref_track) {
-        SvREFCNT_dec(self_context.ref_track);
-        self_context.ref_track = Nullhv;
-    }
+     if (run_encoder(&self_context, data, error_msg_ref, error_data_ref, stats_ref)) {
+         *SvEND(self_context.out) = '\0';
+         rv = self_context.out;
+     }
+     else {
+         SvREFCNT_dec(self_context.out);
+         rv = &PL_sv_undef;
+     }
 
      RETVAL = rv;
 
      OUTPUT:
      RETVAL
 
+SV *
+_xs_to_json_fh(SV * self, SV * data, SV * fh, SV * error_msg_ref, SV * error_data_ref, SV * stats_ref)
+     PREINIT:
+     self_context self_context;
+     PerlIO * fp;
+     int ok;
+
+     CODE:
+     fp = IoOFP(sv_2io(fh));
+     UNLESS (fp) {
+         croak("%s v%s - filehandle is not open for writing", MOD_NAME, XS_VERSION);
+     }
+
+     setup_self_context(self, &self_context);
+     self_context.out_fp = fp;
+
+     /* the bytes written are utf-8, whether or not there are any strings */
+     self_context.out = newSV(get_write_size(self));
+     sv_setpvn(self_context.out, "", 0);
+     SvUTF8_on(self_context.out);
+
+     ok = run_encoder(&self_context, data, error_msg_ref, error_data_ref, stats_ref);
+     SvREFCNT_dec(self_context.out);
+
+     RETVAL = ok ? newSViv(1) : &PL_sv_undef;
+
+     OUTPUT:
+     RETVAL
+
 SV *
 have_big_int(SV * self)
     PREINIT:
@@ -1936,3 +2845,67 @@ get_ref_type(SV * ref)
  RETVAL
 
 
+
+
+MODULE = JSON::DWIW  PACKAGE = JSON::DWIW::Decoder
+
+PROTOTYPES: DISABLE
+
+SV *
+_new(char * class, ...)
+    PREINIT:
+    SV * options = Nullsv;
+    json_decoder * dec;
+
+    CODE:
+    if (items > 1) {
+        options = (SV *)ST(1);
+    }
+
+    dec = do_json_new_decoder(options);
+    RETVAL = newSV(0);
+    sv_setref_pv(RETVAL, class, (void *)dec);
+
+    OUTPUT:
+    RETVAL
+
+SV *
+decode(SV * self, SV * data)
+    ALIAS:
+    JSON::DWIW::Decoder::decode_file = 1
+
+    PREINIT:
+    json_decoder * dec;
+    STRLEN data_len;
+
+    CODE:
+    UNLESS (sv_isobject(self) && sv_derived_from(self, "JSON::DWIW::Decoder")) {
+        croak("%s v%s - decode() must be called on a JSON::DWIW::Decoder object",
+            MOD_NAME, XS_VERSION);
+    }
+
+    dec = INT2PTR(json_decoder *, SvIV(SvRV(self)));
+
+    if (ix == 1) {
+        RETVAL = do_json_decoder_parse_file(dec, data);
+    }
+    else {
+        IGNORE_RV(SvPV(data, data_len));
+        if (data_len == 0) {
+            /* same as deserialize() */
+            RETVAL = newSVpv("", 0);
+        }
+        else {
+            RETVAL = do_json_decoder_parse(dec, data);
+        }
+    }
+
+    OUTPUT:
+    RETVAL
+
+void
+DESTROY(SV * self)
+    CODE:
+    if (SvROK(self)) {
+        do_json_free_decoder(INT2PTR(json_decoder *, SvIV(SvRV(self))));
+    }
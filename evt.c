@@ -94,12 +94,66 @@ typedef struct {
     SV *parse_const_cb;
     IV start_depth;
     SV *start_depth_handler;
+    jsonevt_ctx * evt_ctx; /* for jsonevt_get_size_hint() */
+
+    /* A hash key from string_callback(), waiting for its value.  It
+       is stored with hv_store() straight from here, instead of being
+       made into an SV and pushed onto the stack. */
+    char * key;
+    I32 key_len;    /* negative if the key is utf-8 */
+    uint key_size;
+    int have_key;
 } parse_callback_ctx;
 
 typedef struct {
     parse_callback_ctx cbd;
 } perl_wrapper_ctx;
 
+typedef struct {
+    uint strings;
+    uint max_string_bytes;
+    uint max_string_chars;
+    uint numbers;
+    uint bools;
+    uint nulls;
+    uint hashes;
+    uint arrays;
+    uint max_depth;
+    uint lines;
+    uint bytes;
+    uint chars;
+} parse_stats;
+
+/* The globals set after each parse are looked up once, when the
+   module is loaded.  The stats hash is only built when
+   $JSON::DWIW::Last_Stats is read -- until then, the numbers are
+   kept in stats, and stats_sv is the scalar they are for.  The line
+   and char counts take a pass over the input, so when the input came
+   from an SV, that pass waits even longer (see make_stats_hash()) --
+   stats_input is a copy of the SV (which perl shares with it
+   copy-on-write where it can), and stats_input_end is the byte count
+   the lines and chars are counted up to. */
+#define MY_CXT_KEY "JSON::DWIW::_evt_guts" XS_VERSION
+
+typedef struct {
+    GV * last_error_gv;
+    GV * last_error_data_gv;
+    GV * last_stats_gv;
+
+    SV * stats_sv;
+    int stats_pending;
+    parse_stats stats;
+    SV * stats_input;
+    uint stats_input_end;
+
+    /* what the JSON::DWIW::Boolean objects for true and false refer
+       to -- see get_bool_obj() */
+    SV * true_sv;
+    SV * false_sv;
+} my_cxt_t;
+
+START_MY_CXT
+
 #define GROW_STACK(ctx) ( ((ctx)->stack_size <<= 1), JSONEVT_RENEW_RV((ctx)->stack, (ctx)->stack_size, parse_cb_stack_entry))
 
 
@@ -233,6 +287,34 @@ get_new_bool_obj(int bool_val) {
     return obj;
 }
 
+/* For convert_bool.  The first true and false objects are made by
+   JSON::DWIW::Boolean, and after that, each value is a new reference
+   to the same (read-only) scalar, so there is no method call per
+   value. */
+static SV *
+get_bool_obj(int bool_val) {
+    dMY_CXT;
+    SV ** cached = bool_val ? &MY_CXT.true_sv : &MY_CXT.false_sv;
+    SV * obj;
+
+    if (*cached) {
+        obj = newRV_inc(*cached);
+#if PERL_VERSION < 18
+        /* overloading is flagged on the reference in older perls */
+        SvAMAGIC_on(obj);
+#endif
+        return obj;
+    }
+
+    obj = get_new_bool_obj(bool_val);
+    if (obj && SvROK(obj)) {
+        *cached = SvREFCNT_inc(SvRV(obj));
+        SvREADONLY_on(*cached);
+    }
+
+    return obj;
+}
+
 #define kHaveModuleNotChecked 0
 #define kHaveModule 1
 #define kHaveModuleDontHave 2
@@ -333,6 +415,11 @@ insert_entry(parse_callback_ctx * ctx, SV * val) {
         if (type == SVt_PVAV) {
             av_push((AV *)SvRV(cur_entry->data), val);
         }
+        else if (ctx->have_key) {
+            /* a hash with its key waiting in ctx->key */
+            ctx->have_key = 0;
+            IGNORE_RV(hv_store((HV *)s, ctx->key, ctx->key_len, val, 0));
+        }
         else {
             /* must be a hash (SVt_PVHV) */
             /* val must be a hash key, so push it onto the stack */
@@ -403,11 +490,41 @@ push_stack_val(parse_callback_ctx * ctx, SV * val) {
     return 1;
 }
 
+/* The data passed to string_callback() may be in a buffer the parser
+   reuses for the value, so the key has to be copied. */
+static void
+save_key(parse_callback_ctx * ctx, const char * data, uint data_len) {
+    uint i;
+    int is_utf8 = 0;
+
+    if (data_len >= ctx->key_size) {
+        ctx->key_size = data_len + 64;
+        JSONEVT_RENEW(ctx->key, ctx->key_size, char);
+    }
+    memcpy(ctx->key, data, data_len);
+
+    /* only flag the key as utf-8 if it has to be */
+    for (i = 0; i < data_len; i++) {
+        if ((U8)data[i] >= 0x80) {
+            is_utf8 = 1;
+            break;
+        }
+    }
+
+    ctx->key_len = is_utf8 ? -(I32)data_len : (I32)data_len;
+    ctx->have_key = 1;
+}
+
 static int
 string_callback(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
     parse_callback_ctx * ctx = (parse_callback_ctx *)cb_data;
     SV * val;
 
+    if (flags & JSON_EVT_IS_HASH_KEY) {
+        save_key(ctx, data, data_len);
+        return 0;
+    }
+
     val = newSVpvn(data, data_len);
 
     /* flag as utf-8 */
@@ -420,39 +537,20 @@ string_callback(void * cb_data, const char * data, uint data_len, uint flags, ui
     return 0;
 }
 
+/* True if the number may be too big or too precise for an IV, UV, or
+   NV, going by the number of digits. */
 static int
-number_callback(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
-    parse_callback_ctx * ctx = (parse_callback_ctx *)cb_data;
-    NV nv_val;
-    IV iv_val;
-    UV uv_val;
-    
-    SV * sv_val = Nullsv;
-    SV * tmp_sv = Nullsv;
-    int try_big_num = 0;
+number_needs_big_num(const char * data, uint data_len, uint flags) {
     char * uv_str = Nullch;
-    unsigned char number_done = 0;
 
-    SETUP_TRACE;
-
-    if (ctx->parse_number_cb) {
-        tmp_sv = newSVpv(data, data_len);
-        sv_val = json_call_function_one_arg_one_return(ctx->parse_number_cb, tmp_sv);
-        SvREFCNT_dec(tmp_sv);
-        push_stack_val(ctx, sv_val);
-        return 0;
-    }
-
-
-    /* figure out if we need to create a BigNum object or not */
     if (flags & (JSON_EVT_PARSE_NUMBER_HAVE_DECIMAL | JSON_EVT_PARSE_NUMBER_HAVE_EXPONENT)) {
         if (flags & JSON_EVT_PARSE_NUMBER_HAVE_SIGN) {
             if (data_len - 1 >= DBL_DIG) {
-                try_big_num = 1;
+                return 1;
             }
         }
         else if (data_len >= DBL_DIG) {
-            try_big_num = 1;
+            return 1;
         }
     }
     else {
@@ -461,11 +559,11 @@ number_callback(void * cb_data, const char * data, uint data_len, uint flags, ui
                 if (data_len - 1 == IV_DIG) {
                     uv_str = form("%"IVdf"", (IV)IV_MIN);
                     if (strncmp(data, uv_str, data_len) > 0) {
-                        try_big_num = 1;
+                        return 1;
                     }
                 }
                 else {
-                    try_big_num = 1;
+                    return 1;
                 }
             }
         }
@@ -474,16 +572,45 @@ number_callback(void * cb_data, const char * data, uint data_len, uint flags, ui
                 if (data_len == UV_DIG) {
                     uv_str = form("%"UVuf"", (UV)UV_MAX);
                     if (strncmp(data, uv_str, data_len) > 0) {
-                        try_big_num = 1;
+                        return 1;
                     }
                 }
                 else {
-                    try_big_num = 1;
+                    return 1;
                 }
             }
         }
     }
 
+    return 0;
+}
+
+static int
+number_callback(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    parse_callback_ctx * ctx = (parse_callback_ctx *)cb_data;
+    NV nv_val;
+    IV iv_val;
+    UV uv_val;
+    
+    SV * sv_val = Nullsv;
+    SV * tmp_sv = Nullsv;
+    int try_big_num = 0;
+    unsigned char number_done = 0;
+
+    SETUP_TRACE;
+
+    if (ctx->parse_number_cb) {
+        tmp_sv = newSVpv(data, data_len);
+        sv_val = json_call_function_one_arg_one_return(ctx->parse_number_cb, tmp_sv);
+        SvREFCNT_dec(tmp_sv);
+        push_stack_val(ctx, sv_val);
+        return 0;
+    }
+
+
+    /* figure out if we need to create a BigNum object or not */
+    try_big_num = number_needs_big_num(data, data_len, flags);
+
     if (try_big_num) {
         if (flags & (JSON_EVT_PARSE_NUMBER_HAVE_EXPONENT | JSON_EVT_PARSE_NUMBER_HAVE_DECIMAL)) {
             if (have_bigfloat()) {
@@ -544,11 +671,61 @@ number_callback(void * cb_data, const char * data, uint data_len, uint flags, ui
     return 0;
 }
 
+/* Same as number_callback(), but the parser has already worked out
+   the value, so there's no need to convert it from the text. */
+static int
+typed_number_callback(void * cb_data, const char * data, uint data_len, const jsonevt_number * num,
+    uint flags, uint level) {
+    parse_callback_ctx * ctx = (parse_callback_ctx *)cb_data;
+    SV * sv_val = Nullsv;
+
+    if (ctx->parse_number_cb || (flags & JSON_EVT_PARSE_NUMBER_OVERFLOW)
+        || number_needs_big_num(data, data_len, flags)) {
+        return number_callback(cb_data, data, data_len, flags & ~JSON_EVT_PARSE_NUMBER_OVERFLOW,
+            level);
+    }
+
+    switch (num->type) {
+      case JSON_EVT_NUMBER_INT64:
+          sv_val = newSViv((IV)num->val.i);
+          break;
+
+      case JSON_EVT_NUMBER_UINT64:
+          sv_val = newSVuv((UV)num->val.u);
+          break;
+
+      default:
+#if defined(USE_LONG_DOUBLE) || defined(USE_QUADMATH)
+          /* NVs have more precision than the parser's doubles */
+          return number_callback(cb_data, data, data_len, flags, level);
+#else
+          sv_val = newSVnv((NV)num->val.d);
+#endif
+          break;
+    }
+
+    push_stack_val(ctx, sv_val);
+
+    return 0;
+}
+
+/* The elements of the array just above start_depth are handed to the
+   start_depth_handler and popped off as they come, so it shouldn't be
+   made to hold all of them. */
+#define USE_SIZE_HINT(ctx, level) (! ((ctx)->start_depth_handler \
+            && (IV)(level) + 1 == (ctx)->start_depth))
+
 static int
 array_begin_callback(void * cb_data, uint flags, uint level) {
     parse_callback_ctx * ctx = (parse_callback_ctx *)cb_data;
+    AV * array = newAV();
+    uint size = jsonevt_get_size_hint(ctx->evt_ctx);
+
+    if (size > 1 && USE_SIZE_HINT(ctx, level)) {
+        av_extend(array, size - 1);
+    }
 
-    push_stack_val(ctx, newRV_noinc((SV *)newAV()));
+    push_stack_val(ctx, newRV_noinc((SV *)array));
 
     LOG_DEBUG("\nin array_begin callback at level %u\n", level);
 
@@ -590,6 +767,9 @@ array_element_end_callback(void * cb_data, uint flags, uint level) {
 
         rv = json_call_function_one_arg_one_return(ctx->start_depth_handler, val);
 
+        /* av_pop() handed us the array's reference to val */
+        SvREFCNT_dec(val);
+
         /*
           parse_cb_stack_entry *entry = CUR_STACK_ENTRY(ctx);
           SV *data = entry->data;
@@ -598,7 +778,6 @@ array_element_end_callback(void * cb_data, uint flags, uint level) {
           data = av_pop((AV *)entry->data);
         */
 
-        /* rv will be a mortal, so don't decrement it's ref count */
         /* rv = json_call_function_one_arg_one_return(ctx->start_depth_handler, data); */
  
         /* POP_STACK(ctx); */
@@ -609,11 +788,13 @@ array_element_end_callback(void * cb_data, uint flags, uint level) {
           SvREFCNT_dec(data);
         */
 
-        /* FIXME: check whether ref count gets decremented when popped off the array */
-
         UNLESS (SvOK(rv)) {
             return 1;
         }
+
+        /* json_call_function_one_arg_one_return() increments the
+           ref count of a defined return value */
+        SvREFCNT_dec(rv);
     }
 
 
@@ -633,8 +814,15 @@ array_element_begin_callback(void * cb_data, uint flags, uint level) {
 static int
 hash_begin_callback(void * cb_data, uint flags, uint level) {
     parse_callback_ctx * ctx = (parse_callback_ctx *)cb_data;
+    HV * hash = newHV();
+    uint size = jsonevt_get_size_hint(ctx->evt_ctx);
 
-    push_stack_val(ctx, newRV_noinc((SV *)newHV()));
+    /* a new hash starts out with 8 buckets */
+    if (size > 8) {
+        hv_ksplit(hash, size);
+    }
+
+    push_stack_val(ctx, newRV_noinc((SV *)hash));
 
     LOG_DEBUG("in hash_begin callback at level %u, cb_data is %"UVxf, level, PTR2UV(ctx));
 
@@ -690,7 +878,7 @@ bool_callback(void * cb_data, uint bool_val, uint flags, uint level) {
         SvREFCNT_dec(arg);
     }
     else if (ctx->options & EVT_OPTION_CONVERT_BOOL) {
-        s = get_new_bool_obj(bool_val);
+        s = get_bool_obj(bool_val);
     }
     else {
         s = bool_val ? newSVuv(1) : newSVpvn("", 0);
@@ -746,6 +934,8 @@ setup_options(jsonevt_ctx * json_ctx, parse_callback_ctx * ctx, SV * self_sv) {
     SV ** ptr;
     HV * self_hash;
     IV num_keys = 0;
+    /* set_stats() keeps what it needs for the line and char counts */
+    uint evt_options = JSON_EVT_OPTION_LAZY_TEXT_STATS;
 
     UNLESS (self_sv) {
         return 0;
@@ -812,6 +1002,13 @@ setup_options(jsonevt_ctx * json_ctx, parse_callback_ctx * ctx, SV * self_sv) {
         ctx->start_depth = -1;
     }
 
+    ptr = hv_fetch((HV *)self_hash, "structural_index", 16, 0);
+    if (ptr && SvTRUE(*ptr)) {
+        evt_options |= JSON_EVT_OPTION_STRUCTURAL_INDEX;
+    }
+
+    jsonevt_set_options(json_ctx, evt_options);
+
     return 1;
 }
 
@@ -836,65 +1033,95 @@ do_json_dummy_parse(SV * self_sv, SV * json_str_sv) {
     return rv;
 }
 
-static jsonevt_ctx *
-init_cbs(perl_wrapper_ctx * pwctx, SV * self_sv) {
-    /* static jsonevt_ctx * ctx = (jsonevt_ctx *)0; */
-
-    /* FIXME: need to find a way to reuse this without making it a static var */
-    jsonevt_ctx * ctx = (jsonevt_ctx *)0;
+static void
+set_parse_callbacks(jsonevt_ctx * ctx) {
+    jsonevt_set_string_cb(ctx, string_callback);
+    jsonevt_set_typed_number_cb(ctx, typed_number_callback);
+    jsonevt_set_begin_array_cb(ctx, array_begin_callback);
+    jsonevt_set_end_array_cb(ctx, array_end_callback);
+    /*
+      jsonevt_set_begin_array_element_cb(ctx, array_element_begin_callback);
+    */
+    jsonevt_set_end_array_element_cb(ctx, array_element_end_callback);
 
-    /* jsonevt_ctx * ctx = jsonevt_new_ctx(); */
-    parse_callback_ctx * cb_data;
+    jsonevt_set_begin_hash_cb(ctx, hash_begin_callback);
+    jsonevt_set_end_hash_cb(ctx, hash_end_callback);
     /*
-    char * error = Nullch;
-    SV * rv = Nullsv;
-    HV * error_hash = Nullhv;
-    HV * stats = Nullhv;
-    int throw_exception = 0;
-    SV * tmp_sv = Nullsv;
-    SV * error_msg = Nullsv;
-    SV * error_data_ref = Nullsv;
-    SV * stats_ref = Nullsv;
+      jsonevt_set_begin_hash_entry_cb(ctx, hash_entry_begin_callback);
+      jsonevt_set_end_hash_entry_cb(ctx, hash_entry_end_callback);
     */
 
-    SETUP_TRACE;
+    jsonevt_set_bool_cb(ctx, bool_callback);
+    jsonevt_set_null_cb(ctx, null_callback);
+}
 
-    UNLESS (ctx) {
-        ctx = jsonevt_new_ctx();
+static void
+init_cb_data(parse_callback_ctx * cb_data, jsonevt_ctx * ctx) {
+    cb_data->evt_ctx = ctx;
+    cb_data->stack_size = 64;
 
-        LOG_DEBUG("creating ctx %#08"UVxf, PTR2UV(ctx));
+    JSONEVT_NEW(cb_data->stack, cb_data->stack_size, parse_cb_stack_entry);
 
-        jsonevt_set_string_cb(ctx, string_callback);
-        jsonevt_set_number_cb(ctx, number_callback);
-        jsonevt_set_begin_array_cb(ctx, array_begin_callback);
-        jsonevt_set_end_array_cb(ctx, array_end_callback);
-        /*
-          jsonevt_set_begin_array_element_cb(ctx, array_element_begin_callback);
-        */
-        jsonevt_set_end_array_element_cb(ctx, array_element_end_callback);
+    cb_data->stack_level = -1;
+    memzero(cb_data->stack, cb_data->stack_size * sizeof(parse_cb_stack_entry));
 
-        jsonevt_set_begin_hash_cb(ctx, hash_begin_callback);
-        jsonevt_set_end_hash_cb(ctx, hash_end_callback);
-        /*
-          jsonevt_set_begin_hash_entry_cb(ctx, hash_entry_begin_callback);
-          jsonevt_set_end_hash_entry_cb(ctx, hash_entry_end_callback);
-        */
-        
-        jsonevt_set_bool_cb(ctx, bool_callback);
-        jsonevt_set_null_cb(ctx, null_callback);
+    cb_data->key = NULL;
+    cb_data->key_size = 0;
+    cb_data->have_key = 0;
+}
+
+/* get the stack ready for another parse, keeping the options */
+static void
+reset_cb_data(parse_callback_ctx * cb_data) {
+    cb_data->stack_level = -1;
+    memzero(cb_data->stack, cb_data->stack_size * sizeof(parse_cb_stack_entry));
+    cb_data->have_key = 0;
+}
+
+static void
+free_cb_data(parse_callback_ctx * cb_data) {
+    JSONEVT_FREE_MEM(cb_data->stack); cb_data->stack = NULL;
+
+    if (cb_data->key) {
+        JSONEVT_FREE_MEM(cb_data->key);
+        cb_data->key = NULL;
     }
 
-    memzero(pwctx, sizeof(*pwctx));
-    cb_data = &pwctx->cbd;
+    if (cb_data->parse_number_cb) {
+        SvREFCNT_dec(cb_data->parse_number_cb);
+        cb_data->parse_number_cb = Nullsv;
+    }
 
-    /* memzero(&cb_data, sizeof(parse_callback_ctx)); */
+    if (cb_data->parse_const_cb) {
+        SvREFCNT_dec(cb_data->parse_const_cb);
+        cb_data->parse_const_cb = Nullsv;
+    }
 
-    cb_data->stack_size = 64;
+    if (cb_data->start_depth_handler) {
+        SvREFCNT_dec(cb_data->start_depth_handler);
+        cb_data->start_depth_handler = Nullsv;
+    }
+}
 
-    JSONEVT_NEW(cb_data->stack, cb_data->stack_size, parse_cb_stack_entry);
+static jsonevt_ctx *
+init_cbs(perl_wrapper_ctx * pwctx, SV * self_sv) {
+    jsonevt_ctx * ctx;
+    parse_callback_ctx * cb_data;
 
-    cb_data->stack_level = -1;
-    memzero(cb_data->stack, cb_data->stack_size * sizeof(parse_cb_stack_entry));
+    SETUP_TRACE;
+
+    /* see json_decoder below for reusing all of this */
+    ctx = jsonevt_new_ctx();
+
+    LOG_DEBUG("creating ctx %#08"UVxf, PTR2UV(ctx));
+
+    set_parse_callbacks(ctx);
+    jsonevt_set_options(ctx, JSON_EVT_OPTION_LAZY_TEXT_STATS);
+
+    memzero(pwctx, sizeof(*pwctx));
+    cb_data = &pwctx->cbd;
+
+    init_cb_data(cb_data, ctx);
 
     jsonevt_set_cb_data(ctx, cb_data);
 
@@ -905,8 +1132,351 @@ init_cbs(perl_wrapper_ctx * pwctx, SV * self_sv) {
     return ctx;
 }
 
+static void
+fetch_globals(my_cxt_t * cxt) {
+    cxt->last_error_gv = gv_fetchpv("JSON::DWIW::LastError", GV_ADD, SVt_PV);
+    cxt->last_error_data_gv = gv_fetchpv("JSON::DWIW::LastErrorData", GV_ADD, SVt_PV);
+    cxt->last_stats_gv = gv_fetchpv("JSON::DWIW::Last_Stats", GV_ADD, SVt_PV);
+}
+
+/* called from BOOT */
+void
+do_json_init_globals(void) {
+    MY_CXT_INIT;
+
+    memzero(&MY_CXT, sizeof(MY_CXT));
+    fetch_globals(&MY_CXT);
+}
+
+/* Work out the line and char counts that set_stats() put off.  This
+   is only done when a thread is cloned -- the input belongs to the
+   parent, so the clone just forgets about it. */
+static void
+count_stats_text(my_cxt_t * cxt) {
+    UNLESS (cxt->stats_input) {
+        return;
+    }
+
+    jsonevt_count_text_stats(SvPVX(cxt->stats_input), (uint)SvCUR(cxt->stats_input),
+        cxt->stats_input_end, &cxt->stats.lines, &cxt->stats.chars);
+
+    cxt->stats_input = Nullsv;
+}
+
+static void
+drop_stats_input(my_cxt_t * cxt) {
+    if (cxt->stats_input) {
+        SvREFCNT_dec(cxt->stats_input);
+        cxt->stats_input = Nullsv;
+    }
+}
+
+/* called from CLONE, in the new thread */
+void
+do_json_clone_globals(void) {
+    MY_CXT_CLONE;
+
+    fetch_globals(&MY_CXT);
+    MY_CXT.stats_sv = GvSVn(MY_CXT.last_stats_gv);
+
+    /* the input belongs to the parent, which is waiting on the clone,
+       so count from it now while it is still safe to read */
+    count_stats_text(&MY_CXT);
+
+    /* these belong to the parent, so new ones are made on first use */
+    MY_CXT.true_sv = Nullsv;
+    MY_CXT.false_sv = Nullsv;
+}
+
+#ifdef IS_PERL_5_8
+/*
+  The "lines" and "chars" values in a stats hash are counted from a
+  copy of the input the first time one of them is read, so that
+  from_json() can keep the hash around without paying for the count.
+  Both SVs share one of these.
+*/
+typedef struct {
+    SV * input;    /* Nullsv once counted */
+    uint end;
+    uint lines;
+    uint chars;
+    int refs;
+} lazy_text_stats;
+
+#define LAZY_TEXT_STAT_LINES 0
+#define LAZY_TEXT_STAT_CHARS 1
+/* set in mg_private once the SV has its value, whether from the
+   count or from being assigned to */
+#define LAZY_TEXT_STAT_HAVE_VALUE 2
+
+static int
+text_stat_magic_get(pTHX_ SV * sv, MAGIC * mg) {
+    lazy_text_stats * ts = (lazy_text_stats *)mg->mg_ptr;
+
+    if (mg->mg_private & LAZY_TEXT_STAT_HAVE_VALUE) {
+        return 0;
+    }
+
+    if (ts->input) {
+        jsonevt_count_text_stats(SvPVX(ts->input), (uint)SvCUR(ts->input), ts->end,
+            &ts->lines, &ts->chars);
+        SvREFCNT_dec(ts->input);
+        ts->input = Nullsv;
+    }
+
+    sv_setuv(sv, (mg->mg_private & LAZY_TEXT_STAT_CHARS) ? ts->chars : ts->lines);
+    mg->mg_private |= LAZY_TEXT_STAT_HAVE_VALUE;
+
+    return 0;
+}
+
+static int
+text_stat_magic_set(pTHX_ SV * sv, MAGIC * mg) {
+    mg->mg_private |= LAZY_TEXT_STAT_HAVE_VALUE;
+
+    return 0;
+}
+
+static int
+text_stat_magic_free(pTHX_ SV * sv, MAGIC * mg) {
+    lazy_text_stats * ts = (lazy_text_stats *)mg->mg_ptr;
+
+    if (--ts->refs == 0) {
+        if (ts->input) {
+            SvREFCNT_dec(ts->input);
+        }
+        JSONEVT_FREE_MEM(ts);
+    }
+
+    return 0;
+}
+
+#ifdef USE_ITHREADS
+/* The input belongs to the parent thread, which is waiting on the
+   clone, so the clone gets the counts instead. */
+static int
+text_stat_magic_dup(pTHX_ MAGIC * mg, CLONE_PARAMS * param) {
+    lazy_text_stats * ts = (lazy_text_stats *)mg->mg_ptr;
+    lazy_text_stats * new_ts;
+
+    JSONEVT_NEW(new_ts, 1, lazy_text_stats);
+    memzero(new_ts, sizeof(*new_ts));
+
+    if (ts->input) {
+        jsonevt_count_text_stats(SvPVX(ts->input), (uint)SvCUR(ts->input), ts->end,
+            &new_ts->lines, &new_ts->chars);
+    }
+    else {
+        new_ts->lines = ts->lines;
+        new_ts->chars = ts->chars;
+    }
+
+    new_ts->refs = 1;
+    mg->mg_ptr = (char *)new_ts;
+
+    return 0;
+}
+
+static MGVTBL text_stat_magic_vtbl = { text_stat_magic_get, text_stat_magic_set, 0, 0,
+                                       text_stat_magic_free, 0, text_stat_magic_dup };
+#else
+static MGVTBL text_stat_magic_vtbl = { text_stat_magic_get, text_stat_magic_set, 0, 0,
+                                       text_stat_magic_free };
+#endif
+
 static SV *
-handle_parse_result(int result, jsonevt_ctx * ctx, perl_wrapper_ctx * wctx) {
+new_text_stat_sv(lazy_text_stats * ts, U16 which) {
+    SV * sv = newSV(0);
+    MAGIC * mg;
+
+    mg = sv_magicext(sv, NULL, PERL_MAGIC_ext, &text_stat_magic_vtbl, (char *)ts, 0);
+    mg->mg_private = which;
+#ifdef USE_ITHREADS
+    mg->mg_flags |= MGf_DUP;
+#endif
+    ts->refs++;
+
+    return sv;
+}
+#endif
+
+/* If input is set, the line and char counts haven't been worked out
+   yet, and the hash takes over input to count them from. */
+static HV *
+make_stats_hash(parse_stats * st, SV * input, uint input_end) {
+    HV * stats = newHV();
+#ifdef IS_PERL_5_8
+    lazy_text_stats * ts;
+#endif
+
+    IGNORE_RV(hv_store(stats, "strings", 7, newSVuv(st->strings), 0));
+    IGNORE_RV(hv_store(stats, "max_string_bytes", 16, newSVuv(st->max_string_bytes), 0));
+    IGNORE_RV(hv_store(stats, "max_string_chars", 16, newSVuv(st->max_string_chars), 0));
+    IGNORE_RV(hv_store(stats, "numbers", 7, newSVuv(st->numbers), 0));
+    IGNORE_RV(hv_store(stats, "bools", 5, newSVuv(st->bools), 0));
+    IGNORE_RV(hv_store(stats, "nulls", 5, newSVuv(st->nulls), 0));
+    IGNORE_RV(hv_store(stats, "hashes", 6, newSVuv(st->hashes), 0));
+    IGNORE_RV(hv_store(stats, "arrays", 6, newSVuv(st->arrays), 0));
+    IGNORE_RV(hv_store(stats, "max_depth", 9, newSVuv(st->max_depth), 0));
+
+    IGNORE_RV(hv_store(stats, "bytes", 5, newSVuv(st->bytes), 0));
+
+#ifdef IS_PERL_5_8
+    if (input) {
+        JSONEVT_NEW(ts, 1, lazy_text_stats);
+        memzero(ts, sizeof(*ts));
+        ts->input = input;
+        ts->end = input_end;
+
+        IGNORE_RV(hv_store(stats, "lines", 5, new_text_stat_sv(ts, LAZY_TEXT_STAT_LINES), 0));
+        IGNORE_RV(hv_store(stats, "chars", 5, new_text_stat_sv(ts, LAZY_TEXT_STAT_CHARS), 0));
+
+        return stats;
+    }
+#endif
+
+    IGNORE_RV(hv_store(stats, "lines", 5, newSVuv(st->lines), 0));
+    IGNORE_RV(hv_store(stats, "chars", 5, newSVuv(st->chars), 0));
+
+    return stats;
+}
+
+static void
+store_stats_hash(SV * sv, parse_stats * st, SV * input, uint input_end) {
+    SV * stats_ref = newRV_noinc((SV *)make_stats_hash(st, input, input_end));
+
+    sv_setsv(sv, stats_ref);
+    SvREFCNT_dec(stats_ref);
+}
+
+#ifdef IS_PERL_5_8
+static int
+stats_magic_get(pTHX_ SV * sv, MAGIC * mg) {
+    dMY_CXT;
+
+    if (MY_CXT.stats_pending && sv == MY_CXT.stats_sv) {
+        MY_CXT.stats_pending = 0;
+        store_stats_hash(sv, &MY_CXT.stats, MY_CXT.stats_input, MY_CXT.stats_input_end);
+        MY_CXT.stats_input = Nullsv;
+    }
+
+    return 0;
+}
+
+/* anything assigned from Perl (e.g., by to_json()) replaces the stats */
+static int
+stats_magic_set(pTHX_ SV * sv, MAGIC * mg) {
+    dMY_CXT;
+
+    if (sv == MY_CXT.stats_sv) {
+        MY_CXT.stats_pending = 0;
+        drop_stats_input(&MY_CXT);
+    }
+
+    return 0;
+}
+
+static MGVTBL stats_magic_vtbl = { stats_magic_get, stats_magic_set };
+
+static int
+has_stats_magic(SV * sv) {
+    MAGIC * mg;
+
+    UNLESS (SvMAGICAL(sv)) {
+        return 0;
+    }
+
+    for (mg = SvMAGIC(sv); mg; mg = mg->mg_moremagic) {
+        if (mg->mg_type == PERL_MAGIC_ext && mg->mg_virtual == &stats_magic_vtbl) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+#endif
+
+/* input_sv is what was parsed, if it came from an SV (otherwise
+   Nullsv), in which case the ctx must have been set up with
+   JSON_EVT_OPTION_LAZY_TEXT_STATS. */
+static void
+set_stats(jsonevt_ctx * ctx, SV * input_sv) {
+    dMY_CXT;
+    parse_stats * st = &MY_CXT.stats;
+    SV * sv = GvSVn(MY_CXT.last_stats_gv);
+
+    st->strings = jsonevt_get_stats_string_count(ctx);
+    st->max_string_bytes = jsonevt_get_stats_longest_string_bytes(ctx);
+    st->max_string_chars = jsonevt_get_stats_longest_string_chars(ctx);
+    st->numbers = jsonevt_get_stats_number_count(ctx);
+    st->bools = jsonevt_get_stats_bool_count(ctx);
+    st->nulls = jsonevt_get_stats_null_count(ctx);
+    st->hashes = jsonevt_get_stats_hash_count(ctx);
+    st->arrays = jsonevt_get_stats_array_count(ctx);
+    st->max_depth = jsonevt_get_stats_deepest_level(ctx);
+
+    st->bytes = jsonevt_get_stats_byte_count(ctx);
+
+    drop_stats_input(&MY_CXT);
+
+#ifdef IS_PERL_5_8
+    /* the lines and chars are counted from a copy of the input if it
+       is a plain string -- otherwise they need the buffer the ctx
+       has, so they can't wait */
+    if (input_sv && SvPOK(input_sv) && ! SvGMAGICAL(input_sv)) {
+        MY_CXT.stats_input = newSVsv(input_sv);
+        MY_CXT.stats_input_end = st->bytes;
+    }
+    else {
+        st->lines = jsonevt_get_stats_line_count(ctx);
+        st->chars = jsonevt_get_stats_char_count(ctx);
+    }
+
+    UNLESS (has_stats_magic(sv)) {
+        sv_magicext(sv, NULL, PERL_MAGIC_ext, &stats_magic_vtbl, NULL, 0);
+    }
+
+    MY_CXT.stats_sv = sv;
+    MY_CXT.stats_pending = 1;
+#else
+    st->lines = jsonevt_get_stats_line_count(ctx);
+    st->chars = jsonevt_get_stats_char_count(ctx);
+
+    store_stats_hash(sv, st, Nullsv, 0);
+#endif
+}
+
+static void
+clear_stats(void) {
+    dMY_CXT;
+
+    MY_CXT.stats_pending = 0;
+    drop_stats_input(&MY_CXT);
+    sv_setsv(GvSVn(MY_CXT.last_stats_gv), &PL_sv_undef);
+}
+
+static void
+clear_error(void) {
+    dMY_CXT;
+    SV * sv;
+
+    sv = GvSVn(MY_CXT.last_error_data_gv);
+    if (SvOK(sv)) {
+        sv_setsv(sv, &PL_sv_undef);
+    }
+
+    sv = GvSVn(MY_CXT.last_error_gv);
+    if (SvOK(sv)) {
+        sv_setsv(sv, &PL_sv_undef);
+    }
+}
+
+/* If one_off is true, ctx and wctx are freed -- otherwise they belong
+   to a json_decoder and are kept for the next parse.  input_sv is
+   passed on to set_stats(). */
+static SV *
+handle_parse_result(int result, jsonevt_ctx * ctx, perl_wrapper_ctx * wctx, int one_off,
+    SV * input_sv) {
     char * error = Nullch;
     SV * rv = Nullsv;
     HV * error_hash = Nullhv;
@@ -914,10 +1484,10 @@ handle_parse_result(int result, jsonevt_ctx * ctx, perl_wrapper_ctx * wctx) {
     SV * tmp_sv = Nullsv;
     SV * error_msg = Nullsv;
     SV * error_data_ref = Nullsv;
-    SV * stats_ref = Nullsv;
-    HV * stats = Nullhv;
     
     UNLESS (result) {
+        dMY_CXT;
+
         SETUP_TRACE;
     
         error = jsonevt_get_error(ctx);
@@ -947,15 +1517,13 @@ handle_parse_result(int result, jsonevt_ctx * ctx, perl_wrapper_ctx * wctx) {
         IGNORE_RV(hv_store(error_hash, "col", 3, newSVuv(jsonevt_get_error_char_col(ctx)), 0));
         IGNORE_RV(hv_store(error_hash, "byte_col", 8, newSVuv(jsonevt_get_error_byte_col(ctx)), 0));
 
-        tmp_sv = get_sv("JSON::DWIW::LastErrorData", 1);
-        sv_setsv(tmp_sv, error_data_ref);
+        sv_setsv(GvSVn(MY_CXT.last_error_data_gv), error_data_ref);
         SvREFCNT_dec(error_data_ref);
 
-        tmp_sv = get_sv("JSON::DWIW::LastError", 1);
-        sv_setsv(tmp_sv, error_msg); /* ref count decremented below after exceptions check */
+        /* ref count decremented below after exceptions check */
+        sv_setsv(GvSVn(MY_CXT.last_error_gv), error_msg);
 
-        tmp_sv = get_sv("JSON::DWIW::Last_Stats", 1);
-        sv_setsv(tmp_sv, &PL_sv_undef);
+        clear_stats();
 
         if (wctx->cbd.stack[0].data) {
             SvREFCNT_dec(wctx->cbd.stack[0].data);
@@ -966,58 +1534,19 @@ handle_parse_result(int result, jsonevt_ctx * ctx, perl_wrapper_ctx * wctx) {
     else {
         SETUP_TRACE;
         rv = wctx->cbd.stack[0].data;
-        stats = newHV();
-
-        IGNORE_RV(hv_store(stats, "strings", 7,
-                newSVuv(jsonevt_get_stats_string_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "max_string_bytes", 16,
-                newSVuv(jsonevt_get_stats_longest_string_bytes(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "max_string_chars", 16,
-                newSVuv(jsonevt_get_stats_longest_string_chars(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "numbers", 7,
-                newSVuv(jsonevt_get_stats_number_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "bools", 5, newSVuv(jsonevt_get_stats_bool_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "nulls", 5, newSVuv(jsonevt_get_stats_null_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "hashes", 6, newSVuv(jsonevt_get_stats_hash_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "arrays", 6, newSVuv(jsonevt_get_stats_array_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "max_depth", 9,
-                newSVuv(jsonevt_get_stats_deepest_level(ctx)), 0));
-        
-        IGNORE_RV(hv_store(stats, "lines", 5, newSVuv(jsonevt_get_stats_line_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "bytes", 5, newSVuv(jsonevt_get_stats_byte_count(ctx)), 0));
-        IGNORE_RV(hv_store(stats, "chars", 5, newSVuv(jsonevt_get_stats_char_count(ctx)), 0));
-        
-        tmp_sv = get_sv("JSON::DWIW::Last_Stats", 1);
-        stats_ref = newRV_noinc((SV *)stats);
-        sv_setsv(tmp_sv, stats_ref);
-        SvREFCNT_dec(stats_ref);
-        
-        tmp_sv = get_sv("JSON::DWIW::LastErrorData", 1);
-        sv_setsv(tmp_sv, &PL_sv_undef);
 
-        tmp_sv = get_sv("JSON::DWIW::LastError", 1);
-        sv_setsv(tmp_sv, &PL_sv_undef);
+        set_stats(ctx, input_sv);
+        clear_error();
     }
 
-    /* fix memory leak -- the stack was allocated in init_cbs() */
-    JSONEVT_FREE_MEM(wctx->cbd.stack); wctx->cbd.stack = NULL;
-    if (wctx->cbd.parse_number_cb) {
-        SvREFCNT_dec(wctx->cbd.parse_number_cb);
-    }
-
-    if (wctx->cbd.parse_const_cb) {
-        SvREFCNT_dec(wctx->cbd.parse_const_cb);
-    }
+    if (one_off) {
+        /* fix memory leak -- the stack was allocated in init_cbs() */
+        free_cb_data(&wctx->cbd);
 
-    if (wctx->cbd.start_depth_handler) {
-        SvREFCNT_dec(wctx->cbd.start_depth_handler);
+        LOG_DEBUG("freeing ctx %#08"UVxf, PTR2UV(ctx));
+        jsonevt_free_ctx(ctx);
     }
 
-    /* change to json_reset_ctx(ctx) once we start reusing the ctx from libjsonevt */
-    /* jsonevt_reset_ctx(ctx); */
-    LOG_DEBUG("freeing ctx %#08"UVxf, PTR2UV(ctx));
-    jsonevt_free_ctx(ctx);
-
     if (throw_exception) {
         tmp_sv = get_sv("@", TRUE);
         sv_setsv(tmp_sv, error_msg);
@@ -1049,8 +1578,9 @@ handle_parse_result(int result, jsonevt_ctx * ctx, perl_wrapper_ctx * wctx) {
     return &PL_sv_undef;
 }
 
-SV *
-do_json_parse_buf(SV * self_sv, char * buf, STRLEN buf_len) {
+/* input_sv is the SV buf came from, if there is one */
+static SV *
+parse_buf(SV * self_sv, char * buf, STRLEN buf_len, SV * input_sv) {
     jsonevt_ctx * ctx;
     perl_wrapper_ctx wctx;
 
@@ -1059,7 +1589,12 @@ do_json_parse_buf(SV * self_sv, char * buf, STRLEN buf_len) {
     memzero(&wctx, sizeof(perl_wrapper_ctx));
     ctx = init_cbs(&wctx, self_sv);
 
-    return handle_parse_result(jsonevt_parse(ctx, buf, buf_len), ctx, &wctx);
+    return handle_parse_result(jsonevt_parse(ctx, buf, buf_len), ctx, &wctx, 1, input_sv);
+}
+
+SV *
+do_json_parse_buf(SV * self_sv, char * buf, STRLEN buf_len) {
+    return parse_buf(self_sv, buf, buf_len, Nullsv);
 }
 
 SV *
@@ -1071,7 +1606,7 @@ do_json_parse(SV * self_sv, SV * json_str_sv) {
 
     buf = SvPV(json_str_sv, buf_len);
     
-    return do_json_parse_buf(self_sv, buf, buf_len);
+    return parse_buf(self_sv, buf, buf_len, json_str_sv);
 }
 
 SV *
@@ -1088,7 +1623,158 @@ do_json_parse_file(SV * self_sv, SV * file_sv) {
     memzero(&wctx, sizeof(perl_wrapper_ctx));
     ctx = init_cbs(&wctx, self_sv);
 
-    return handle_parse_result(jsonevt_parse_file(ctx, filename), ctx, &wctx);
+    return handle_parse_result(jsonevt_parse_file(ctx, filename), ctx, &wctx, 1, Nullsv);
+}
+
+#define DEFAULT_READ_SIZE 65536
+
+static STRLEN
+get_read_size(SV * self_sv) {
+    SV ** ptr;
+    HV * self_hash;
+    IV size;
+
+    UNLESS (self_sv) {
+        return DEFAULT_READ_SIZE;
+    }
+
+    self_hash = SvROK(self_sv) ? (HV *)SvRV(self_sv) : (HV *)self_sv;
+    if (SvTYPE(self_hash) != SVt_PVHV) {
+        return DEFAULT_READ_SIZE;
+    }
+
+    ptr = hv_fetch(self_hash, "read_size", 9, 0);
+    if (ptr && SvOK(*ptr)) {
+        size = SvIV(*ptr);
+        if (size > 0) {
+            return (STRLEN)size;
+        }
+    }
+
+    return DEFAULT_READ_SIZE;
+}
+
+SV *
+do_json_parse_fh(SV * self_sv, SV * fh_sv) {
+    jsonevt_ctx * ctx;
+    perl_wrapper_ctx wctx;
+    PerlIO * fp;
+    char * read_buf = NULL;
+    STRLEN read_size;
+    SSize_t amt_read = 0;
+    int rv;
+
+    SETUP_TRACE;
+
+    fp = IoIFP(sv_2io(fh_sv));
+    UNLESS (fp) {
+        croak("%s v%s - filehandle is not open for reading", MOD_NAME, XS_VERSION);
+    }
+
+    /* mortal, so that it is still freed if a callback dies */
+    read_size = get_read_size(self_sv);
+    read_buf = SvPVX(sv_2mortal(newSV(read_size)));
+
+    memzero(&wctx, sizeof(perl_wrapper_ctx));
+    ctx = init_cbs(&wctx, self_sv);
+
+    rv = jsonevt_parse_begin(ctx);
+    while (rv && (amt_read = PerlIO_read(fp, read_buf, read_size)) > 0) {
+        rv = jsonevt_parse_chunk(ctx, read_buf, (uint)amt_read);
+    }
+
+    if (rv && (amt_read < 0 || PerlIO_error(fp))) {
+        jsonevt_parse_fail(ctx, form("error reading input: %s", Strerror(errno)));
+    }
+
+    rv = jsonevt_parse_end(ctx);
+
+    return handle_parse_result(rv, ctx, &wctx, 1, Nullsv);
 }
 
+/*
+  A decoder keeps its ctx (with the callbacks set), its stack, and the
+  options from setup_options() for as many parses as it is used for,
+  instead of setting them all up and tearing them down each time.
+*/
+struct json_decoder_struct {
+    jsonevt_ctx * ctx;
+    perl_wrapper_ctx wctx;
+    int busy;
+};
+
+json_decoder *
+do_json_new_decoder(SV * options_sv) {
+    json_decoder * dec;
+
+    JSONEVT_NEW(dec, 1, json_decoder);
+    memzero(dec, sizeof(*dec));
+
+    dec->ctx = jsonevt_new_ctx();
+    set_parse_callbacks(dec->ctx);
+    jsonevt_set_options(dec->ctx, JSON_EVT_OPTION_LAZY_TEXT_STATS);
+
+    init_cb_data(&dec->wctx.cbd, dec->ctx);
+    jsonevt_set_cb_data(dec->ctx, &dec->wctx.cbd);
+
+    if (options_sv && SvOK(options_sv)) {
+        setup_options(dec->ctx, &dec->wctx.cbd, options_sv);
+    }
+
+    return dec;
+}
+
+void
+do_json_free_decoder(json_decoder * dec) {
+    free_cb_data(&dec->wctx.cbd);
+    jsonevt_free_ctx(dec->ctx);
+    JSONEVT_FREE_MEM(dec);
+}
+
+static SV *
+decoder_parse(json_decoder * dec, char * buf, STRLEN buf_len, char * filename, SV * input_sv) {
+    int rv;
+
+    /* a callback (e.g., parse_number) could try to use the same decoder */
+    if (dec->busy) {
+        croak("%s v%s - decoder is already parsing", MOD_NAME, XS_VERSION);
+    }
+
+    /* busy is put back even if a callback dies */
+    ENTER;
+    SAVEINT(dec->busy);
+    dec->busy = 1;
 
+    reset_cb_data(&dec->wctx.cbd);
+
+    if (filename) {
+        rv = jsonevt_parse_file(dec->ctx, filename);
+    }
+    else {
+        rv = jsonevt_parse(dec->ctx, buf, buf_len);
+    }
+
+    LEAVE;
+
+    return handle_parse_result(rv, dec->ctx, &dec->wctx, 0, input_sv);
+}
+
+SV *
+do_json_decoder_parse(json_decoder * dec, SV * json_str_sv) {
+    char * buf;
+    STRLEN buf_len;
+
+    buf = SvPV(json_str_sv, buf_len);
+
+    return decoder_parse(dec, buf, buf_len, NULL, json_str_sv);
+}
+
+SV *
+do_json_decoder_parse_file(json_decoder * dec, SV * file_sv) {
+    char * filename;
+    STRLEN filename_len;
+
+    filename = SvPV(file_sv, filename_len);
+
+    return decoder_parse(dec, NULL, 0, filename, Nullsv);
+}
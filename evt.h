@@ -24,7 +24,18 @@ do_json_parse_buf(SV * self_sv, char * buf, STRLEN buf_len);
 
 SV * do_json_parse(SV * self_sv, SV * json_str_sv);
 SV * do_json_parse_file(SV * self_sv, SV * file_sv);
+SV * do_json_parse_fh(SV * self_sv, SV * fh_sv);
 SV * do_json_dummy_parse(SV *self_sv, SV * json_str_sv);
 
+void do_json_init_globals(void);
+void do_json_clone_globals(void);
+
+typedef struct json_decoder_struct json_decoder;
+
+json_decoder * do_json_new_decoder(SV * options_sv);
+void do_json_free_decoder(json_decoder * dec);
+SV * do_json_decoder_parse(json_decoder * dec, SV * json_str_sv);
+SV * do_json_decoder_parse_file(json_decoder * dec, SV * file_sv);
+
 #endif
 
@@ -102,6 +102,11 @@ Scalars that have been used as both a string and a number will be
 output as a string.  A reference to a reference is currently
 output as an empty string, but this may change.
 
+Floating point numbers are output with the fewest digits that
+convert back to the same value, instead of Perl's 15 significant
+digits, e.g., 0.1 + 0.2 is output as 0.30000000000000004, not 0.3.
+Infinity and NaN are output the way Perl stringifies them.
+
 You may notice there is a deserialize function, but not a
 serialize one.  The deserialize function was written as a full
 rewrite (the parsing is in a separate, event-based library now)
@@ -308,6 +313,20 @@ becomes an object that evaluates to false in a boolean context.
 These objects are recognized by the to_json() method, so they
 will be output as "true" or "false" instead of "1" or "0".
 
+All of the true values share one object, as do all of the false
+values, so the objects are read-only.
+
+=head3 I<convert_blessed>
+
+When converting to JSON, an object whose class has a C<TO_JSON>
+method is output as whatever that method returns (called in scalar
+context, with the object as its only argument), instead of as the
+hash or array it is built on.  The method is looked up once for
+each class in a call to to_json().  If the method dies, or returns
+the same object it was called on, it is an error.
+L<JSON::DWIW::Boolean>, L<Math::BigInt>, and L<Math::BigFloat>
+objects are still output as booleans and numbers.
+
 =head3 I<bare_solidus>
 
 Don't escape solidus characters ("/") in strings.  The output is
@@ -321,7 +340,18 @@ optioned turned on (but the output will still be valid JSON).
 
 =head3 I<sort_keys>
 
-Set to a true value to sort hash keys (alphabetically) when converting to JSON.
+Set to a true value to sort hash keys when converting to JSON.  Keys
+are sorted by character (code point), the same as Perl's C<sort> without
+C<use locale>, so the output is the same from run to run for the same data.
+
+=head3 I<cache_keys>
+
+If set to a true value, the JSON for each hash key (quoted and
+escaped) is remembered after it is first output, and copied from
+there the next time the same key is seen, in this call or a later
+one.  This helps when the same key names are output over and over.
+Up to 1024 keys of up to 48 bytes are kept for each interpreter
+(thread), and the output is the same as without this option.
 
 =head3 I<parse_number>
 
@@ -357,7 +387,8 @@ parser does not return the entire data structure.  Instead, it
 calls I<start_depth_handler> for each element in the array when
 the parser is at level I<start_depth>.  This is useful for
 parsing a very large array without loading all the data into
-memory (especially when using C<deserialize_file>).
+memory (especially when using C<deserialize_file> or
+C<deserialize_fh>).
 
 E.g., with I<start_depth> set to 1 and I<start_depth_handler> set to C<$handler>:
 
@@ -392,6 +423,31 @@ E.g., with I<start_depth> set to 1 and I<start_depth_handler> set to C<$handler>
 
     $leftover_data = [];
 
+=head3 I<structural_index>
+
+If set to a true value, the parser first makes a quick pass over
+the JSON to find where each token begins, and where each string,
+array, and hash ends.  The parser can then skip over the bodies
+of strings without escapes, and the whitespace and punctuation
+between the values in arrays and hashes, instead of looking at
+them one character at a time, which is faster for large input.
+The number
+of elements in each array and hash is also counted, so they can be
+allocated at their full size up front instead of being grown as
+they are filled in.  The result is the same as without this option.  If the JSON contains
+comments, or non-ASCII characters outside of strings, this option
+is ignored.
+
+=head3 I<read_size>
+
+The number of bytes C<deserialize_fh()> reads from the filehandle
+at a time.  The default is 65536.
+
+=head3 I<write_size>
+
+The number of bytes C<to_json_fh()> and C<to_json_file()> collect
+before writing them out.  The default is 65536.
+
 =cut
 
 sub new {
@@ -407,9 +463,10 @@ sub new {
     }
 
     foreach my $field (qw/bare_keys use_exceptions bad_char_policy dump_vars pretty
-                          escape_multi_byte convert_bool detect_circular_refs
+                          escape_multi_byte convert_bool convert_blessed detect_circular_refs
                           ascii bare_solidus minimal_escaping
-                          parse_number parse_constant sort_keys start_depth start_depth_handler/) {
+                          parse_number parse_constant sort_keys cache_keys start_depth start_depth_handler
+                          structural_index read_size write_size/) {
         if (exists($params->{$field})) {
             $self->{$field} = $params->{$field};
         }
@@ -549,12 +606,28 @@ data structure resulting from the conversion.  If the return
 value is undef, check the result of the C<get_error_string()>
 function/method to see if an error is defined.
 
+To decode a lot of small documents with the same options, see
+L<JSON::DWIW::Decoder>, which sets up the parser once and reuses it.
+
 =head2 C<deserialize_file($file, \%options)>
 
 Same as deserialize, except that it takes a file as an argument.
 On Unix, this mmap's the file, so it does not load a big file
 into memory all at once, and does less buffer copying.
 
+=head2 C<deserialize_fh($fh, \%options)>
+
+Same as deserialize, except that it reads the JSON from the given
+filehandle (e.g., a socket) until end of file.  The input is parsed
+as it is read, a piece at a time, at any depth, so with I<start_depth>
+and I<start_depth_handler> set, each element of a large array can be
+handled as soon as it has been read -- including one nested inside
+another value, as in C<{"data":[ ... ]}> with a I<start_depth> of 2
+-- and only about one element is kept in memory at a time.  An error
+reading from the filehandle is reported like a parse error.
+
+Aliases: load_fh
+
 =cut
 
 =pod
@@ -692,8 +765,9 @@ sub from_json_file {
 =head2 C<to_json_file>
 
 Converts C<$data> to JSON and writes the result to the file C<$file>.
-Currently, this is simply a convenience routine that converts
-the data to a JSON string and then writes it to the file.
+The JSON is written to the file as it is generated (see
+C<to_json_fh()>), so the whole string is never in memory at once.
+If there is an error, the file is left empty.
 
  my ($ok, $error) = $json->to_json_file($data, $file, \%options);
 
@@ -737,14 +811,91 @@ sub to_json_file {
         }
     }
 
-    if ($] >= 5.008) {
-        binmode($out_fh, 'utf8');
+    # the output is already utf-8
+    binmode($out_fh);
+
+    my $ok = $self->_to_json_fh($data, $out_fh);
+    my $error_msg = $self->{last_error};
+
+    unless (close($out_fh)) {
+        $ok = undef;
+        $error_msg = "JSON::DWIW v$VERSION - couldn't write output file $file: $!"
+            unless defined($error_msg);
+    }
+
+    unless ($ok) {
+        truncate($file, 0);
+
+        die $error_msg if $self->{use_exceptions};
+
+        return wantarray ? (undef, $error_msg) : undef;
     }
 
+    return wantarray ? (1, $error_msg) : 1;
+}
+
+=pod
+
+=head2 C<to_json_fh>
+
+Converts C<$data> to JSON and writes it to the filehandle C<$fh> as
+it is generated, a piece of I<write_size> bytes at a time, so memory
+use doesn't grow with the size of the output.  The JSON is written
+as UTF-8 bytes, so C<$fh> should not have an encoding layer (such as
+C<:utf8>) on it.  If there is an error, whatever was written before
+the error was found stays written.
+
+ my ($ok, $error) = $json->to_json_fh($data, $fh, \%options);
+
+=cut
+sub to_json_fh {
+    my $proto = shift;
+    my $fh;
+    my $data;
+    my $self;
+        
+    if (UNIVERSAL::isa($proto, 'JSON::DWIW')) {
+        $data = shift;
+        $fh = shift;
+        my $options = shift;
+        if ($options) {
+            if (ref($proto) and $proto->isa('HASH')) {
+                if (UNIVERSAL::isa($options, 'HASH')) {
+                    $options = { %$proto, %$options };
+                }
+            }
+
+            $self = $proto->new($options, @_);
+        }
+        else {
+            $self = ref($proto) ? $proto : $proto->new(@_);
+        }
+    }
+    else {
+        $data = $proto;
+        $fh = shift;
+        $self = JSON::DWIW->new(@_);
+    }
+
+    my $ok = $self->_to_json_fh($data, $fh);
+    my $error_msg = $self->{last_error};
+
+    if (defined($error_msg) and $self->{use_exceptions}) {
+        die $error_msg;
+    }
+
+    return wantarray ? ($ok, $error_msg) : $ok;
+}
+
+sub _to_json_fh {
+    my $self = shift;
+    my $data = shift;
+    my $fh = shift;
+
     my $error_msg;
     my $error_data;
     my $stats_data = { };
-    my $str = _xs_to_json($self, $data, \$error_msg, \$error_data, $stats_data);
+    my $ok = _xs_to_json_fh($self, $data, $fh, \$error_msg, \$error_data, $stats_data);
 
     if ($stats_data) {
         $JSON::DWIW::Last_Stats = $stats_data;
@@ -757,19 +908,7 @@ sub to_json_file {
     $JSON::DWIW::LastErrorData = $error_data;
     $self->{last_error_data} = $error_data;
 
-
-    if (defined($error_msg) and $self->{use_exceptions}) {
-        die $error_msg;
-    }
-
-    if ($error_msg) {
-        return wantarray ? (undef, $error_msg) : undef;
-    }
-
-    print $out_fh $str;
-    close $out_fh;
-
-    return wantarray ? (1, $error_msg) : 1;
+    return $ok;
 }
 
 sub parse_mmap_file {
@@ -7,6 +7,76 @@ JSON::DWIW::Changes - List of significant changes to JSON::DWIW
 
 =head1 CHANGES
 
+=head2 VERSION 0.48
+
+=over 4
+
+=item Fixed bad_char_policy => 'convert' garbling the rest of a string after a converted char
+
+=item A surrogate pair written as two \u escapes (e.g., C<"\ud834\udd1e">) is now decoded as the one character it stands for, instead of as the two halves
+
+=item Added the I<structural_index> option for faster parsing of large JSON.  The quick pass marks where each token starts, so strings without escapes are skipped over, and arrays and hashes go from one token to the next instead of a character at a time.
+
+=item Added C<deserialize_fh()> and the I<read_size> option, and an incremental parsing API to libjsonevt (C<jsonevt_parse_begin()>, C<jsonevt_parse_chunk()>, C<jsonevt_parse_end()>).  The input is parsed a token at a time as it comes in, at any depth, and discarded once parsed.
+
+=item The parser no longer keeps track of line and column numbers as it goes -- they are worked out from the input when an error is reported or the stats are requested.  The C<lines> and C<chars> stats are counted from a copy of the input the first time one of them is read, so parses that never look at them don't pay for it.  libjsonevt has a new C<JSON_EVT_OPTION_LAZY_TEXT_STATS> option for this.
+
+=item Numbers are converted to integers or doubles by the parser as they are read, instead of being converted from their text afterwards.  libjsonevt has a new typed number callback (C<jsonevt_set_typed_number_cb()>) that gets the converted value.
+
+=item Added F<libjsonevt/c++/jsonevt_sax.h>, a header-only C++17 version of the parser that calls the methods of a handler class given as a template parameter, instead of going through function pointers
+
+=item Added C<jsonevt_doc_parse()> and friends to libjsonevt, which parse a document into a flat tape of nodes (with all the strings in one arena) that can be walked, indexed, and searched by key afterwards
+
+=item Added a pull-style cursor to libjsonevt (C<jsonevt_cursor_next()>, C<jsonevt_cursor_skip()>, etc.).  Values that aren't wanted can be skipped, with arrays and hashes stepped over by matching brackets and quotes rather than being parsed.
+
+=item Added C<jsonevt_ndjson_parse_file()> and friends to libjsonevt, for parsing newline-delimited JSON on a pool of threads, each with its own context.  Records can be delivered in line order or as they are parsed, and a bad line is reported without stopping the parse.  libjsonevt needs pthreads for this, except on Windows, where the lines are parsed on the calling thread.  The module doesn't use it, so it isn't linked with pthreads.
+
+=item Added C<jsonevt_ndjson_parse_array()> and C<jsonevt_ndjson_parse_array_file()> to libjsonevt, which parse the elements of one big top-level array on the same pool of threads, after a quick scan of the brackets and quotes to split it up.  The elements can be delivered as records (in order, with their index) or merged back into a single C<jsonevt_doc>.
+
+=item Added L<JSON::DWIW::Decoder>, which sets up the parser context, callbacks, stack, and options once, and reuses them for each document it decodes
+
+=item The hash in C<$JSON::DWIW::Last_Stats> is no longer built after every parse -- the counts are kept, and the hash is made when the variable is first read (e.g., by C<get_stats()>).  The error and stats globals are looked up once, when the module is loaded.
+
+=item The I<structural_index> pass now counts the elements of each array and hash, and C<deserialize()> uses the counts to allocate them at their full size.  libjsonevt has a new C<jsonevt_get_size_hint()> for use in the begin_array and begin_hash callbacks.
+
+=item Hash keys are stored straight from the parser's buffer instead of being made into a scalar first, and are only flagged as UTF-8 if they have non-ASCII characters
+
+=item With I<convert_bool>, the true and false objects are made once and shared (read-only) by every value, instead of calling C<JSON::DWIW::Boolean-E<gt>true()> or C<false()> for each one
+
+=item to_json() writes everything into one output buffer that grows by doubling, instead of building a new string for each array, hash, and value and appending it to its parent's
+
+=item Fixed double UTF-8 encoding of hash keys with I<sort_keys> when the key had been stored downgraded to Latin-1 (e.g., a key from a decoded JSON string)
+
+=item If there is an error encoding, to_json() now returns undef, even when the top-level value is a string
+
+=item String escaping in to_json() and the C writer in libjsonevt share one scanner (SSE2/AVX2 when available) that finds the next character needing a closer look, and everything before it is copied in one piece
+
+=item to_json() no longer checks that strings Perl has flagged as UTF-8 are valid UTF-8 (unless escape_multi_byte is on), since Perl has already done that
+
+=item The C writer no longer treats a multi-byte character at the very end of a string as Latin-1, and no longer mallocs a buffer for each C<\u> escape
+
+=item to_json() writes floating point numbers with the fewest digits that convert back to the same value (Grisu3, with an exact fallback), instead of Perl's 15 significant digits, and writes integers without going through sprintf().  Negative zero now comes out as -0
+
+=item The C writer's jsonevt_new_float(), jsonevt_new_int(), jsonevt_new_uint(), and jsonevt_new_bool() values can now be added to arrays and hashes with jsonevt_array_add_data() and jsonevt_hash_add_data() -- they used to come out empty
+
+=item to_json_file() writes the output to the file whenever the buffer fills up (see the new I<write_size> option), instead of building the whole string in memory and encoding it to UTF-8 again before printing it.  If there is an error, the file is left empty.
+
+=item Added to_json_fh(), which does the same for a filehandle that is already open
+
+=item With I<detect_circular_refs>, the arrays and hashes already output are kept in a set of pointers instead of a Perl hash keyed on their stringified addresses, so it no longer allocates for each one.  Only arrays and hashes are tracked now, so the same boolean (e.g., from I<convert_bool>), Math::BigInt, or scalar reference appearing twice is no longer output as a "circular ref".
+
+=item With I<sort_keys>, the entries of a hash are sorted by key in place, and the values taken from them, instead of copying each key to a new scalar, sorting those with sv_cmp(), and looking each one up again
+
+=item Added the I<cache_keys> option, which keeps the JSON for hash keys after they are first output, so the same keys don't have to be checked and escaped again, in the same call or a later one
+
+=item When an array has hashes with the same keys one after another (e.g., rows from a database), the JSON for the keys is made once, from the first of them, and only the values are output for the rest.  Without I<sort_keys>, each of these hashes now has its keys in the same order as the first one.
+
+=item Added the I<convert_blessed> option, which outputs an object whose class has a C<TO_JSON> method as whatever the method returns
+
+=item How each class of object is output is worked out once per call to to_json(), so objects of a class already seen aren't checked against JSON::DWIW::Boolean, Math::BigInt, and Math::BigFloat again.  JSON::DWIW::Boolean objects are output without calling their overloaded bool method.
+
+=back
+
 =head2 VERSION 0.47
 
 =over 4
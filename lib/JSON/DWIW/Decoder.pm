@@ -0,0 +1,143 @@
+# Creation date: 2026-10-17 22:41:09
+# Authors: don
+#
+# Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+#
+# This is free software; you can redistribute it and/or modify it under
+# the Perl Artistic license.  You should have received a copy of the
+# Artistic license with this distribution, in the file named
+# "Artistic".  You may also obtain a copy from
+# http://regexguy.com/license/Artistic
+#
+# This program is distributed in the hope that it will be
+# useful, but WITHOUT ANY WARRANTY; without even the implied
+# warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+# PURPOSE.
+
+=pod
+
+=head1 NAME
+
+JSON::DWIW::Decoder - A reusable JSON decoder
+
+=head1 SYNOPSIS
+
+ use JSON::DWIW::Decoder;
+ my $decoder = JSON::DWIW::Decoder->new({ convert_bool => 1 });
+
+ foreach my $json_str (@messages) {
+     my $data = $decoder->decode($json_str);
+     ...
+ }
+
+=head1 DESCRIPTION
+
+C<JSON::DWIW::deserialize()> sets up a parser context, registers
+its callbacks, allocates a stack, and looks up each of the options
+in the options hash every time it is called, then throws it all
+away.  For small documents, that can take longer than the parse
+itself.  A decoder object does all of that once, when it is
+created, and keeps it for as many documents as it is used to
+decode.
+
+The result of C<decode()> is the same as for C<deserialize()> with
+the same options, and C<$JSON::DWIW::LastError>,
+C<$JSON::DWIW::LastErrorData>, and C<$JSON::DWIW::Last_Stats> are
+set the same way.
+
+The options are read when the decoder is created, so changing the
+hash afterward has no effect on the decoder.
+
+A decoder is not shared by threads created with L<threads> -- the
+copy in the new thread is not usable.
+
+=cut
+
+use strict;
+use warnings;
+
+use 5.006_00;
+
+package JSON::DWIW::Decoder;
+
+use JSON::DWIW ();
+
+our $VERSION = '0.01';
+
+=pod
+
+=head1 METHODS
+
+=head2 C<new(\%options)>
+
+Returns a new decoder.  C<%options> are the same as the parsing
+options for C<JSON::DWIW::deserialize()> (I<convert_bool>,
+I<use_exceptions>, I<bad_char_policy>, I<parse_number>,
+I<parse_constant>, I<start_depth>, I<start_depth_handler>, and
+I<structural_index>).  A L<JSON::DWIW> object may be passed instead
+of a hash.
+
+=cut
+
+sub new {
+    my $proto = shift;
+    my $options = shift;
+
+    unless (defined($options) and UNIVERSAL::isa($options, 'HASH')) {
+        $options = undef;
+    }
+
+    return _new(ref($proto) || $proto, $options);
+}
+
+=pod
+
+=head2 C<decode($json_str)>
+
+Returns the Perl data structure for the given JSON string, like
+C<JSON::DWIW::deserialize()>.  A decoder can't be used again from
+inside one of its own callbacks (e.g., I<parse_number>) -- that
+dies.
+
+=head2 C<decode_file($file)>
+
+Same as C<decode()>, except that it takes a file as an argument.
+
+=cut
+
+# decode() and decode_file() are in DWIW.xs
+
+sub CLONE_SKIP {
+    return 1;
+}
+
+=pod
+
+=head1 AUTHOR
+
+Don Owens <don@regexguy.com>
+
+=head1 LICENSE AND COPYRIGHT
+
+Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+This is free software; you can redistribute it and/or modify it
+under the same terms as Perl itself.  See perlartistic.
+
+This program is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.
+
+=cut
+
+1;
+
+# Local Variables: #
+# mode: perl #
+# tab-width: 4 #
+# indent-tabs-mode: nil #
+# cperl-indent-level: 4 #
+# perl-indent-level: 4 #
+# End: #
+# vim:set ai si et sta ts=4 sw=4 sts=4:
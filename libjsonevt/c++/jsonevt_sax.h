@@ -0,0 +1,968 @@
+/* Creation date: 2026-10-17T23:41:12Z
+ * Authors: Don
+ */
+
+/*
+  Header-only C++17 version of the libjsonevt parser, where the
+  callbacks are the methods of a handler class given as a template
+  parameter instead of function pointers in a jsonevt_ctx.  The calls
+  can then be inlined into the parser, and the parser is specialized
+  for each handler.
+
+      struct counter {
+          uint strings = 0;
+          int on_string(std::string_view str, uint flags, uint level) {
+              strings++;
+              return 0;
+          }
+      };
+
+      counter c;
+      jsonevt::parse_error err;
+      if (! jsonevt::parse(json, c, &err)) {
+          std::cerr << err.message << std::endl;
+      }
+
+  The input is UTF-8 and the syntax accepted is the same as for
+  jsonevt_parse(): comments, single-quoted strings, bare hash keys,
+  and extra commas are all allowed.  It is a bit stricter about
+  truncated input, e.g., "[tru]" or a hash missing its closing brace
+  at the end of the input are errors here.  The handler only needs the
+  methods for the events it cares about.  Each gets the same flags and
+  level as the corresponding C callback, and may return either void or
+  an int, in which case a non-zero value stops the parse (as with the
+  C callbacks):
+
+      on_string(std::string_view str, uint flags, uint level)
+      on_number(std::string_view text, uint flags, uint level)
+      on_number(std::string_view text, const jsonevt_number & num, uint flags, uint level)
+      on_bool(bool val, uint flags, uint level)
+      on_null(uint flags, uint level)
+      on_begin_array(uint flags, uint level)
+      on_end_array(uint flags, uint level)
+      on_begin_array_element(uint flags, uint level)
+      on_end_array_element(uint flags, uint level)
+      on_begin_hash(uint flags, uint level)
+      on_end_hash(uint flags, uint level)
+      on_begin_hash_entry(uint flags, uint level)
+      on_end_hash_entry(uint flags, uint level)
+      on_comment(std::string_view text, uint flags, uint level)
+
+  If the handler has the second form of on_number(), the value of each
+  number is worked out while it is scanned, as for the typed number
+  callback, and the first form is not used.
+
+  Strings without escapes are slices of the input.  Strings that had
+  to be unescaped are in a buffer that is reused, so the data is only
+  valid until the callback returns.
+
+  The scanning and number conversion routines from libjsonevt are
+  used, so the program still needs to link with it.  Their headers
+  are not installed, so neither is this one: build against the source
+  tree, with the libjsonevt directory in the include path.
+*/
+
+#ifndef JSONEVT_SAX_H
+#define JSONEVT_SAX_H
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#error "jsonevt_sax.h requires C++17"
+#endif
+
+#include <jsonevt.h>
+#include <scan.h>
+#include <number.h>
+#include <utf8.h>
+#include <utf16.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace jsonevt {
+
+struct parse_options {
+    /* JSON_EVT_OPTION_BAD_CHAR_POLICY_CONVERT to take bytes that are
+       not valid UTF-8 as Latin-1 chars instead of reporting an error */
+    uint bad_char_policy = JSON_EVT_OPTION_BAD_CHAR_POLICY_ERROR;
+};
+
+struct parse_error {
+    std::string message;
+    size_t byte_pos = 0;
+    size_t char_pos = 0;
+    uint line = 0;
+    uint char_col = 0;
+    uint byte_col = 0;
+
+    /* the value returned by the callback, if one stopped the parse */
+    int callback_rv = 0;
+};
+
+namespace detail {
+
+#define JSONEVT_SAX_HAS_METHOD(name, ...)                                            \
+    template <class H, class = void> struct has_##name : std::false_type { };         \
+    template <class H> struct has_##name<H,                                           \
+        std::void_t<decltype(std::declval<H &>().name(__VA_ARGS__))> > : std::true_type { };
+
+JSONEVT_SAX_HAS_METHOD(on_string, std::string_view(), 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_comment, std::string_view(), 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_bool, true, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_null, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_begin_array, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_end_array, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_begin_array_element, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_end_array_element, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_begin_hash, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_end_hash, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_begin_hash_entry, 0u, 0u)
+JSONEVT_SAX_HAS_METHOD(on_end_hash_entry, 0u, 0u)
+
+template <class H, class = void> struct has_typed_on_number : std::false_type { };
+template <class H> struct has_typed_on_number<H,
+    std::void_t<decltype(std::declval<H &>().on_number(std::string_view(),
+                std::declval<const jsonevt_number &>(), 0u, 0u))> > : std::true_type { };
+
+template <class H, class = void> struct has_text_on_number : std::false_type { };
+template <class H> struct has_text_on_number<H,
+    std::void_t<decltype(std::declval<H &>().on_number(std::string_view(), 0u, 0u))> >
+    : std::true_type { };
+
+#undef JSONEVT_SAX_HAS_METHOD
+
+/* call f, which returns void or something that converts to int */
+template <class F>
+inline int
+call_handler(F && f) {
+    if constexpr (std::is_void_v<decltype(f())>) {
+        f();
+        return 0;
+    }
+    else {
+        return static_cast<int>(f());
+    }
+}
+
+inline bool
+is_word_char(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')
+        || c == '_' || c == '$';
+}
+
+inline int
+hex_nibble(unsigned char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+} // namespace detail
+
+template <class Handler>
+class sax_parser {
+  public:
+
+    sax_parser(std::string_view json, Handler & handler, const parse_options & options)
+        : buf_(json.data()), len_(json.size()), pos_(0), handler_(handler), options_(options),
+          error_(0) { }
+
+    bool
+    run(parse_error * error) {
+        bool ok;
+
+        error_ = error;
+
+        ok = check_bom() && parse_value(0, 0);
+        if (ok && pos_ < len_) {
+            ok = eat_whitespace(false);
+            if (ok && pos_ < len_) {
+                ok = set_error("syntax error - garbage at end of JSON");
+            }
+        }
+
+        return ok;
+    }
+
+  private:
+
+    const char * buf_;
+    size_t len_;
+    size_t pos_;
+    Handler & handler_;
+    parse_options options_;
+    parse_error * error_;
+    std::string str_buf_;
+
+    /* Decode the char at pos.  Returns 0 for a bad sequence, unless
+       the bad char policy says to take the byte as a char by itself. */
+    uint32_t
+    decode_char(size_t pos, uint32_t * char_len) const {
+        uint32_t code_point;
+
+        if (UTF8_BYTE_IS_INVARIANT(buf_[pos])) {
+            *char_len = 1;
+            return (unsigned char)buf_[pos];
+        }
+
+        code_point = utf8_bytes_to_unicode((const uint8_t *)&buf_[pos], (uint32_t)(len_ - pos),
+            char_len);
+        if (code_point == 0 && (options_.bad_char_policy & JSON_EVT_OPTION_BAD_CHAR_POLICY_CONVERT)) {
+            *char_len = 1;
+            return (unsigned char)buf_[pos];
+        }
+
+        return code_point;
+    }
+
+    bool
+    set_error(const char * msg) {
+        const unsigned char * s = (const unsigned char *)buf_;
+        size_t i = 0;
+        uint32_t code_point;
+        uint32_t char_len;
+        char loc[128];
+
+        if (! error_) {
+            return false;
+        }
+
+        error_->byte_pos = pos_;
+        error_->char_pos = 0;
+        error_->line = 1;
+        error_->char_col = 0;
+        error_->byte_col = 0;
+
+        /* only worked out when there is an error to report */
+        while (i < pos_ && i < len_) {
+            if (UTF8_BYTE_IS_INVARIANT(s[i])) {
+                code_point = s[i];
+                char_len = 1;
+            }
+            else {
+                code_point = utf8_bytes_to_unicode(&s[i], (uint32_t)(len_ - i), &char_len);
+                if (code_point == 0) {
+                    char_len = 1;
+                }
+            }
+
+            i += char_len;
+            error_->char_pos++;
+
+            if (code_point == 0x0a || code_point == 0x2028) {
+                error_->line++;
+                error_->char_col = 0;
+                error_->byte_col = 0;
+            }
+            else {
+                error_->char_col++;
+                error_->byte_col += char_len;
+            }
+        }
+
+        snprintf(loc, sizeof(loc), "byte %lu, char %lu, line %u, col %u (byte col %u) - ",
+            (unsigned long)error_->byte_pos, (unsigned long)error_->char_pos, error_->line,
+            error_->char_col, error_->byte_col);
+
+        error_->message = loc;
+        error_->message += msg;
+
+        return false;
+    }
+
+    bool
+    callback_error(const char * cb_name, int rv) {
+        std::string msg("early termination from ");
+
+        msg += cb_name;
+        msg += " callback";
+
+        if (error_) {
+            error_->callback_rv = rv;
+        }
+
+        return set_error(msg.c_str());
+    }
+
+#define JSONEVT_SAX_CALL(method, name, ...)                                       \
+    if constexpr (detail::has_##method<Handler>::value) {                          \
+        int cb_rv = detail::call_handler([&]() { return handler_.method(__VA_ARGS__); }); \
+        if (cb_rv) {                                                               \
+            return callback_error(name, cb_rv);                                    \
+        }                                                                          \
+    }
+
+    bool
+    check_bom() {
+        static const char * error_fmt = "found BOM for unsupported %s encoding -- this parser requires UTF-8";
+        const char * encoding = 0;
+        char msg[128];
+
+        if (len_ >= 3 && memcmp(buf_, "\xEF\xBB\xBF", 3) == 0) {
+            pos_ = 3;
+            return true;
+        }
+
+        if (len_ >= 2 && memcmp(buf_, "\xFE\xFF", 2) == 0) {
+            encoding = "UTF-16BE";
+        }
+        else if (len_ >= 4 && memcmp(buf_, "\xFF\xFE\x00\x00", 4) == 0) {
+            encoding = "UTF-32LE";
+        }
+        else if (len_ >= 2 && memcmp(buf_, "\xFF\xFE", 2) == 0) {
+            encoding = "UTF-16LE";
+        }
+        else if (len_ >= 4 && memcmp(buf_, "\x00\x00\xFE\xFF", 4) == 0) {
+            encoding = "UTF-32BE";
+        }
+
+        if (encoding) {
+            snprintf(msg, sizeof(msg), error_fmt, encoding);
+            return set_error(msg);
+        }
+
+        return true;
+    }
+
+    /* Skip a comment running to the end of the line, starting at
+       pos_, which is just after the '#' or "//". */
+    bool
+    eat_line_comment(uint flags) {
+        size_t start = pos_;
+        size_t end;
+        uint32_t code_point;
+        uint32_t char_len;
+
+        while (pos_ < len_) {
+            code_point = decode_char(pos_, &char_len);
+            if (code_point == 0 && ! UTF8_BYTE_IS_INVARIANT(buf_[pos_])) {
+                return set_error("bad utf-8 sequence");
+            }
+
+            end = pos_;
+            pos_ += char_len;
+
+            if (code_point == 0x000a || code_point == 0x0085 || code_point == 0x2028) {
+                JSONEVT_SAX_CALL(on_comment, "comment", std::string_view(buf_ + start, end - start),
+                    flags, 0u);
+                return true;
+            }
+        }
+
+        JSONEVT_SAX_CALL(on_comment, "comment", std::string_view(buf_ + start, pos_ - start),
+            flags, 0u);
+
+        return true;
+    }
+
+    /* pos_ is just after the opening slash-star */
+    bool
+    eat_block_comment() {
+        size_t start = pos_;
+        const char * p;
+
+        for (p = buf_ + pos_; p + 1 < buf_ + len_; p++) {
+            if (p[0] == '*' && p[1] == '/') {
+                pos_ = p - buf_ + 2;
+                JSONEVT_SAX_CALL(on_comment, "comment",
+                    std::string_view(buf_ + start, p - (buf_ + start)), JSON_EVT_IS_C_COMMENT, 0u);
+                return true;
+            }
+        }
+
+        /* unterminated, which the caller finds out when it runs out of input */
+        pos_ = len_;
+
+        return true;
+    }
+
+    bool
+    eat_whitespace(bool commas_are_whitespace) {
+        unsigned char c;
+        uint32_t code_point;
+        uint32_t char_len;
+
+        while (pos_ < len_) {
+            c = (unsigned char)buf_[pos_];
+
+            if (c == ' ' || (c >= 0x09 && c <= 0x0d)) {
+                pos_++;
+                pos_ += jsonevt_scan_space(buf_ + pos_, (uint)(len_ - pos_));
+                continue;
+            }
+
+            if (c & 0x80) {
+                code_point = decode_char(pos_, &char_len);
+                switch (code_point) {
+                  case 0x0085: /* NEL - next line */
+                  case 0x00a0: /* NSBP - non-breaking space */
+                  case 0x200b: /* ZWSP - zero width space */
+                  case 0x2028: /* LS - line separator */
+                  case 0x2029: /* PS - paragraph separator */
+                  case 0x2060: /* WJ - word joiner */
+                      pos_ += char_len;
+                      continue;
+
+                  case 0:
+                      return set_error("bad utf-8 sequence");
+
+                  default:
+                      return true;
+                }
+            }
+
+            switch (c) {
+              case ',':
+                  if (! commas_are_whitespace) {
+                      return true;
+                  }
+                  pos_++;
+                  break;
+
+              case '#':
+                  pos_++;
+                  if (! eat_line_comment(JSON_EVT_IS_PERL_COMMENT)) {
+                      return false;
+                  }
+                  break;
+
+              case '/':
+                  pos_++;
+                  if (pos_ < len_ && buf_[pos_] == '/') {
+                      pos_++;
+                      if (! eat_line_comment(JSON_EVT_IS_CPLUSPLUS_COMMENT)) {
+                          return false;
+                      }
+                  }
+                  else if (pos_ < len_ && buf_[pos_] == '*') {
+                      pos_++;
+                      if (! eat_block_comment()) {
+                          return false;
+                      }
+                  }
+                  else {
+                      return set_error("syntax error -- can't have '/' by itself");
+                  }
+                  break;
+
+              default:
+                  return true;
+            }
+        }
+
+        return true;
+    }
+
+    bool
+    parse_number(uint level, uint flags) {
+        size_t start = pos_;
+        jsonevt_number_acc acc;
+        unsigned char c;
+
+        if (pos_ < len_ && buf_[pos_] == '-') {
+            flags |= JSON_EVT_PARSE_NUMBER_HAVE_SIGN;
+            pos_++;
+        }
+
+        if (pos_ >= len_ || buf_[pos_] < '0' || buf_[pos_] > '9') {
+            return set_error("syntax error");
+        }
+
+        memset((void *)&acc, 0, sizeof(acc));
+
+        pos_ += eat_digits(&acc, JSONEVT_NUMBER_INT_PART);
+
+        if (pos_ < len_ && buf_[pos_] == '.') {
+            flags |= JSON_EVT_PARSE_NUMBER_HAVE_DECIMAL;
+            pos_++;
+            pos_ += eat_digits(&acc, JSONEVT_NUMBER_FRACTION_PART);
+        }
+
+        if (pos_ < len_ && (buf_[pos_] == 'e' || buf_[pos_] == 'E')) {
+            flags |= JSON_EVT_PARSE_NUMBER_HAVE_EXPONENT;
+            pos_++;
+
+            if (pos_ < len_) {
+                c = (unsigned char)buf_[pos_];
+                if (c == '+' || c == '-') {
+                    acc.exp_negative = c == '-';
+                    pos_++;
+                }
+            }
+
+            pos_ += eat_digits(&acc, JSONEVT_NUMBER_EXPONENT_PART);
+        }
+
+        std::string_view text(buf_ + start, pos_ - start);
+        int cb_rv = 0;
+
+        if constexpr (detail::has_typed_on_number<Handler>::value) {
+            jsonevt_number num;
+
+            jsonevt_number_finish(&acc, text.data(), (uint)text.size(), &flags, &num);
+            cb_rv = detail::call_handler([&]() { return handler_.on_number(text, num, flags, level); });
+        }
+        else if constexpr (detail::has_text_on_number<Handler>::value) {
+            cb_rv = detail::call_handler([&]() { return handler_.on_number(text, flags, level); });
+        }
+
+        if (cb_rv) {
+            return callback_error("number", cb_rv);
+        }
+
+        return true;
+    }
+
+    /* Step over the digits at pos_.  They are only added up if the
+       handler wants the value. */
+    size_t
+    eat_digits(jsonevt_number_acc * acc, uint part) {
+        size_t i = pos_;
+
+        if constexpr (detail::has_typed_on_number<Handler>::value) {
+            return jsonevt_number_scan_digits(buf_ + pos_, (uint)(len_ - pos_), acc, part);
+        }
+        else {
+            (void)acc;
+            (void)part;
+            while (i < len_ && buf_[i] >= '0' && buf_[i] <= '9') {
+                i++;
+            }
+
+            return i - pos_;
+        }
+    }
+
+    /* If is_identifier is true, this is a bare hash key and is passed
+       on as a string.  Otherwise it must be true, false, or null. */
+    bool
+    parse_word(bool is_identifier, uint level, uint flags) {
+        size_t start = pos_;
+        std::string_view word;
+
+        if (pos_ < len_ && buf_[pos_] >= '0' && buf_[pos_] <= '9') {
+            if (flags & JSON_EVT_IS_HASH_KEY) {
+                return set_error("syntax error in hash key (bare keys must begin with [A-Za-z_0-9])");
+            }
+            return parse_number(level, flags);
+        }
+
+        while (pos_ < len_ && detail::is_word_char((unsigned char)buf_[pos_])) {
+            pos_++;
+        }
+
+        if (pos_ == start) {
+            if (flags & JSON_EVT_IS_HASH_VALUE) {
+                return set_error("syntax error in hash value");
+            }
+            else if (flags & JSON_EVT_IS_HASH_KEY) {
+                return set_error("syntax error in hash key");
+            }
+
+            return set_error("syntax error");
+        }
+
+        word = std::string_view(buf_ + start, pos_ - start);
+
+        if (is_identifier) {
+            JSONEVT_SAX_CALL(on_string, "string", word, flags, level);
+            return true;
+        }
+
+        if (word == "true" || word == "false") {
+            JSONEVT_SAX_CALL(on_bool, "bool", word == "true", flags, level);
+            return true;
+        }
+
+        if (word == "null") {
+            JSONEVT_SAX_CALL(on_null, "null", flags, level);
+            return true;
+        }
+
+        return set_error("syntax error");
+    }
+
+    /* Returns true if buf has no bytes that the unescaping path would
+       change or report, i.e., it is valid UTF-8 with no overlong
+       sequences. */
+    static bool
+    plain_utf8(const char * buf, size_t len) {
+        const uint8_t * s = (const uint8_t *)buf;
+        size_t i = 0;
+        uint32_t code_point;
+        uint32_t char_len;
+        uint8_t tmp_bytes[4];
+
+        while (i < len) {
+            if (UTF8_BYTE_IS_INVARIANT(s[i])) {
+                i++;
+                continue;
+            }
+
+            code_point = utf8_bytes_to_unicode(&s[i], (uint32_t)(len - i), &char_len);
+            if (code_point == 0 || utf8_unicode_to_bytes(code_point, tmp_bytes) != char_len) {
+                return false;
+            }
+
+            i += char_len;
+        }
+
+        return true;
+    }
+
+    void
+    append_code_point(uint32_t code_point) {
+        uint8_t bytes[4];
+        uint32_t n;
+
+        if (code_point < 0x80) {
+            str_buf_.push_back((char)code_point);
+            return;
+        }
+
+        n = utf8_unicode_to_bytes(code_point, bytes);
+        str_buf_.append((const char *)bytes, n);
+    }
+
+    bool
+    get_hex_escape(uint digits, uint32_t * code_point, const char * error_msg) {
+        uint i;
+        int nv;
+
+        *code_point = 0;
+        for (i = 0; i < digits; i++) {
+            nv = pos_ < len_ ? detail::hex_nibble((unsigned char)buf_[pos_]) : -1;
+            if (nv == -1) {
+                return set_error(error_msg);
+            }
+
+            *code_point = *code_point * 16 + (uint32_t)nv;
+            pos_++;
+        }
+
+        return true;
+    }
+
+    /* If the input goes on with a \u escape for the low half of a
+       surrogate pair starting with high, the code point for the pair,
+       else 0.  Nothing is consumed. */
+    uint32_t
+    low_surrogate_pair(uint32_t high) const {
+        uint32_t low = 0;
+        size_t i;
+        int nv;
+
+        if (len_ - pos_ < 6 || buf_[pos_] != '\\' || buf_[pos_ + 1] != 'u') {
+            return 0;
+        }
+
+        for (i = 2; i < 6; i++) {
+            nv = detail::hex_nibble((unsigned char)buf_[pos_ + i]);
+            if (nv == -1) {
+                return 0;
+            }
+            low = low * 16 + (uint32_t)nv;
+        }
+
+        return utf16_surrogate_pair_to_unicode(high, low);
+    }
+
+    bool
+    parse_string(uint level, uint flags) {
+        char quote_char = buf_[pos_];
+        size_t start;
+        size_t run;
+        uint32_t code_point;
+        uint32_t pair;
+        uint32_t char_len;
+        int have_high = 0;
+
+        pos_++;
+        start = pos_;
+
+        run = jsonevt_scan_string(buf_ + pos_, (uint)(len_ - pos_), quote_char, &have_high);
+        if (pos_ + run < len_ && buf_[pos_ + run] == quote_char
+            && (! have_high || plain_utf8(buf_ + pos_, run))) {
+            /* nothing to unescape or convert, so pass the input through */
+            pos_ += run + 1;
+            JSONEVT_SAX_CALL(on_string, "string", std::string_view(buf_ + start, run), flags, level);
+            return true;
+        }
+
+        str_buf_.clear();
+
+        while (pos_ < len_) {
+            run = jsonevt_scan_string(buf_ + pos_, (uint)(len_ - pos_), quote_char, &have_high);
+            if (run && (! have_high || plain_utf8(buf_ + pos_, run))) {
+                str_buf_.append(buf_ + pos_, run);
+                pos_ += run;
+                continue;
+            }
+
+            if (buf_[pos_] == quote_char) {
+                pos_++;
+                JSONEVT_SAX_CALL(on_string, "string", std::string_view(str_buf_), flags, level);
+                return true;
+            }
+
+            if (buf_[pos_] != '\\') {
+                /* a char the plain run stopped at */
+                code_point = decode_char(pos_, &char_len);
+                if (code_point == 0 && ! UTF8_BYTE_IS_INVARIANT(buf_[pos_])) {
+                    return set_error("bad utf-8 sequence");
+                }
+
+                pos_ += char_len;
+                append_code_point(code_point);
+                continue;
+            }
+
+            pos_++;
+            if (pos_ >= len_) {
+                break;
+            }
+
+            code_point = decode_char(pos_, &char_len);
+            if (code_point == 0 && ! UTF8_BYTE_IS_INVARIANT(buf_[pos_])) {
+                return set_error("bad utf-8 sequence");
+            }
+            pos_ += char_len;
+
+            switch (code_point) {
+              case 'b':
+                  code_point = 0x08; /* backspace */
+                  break;
+
+              case 'n':
+                  code_point = 0x0a; /* line feed */
+                  break;
+
+              case 'v':
+                  code_point = 0x0b; /* vertical tab */
+                  break;
+
+              case 'f':
+                  code_point = 0x0c; /* form feed */
+                  break;
+
+              case 'r':
+                  code_point = 0x0d; /* carriage return */
+                  break;
+
+              case 't':
+                  code_point = 0x09; /* tab */
+                  break;
+
+              case 'x':
+                  if (! get_hex_escape(2, &code_point, "bad hex escape character specification")) {
+                      return false;
+                  }
+                  break;
+
+              case 'u':
+                  if (! get_hex_escape(4, &code_point, "bad unicode character specification")) {
+                      return false;
+                  }
+
+                  /* a surrogate pair is a single character */
+                  pair = low_surrogate_pair(code_point);
+                  if (pair) {
+                      code_point = pair;
+                      pos_ += 6;
+                  }
+                  break;
+
+              default:
+                  /* \\, \/, \", \', and unrecognized escapes are all
+                     taken literally */
+                  break;
+            }
+
+            append_code_point(code_point);
+        }
+
+        return set_error("unterminated string");
+    }
+
+    bool
+    parse_array(uint level, uint flags) {
+        bool found_comma;
+        unsigned char c;
+
+        JSONEVT_SAX_CALL(on_begin_array, "begin_array", flags, level);
+
+        pos_++;
+        if (! eat_whitespace(false)) {
+            return false;
+        }
+
+        if (pos_ < len_ && buf_[pos_] == ']') {
+            JSONEVT_SAX_CALL(on_end_array, "end_array", flags, level);
+            pos_++;
+            return true;
+        }
+
+        if (pos_ >= len_) {
+            return set_error("array not terminated");
+        }
+
+        for (;;) {
+            JSONEVT_SAX_CALL(on_begin_array_element, "begin_array_element", 0u, level + 1);
+
+            if (! parse_value(level + 1, JSON_EVT_IS_ARRAY_ELEMENT)) {
+                return false;
+            }
+
+            JSONEVT_SAX_CALL(on_end_array_element, "end_array_element", 0u, level + 1);
+
+            if (! eat_whitespace(false)) {
+                return false;
+            }
+
+            /* extra commas are skipped, but a comma just before the
+               ']' is still an error, as with jsonevt_parse() */
+            c = pos_ < len_ ? (unsigned char)buf_[pos_] : 0;
+            found_comma = c == ',';
+            if (found_comma && ! eat_whitespace(true)) {
+                return false;
+            }
+
+            if (c == ']') {
+                JSONEVT_SAX_CALL(on_end_array, "end_array", flags, level);
+                pos_++;
+                return true;
+            }
+
+            if (! found_comma) {
+                return set_error("syntax error in array");
+            }
+        }
+    }
+
+    bool
+    parse_hash(uint level, uint flags) {
+        bool found_comma;
+        unsigned char c;
+
+        JSONEVT_SAX_CALL(on_begin_hash, "begin_hash", flags, level);
+
+        pos_++;
+        if (! eat_whitespace(true)) {
+            return false;
+        }
+
+        if (pos_ < len_ && buf_[pos_] == '}') {
+            JSONEVT_SAX_CALL(on_end_hash, "end_hash", flags, level);
+            pos_++;
+            return true;
+        }
+
+        for (;;) {
+            if (! eat_whitespace(false)) {
+                return false;
+            }
+
+            JSONEVT_SAX_CALL(on_begin_hash_entry, "begin_hash_entry", 0u, level + 1);
+
+            c = pos_ < len_ ? (unsigned char)buf_[pos_] : 0;
+            if (c == '"' || c == '\'') {
+                if (! parse_string(level + 1, JSON_EVT_IS_HASH_KEY)) {
+                    return false;
+                }
+            }
+            else if (! parse_word(true, level + 1, JSON_EVT_IS_HASH_KEY)) {
+                return false;
+            }
+
+            if (! eat_whitespace(false)) {
+                return false;
+            }
+
+            if (pos_ >= len_ || buf_[pos_] != ':') {
+                return set_error("syntax error: bad object (missing ':')");
+            }
+            pos_++;
+
+            if (! parse_value(level + 1, JSON_EVT_IS_HASH_VALUE)) {
+                return false;
+            }
+
+            JSONEVT_SAX_CALL(on_end_hash_entry, "end_hash_entry", 0u, level + 1);
+
+            if (! eat_whitespace(false)) {
+                return false;
+            }
+
+            found_comma = pos_ < len_ && buf_[pos_] == ',';
+            if (found_comma && ! eat_whitespace(true)) {
+                return false;
+            }
+
+            if (pos_ < len_ && buf_[pos_] == '}') {
+                JSONEVT_SAX_CALL(on_end_hash, "end_hash", flags, level);
+                pos_++;
+                return true;
+            }
+
+            if (! found_comma) {
+                return set_error("syntax error: bad object (missing ',' or '}')");
+            }
+        }
+    }
+
+    bool
+    parse_value(uint level, uint flags) {
+        if (! eat_whitespace(false)) {
+            return false;
+        }
+
+        switch (pos_ < len_ ? buf_[pos_] : 0) {
+          case '"':
+          case '\'':
+              return parse_string(level, flags);
+
+          case '[':
+              return parse_array(level, flags);
+
+          case '{':
+              return parse_hash(level, flags);
+
+          case '-':
+          case '+':
+              return parse_number(level, flags);
+
+          default:
+              return parse_word(false, level, flags);
+        }
+    }
+
+#undef JSONEVT_SAX_CALL
+};
+
+/* Parse json, calling the methods of handler for each event.  Returns
+   true on success.  On failure, the details go in *error if it is
+   given. */
+template <class Handler>
+inline bool
+parse(std::string_view json, Handler & handler, parse_error * error = 0,
+    const parse_options & options = parse_options()) {
+    sax_parser<Handler> parser(json, handler, options);
+
+    return parser.run(error);
+}
+
+} // namespace jsonevt
+
+#endif /* JSONEVT_SAX_H */
@@ -0,0 +1,959 @@
+/* Creation date: 2026-10-18T01:12:09Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+
+/* $Revision$ */
+#include "cursor.h"
+#include "scan.h"
+#include "number.h"
+#include "utf8.h"
+#include "utf16.h"
+#include "print.h"
+#include "jsonevt_utils.h"
+
+#include <string.h>
+
+#define UNLESS(stuff) if (! stuff)
+
+#define memzero(buf, size) memset(buf, 0, size)
+
+#define CURSOR_INITIAL_STACK_SIZE 32
+
+/* returned by find_next() instead of a token */
+#define CURSOR_AT_VALUE 0x100
+#define CURSOR_AT_KEY   0x101
+
+#define IS_DIGIT(c) ( (c) >= '0' && (c) <= '9' )
+#define IS_WORD_CHAR(c) ( IS_DIGIT(c) || ((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z') \
+        || (c) == '_' || (c) == '$' )
+
+static uint
+set_error(jsonevt_cursor * cur, uint pos, const char * msg) {
+    uint line = 1;
+    uint char_pos = 0;
+    uint char_col = 0;
+    uint byte_col = 0;
+    uint i;
+    unsigned char c;
+
+    if (cur->error) {
+        return JSON_EVT_CURSOR_ERROR;
+    }
+
+    if (pos > cur->len) {
+        pos = cur->len;
+    }
+
+    /* only worked out when there is an error, as in the parser */
+    for (i = 0; i < pos; i++) {
+        c = (unsigned char)cur->buf[i];
+        if ((c & 0xc0) == 0x80) {
+            byte_col++;
+            continue;
+        }
+
+        char_pos++;
+        if (c == '\n') {
+            line++;
+            char_col = 0;
+            byte_col = 0;
+        }
+        else {
+            char_col++;
+            byte_col++;
+        }
+    }
+
+    js_asprintf(&cur->error, "byte %u, char %u, line %u, col %u (byte col %u) - %s",
+        pos, char_pos, line, char_col, byte_col, msg);
+
+    cur->state = CURSOR_STATE_ERROR;
+    cur->tok = JSON_EVT_CURSOR_ERROR;
+
+    return JSON_EVT_CURSOR_ERROR;
+}
+
+/* length of the Unicode whitespace character the parser allows at s, or 0 */
+static uint
+unicode_space_len(const unsigned char * s, uint left) {
+    if (left >= 2 && s[0] == 0xc2 && (s[1] == 0x85 || s[1] == 0xa0)) {
+        /* NEL, NBSP */
+        return 2;
+    }
+
+    if (left >= 3 && s[0] == 0xe2) {
+        if (s[1] == 0x80 && (s[2] == 0x8b || s[2] == 0xa8 || s[2] == 0xa9)) {
+            /* ZWSP, LS, PS */
+            return 3;
+        }
+        if (s[1] == 0x81 && s[2] == 0xa0) {
+            /* WJ */
+            return 3;
+        }
+    }
+
+    return 0;
+}
+
+/* Step over the comment starting at *pos.  Returns 0 if there is a '/'
+   by itself. */
+static int
+skip_comment(jsonevt_cursor * cur, uint * pos) {
+    const unsigned char * buf = (const unsigned char *)cur->buf;
+    uint len = cur->len;
+    uint i = *pos;
+
+    if (buf[i] == '/') {
+        i++;
+        if (i < len && buf[i] == '*') {
+            for (i++; i + 1 < len; i++) {
+                if (buf[i] == '*' && buf[i + 1] == '/') {
+                    *pos = i + 2;
+                    return 1;
+                }
+            }
+
+            /* runs to the end of the buffer */
+            *pos = len;
+            return 1;
+        }
+
+        if (i >= len || buf[i] != '/') {
+            return 0;
+        }
+    }
+
+    /* '#' or "//" -- up to and including the end of the line */
+    for (; i < len; i++) {
+        if (buf[i] == '\n') {
+            i++;
+            break;
+        }
+
+        if (buf[i] == 0xc2 && i + 1 < len && buf[i + 1] == 0x85) {
+            i += 2;
+            break;
+        }
+
+        if (buf[i] == 0xe2 && i + 2 < len && buf[i + 1] == 0x80 && buf[i + 2] == 0xa8) {
+            i += 3;
+            break;
+        }
+    }
+
+    *pos = i;
+
+    return 1;
+}
+
+/* Skip whitespace and comments (and commas, if commas_are_whitespace).
+   Returns 0 on error. */
+static int
+eat_space(jsonevt_cursor * cur, int commas_are_whitespace) {
+    uint len = cur->len;
+    uint n;
+    unsigned char c;
+
+    while (cur->pos < len) {
+        cur->pos += jsonevt_scan_space(&cur->buf[cur->pos], len - cur->pos);
+        if (cur->pos >= len) {
+            break;
+        }
+
+        c = (unsigned char)cur->buf[cur->pos];
+        if (c == ',' && commas_are_whitespace) {
+            cur->pos++;
+        }
+        else if (c == '#' || c == '/') {
+            UNLESS (skip_comment(cur, &cur->pos)) {
+                set_error(cur, cur->pos, "syntax error -- can't have '/' by itself");
+                return 0;
+            }
+        }
+        else if (c >= 0x80
+            && (n = unicode_space_len((const unsigned char *)&cur->buf[cur->pos], len - cur->pos))) {
+            cur->pos += n;
+        }
+        else {
+            break;
+        }
+    }
+
+    return 1;
+}
+
+/* Return the position of the quote that ends the string starting at
+   pos (just after the opening quote), or len if it isn't terminated. */
+static uint
+find_string_end(jsonevt_cursor * cur, uint pos, char quote_char, uint * flags) {
+    uint len = cur->len;
+    int have_high = 0;
+
+    while (pos < len) {
+        pos += jsonevt_scan_string(&cur->buf[pos], len - pos, quote_char, &have_high);
+        if (pos >= len) {
+            break;
+        }
+
+        if (cur->buf[pos] == quote_char) {
+            return pos;
+        }
+
+        /* backslash -- the next byte can't end the string */
+        *flags |= CURSOR_TOK_HAS_ESCAPE;
+        pos += 2;
+    }
+
+    return len;
+}
+
+/* The value has been skipped or returned, so see what comes after it. */
+static void
+finish_value(jsonevt_cursor * cur) {
+    if (cur->depth == 0) {
+        cur->state = CURSOR_STATE_DONE;
+    }
+    else if (cur->stack[cur->depth - 1] == CURSOR_IN_ARRAY) {
+        cur->state = CURSOR_STATE_ARRAY_NEXT;
+    }
+    else {
+        cur->state = CURSOR_STATE_HASH_NEXT;
+    }
+}
+
+static void
+push_container(jsonevt_cursor * cur, uint8_t type) {
+    if (cur->depth >= cur->stack_size) {
+        cur->stack_size *= 2;
+        JSONEVT_RENEW(cur->stack, cur->stack_size, uint8_t);
+    }
+
+    cur->stack[cur->depth++] = type;
+    cur->state = type == CURSOR_IN_ARRAY ? CURSOR_STATE_ARRAY_FIRST : CURSOR_STATE_HASH_FIRST;
+}
+
+static uint
+end_container(jsonevt_cursor * cur, uint tok) {
+    cur->pos++;
+    cur->depth--;
+    finish_value(cur);
+
+    cur->tok = tok;
+    cur->tok_start = cur->pos - 1;
+    cur->tok_len = 1;
+    cur->tok_flags = 0;
+
+    return tok;
+}
+
+/*
+  Deal with whatever comes between the last token and the next value
+  or key.  Returns CURSOR_AT_VALUE if a value starts at cur->pos,
+  CURSOR_AT_KEY if a key does, or the token to return if the
+  document or the current array or hash has ended instead (or there
+  was an error).
+*/
+static uint
+find_next(jsonevt_cursor * cur) {
+    char c;
+
+    switch (cur->state) {
+      case CURSOR_STATE_ERROR:
+          return JSON_EVT_CURSOR_ERROR;
+          break;
+
+      case CURSOR_STATE_DONE:
+          UNLESS (eat_space(cur, 0)) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          if (cur->pos < cur->len) {
+              return set_error(cur, cur->pos, "syntax error - garbage at end of JSON");
+          }
+          cur->tok = JSON_EVT_CURSOR_END;
+          return JSON_EVT_CURSOR_END;
+          break;
+
+      case CURSOR_STATE_START:
+          UNLESS (eat_space(cur, 0)) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          if (cur->pos >= cur->len) {
+              /* nothing but whitespace, which the parser doesn't allow either */
+              return set_error(cur, cur->pos, "syntax error");
+          }
+          return CURSOR_AT_VALUE;
+          break;
+
+      case CURSOR_STATE_ARRAY_FIRST:
+      case CURSOR_STATE_ARRAY_NEXT:
+          UNLESS (eat_space(cur, 0)) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          if (cur->pos >= cur->len) {
+              return set_error(cur, cur->pos, "array not terminated");
+          }
+
+          c = cur->buf[cur->pos];
+          if (c == ']') {
+              return end_container(cur, JSON_EVT_CURSOR_END_ARRAY);
+          }
+
+          if (cur->state == CURSOR_STATE_ARRAY_NEXT) {
+              if (c != ',') {
+                  return set_error(cur, cur->pos, "syntax error in array");
+              }
+
+              /* extra commas are allowed, but not one right before the ']' */
+              cur->pos++;
+              UNLESS (eat_space(cur, 1)) {
+                  return JSON_EVT_CURSOR_ERROR;
+              }
+              if (cur->pos >= cur->len) {
+                  return set_error(cur, cur->pos, "array not terminated");
+              }
+          }
+          return CURSOR_AT_VALUE;
+          break;
+
+      case CURSOR_STATE_HASH_FIRST:
+      case CURSOR_STATE_HASH_NEXT:
+          UNLESS (eat_space(cur, cur->state == CURSOR_STATE_HASH_FIRST)) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          if (cur->pos >= cur->len) {
+              return set_error(cur, cur->pos, "hash not terminated");
+          }
+
+          c = cur->buf[cur->pos];
+          if (cur->state == CURSOR_STATE_HASH_NEXT) {
+              if (c == ',') {
+                  cur->pos++;
+                  UNLESS (eat_space(cur, 1)) {
+                      return JSON_EVT_CURSOR_ERROR;
+                  }
+                  if (cur->pos >= cur->len) {
+                      return set_error(cur, cur->pos, "hash not terminated");
+                  }
+                  c = cur->buf[cur->pos];
+              }
+              else if (c != '}') {
+                  return set_error(cur, cur->pos, "syntax error: bad object (missing ',' or '}')");
+              }
+          }
+
+          if (c == '}') {
+              return end_container(cur, JSON_EVT_CURSOR_END_HASH);
+          }
+          return CURSOR_AT_KEY;
+          break;
+
+      case CURSOR_STATE_HASH_VALUE:
+          UNLESS (eat_space(cur, 0)) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          if (cur->pos >= cur->len || cur->buf[cur->pos] != ':') {
+              return set_error(cur, cur->pos, "syntax error: bad object (missing ':')");
+          }
+          cur->pos++;
+          UNLESS (eat_space(cur, 0)) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          if (cur->pos >= cur->len) {
+              return set_error(cur, cur->pos, "syntax error in hash value");
+          }
+          return CURSOR_AT_VALUE;
+          break;
+
+      default:
+          break;
+    }
+
+    return set_error(cur, cur->pos, "bad cursor state");
+}
+
+static uint
+lex_string(jsonevt_cursor * cur, uint tok) {
+    char quote_char = cur->buf[cur->pos];
+    uint flags = 0;
+    uint end;
+
+    end = find_string_end(cur, cur->pos + 1, quote_char, &flags);
+    if (end >= cur->len) {
+        return set_error(cur, cur->pos, "unterminated string");
+    }
+
+    cur->tok = tok;
+    cur->tok_start = cur->pos + 1;
+    cur->tok_len = end - cur->pos - 1;
+    cur->tok_flags = flags;
+    cur->pos = end + 1;
+
+    return tok;
+}
+
+static uint
+lex_key(jsonevt_cursor * cur) {
+    uint start = cur->pos;
+    char c = cur->buf[start];
+
+    if (c == '"' || c == '\'') {
+        if (lex_string(cur, JSON_EVT_CURSOR_KEY) != JSON_EVT_CURSOR_KEY) {
+            return JSON_EVT_CURSOR_ERROR;
+        }
+    }
+    else {
+        if (IS_DIGIT(c)) {
+            return set_error(cur, start,
+                "syntax error in hash key (bare keys must begin with [A-Za-z_0-9])");
+        }
+
+        while (cur->pos < cur->len && IS_WORD_CHAR(cur->buf[cur->pos])) {
+            cur->pos++;
+        }
+
+        if (cur->pos == start) {
+            return set_error(cur, start, "syntax error in hash key");
+        }
+
+        cur->tok = JSON_EVT_CURSOR_KEY;
+        cur->tok_start = start;
+        cur->tok_len = cur->pos - start;
+        cur->tok_flags = 0;
+    }
+
+    cur->state = CURSOR_STATE_HASH_VALUE;
+
+    return JSON_EVT_CURSOR_KEY;
+}
+
+static uint
+lex_number(jsonevt_cursor * cur) {
+    const char * buf = cur->buf;
+    uint len = cur->len;
+    uint start = cur->pos;
+    uint pos = start;
+    uint flags = 0;
+
+    if (buf[pos] == '-') {
+        flags |= JSON_EVT_PARSE_NUMBER_HAVE_SIGN;
+        pos++;
+    }
+
+    if (pos >= len || ! IS_DIGIT(buf[pos])) {
+        return set_error(cur, pos, "syntax error");
+    }
+
+    while (pos < len && IS_DIGIT(buf[pos])) {
+        pos++;
+    }
+
+    if (pos < len && buf[pos] == '.') {
+        flags |= JSON_EVT_PARSE_NUMBER_HAVE_DECIMAL;
+        for (pos++; pos < len && IS_DIGIT(buf[pos]); pos++) { }
+    }
+
+    if (pos < len && (buf[pos] == 'e' || buf[pos] == 'E')) {
+        flags |= JSON_EVT_PARSE_NUMBER_HAVE_EXPONENT;
+        pos++;
+        if (pos < len && (buf[pos] == '+' || buf[pos] == '-')) {
+            pos++;
+        }
+        for (; pos < len && IS_DIGIT(buf[pos]); pos++) { }
+    }
+
+    cur->tok = JSON_EVT_CURSOR_NUMBER;
+    cur->tok_start = start;
+    cur->tok_len = pos - start;
+    cur->tok_flags = flags;
+    cur->pos = pos;
+
+    return JSON_EVT_CURSOR_NUMBER;
+}
+
+static uint
+lex_value(jsonevt_cursor * cur) {
+    uint start = cur->pos;
+    uint word_len;
+    char c = cur->buf[start];
+
+    switch (c) {
+      case '[':
+      case '{':
+          cur->pos++;
+          push_container(cur, c == '[' ? CURSOR_IN_ARRAY : CURSOR_IN_HASH);
+
+          cur->tok = c == '[' ? JSON_EVT_CURSOR_BEGIN_ARRAY : JSON_EVT_CURSOR_BEGIN_HASH;
+          cur->tok_start = start;
+          cur->tok_len = 1;
+          cur->tok_flags = 0;
+          return cur->tok;
+          break;
+
+      case '"':
+      case '\'':
+          if (lex_string(cur, JSON_EVT_CURSOR_STRING) != JSON_EVT_CURSOR_STRING) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          break;
+
+      case '-':
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+          if (lex_number(cur) != JSON_EVT_CURSOR_NUMBER) {
+              return JSON_EVT_CURSOR_ERROR;
+          }
+          break;
+
+      default:
+          while (cur->pos < cur->len && IS_WORD_CHAR(cur->buf[cur->pos])) {
+              cur->pos++;
+          }
+          word_len = cur->pos - start;
+
+          cur->tok_start = start;
+          cur->tok_len = word_len;
+          cur->tok_flags = 0;
+
+          if (word_len == 4 && memcmp(&cur->buf[start], "true", 4) == 0) {
+              cur->tok = JSON_EVT_CURSOR_BOOL;
+              cur->tok_flags = CURSOR_TOK_TRUE;
+          }
+          else if (word_len == 5 && memcmp(&cur->buf[start], "false", 5) == 0) {
+              cur->tok = JSON_EVT_CURSOR_BOOL;
+          }
+          else if (word_len == 4 && memcmp(&cur->buf[start], "null", 4) == 0) {
+              cur->tok = JSON_EVT_CURSOR_NULL;
+          }
+          else {
+              return set_error(cur, start, "syntax error");
+          }
+          break;
+    }
+
+    finish_value(cur);
+
+    return cur->tok;
+}
+
+/*
+  Find the end of the array or hash the cursor is inside of, without
+  looking at anything but brackets, quotes, and comments.  Candidate
+  bytes come from the block classifier, as in the structural index.
+  Mismatched brackets (e.g., "[1}") are not noticed.  On success,
+  cur->pos is the position of the closing bracket.
+*/
+static int
+skip_to_container_end(jsonevt_cursor * cur) {
+    const char * buf = cur->buf;
+    uint len = cur->len;
+    uint depth = 1;
+    uint base = cur->pos;
+    uint pos;
+    uint flags = 0;
+    int restart;
+    jsonevt_scan_masks m;
+    uint64_t cand;
+    char c;
+
+    while (base < len) {
+        if (len - base >= JSONEVT_SCAN_BLOCK_SIZE) {
+            jsonevt_scan_block(buf + base, &m);
+        }
+        else {
+            jsonevt_scan_partial_block(buf + base, len - base, &m);
+        }
+
+        cand = m.quote | m.squote | m.structural | m.comment;
+        restart = 0;
+
+        while (cand) {
+            pos = base + JSONEVT_CTZ64(cand);
+            cand = JSONEVT_CLEAR_LOWEST_BIT(cand);
+            c = buf[pos];
+
+            switch (c) {
+              case '[':
+              case '{':
+                  depth++;
+                  break;
+
+              case ']':
+              case '}':
+                  depth--;
+                  UNLESS (depth) {
+                      cur->pos = pos;
+                      return 1;
+                  }
+                  break;
+
+              case '"':
+              case '\'':
+                  pos = find_string_end(cur, pos + 1, c, &flags);
+                  if (pos >= len) {
+                      set_error(cur, cur->pos, "unterminated string");
+                      return 0;
+                  }
+                  base = pos + 1;
+                  restart = 1;
+                  break;
+
+              case '#':
+              case '/':
+                  /* a '/' by itself is left for the parser to complain about */
+                  if (skip_comment(cur, &pos)) {
+                      base = pos;
+                      restart = 1;
+                  }
+                  break;
+
+              default:
+                  /* ':' and ',' */
+                  break;
+            }
+
+            if (restart) {
+                break;
+            }
+        }
+
+        UNLESS (restart) {
+            base += JSONEVT_SCAN_BLOCK_SIZE;
+        }
+    }
+
+    set_error(cur, len, cur->stack[cur->depth - 1] == CURSOR_IN_ARRAY
+        ? "array not terminated" : "hash not terminated");
+
+    return 0;
+}
+
+jsonevt_cursor *
+jsonevt_cursor_new(const char * buf, uint len) {
+    jsonevt_cursor * cur;
+
+    JSONEVT_NEW(cur, 1, jsonevt_cursor);
+    memzero(cur, sizeof(*cur));
+
+    cur->stack_size = CURSOR_INITIAL_STACK_SIZE;
+    JSONEVT_NEW(cur->stack, cur->stack_size, uint8_t);
+
+    jsonevt_cursor_reset(cur, buf, len);
+
+    return cur;
+}
+
+void
+jsonevt_cursor_reset(jsonevt_cursor * cur, const char * buf, uint len) {
+    cur->buf = buf;
+    cur->len = len;
+    cur->pos = 0;
+
+    cur->state = CURSOR_STATE_START;
+    cur->tok = JSON_EVT_CURSOR_END;
+    cur->tok_start = 0;
+    cur->tok_len = 0;
+    cur->tok_flags = 0;
+    cur->depth = 0;
+
+    if (cur->error) {
+        JSONEVT_FREE_MEM(cur->error);
+        cur->error = NULL;
+    }
+
+    /* a BOM is not part of the data */
+    if (len >= 3 && memcmp(buf, "\xef\xbb\xbf", 3) == 0) {
+        cur->pos = 3;
+    }
+}
+
+void
+jsonevt_cursor_free(jsonevt_cursor * cur) {
+    UNLESS (cur) {
+        return;
+    }
+
+    if (cur->error) {
+        JSONEVT_FREE_MEM(cur->error);
+    }
+    if (cur->str_buf) {
+        JSONEVT_FREE_MEM(cur->str_buf);
+    }
+    JSONEVT_FREE_MEM(cur->stack);
+    JSONEVT_FREE_MEM(cur);
+}
+
+uint
+jsonevt_cursor_next(jsonevt_cursor * cur) {
+    uint rv = find_next(cur);
+
+    if (rv == CURSOR_AT_VALUE) {
+        return lex_value(cur);
+    }
+    if (rv == CURSOR_AT_KEY) {
+        return lex_key(cur);
+    }
+
+    return rv;
+}
+
+uint
+jsonevt_cursor_skip(jsonevt_cursor * cur) {
+    uint rv = find_next(cur);
+
+    if (rv == CURSOR_AT_KEY) {
+        return lex_key(cur);
+    }
+
+    if (rv != CURSOR_AT_VALUE) {
+        return rv;
+    }
+
+    rv = lex_value(cur);
+    if (rv == JSON_EVT_CURSOR_BEGIN_ARRAY || rv == JSON_EVT_CURSOR_BEGIN_HASH) {
+        UNLESS (skip_to_container_end(cur)) {
+            return JSON_EVT_CURSOR_ERROR;
+        }
+        end_container(cur, rv == JSON_EVT_CURSOR_BEGIN_ARRAY
+            ? JSON_EVT_CURSOR_END_ARRAY : JSON_EVT_CURSOR_END_HASH);
+        cur->tok = rv;
+    }
+
+    return rv;
+}
+
+uint
+jsonevt_cursor_skip_rest(jsonevt_cursor * cur) {
+    if (cur->state == CURSOR_STATE_ERROR) {
+        return JSON_EVT_CURSOR_ERROR;
+    }
+
+    if (cur->depth == 0) {
+        cur->state = CURSOR_STATE_DONE;
+        cur->pos = cur->len;
+        cur->tok = JSON_EVT_CURSOR_END;
+        return JSON_EVT_CURSOR_END;
+    }
+
+    UNLESS (skip_to_container_end(cur)) {
+        return JSON_EVT_CURSOR_ERROR;
+    }
+
+    return end_container(cur, cur->stack[cur->depth - 1] == CURSOR_IN_ARRAY
+        ? JSON_EVT_CURSOR_END_ARRAY : JSON_EVT_CURSOR_END_HASH);
+}
+
+uint
+jsonevt_cursor_depth(jsonevt_cursor * cur) {
+    return cur->depth;
+}
+
+static uint
+hex_value(const char * s, uint n) {
+    uint val = 0;
+    uint i;
+    char c;
+
+    for (i = 0; i < n; i++) {
+        c = s[i];
+        if (IS_DIGIT(c)) {
+            val = val * 16 + (c - '0');
+        }
+        else if (c >= 'a' && c <= 'f') {
+            val = val * 16 + (c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F') {
+            val = val * 16 + (c - 'A' + 10);
+        }
+        else {
+            return ~(uint)0;
+        }
+    }
+
+    return val;
+}
+
+const char *
+jsonevt_cursor_get_string(jsonevt_cursor * cur, uint * len) {
+    const char * s;
+    uint n;
+    uint i;
+    uint out = 0;
+    uint code_point;
+    uint low;
+    uint pair;
+    uint hex_len;
+    char c;
+
+    if (cur->tok != JSON_EVT_CURSOR_STRING && cur->tok != JSON_EVT_CURSOR_KEY) {
+        return NULL;
+    }
+
+    s = &cur->buf[cur->tok_start];
+    n = cur->tok_len;
+
+    if (! (cur->tok_flags & CURSOR_TOK_HAS_ESCAPE)) {
+        if (len) {
+            *len = n;
+        }
+        return s;
+    }
+
+    /* an escape never decodes to more bytes than it takes up */
+    if (n + 1 > cur->str_buf_size) {
+        cur->str_buf_size = n + 1;
+        JSONEVT_RENEW(cur->str_buf, cur->str_buf_size, char);
+    }
+
+    for (i = 0; i < n; i++) {
+        c = s[i];
+        if (c != '\\') {
+            cur->str_buf[out++] = c;
+            continue;
+        }
+
+        c = s[++i];
+        switch (c) {
+          case 'b': cur->str_buf[out++] = 0x08; break;
+          case 'n': cur->str_buf[out++] = 0x0a; break;
+          case 'v': cur->str_buf[out++] = 0x0b; break;
+          case 'f': cur->str_buf[out++] = 0x0c; break;
+          case 'r': cur->str_buf[out++] = 0x0d; break;
+          case 't': cur->str_buf[out++] = 0x09; break;
+
+          case 'x':
+          case 'u':
+              hex_len = c == 'x' ? 2 : 4;
+              code_point = i + hex_len < n ? hex_value(&s[i + 1], hex_len) : ~(uint)0;
+              if (code_point == ~(uint)0) {
+                  set_error(cur, cur->tok_start + i + 1, c == 'x'
+                      ? "bad hex escape character specification" : "bad unicode character specification");
+                  return NULL;
+              }
+              i += hex_len;
+
+              /* a surrogate pair is a single character */
+              if (c == 'u' && i + 6 < n && s[i + 1] == '\\' && s[i + 2] == 'u') {
+                  low = hex_value(&s[i + 3], 4);
+                  pair = low == ~(uint)0 ? 0 : utf16_surrogate_pair_to_unicode(code_point, low);
+                  if (pair) {
+                      code_point = pair;
+                      i += 6;
+                  }
+              }
+
+              out += utf8_unicode_to_bytes(code_point, (uint8_t *)&cur->str_buf[out]);
+              break;
+
+          default:
+              /* everything else, including quotes, backslash, and '/', is literal */
+              cur->str_buf[out++] = c;
+              break;
+        }
+    }
+
+    cur->str_buf[out] = '\x00';
+    if (len) {
+        *len = out;
+    }
+
+    return cur->str_buf;
+}
+
+int
+jsonevt_cursor_key_is(jsonevt_cursor * cur, const char * key, uint key_len) {
+    const char * s;
+    uint len;
+
+    if (cur->tok != JSON_EVT_CURSOR_KEY) {
+        return 0;
+    }
+
+    /* keys without escapes are compared in place */
+    if (! (cur->tok_flags & CURSOR_TOK_HAS_ESCAPE)) {
+        return cur->tok_len == key_len && memcmp(&cur->buf[cur->tok_start], key, key_len) == 0;
+    }
+
+    s = jsonevt_cursor_get_string(cur, &len);
+
+    return s && len == key_len && memcmp(s, key, key_len) == 0;
+}
+
+const char *
+jsonevt_cursor_get_number_str(jsonevt_cursor * cur, uint * len) {
+    if (cur->tok != JSON_EVT_CURSOR_NUMBER) {
+        return NULL;
+    }
+
+    if (len) {
+        *len = cur->tok_len;
+    }
+
+    return &cur->buf[cur->tok_start];
+}
+
+int
+jsonevt_cursor_get_number(jsonevt_cursor * cur, jsonevt_number * num) {
+    const char * buf = &cur->buf[cur->tok_start];
+    uint len = cur->tok_len;
+    uint pos = 0;
+    uint flags;
+    jsonevt_number_acc acc;
+
+    if (cur->tok != JSON_EVT_CURSOR_NUMBER) {
+        return 0;
+    }
+
+    flags = cur->tok_flags;
+    memzero((void *)&acc, sizeof(acc));
+
+    if (flags & JSON_EVT_PARSE_NUMBER_HAVE_SIGN) {
+        pos++;
+    }
+
+    pos += jsonevt_number_scan_digits(&buf[pos], len - pos, &acc, JSONEVT_NUMBER_INT_PART);
+
+    if (pos < len && buf[pos] == '.') {
+        pos++;
+        pos += jsonevt_number_scan_digits(&buf[pos], len - pos, &acc, JSONEVT_NUMBER_FRACTION_PART);
+    }
+
+    if (pos < len && (buf[pos] == 'e' || buf[pos] == 'E')) {
+        pos++;
+        if (pos < len && (buf[pos] == '+' || buf[pos] == '-')) {
+            acc.exp_negative = buf[pos] == '-';
+            pos++;
+        }
+        jsonevt_number_scan_digits(&buf[pos], len - pos, &acc, JSONEVT_NUMBER_EXPONENT_PART);
+    }
+
+    jsonevt_number_finish(&acc, buf, len, &flags, num);
+
+    return 1;
+}
+
+int
+jsonevt_cursor_get_bool(jsonevt_cursor * cur) {
+    return cur->tok == JSON_EVT_CURSOR_BOOL && (cur->tok_flags & CURSOR_TOK_TRUE) ? 1 : 0;
+}
+
+const char *
+jsonevt_cursor_get_error(jsonevt_cursor * cur) {
+    return cur->error;
+}
@@ -0,0 +1,78 @@
+/* Creation date: 2026-10-18T01:12:09Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+
+/* $Revision$ */
+
+/*
+  State of a jsonevt_cursor.  The cursor never looks further ahead than
+  the token it is returning, and strings and numbers are only decoded
+  when asked for, so skipping a value costs no more than finding where
+  it ends.
+*/
+
+#ifndef JSONEVT_CURSOR_H
+#define JSONEVT_CURSOR_H
+
+#include "jsonevt.h"
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+/* what the cursor expects to see next */
+#define CURSOR_STATE_START       0  /* the top-level value */
+#define CURSOR_STATE_ARRAY_FIRST 1  /* an element or ']' */
+#define CURSOR_STATE_ARRAY_NEXT  2  /* ',' or ']' */
+#define CURSOR_STATE_HASH_FIRST  3  /* a key or '}' */
+#define CURSOR_STATE_HASH_NEXT   4  /* ',' or '}' */
+#define CURSOR_STATE_HASH_VALUE  5  /* ':' and a value */
+#define CURSOR_STATE_DONE        6
+#define CURSOR_STATE_ERROR       7
+
+#define CURSOR_IN_ARRAY 1
+#define CURSOR_IN_HASH  2
+
+/* token flags, on top of the JSON_EVT_PARSE_NUMBER_* flags for numbers */
+#define CURSOR_TOK_HAS_ESCAPE (1 << 4)
+#define CURSOR_TOK_TRUE       (1 << 5)
+
+struct jsonevt_cursor_struct {
+    const char * buf;
+    uint len;
+    uint pos;
+
+    uint state;
+    uint tok;
+    uint tok_start;  /* for strings, the byte after the opening quote */
+    uint tok_len;
+    uint tok_flags;
+
+    uint8_t * stack; /* CURSOR_IN_ARRAY or CURSOR_IN_HASH for each open container */
+    uint depth;
+    uint stack_size;
+
+    char * str_buf;  /* decoded strings that had escapes in them */
+    uint str_buf_size;
+
+    char * error;
+};
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_CURSOR_H */
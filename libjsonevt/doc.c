@@ -0,0 +1,658 @@
+/* Creation date: 2026-10-18T00:20:37Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+#include "doc.h"
+#include "jsonevt_utils.h"
+
+#include <string.h>
+
+#define UNLESS(stuff) if (! stuff)
+
+#define DOC_INITIAL_STACK_SIZE 32
+
+static void
+tape_reserve(doc_builder * b, uint words) {
+    if (b->tape_len + words > b->tape_size) {
+        while (b->tape_len + words > b->tape_size) {
+            b->tape_size *= 2;
+        }
+        JSONEVT_RENEW(b->tape, b->tape_size, uint64_t);
+    }
+}
+
+/* every value counts toward the size of the array or hash it is in */
+static void
+count_value(doc_builder * b) {
+    if (b->depth) {
+        b->stack[b->depth - 1].count++;
+    }
+}
+
+static int
+doc_string_callback(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    doc_builder * b = (doc_builder *)cb_data;
+    uint32_t len32 = (uint32_t)data_len;
+    uint need = sizeof(len32) + data_len + 1;
+
+    if (! (flags & JSON_EVT_IS_HASH_KEY)) {
+        count_value(b);
+    }
+
+    if (b->arena_len + need > b->arena_size) {
+        while (b->arena_len + need > b->arena_size) {
+            b->arena_size *= 2;
+        }
+        JSONEVT_RENEW(b->arena, b->arena_size, char);
+    }
+
+    tape_reserve(b, 1);
+    b->tape[b->tape_len++] = DOC_WORD(DOC_TAG_STRING, b->arena_len);
+
+    memcpy((void *)&b->arena[b->arena_len], (const void *)&len32, sizeof(len32));
+    memcpy((void *)&b->arena[b->arena_len + sizeof(len32)], (const void *)data, data_len);
+    b->arena[b->arena_len + sizeof(len32) + data_len] = '\x00';
+    b->arena_len += need;
+
+    return 0;
+}
+
+static int
+doc_number_callback(void * cb_data, const char * data, uint data_len, const jsonevt_number * num,
+    uint flags, uint level) {
+    doc_builder * b = (doc_builder *)cb_data;
+    uint64_t val;
+
+    count_value(b);
+    tape_reserve(b, 2);
+
+    switch (num->type) {
+      case JSON_EVT_NUMBER_INT64:
+          b->tape[b->tape_len++] = DOC_WORD(DOC_TAG_INT64, 0);
+          val = (uint64_t)num->val.i;
+          break;
+
+      case JSON_EVT_NUMBER_UINT64:
+          b->tape[b->tape_len++] = DOC_WORD(DOC_TAG_UINT64, 0);
+          val = num->val.u;
+          break;
+
+      default:
+          b->tape[b->tape_len++] = DOC_WORD(DOC_TAG_DOUBLE, 0);
+          memcpy((void *)&val, (const void *)&num->val.d, sizeof(val));
+          break;
+    }
+
+    b->tape[b->tape_len++] = val;
+
+    return 0;
+}
+
+static int
+doc_bool_callback(void * cb_data, uint bool_val, uint flags, uint level) {
+    doc_builder * b = (doc_builder *)cb_data;
+
+    count_value(b);
+    tape_reserve(b, 1);
+    b->tape[b->tape_len++] = DOC_WORD(bool_val ? DOC_TAG_TRUE : DOC_TAG_FALSE, 0);
+
+    return 0;
+}
+
+static int
+doc_null_callback(void * cb_data, uint flags, uint level) {
+    doc_builder * b = (doc_builder *)cb_data;
+
+    count_value(b);
+    tape_reserve(b, 1);
+    b->tape[b->tape_len++] = DOC_WORD(DOC_TAG_NULL, 0);
+
+    return 0;
+}
+
+static int
+begin_container(doc_builder * b, uint tag) {
+    count_value(b);
+
+    if (b->depth >= b->stack_size) {
+        b->stack_size *= 2;
+        JSONEVT_RENEW(b->stack, b->stack_size, doc_open_container);
+    }
+
+    b->stack[b->depth].start = b->tape_len;
+    b->stack[b->depth].count = 0;
+    b->depth++;
+
+    /* filled in when the container ends */
+    tape_reserve(b, 1);
+    b->tape[b->tape_len++] = DOC_WORD(tag, 0);
+
+    return 0;
+}
+
+static int
+end_container(doc_builder * b, uint start_tag, uint end_tag) {
+    doc_open_container * c;
+    uint count;
+
+    b->depth--;
+    c = &b->stack[b->depth];
+    count = c->count > DOC_MAX_COUNT ? DOC_MAX_COUNT : c->count;
+
+    tape_reserve(b, 1);
+    b->tape[c->start] = DOC_CONTAINER_WORD(start_tag, b->tape_len, count);
+    b->tape[b->tape_len++] = DOC_WORD(end_tag, c->start);
+
+    return 0;
+}
+
+static int
+doc_begin_array_callback(void * cb_data, uint flags, uint level) {
+    return begin_container((doc_builder *)cb_data, DOC_TAG_ARRAY_START);
+}
+
+static int
+doc_end_array_callback(void * cb_data, uint flags, uint level) {
+    return end_container((doc_builder *)cb_data, DOC_TAG_ARRAY_START, DOC_TAG_ARRAY_END);
+}
+
+static int
+doc_begin_hash_callback(void * cb_data, uint flags, uint level) {
+    return begin_container((doc_builder *)cb_data, DOC_TAG_HASH_START);
+}
+
+static int
+doc_end_hash_callback(void * cb_data, uint flags, uint level) {
+    return end_container((doc_builder *)cb_data, DOC_TAG_HASH_START, DOC_TAG_HASH_END);
+}
+
+/* Move the tape and arena into a single block along with the struct. */
+jsonevt_doc *
+jsonevt_doc_builder_finish(doc_builder * b) {
+    jsonevt_doc * doc;
+    char * block;
+    size_t tape_off = (sizeof(jsonevt_doc) + 7) & ~(size_t)7;
+    size_t arena_off = tape_off + (size_t)b->tape_len * sizeof(uint64_t);
+
+    JSONEVT_NEW(block, arena_off + b->arena_len, char);
+    doc = (jsonevt_doc *)block;
+
+    doc->tape_len = b->tape_len;
+    doc->arena_len = b->arena_len;
+    doc->tape = (uint64_t *)(block + tape_off);
+    doc->arena = block + arena_off;
+
+    memcpy((void *)doc->tape, (const void *)b->tape, (size_t)b->tape_len * sizeof(uint64_t));
+    if (b->arena_len) {
+        memcpy((void *)doc->arena, (const void *)b->arena, b->arena_len);
+    }
+
+    doc->tape[0] = DOC_WORD(DOC_TAG_ROOT, doc->tape_len);
+
+    return doc;
+}
+
+void
+jsonevt_doc_builder_init(doc_builder * b, uint len, int with_root) {
+    memset((void *)b, 0, sizeof(*b));
+
+    /* a guess based on the size of the input, to start with */
+    b->tape_size = len / 8 + 16;
+    b->arena_size = len / 2 + 64;
+    b->stack_size = DOC_INITIAL_STACK_SIZE;
+    JSONEVT_NEW(b->tape, b->tape_size, uint64_t);
+    JSONEVT_NEW(b->arena, b->arena_size, char);
+    JSONEVT_NEW(b->stack, b->stack_size, doc_open_container);
+
+    if (with_root) {
+        b->tape[b->tape_len++] = DOC_WORD(DOC_TAG_ROOT, 0);
+    }
+}
+
+void
+jsonevt_doc_builder_free(doc_builder * b) {
+    if (b->tape) {
+        JSONEVT_FREE_MEM(b->tape);
+    }
+    if (b->arena) {
+        JSONEVT_FREE_MEM(b->arena);
+    }
+    if (b->stack) {
+        JSONEVT_FREE_MEM(b->stack);
+    }
+
+    memset((void *)b, 0, sizeof(*b));
+}
+
+/* Set all of the callbacks, to the ones here if b is not NULL, and to
+   NULL otherwise. */
+void
+jsonevt_doc_builder_attach(jsonevt_ctx * ctx, doc_builder * b) {
+    int use_doc = b != NULL;
+
+    jsonevt_set_cb_data(ctx, b);
+
+    jsonevt_set_string_cb(ctx, use_doc ? doc_string_callback : NULL);
+    jsonevt_set_typed_number_cb(ctx, use_doc ? doc_number_callback : NULL);
+    jsonevt_set_bool_cb(ctx, use_doc ? doc_bool_callback : NULL);
+    jsonevt_set_null_cb(ctx, use_doc ? doc_null_callback : NULL);
+    jsonevt_set_begin_array_cb(ctx, use_doc ? doc_begin_array_callback : NULL);
+    jsonevt_set_end_array_cb(ctx, use_doc ? doc_end_array_callback : NULL);
+    jsonevt_set_begin_hash_cb(ctx, use_doc ? doc_begin_hash_callback : NULL);
+    jsonevt_set_end_hash_cb(ctx, use_doc ? doc_end_hash_callback : NULL);
+
+    jsonevt_set_number_cb(ctx, NULL);
+    jsonevt_set_begin_array_element_cb(ctx, NULL);
+    jsonevt_set_end_array_element_cb(ctx, NULL);
+    jsonevt_set_begin_hash_entry_cb(ctx, NULL);
+    jsonevt_set_end_hash_entry_cb(ctx, NULL);
+    jsonevt_set_comment_cb(ctx, NULL);
+}
+
+/*
+  Put together the document for an array whose elements were built in
+  parts (without root words), in order.  The words of each part are
+  moved up by where the part ends up in the tape, and its strings by
+  where its arena ends up.  Returns NULL if the result would be too
+  big for the 32-bit tape and arena offsets.
+*/
+jsonevt_doc *
+jsonevt_doc_merge_array(doc_builder ** parts, uint num_parts, uint64_t num_elements) {
+    jsonevt_doc * doc;
+    char * block;
+    size_t tape_len = 3;  /* root, array start, array end */
+    size_t arena_len = 0;
+    size_t tape_off;
+    size_t arena_off;
+    size_t t;
+    size_t a;
+    uint i;
+    uint j;
+    uint64_t w;
+    uint64_t * out;
+    uint tag;
+
+    for (i = 0; i < num_parts; i++) {
+        tape_len += parts[i]->tape_len;
+        arena_len += parts[i]->arena_len;
+    }
+
+    if (tape_len > 0xffffffffUL || arena_len > 0xffffffffUL) {
+        return NULL;
+    }
+
+    tape_off = (sizeof(jsonevt_doc) + 7) & ~(size_t)7;
+    arena_off = tape_off + tape_len * sizeof(uint64_t);
+
+    JSONEVT_NEW(block, arena_off + arena_len, char);
+    doc = (jsonevt_doc *)block;
+
+    doc->tape_len = (uint)tape_len;
+    doc->arena_len = (uint)arena_len;
+    doc->tape = (uint64_t *)(block + tape_off);
+    doc->arena = block + arena_off;
+
+    doc->tape[0] = DOC_WORD(DOC_TAG_ROOT, tape_len);
+    doc->tape[1] = DOC_CONTAINER_WORD(DOC_TAG_ARRAY_START, tape_len - 1,
+        num_elements > DOC_MAX_COUNT ? DOC_MAX_COUNT : num_elements);
+    doc->tape[tape_len - 1] = DOC_WORD(DOC_TAG_ARRAY_END, 1);
+
+    t = 2;
+    a = 0;
+    for (i = 0; i < num_parts; i++) {
+        out = &doc->tape[t];
+
+        for (j = 0; j < parts[i]->tape_len; j++) {
+            w = parts[i]->tape[j];
+            tag = DOC_WORD_TAG(w);
+
+            switch (tag) {
+              case DOC_TAG_INT64:
+              case DOC_TAG_UINT64:
+              case DOC_TAG_DOUBLE:
+                  /* the value word is not a tagged word */
+                  out[j] = w;
+                  j++;
+                  out[j] = parts[i]->tape[j];
+                  break;
+
+              case DOC_TAG_STRING:
+                  out[j] = DOC_WORD(tag, DOC_WORD_PAYLOAD(w) + a);
+                  break;
+
+              case DOC_TAG_ARRAY_START:
+              case DOC_TAG_HASH_START:
+                  out[j] = DOC_CONTAINER_WORD(tag, DOC_CONTAINER_END(w) + t, DOC_CONTAINER_COUNT(w));
+                  break;
+
+              case DOC_TAG_ARRAY_END:
+              case DOC_TAG_HASH_END:
+                  out[j] = DOC_WORD(tag, DOC_WORD_PAYLOAD(w) + t);
+                  break;
+
+              default:
+                  out[j] = w;
+                  break;
+            }
+        }
+
+        if (parts[i]->arena_len) {
+            memcpy((void *)&doc->arena[a], (const void *)parts[i]->arena, parts[i]->arena_len);
+        }
+
+        t += parts[i]->tape_len;
+        a += parts[i]->arena_len;
+    }
+
+    return doc;
+}
+
+jsonevt_doc *
+jsonevt_doc_parse(jsonevt_ctx * ctx, const char * buf, uint len) {
+    doc_builder b;
+    jsonevt_doc * doc = NULL;
+
+    jsonevt_doc_builder_init(&b, len, 1);
+
+    jsonevt_doc_builder_attach(ctx, &b);
+
+    if (jsonevt_parse(ctx, buf, len)) {
+        doc = jsonevt_doc_builder_finish(&b);
+    }
+
+    /* so a later parse with ctx doesn't call back into b */
+    jsonevt_doc_builder_attach(ctx, NULL);
+
+    jsonevt_doc_builder_free(&b);
+
+    return doc;
+}
+
+void
+jsonevt_doc_free(jsonevt_doc * doc) {
+    if (doc) {
+        JSONEVT_FREE_MEM(doc);
+    }
+}
+
+/* the word for node, or 0 if there isn't one */
+static uint64_t
+node_word(const jsonevt_doc * doc, uint node) {
+    if (node == 0 || node >= doc->tape_len) {
+        return 0;
+    }
+
+    return doc->tape[node];
+}
+
+uint
+jsonevt_doc_root(const jsonevt_doc * doc) {
+    return doc->tape_len > 1 ? 1 : 0;
+}
+
+uint
+jsonevt_doc_type(const jsonevt_doc * doc, uint node) {
+    switch (DOC_WORD_TAG(node_word(doc, node))) {
+      case DOC_TAG_NULL:
+          return JSON_EVT_DOC_NULL;
+
+      case DOC_TAG_TRUE:
+      case DOC_TAG_FALSE:
+          return JSON_EVT_DOC_BOOL;
+
+      case DOC_TAG_INT64:
+          return JSON_EVT_DOC_INT64;
+
+      case DOC_TAG_UINT64:
+          return JSON_EVT_DOC_UINT64;
+
+      case DOC_TAG_DOUBLE:
+          return JSON_EVT_DOC_DOUBLE;
+
+      case DOC_TAG_STRING:
+          return JSON_EVT_DOC_STRING;
+
+      case DOC_TAG_ARRAY_START:
+          return JSON_EVT_DOC_ARRAY;
+
+      case DOC_TAG_HASH_START:
+          return JSON_EVT_DOC_HASH;
+
+      default:
+          return JSON_EVT_DOC_NONE;
+    }
+}
+
+int
+jsonevt_doc_get_bool(const jsonevt_doc * doc, uint node) {
+    return DOC_WORD_TAG(node_word(doc, node)) == DOC_TAG_TRUE;
+}
+
+int
+jsonevt_doc_get_int64(const jsonevt_doc * doc, uint node, int64_t * val) {
+    uint tag = DOC_WORD_TAG(node_word(doc, node));
+    uint64_t w;
+    double d;
+
+    if (tag == DOC_TAG_INT64) {
+        *val = (int64_t)doc->tape[node + 1];
+        return 1;
+    }
+
+    if (tag == DOC_TAG_UINT64) {
+        w = doc->tape[node + 1];
+        if (w > (uint64_t)INT64_MAX) {
+            return 0;
+        }
+        *val = (int64_t)w;
+        return 1;
+    }
+
+    if (tag == DOC_TAG_DOUBLE) {
+        memcpy((void *)&d, (const void *)&doc->tape[node + 1], sizeof(d));
+        if (! (d >= -9223372036854775808.0 && d < 9223372036854775808.0) || d != (double)(int64_t)d) {
+            return 0;
+        }
+        *val = (int64_t)d;
+        return 1;
+    }
+
+    return 0;
+}
+
+int
+jsonevt_doc_get_uint64(const jsonevt_doc * doc, uint node, uint64_t * val) {
+    uint tag = DOC_WORD_TAG(node_word(doc, node));
+    double d;
+
+    if (tag == DOC_TAG_UINT64) {
+        *val = doc->tape[node + 1];
+        return 1;
+    }
+
+    if (tag == DOC_TAG_INT64) {
+        if ((int64_t)doc->tape[node + 1] < 0) {
+            return 0;
+        }
+        *val = doc->tape[node + 1];
+        return 1;
+    }
+
+    if (tag == DOC_TAG_DOUBLE) {
+        memcpy((void *)&d, (const void *)&doc->tape[node + 1], sizeof(d));
+        if (! (d >= 0.0 && d < 18446744073709551616.0) || d != (double)(uint64_t)d) {
+            return 0;
+        }
+        *val = (uint64_t)d;
+        return 1;
+    }
+
+    return 0;
+}
+
+int
+jsonevt_doc_get_double(const jsonevt_doc * doc, uint node, double * val) {
+    switch (DOC_WORD_TAG(node_word(doc, node))) {
+      case DOC_TAG_DOUBLE:
+          memcpy((void *)val, (const void *)&doc->tape[node + 1], sizeof(*val));
+          return 1;
+
+      case DOC_TAG_INT64:
+          *val = (double)(int64_t)doc->tape[node + 1];
+          return 1;
+
+      case DOC_TAG_UINT64:
+          *val = (double)doc->tape[node + 1];
+          return 1;
+
+      default:
+          return 0;
+    }
+}
+
+const char *
+jsonevt_doc_get_string(const jsonevt_doc * doc, uint node, uint * len) {
+    uint64_t w = node_word(doc, node);
+    const char * s;
+    uint32_t len32;
+
+    if (DOC_WORD_TAG(w) != DOC_TAG_STRING) {
+        return NULL;
+    }
+
+    s = &doc->arena[DOC_WORD_PAYLOAD(w)];
+    memcpy((void *)&len32, (const void *)s, sizeof(len32));
+    if (len) {
+        *len = len32;
+    }
+
+    return s + sizeof(len32);
+}
+
+uint
+jsonevt_doc_get_size(const jsonevt_doc * doc, uint node) {
+    uint64_t w = node_word(doc, node);
+    uint count;
+    uint child;
+
+    if (DOC_WORD_TAG(w) != DOC_TAG_ARRAY_START && DOC_WORD_TAG(w) != DOC_TAG_HASH_START) {
+        return 0;
+    }
+
+    count = DOC_CONTAINER_COUNT(w);
+    if (count < DOC_MAX_COUNT) {
+        return count;
+    }
+
+    /* too many to fit in the word, so count them */
+    count = 0;
+    for (child = jsonevt_doc_first_child(doc, node); child;
+         child = jsonevt_doc_next_sibling(doc, child)) {
+        count++;
+    }
+
+    return DOC_WORD_TAG(w) == DOC_TAG_HASH_START ? count / 2 : count;
+}
+
+uint
+jsonevt_doc_first_child(const jsonevt_doc * doc, uint node) {
+    uint64_t w = node_word(doc, node);
+
+    if (DOC_WORD_TAG(w) != DOC_TAG_ARRAY_START && DOC_WORD_TAG(w) != DOC_TAG_HASH_START) {
+        return 0;
+    }
+
+    return DOC_CONTAINER_END(w) == node + 1 ? 0 : node + 1;
+}
+
+uint
+jsonevt_doc_next_sibling(const jsonevt_doc * doc, uint node) {
+    uint64_t w = node_word(doc, node);
+    uint next;
+
+    switch (DOC_WORD_TAG(w)) {
+      case DOC_TAG_ARRAY_START:
+      case DOC_TAG_HASH_START:
+          next = DOC_CONTAINER_END(w) + 1;
+          break;
+
+      case DOC_TAG_INT64:
+      case DOC_TAG_UINT64:
+      case DOC_TAG_DOUBLE:
+          next = node + 2;
+          break;
+
+      case 0:
+          return 0;
+
+      default:
+          next = node + 1;
+          break;
+    }
+
+    /* the end of the enclosing array or hash, or of the tape */
+    switch (DOC_WORD_TAG(node_word(doc, next))) {
+      case DOC_TAG_ARRAY_END:
+      case DOC_TAG_HASH_END:
+      case 0:
+          return 0;
+
+      default:
+          return next;
+    }
+}
+
+uint
+jsonevt_doc_array_get(const jsonevt_doc * doc, uint node, uint i) {
+    uint child;
+
+    if (DOC_WORD_TAG(node_word(doc, node)) != DOC_TAG_ARRAY_START) {
+        return 0;
+    }
+
+    for (child = jsonevt_doc_first_child(doc, node); child && i;
+         child = jsonevt_doc_next_sibling(doc, child)) {
+        i--;
+    }
+
+    return child;
+}
+
+uint
+jsonevt_doc_hash_get(const jsonevt_doc * doc, uint node, const char * key, uint key_len) {
+    uint child;
+    const char * s;
+    uint len;
+
+    if (DOC_WORD_TAG(node_word(doc, node)) != DOC_TAG_HASH_START) {
+        return 0;
+    }
+
+    for (child = jsonevt_doc_first_child(doc, node); child;
+         child = jsonevt_doc_next_sibling(doc, jsonevt_doc_next_sibling(doc, child))) {
+        s = jsonevt_doc_get_string(doc, child, &len);
+        if (s && len == key_len && memcmp(s, key, key_len) == 0) {
+            return child + 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/* Creation date: 2026-10-18T00:20:37Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Layout of a jsonevt_doc.  The document is a tape of 64-bit words,
+  one per node (two for numbers), in the order the values appear in
+  the input.  The top 8 bits of each word are the tag, and the other
+  56 the payload:
+
+    DOC_TAG_ROOT         word 0 -- payload is the number of words in the tape
+    DOC_TAG_NULL, DOC_TAG_TRUE, DOC_TAG_FALSE
+    DOC_TAG_INT64, DOC_TAG_UINT64, DOC_TAG_DOUBLE
+                         the value is in the next word
+    DOC_TAG_STRING       payload is the offset of the string in the arena,
+                         where it is stored as a uint32_t length, the
+                         bytes, and a NUL
+    DOC_TAG_ARRAY_START, DOC_TAG_HASH_START
+                         low 32 bits of the payload are the index of the
+                         matching end word, and the next 24 are the
+                         number of elements or entries (DOC_MAX_COUNT if
+                         there are more)
+    DOC_TAG_ARRAY_END, DOC_TAG_HASH_END
+                         payload is the index of the start word
+
+  The members of a hash are its keys and values in turn, so the next
+  node after a container is always the word after its end word.  The
+  struct, tape, and arena are all in one allocation.
+*/
+
+#ifndef JSONEVT_DOC_H
+#define JSONEVT_DOC_H
+
+#include "jsonevt.h"
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+#define DOC_TAG_ROOT        'r'
+#define DOC_TAG_NULL        'n'
+#define DOC_TAG_TRUE        't'
+#define DOC_TAG_FALSE       'f'
+#define DOC_TAG_INT64       'l'
+#define DOC_TAG_UINT64      'u'
+#define DOC_TAG_DOUBLE      'd'
+#define DOC_TAG_STRING      '"'
+#define DOC_TAG_ARRAY_START '['
+#define DOC_TAG_ARRAY_END   ']'
+#define DOC_TAG_HASH_START  '{'
+#define DOC_TAG_HASH_END    '}'
+
+#define DOC_MAX_COUNT 0xffffff
+
+#define DOC_WORD(tag, payload) ( ((uint64_t)(tag) << 56) | ((uint64_t)(payload) & 0xffffffffffffffULL) )
+#define DOC_WORD_TAG(w)     ( (uint)((w) >> 56) )
+#define DOC_WORD_PAYLOAD(w) ( (w) & 0xffffffffffffffULL )
+
+#define DOC_CONTAINER_WORD(tag, end, count) DOC_WORD(tag, ((uint64_t)(count) << 32) | (uint32_t)(end))
+#define DOC_CONTAINER_END(w)   ( (uint)((w) & 0xffffffff) )
+#define DOC_CONTAINER_COUNT(w) ( (uint)(((w) >> 32) & DOC_MAX_COUNT) )
+
+struct jsonevt_doc_struct {
+    uint tape_len;
+    uint arena_len;
+    uint64_t * tape;
+    char * arena;
+};
+
+/* A document being built by the parse callbacks in doc.c. */
+typedef struct {
+    uint start;   /* tape index of the start word */
+    uint count;   /* elements or entries so far */
+} doc_open_container;
+
+typedef struct {
+    uint64_t * tape;
+    uint tape_len;
+    uint tape_size;
+
+    char * arena;
+    uint arena_len;
+    uint arena_size;
+
+    doc_open_container * stack;
+    uint depth;
+    uint stack_size;
+} doc_builder;
+
+void jsonevt_doc_builder_init(doc_builder * b, uint len, int with_root);
+void jsonevt_doc_builder_free(doc_builder * b);
+
+/* set the parse callbacks on ctx to add to b, or clear them if b is NULL */
+void jsonevt_doc_builder_attach(jsonevt_ctx * ctx, doc_builder * b);
+
+/* b must have been started with a root word */
+jsonevt_doc * jsonevt_doc_builder_finish(doc_builder * b);
+
+/* the document for an array whose elements were built in parts */
+jsonevt_doc * jsonevt_doc_merge_array(doc_builder ** parts, uint num_parts, uint64_t num_elements);
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_DOC_H */
@@ -23,6 +23,8 @@
 
 
 #include "jsonevt_private.h"
+#include "scan.h"
+#include "number.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -44,16 +46,22 @@ struct jsonevt_writer_data_struct {
 struct jsonevt_float_struct {
     WR_TYPE_PREFIX;
     double val;
+    size_t size;
+    char str[JSONEVT_NUMBER_BUF_SIZE]; /* val as JSON */
 };
 
 struct jsonevt_int_struct {
     WR_TYPE_PREFIX;
     long val;
+    size_t size;
+    char str[JSONEVT_NUMBER_BUF_SIZE]; /* val as JSON */
 };
 
 struct jsonevt_uint_struct {
     WR_TYPE_PREFIX;
     unsigned long val;
+    size_t size;
+    char str[JSONEVT_NUMBER_BUF_SIZE]; /* val as JSON */
 };
 
 struct jsonevt_bool_struct {
@@ -140,6 +148,13 @@ jsonevt_new_float(double val) {
     ctx->type = float_val;
     ctx->val = val;
 
+    ctx->size = jsonevt_format_double(val, ctx->str);
+    UNLESS (ctx->size) {
+        /* no way to write inf or nan in JSON */
+        memcpy(ctx->str, "null", 5);
+        ctx->size = 4;
+    }
+
     return ctx;
 }
 
@@ -150,6 +165,7 @@ jsonevt_new_int(long val) {
     memset(ctx, 0, sizeof(jsonevt_int));
     ctx->type = int_val;
     ctx->val = val;
+    ctx->size = jsonevt_format_int((int64_t)val, ctx->str);
 
     return ctx;
 }
@@ -161,6 +177,7 @@ jsonevt_new_uint(unsigned long val) {
     memset(ctx, 0, sizeof(jsonevt_uint));
     ctx->type = uint_val;
     ctx->val = val;
+    ctx->size = jsonevt_format_uint((uint64_t)val, ctx->str);
 
     return ctx;
 }
@@ -240,7 +257,12 @@ json_append_bytes(_jsonevt_buf * ctx, char * data, size_t length) {
     }
 
     if (ctx->max_size - ctx->used_size < length + 1) {
+        /* grow by doubling, so escaping a string one piece at a time
+           doesn't realloc for every escape */
         new_size = length + 1 + ctx->used_size;
+        if (new_size < ctx->max_size * 2) {
+            new_size = ctx->max_size * 2;
+        }
         _json_ensure_buf_size(ctx, new_size);
     }
 
@@ -277,22 +299,36 @@ json_get_str_buffer(_jsonevt_buf * ctx, size_t * size) {
 
 static _jsonevt_buf *
 _json_escape_c_buffer(char * str, size_t length, unsigned long options) {
-    _jsonevt_buf * ctx = json_new_buf(length + 1);
-    size_t i;
+    /* exactly enough room if nothing needs to be escaped */
+    _jsonevt_buf * ctx = json_new_buf(length + 2);
+    size_t i = 0;
+    size_t run_len;
     uint32_t this_char;
-    char * tmp_buf = NULL;
     uint32_t char_len = 0;
+    char esc_buf[16];
 
     /* opening quotes */
     json_append_one_byte(ctx, '"');
 
-    for (i = 0; i < length;) {
-        this_char = utf8_bytes_to_unicode((uint8_t *)str + i, length - i - 1, &char_len);
+    while (i < length) {
+        /* everything up to the next byte that may need escaping goes in as is */
+        run_len = jsonevt_scan_escape(str + i, length - i,
+            JSONEVT_SCAN_ESC_SOLIDUS | JSONEVT_SCAN_ESC_HIGH);
+        if (run_len) {
+            json_append_bytes(ctx, str + i, run_len);
+            i += run_len;
+
+            if (i >= length) {
+                break;
+            }
+        }
+
+        this_char = utf8_bytes_to_unicode((uint8_t *)str + i, length - i, &char_len);
         if (char_len == 0) {
             /* bad utf-8 sequence */
             /* for now, assume latin-1 and convert to utf-8 */
             char_len = 1;
-            this_char = str[i];
+            this_char = (uint8_t)str[i];
         }
 
         i += char_len;
@@ -333,12 +369,7 @@ _json_escape_c_buffer(char * str, size_t length, unsigned long options) {
 
           default:
               if (this_char < 0x1f || ( this_char >= 0x80 && (options & JSON_EVT_OPTION_ASCII) ) ) {
-                  /* FIXME: don't use js_asprintf -- instead convert
-                     the bits directly to hex nibbles
-                  */
-                  js_asprintf(&tmp_buf, "\\u%04x", this_char);
-                  json_append_bytes(ctx, tmp_buf, strlen(tmp_buf));
-                  free(tmp_buf); tmp_buf = NULL;
+                  json_append_bytes(ctx, esc_buf, jsonevt_u_escape(this_char, esc_buf));
               }
               else {
                   json_append_unicode_char(ctx, this_char);
@@ -553,6 +584,22 @@ jsonevt_get_data_string(jsonevt_writer_data *ctx, size_t *length_ptr) {
     else if (ctx->type == str) {
         return jsonevt_string_get_string((jsonevt_string *)ctx, length_ptr);
     }
+    else if (ctx->type == float_val) {
+        *length_ptr = ((jsonevt_float *)ctx)->size;
+        return ((jsonevt_float *)ctx)->str;
+    }
+    else if (ctx->type == int_val) {
+        *length_ptr = ((jsonevt_int *)ctx)->size;
+        return ((jsonevt_int *)ctx)->str;
+    }
+    else if (ctx->type == uint_val) {
+        *length_ptr = ((jsonevt_uint *)ctx)->size;
+        return ((jsonevt_uint *)ctx)->str;
+    }
+    else if (ctx->type == bool_val) {
+        *length_ptr = ((jsonevt_bool *)ctx)->val ? 4 : 5;
+        return ((jsonevt_bool *)ctx)->val ? "true" : "false";
+    }
 
     *length_ptr = 0;
     return NULL;
@@ -27,6 +27,8 @@
 */
 
 #include "jsonevt_private.h"
+#include "scan.h"
+#include "utf16.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -68,6 +70,7 @@ static fd flag_data[ ] =
         BFD(JSON_EVT_IS_C_COMMENT)
         BFD(JSON_EVT_IS_CPLUSPLUS_COMMENT)
         BFD(JSON_EVT_IS_PERL_COMMENT)
+        BFD(JSON_EVT_PARSE_NUMBER_OVERFLOW)
         { NULL, 0 }
     };
 
@@ -162,39 +165,135 @@ peek_char(json_context * ctx) {
     return ctx->cur_char;
 }
 
-static uint
+static JSONEVT_INLINE_FUNC uint
 next_char(json_context * ctx) {
     uint len = 0;
+    uint8_t byte;
 
     if (ctx->pos >= ctx->len) {
         return 0;
     }
 
-    if (JSON_IS_END_OF_LINE(ctx->cur_char)) {
-        ctx->cur_line++;
-        ctx->cur_byte_col = 0;
-        ctx->cur_char_col = 0;
-    }
-    else {
-        if (ctx->pos) {
-            ctx->cur_byte_col += ctx->cur_char_len;
-            ctx->cur_char_col++;
-        }
+    ctx->cur_byte_pos = ctx->pos;
+
+    byte = (uint8_t)ctx->buf[ctx->pos];
+    if (UTF8_BYTE_IS_INVARIANT(byte)) {
+        /* ascii -- no need to decode */
+        ctx->cur_char = byte;
+        ctx->cur_char_len = 1;
+        ctx->flags.have_char = 1;
+        ctx->pos++;
+
+        return byte;
     }
 
-    ctx->cur_byte_pos = ctx->pos;
-    ctx->cur_char = READ_CHAR(ctx, &len);
+    ctx->cur_char = json_utf8_to_uni_with_check(ctx, &ctx->buf[ctx->pos], ctx->len - ctx->pos,
+        &len, 0);
     ctx->cur_char_len = len;
-    ctx->cur_char_pos = ctx->char_pos;
 
     ctx->flags.have_char = 1;
 
     ctx->pos += len;
-    ctx->char_pos++;
 
     return ctx->cur_char;
 }
 
+#define SWAR_ONES      0x0101010101010101ULL
+#define SWAR_HIGH_BITS 0x8080808080808080ULL
+#define SWAR_HAS_ZERO_BYTE(w) ( ((w) - SWAR_ONES) & ~(w) & SWAR_HIGH_BITS )
+
+/* Decode the char at pos without reporting errors.  A bad byte is
+   taken as a char by itself, as the convert bad char policy does. */
+static uint
+decode_char_at(json_context * ctx, uint pos, uint * ret_len) {
+    const uint8_t * s = (const uint8_t *)&ctx->buf[pos];
+    uint code_point;
+
+    if (UTF8_BYTE_IS_INVARIANT(*s)) {
+        *ret_len = 1;
+        return (uint)*s;
+    }
+
+    code_point = utf8_bytes_to_unicode((uint8_t *)s, ctx->len - pos, ret_len);
+    if (code_point == 0) {
+        *ret_len = 1;
+        return (uint)*s;
+    }
+
+    return code_point;
+}
+
+/*
+  Work out the line, column, and char position of byte offset end in
+  the current buffer by counting from ctx->text_base.  This is only
+  done when an error is reported or the line and char stats are asked
+  for, so the parser itself only has to keep track of the byte offset.
+  Chars are decoded the same way next_char() does it, so a bad byte
+  that gets converted counts as one char.
+*/
+static void
+get_text_pos(json_context * ctx, uint end, jsonevt_text_pos * tp) {
+    const uint8_t * s = (const uint8_t *)ctx->buf;
+    uint i;
+    uint code_point;
+    uint char_len;
+    uint64_t w;
+
+    *tp = ctx->text_base;
+    i = tp->byte_pos;
+
+    if (i == 0 && ctx->base_byte_pos == 0 && ctx->pos > 0) {
+        /* next_char() has always counted an end of line at the very
+           start of the input twice, since it gets peeked first */
+        code_point = decode_char_at(ctx, 0, &char_len);
+        if (JSON_IS_END_OF_LINE(code_point)) {
+            tp->line++;
+        }
+    }
+
+    while (i < end) {
+        if (end - i >= 8) {
+            memcpy((void *)&w, (const void *)&s[i], 8);
+            if (! (w & SWAR_HIGH_BITS) && ! SWAR_HAS_ZERO_BYTE(w ^ (SWAR_ONES * 0x0a))) {
+                /* 8 ascii chars, none of them a line feed */
+                i += 8;
+                tp->char_pos += 8;
+                tp->byte_col += 8;
+                tp->char_col += 8;
+                continue;
+            }
+        }
+
+        code_point = decode_char_at(ctx, i, &char_len);
+        i += char_len;
+        tp->char_pos++;
+
+        if (JSON_IS_END_OF_LINE(code_point)) {
+            tp->line++;
+            tp->byte_col = 0;
+            tp->char_col = 0;
+        }
+        else {
+            tp->byte_col += char_len;
+            tp->char_col++;
+        }
+    }
+
+    tp->byte_pos = i;
+}
+
+/* The char position of the current char.  If the error being reported
+   is a bad char found by next_char(), the position reported has always
+   been that of the char before it. */
+static uint
+get_cur_char_pos(json_context * ctx, jsonevt_text_pos * tp) {
+    if (ctx->pos == CUR_POS(ctx) && tp->char_pos > 0) {
+        return tp->char_pos - 1;
+    }
+
+    return tp->char_pos;
+}
+
 static char *
 vset_error(json_context * ctx, char * file, uint line, char * fmt, va_list *ap) {
     char * error = NULL;
@@ -202,6 +301,8 @@ vset_error(json_context * ctx, char * file, uint line, char * fmt, va_list *ap)
     char * msg = NULL;
     int loc_len = 0;
     int msg_len = 0;
+    jsonevt_text_pos tp;
+    uint char_pos;
 
     if (! ctx->ext_ctx) {
         return NULL;
@@ -211,18 +312,21 @@ vset_error(json_context * ctx, char * file, uint line, char * fmt, va_list *ap)
         return ctx->ext_ctx->error;
     }
 
+    get_text_pos(ctx, CUR_POS(ctx), &tp);
+    char_pos = get_cur_char_pos(ctx, &tp);
+
 #if JSON_DO_DEBUG
     loc_len = js_asprintf(&loc, "%s (%u) v%u.%u.%u byte %u, char %u, line %u, col %u (byte col %u) - ",
         file, line, JSON_EVT_MAJOR_VERSION, JSON_EVT_MINOR_VERSION, JSON_EVT_PATCH_LEVEL,
-        CUR_POS(ctx), CUR_CHAR_POS(ctx), CUR_LINE(ctx), CUR_COL(ctx), CUR_BYTE_COL(ctx));
+        CUR_ABS_POS(ctx), char_pos, tp.line, tp.char_col, tp.byte_col);
 #else
 #if NO_VERSION_IN_ERROR
     loc_len = js_asprintf(&loc, "byte %u, char %u, line %u, col %u (byte col %u) - ",
-        CUR_POS(ctx), CUR_CHAR_POS(ctx), CUR_LINE(ctx), CUR_COL(ctx), CUR_BYTE_COL(ctx));
+        CUR_ABS_POS(ctx), char_pos, tp.line, tp.char_col, tp.byte_col);
 #else
     loc_len = js_asprintf(&loc, "v%u.%u.%u byte %u, char %u, line %u, col %u (byte col %u) - ",
         JSON_EVT_MAJOR_VERSION, JSON_EVT_MINOR_VERSION, JSON_EVT_PATCH_LEVEL,
-        CUR_POS(ctx), CUR_CHAR_POS(ctx), CUR_LINE(ctx), CUR_COL(ctx), CUR_BYTE_COL(ctx));
+        CUR_ABS_POS(ctx), char_pos, tp.line, tp.char_col, tp.byte_col);
 #endif
 #endif
 
@@ -234,11 +338,11 @@ vset_error(json_context * ctx, char * file, uint line, char * fmt, va_list *ap)
     error[loc_len + msg_len] = '\x00';
 
     ctx->ext_ctx->error = error;
-    ctx->ext_ctx->error_line = CUR_LINE(ctx);
-    ctx->ext_ctx->error_char_col = CUR_COL(ctx);
-    ctx->ext_ctx->error_byte_col = CUR_BYTE_COL(ctx);
-    ctx->ext_ctx->error_byte_pos = CUR_POS(ctx);
-    ctx->ext_ctx->error_char_pos = CUR_CHAR_POS(ctx);
+    ctx->ext_ctx->error_line = tp.line;
+    ctx->ext_ctx->error_char_col = tp.char_col;
+    ctx->ext_ctx->error_byte_col = tp.byte_col;
+    ctx->ext_ctx->error_byte_pos = CUR_ABS_POS(ctx);
+    ctx->ext_ctx->error_char_pos = char_pos;
 
     JSONEVT_FREE_MEM(msg);
     JSONEVT_FREE_MEM(loc);
@@ -258,6 +362,123 @@ set_error(json_context * ctx, char * file, uint line, char * fmt, ...) {
     return error;
 }
 
+typedef struct {
+    uint chars;      /* chars in the slice */
+} slice_info;
+
+/*
+  Check that the slice is utf-8 that the code point path would copy
+  through unchanged (no invalid or overlong sequences), counting chars
+  along the way.  Returns 0 otherwise, so that the caller can fall back
+  to the code point path and get the same conversions and errors.
+*/
+static int
+check_utf8_slice(const char * buf, uint len, slice_info * info) {
+    const uint8_t * s = (const uint8_t *)buf;
+    uint i = 0;
+    uint32_t code_point;
+    uint32_t char_len;
+    uint8_t tmp_bytes[4];
+    uint64_t w;
+
+    memzero((void *)info, sizeof(*info));
+
+    while (i < len) {
+        if (len - i >= 8) {
+            memcpy((void *)&w, (const void *)&s[i], 8);
+            if (! (w & SWAR_HIGH_BITS)) {
+                /* 8 ascii chars */
+                i += 8;
+                info->chars += 8;
+                continue;
+            }
+        }
+
+        if (UTF8_BYTE_IS_INVARIANT(s[i])) {
+            char_len = 1;
+        }
+        else {
+            code_point = utf8_bytes_to_unicode(&s[i], len - i, &char_len);
+            if (code_point == 0 || utf8_unicode_to_bytes(code_point, tmp_bytes) != char_len) {
+                return 0;
+            }
+        }
+
+        i += char_len;
+        info->chars++;
+    }
+
+    return 1;
+}
+
+/*
+  Make the char at end_pos the current char, as if next_char() had been
+  called for the current char and every char up to end_pos.
+*/
+static void
+skip_to_pos(json_context * ctx, uint end_pos) {
+    uint len = 0;
+
+    ctx->pos = end_pos;
+    ctx->cur_byte_pos = ctx->pos;
+    ctx->cur_char = READ_CHAR(ctx, &len);
+    ctx->cur_char_len = len;
+
+    ctx->flags.have_char = 1;
+
+    ctx->pos += len;
+}
+
+/*
+  The current char is ASCII whitespace.  Skip it and any ASCII
+  whitespace following it in one go.  The last byte in the buffer is
+  never skipped over, so the position at the end of the buffer is the
+  same as where next_char() leaves it.
+*/
+static void
+skip_ascii_whitespace(json_context * ctx) {
+    uint run;
+
+    run = jsonevt_scan_space(CUR_BUF(ctx), BYTES_LEFT(ctx) - 1);
+
+    skip_to_pos(ctx, BUF_POS(ctx) + run);
+}
+
+/*
+  Called with the current char being the last char of a '#' or '//'
+  that starts a comment.  Eats the rest of the line, including the end
+  of line char, and passes the text in between to the comment
+  callback.  Returns 0 on error.
+*/
+static int
+eat_line_comment(json_context * ctx, uint flags) {
+    const char * start = CUR_BUF(ctx);
+    const char * end;
+    uint this_char;
+
+    while (HAVE_MORE_CHARS(ctx)) {
+        this_char = NEXT_CHAR(ctx);
+        if (ERROR_IS_SET(ctx)) {
+            return 0;
+        }
+
+        if (this_char == 0x000a || this_char == 0x0085 || this_char == 0x2028) {
+            end = CUR_BUF(ctx) - ctx->cur_char_len;
+
+            /* eat the eol char */
+            NEXT_CHAR(ctx);
+            DO_COMMENT_CALLBACK_WITH_RET(ctx, start, end - start, flags);
+
+            return 1;
+        }
+    }
+
+    /* end of buffer */
+    DO_COMMENT_CALLBACK_WITH_RET(ctx, start, CUR_BUF(ctx) - start, flags);
+
+    return 1;
+}
+
 static int
 eat_whitespace(json_context *ctx, int commas_are_whitespace, uint line) {
     uint this_char;
@@ -279,20 +500,25 @@ eat_whitespace(json_context *ctx, int commas_are_whitespace, uint line) {
     while (keep_going && HAVE_MORE_CHARS(ctx)) {
         this_char = PEEK_CHAR(ctx);
 
-        if (this_char >= 0x0009 && this_char <= 0x000d) {
-            /* U+0009 - tab
+        if (this_char == 0x0020 || (this_char >= 0x0009 && this_char <= 0x000d)) {
+            /* U+0020 - space
+               U+0009 - tab
                U+000A - line feed
                U+000B - vertical tab
                U+000C - form feed
                U+000D - carriage return
 
              */
-            NEXT_CHAR(ctx);
+            if (BUF_POS(ctx)) {
+                skip_ascii_whitespace(ctx);
+            }
+            else {
+                NEXT_CHAR(ctx);
+            }
             continue;
         }
 
         switch (this_char) {
-          case 0x0020: /* space */
           case 0x0085: /* NEL - next line */
           case 0x00a0: /* NSBP - non-breaking space */
           case 0x200b: /* ZWSP - zero width space */
@@ -313,44 +539,28 @@ eat_whitespace(json_context *ctx, int commas_are_whitespace, uint line) {
               break;
 
           case '#':
-              tmp_buf = CUR_BUF(ctx);
-              while (HAVE_MORE_CHARS(ctx)) {
-                  this_char = NEXT_CHAR(ctx);
-                  if (this_char == 0x000a || this_char == 0x0085 || this_char == 0x2028) {
-                      /* eat the eol char */
-                      this_char = NEXT_CHAR(ctx);
-                      DO_COMMENT_CALLBACK_WITH_RET(ctx, tmp_buf,
-                          CUR_BUF(ctx) - tmp_buf - 1, JSON_EVT_IS_PERL_COMMENT);
-                      break;
-                  }
+              if (BUF_POS(ctx) == 0) {
+                  /* the '#' was only peeked at, so consume it first */
+                  NEXT_CHAR(ctx);
+              }
+
+              UNLESS (eat_line_comment(ctx, JSON_EVT_IS_PERL_COMMENT)) {
+                  return 0;
               }
-              
-              /* end of buffer */
-              DO_COMMENT_CALLBACK_WITH_RET(ctx, tmp_buf,
-                  CUR_BUF(ctx) - tmp_buf, JSON_EVT_IS_PERL_COMMENT);
-              
               break;
 
           case '/':
+              if (BUF_POS(ctx) == 0) {
+                  /* the '/' was only peeked at, so consume it first */
+                  NEXT_CHAR(ctx);
+              }
+
               this_char = NEXT_CHAR(ctx);
               if (this_char == '/') {
                   /* C++ style comment -- rest of line is a comment */
-                  tmp_buf = CUR_BUF(ctx);
-                  while (HAVE_MORE_CHARS(ctx)) {
-                      this_char = NEXT_CHAR(ctx);
-                      if (this_char == 0x000a || this_char == 0x0085 || this_char == 0x2028) {
-                          /* eat the eol char */
-                          this_char = NEXT_CHAR(ctx);
-                          DO_COMMENT_CALLBACK_WITH_RET(ctx, tmp_buf,
-                              CUR_BUF(ctx) - tmp_buf - 1, JSON_EVT_IS_CPLUSPLUS_COMMENT);
-                          break;
-                      }
+                  UNLESS (eat_line_comment(ctx, JSON_EVT_IS_CPLUSPLUS_COMMENT)) {
+                      return 0;
                   }
-
-                  /* end of buffer */
-                  DO_COMMENT_CALLBACK_WITH_RET(ctx, tmp_buf,
-                      CUR_BUF(ctx) - tmp_buf, JSON_EVT_IS_CPLUSPLUS_COMMENT);
-
                   break;
               }
               else if (this_char == '*') {
@@ -359,6 +569,7 @@ eat_whitespace(json_context *ctx, int commas_are_whitespace, uint line) {
 
                   while (HAVE_MORE_CHARS(ctx)) {
                       this_char = NEXT_CHAR(ctx);
+                      BREAK_ON_ERROR(ctx);
                       if (last_char_valid) {
                           if (this_char == '/') {
                               if (last_char == '*') {
@@ -376,6 +587,10 @@ eat_whitespace(json_context *ctx, int commas_are_whitespace, uint line) {
 
                       last_char = this_char;
                   }
+
+                  if (ERROR_IS_SET(ctx)) {
+                      return 0;
+                  }
               }
               else {
                   JSON_DEBUG("bad comment -- found first '/' but not second one");
@@ -445,79 +660,102 @@ switch_to_dynamic_buf(json_str * s) {
         utf8_unicode_to_bytes((uint32_t)code_point, out_buf) )
 
 
-/* return estimate JSON string size in bytes */
-/* assume utf-8 for now */
+/*
+  Find the quote ending the string that starts at the current buffer
+  position.  Returns its byte offset in the buffer, or the buffer
+  length if the string is unterminated.  *has_escape is set if there
+  is a backslash before the end.  If not, and the string is all ascii,
+  *have_info is set and info describes the body of the string.
+*/
 static uint
-estimate_json_string_size(const char * buf, uint max_len, uint boundary_char,
-    uint * end_quote_pos) {
-    uint i;
-    uint size = 0;
-    uint bytes_this_char = 0;
+find_string_end(json_context * ctx, uint quote_char, int * has_escape, slice_info * info,
+    int * have_info) {
+    uint pos = BUF_POS(ctx);
+    int have_high = 0;
 
-    JSON_DEBUG("max_len=%u", max_len);
+    *has_escape = 0;
+    *have_info = 0;
 
-    if (end_quote_pos) {
-        *end_quote_pos = 0;
-    }
+    pos += jsonevt_scan_string(&ctx->buf[pos], ctx->len - pos, (char)quote_char, &have_high);
 
-    for (i = 0; i < max_len; i++) {
-        if (size < max_len) {
-            if (buf[size] == boundary_char) {
-                if (end_quote_pos) {
-                    *end_quote_pos = size;
-                    JSON_DEBUG("set end_quote_pos=%u", *end_quote_pos);
-                }
-                break;
-            }
-            size++;
-        }
-        else {
-            JSON_DEBUG("returning size %u", size);
-            return size;
+    if (pos < ctx->len && (uint)ctx->buf[pos] == quote_char) {
+        UNLESS (have_high) {
+            info->chars = pos - BUF_POS(ctx);
+            *have_info = 1;
         }
 
-        /* FIXME: utf-8 can be two bytes, both of which can have the high bit set, e.g.,
-           ce a9 (e with accute accent */
-
-        if (buf[size - 1] & 0x80) {
-            JSON_DEBUG("HERE in multibyte sequence");
+        return pos;
+    }
 
+    while (pos < ctx->len) {
+        /* backslash -- skip the escaped byte */
+        *has_escape = 1;
+        pos += 2;
+        if (pos >= ctx->len) {
+            break;
+        }
 
-            /* multi-byte char */
-            bytes_this_char = 1;
-            size++;
-            while (bytes_this_char < 4) {
-                if (size < max_len) {
-                    size++;
-                    bytes_this_char++;
-                    if (! (buf[size - 1] & 0x80) ) {
-                        break;
-                    }
-                }
-                else {
-                    break;
-                }
-            }
+        pos += jsonevt_scan_string(&ctx->buf[pos], ctx->len - pos, (char)quote_char, &have_high);
+        if (pos < ctx->len && (uint)ctx->buf[pos] == quote_char) {
+            return pos;
         }
+    }
+
+    return ctx->len;
+}
 
+/*
+  Return the length in bytes of the run of chars starting at the
+  current buffer position that can be copied through as is, i.e., up to
+  the next quote_char or backslash, filling in info.  Returns 0 if the
+  run is empty, goes to the end of the buffer, or has bytes the code
+  point path would convert or report.
+*/
+static uint
+scan_plain_run(json_context * ctx, uint quote_char, slice_info * info) {
+    uint left = BYTES_LEFT(ctx);
+    int have_high = 0;
+    uint run;
 
+    run = jsonevt_scan_string(CUR_BUF(ctx), left, (char)quote_char, &have_high);
+    if (run == 0 || run >= left) {
+        return 0;
+    }
 
+    if (have_high) {
+        UNLESS (check_utf8_slice(CUR_BUF(ctx), run, info)) {
+            return 0;
+        }
+    }
+    else {
+        info->chars = run;
     }
 
-    JSON_DEBUG("returning size %u", size);
-    return size;
+    return run;
 }
 
+/*
+  Step over the digits starting at the current char, adding them to
+  acc.  As with stepping through them one at a time with next_char(),
+  the last digit is left as the current char if the digits run to the
+  end of the buffer.
+*/
+static void
+eat_digits(json_context * ctx, jsonevt_number_acc * acc, uint part) {
+    uint start = CUR_POS(ctx);
+    uint end;
 
-#define EAT_DIGITS(ctx) while (HAVE_MORE_CHARS(ctx) && \
-        CUR_CHAR(ctx) >= '0' && CUR_CHAR(ctx) <= '9' ) { NEXT_CHAR(ctx); } \
-    if (CUR_CHAR(ctx) >= '0' && CUR_CHAR(ctx) <= '9' ) { NEXT_CHAR(ctx); }
+    if (CUR_CHAR(ctx) < '0' || CUR_CHAR(ctx) > '9') {
+        return;
+    }
 
+    end = start + jsonevt_number_scan_digits(&ctx->buf[start], ctx->len - start, acc, part);
+    if (end >= ctx->len) {
+        end = ctx->len - 1;
+    }
 
-/*
-#define EAT_DIGITS(ctx) fprintf(stderr, "looking at char %c\n", CUR_CHAR(ctx)); while (HAVE_MORE_CHARS(ctx) && \
-        CUR_CHAR(ctx) >= '0' && CUR_CHAR(ctx) <= '9' ) { NEXT_CHAR(ctx); fprintf(stderr, "looking at char %c\n", CUR_CHAR(ctx)); }
-*/
+    skip_to_pos(ctx, end);
+}
 
 #define kParseNumberHaveSign     JSON_EVT_PARSE_NUMBER_HAVE_SIGN
 #define kParseNumberHaveDecimal  JSON_EVT_PARSE_NUMBER_HAVE_DECIMAL
@@ -531,11 +769,18 @@ parse_number(json_context * ctx, uint level, uint flags) {
     uint this_char;
     uint start_pos = 0;
     uint len = 0;
+    jsonevt_number_acc acc;
+    jsonevt_number num;
 
     this_char = PEEK_CHAR(ctx);
     start_pos = CUR_POS(ctx);
 
     if (this_char == '-') {
+        if (BUF_POS(ctx) == 0) {
+            /* the '-' was only peeked at, so consume it first */
+            NEXT_CHAR(ctx);
+        }
+
         this_char = NEXT_CHAR(ctx);
         flags |= kParseNumberHaveSign;
     }
@@ -547,7 +792,9 @@ parse_number(json_context * ctx, uint level, uint flags) {
 
     ctx->ext_ctx->number_count++;
 
-    EAT_DIGITS(ctx);
+    memzero((void *)&acc, sizeof(acc));
+
+    eat_digits(ctx, &acc, JSONEVT_NUMBER_INT_PART);
 
     if (HAVE_MORE_CHARS(ctx)) {
         this_char = CUR_CHAR(ctx);
@@ -555,7 +802,7 @@ parse_number(json_context * ctx, uint level, uint flags) {
         if (this_char == '.') {
             flags |= kParseNumberHaveDecimal;
             NEXT_CHAR(ctx);
-            EAT_DIGITS(ctx);
+            eat_digits(ctx, &acc, JSONEVT_NUMBER_FRACTION_PART);
             this_char = CUR_CHAR(ctx);
         }
 
@@ -567,17 +814,23 @@ parse_number(json_context * ctx, uint level, uint flags) {
 
                 if (HAVE_MORE_CHARS(ctx)) {
                     if (this_char == '+' || this_char == '-') {
+                        acc.exp_negative = this_char == '-';
                         this_char = NEXT_CHAR(ctx);
                     }
 
-                    EAT_DIGITS(ctx);
+                    eat_digits(ctx, &acc, JSONEVT_NUMBER_EXPONENT_PART);
                     this_char = CUR_CHAR(ctx);
                 }
+                else {
+                    /* a digit at the very end is still part of the
+                       number, even though it isn't stepped over */
+                    eat_digits(ctx, &acc, JSONEVT_NUMBER_EXPONENT_PART);
+                }
             }
         }
     }
         
-    if (ctx->number_cb) {
+    if (ctx->number_cb || ctx->typed_number_cb) {
         len = CUR_POS(ctx) - start_pos;
 
         /* work around edge case where the entire input is just a number */
@@ -590,9 +843,15 @@ parse_number(json_context * ctx, uint level, uint flags) {
         }
         */
         
-
-        DO_CB_WITH_RET(ctx, "number", ctx->number_cb(ctx->cb_data, &(ctx->buf[start_pos]), len,
-                flags, level));
+        if (ctx->typed_number_cb) {
+            jsonevt_number_finish(&acc, &(ctx->buf[start_pos]), len, &flags, &num);
+            DO_CB_WITH_RET(ctx, "number", ctx->typed_number_cb(ctx->cb_data,
+                    &(ctx->buf[start_pos]), len, &num, flags, level));
+        }
+        else {
+            DO_CB_WITH_RET(ctx, "number", ctx->number_cb(ctx->cb_data, &(ctx->buf[start_pos]),
+                    len, flags, level));
+        }
     }
 
     return 1;
@@ -706,6 +965,31 @@ parse_word(json_context * ctx, int is_identifier, uint level, uint flags) {
                   u_bytes[i] = (uint8_t)nv;                             \
                   i++;
 
+/* If the input goes on with a \u escape for the low half of a
+   surrogate pair starting with high, the code point for the pair, else
+   0.  Nothing is consumed. */
+static uint32_t
+peek_low_surrogate(json_context * ctx, uint32_t high) {
+    const char * s = CUR_BUF(ctx);
+    uint32_t low = 0;
+    int nv;
+    uint i;
+
+    if (ctx->len - ctx->pos < 6 || s[0] != '\\' || s[1] != 'u') {
+        return 0;
+    }
+
+    for (i = 2; i < 6; i++) {
+        nv = HEX_NIBBLE_TO_INT(s[i]);
+        if (nv == -1) {
+            return 0;
+        }
+        low = low * 16 + (uint32_t)nv;
+    }
+
+    return utf16_surrogate_pair_to_unicode(high, low);
+}
+
 static int
 parse_string(json_context * ctx, uint level, uint flags) {
     uint32_t this_char;
@@ -717,6 +1001,7 @@ parse_string(json_context * ctx, uint level, uint flags) {
     uint end_quote_pos = 0;
     uint8_t u_bytes[4];
     uint32_t u_bytes_len;
+    uint32_t pair_char;
     /* uint multiplier; */
     int i;
     /* uint this_val; */
@@ -724,6 +1009,13 @@ parse_string(json_context * ctx, uint level, uint flags) {
     const char * orig_buf = NULL;
     char stack_buf[STATIC_BUF_SIZE];
     int cb_rv = CB_OK_VAL;
+    jsonevt_index_entry * entry = NULL;
+    slice_info info;
+    int have_info = 0;
+    int has_escape = 0;
+    int have_next = 0;
+    uint end_pos = 0;
+    uint run_len = 0;
 
     SETUP_TRACE;
 
@@ -748,16 +1040,59 @@ parse_string(json_context * ctx, uint level, uint flags) {
     }
 
     orig_buf = CUR_BUF(ctx);
+
+    entry = jsonevt_index_find(&ctx->index, CUR_POS(ctx));
+    if (entry) {
+        end_pos = entry->end;
+        has_escape = entry->flags & JSONEVT_INDEX_HAS_ESCAPE ? 1 : 0;
+    }
+    else {
+        end_pos = find_string_end(ctx, quote_char, &has_escape, &info, &have_info);
+    }
+
+    if (! has_escape && end_pos < ctx->len
+        && (have_info || check_utf8_slice(orig_buf, end_pos - BUF_POS(ctx), &info))) {
+        /* nothing to unescape or convert, so pass the original buffer through */
+        skip_to_pos(ctx, end_pos);
+
+        UPDATE_STATS_STRING_BYTES(ctx, (uint)(&ctx->buf[end_pos] - orig_buf));
+        UPDATE_STATS_STRING_CHARS(ctx, info.chars);
+
+        if (ctx->string_cb) {
+            cb_rv = ctx->string_cb(ctx->cb_data, orig_buf, (uint)(&ctx->buf[end_pos] - orig_buf),
+                flags, level);
+            if (CB_IS_TERM(cb_rv)) {
+                SET_CB_ERROR(ctx, "string");
+                CB_SET_TERM_VAL(ctx, cb_rv);
+                return 0;
+            }
+        }
+
+        /* eat the quote */
+        NEXT_CHAR(ctx);
+        if (ERROR_IS_SET(ctx)) {
+            return 0;
+        }
+
+        return 1;
+    }
     
-    while (HAVE_MORE_CHARS(ctx)) {
-        this_char = NEXT_CHAR(ctx);
-        BREAK_ON_ERROR(ctx);
+    while (have_next || HAVE_MORE_CHARS(ctx)) {
+        if (have_next) {
+            this_char = CUR_CHAR(ctx);
+            have_next = 0;
+        }
+        else {
+            this_char = NEXT_CHAR(ctx);
+            BREAK_ON_ERROR(ctx);
+        }
 
         if (first_time) {
             first_time = 0;
 
-            buf_size = estimate_json_string_size(orig_buf, ctx->len - CUR_POS(ctx),
-                quote_char, &end_quote_pos);
+            /* at most one byte out for each byte in */
+            end_quote_pos = (uint)(&ctx->buf[end_pos] - orig_buf);
+            buf_size = end_quote_pos;
 
             INIT_JSON_STR_STATIC_BUF(&str, orig_buf, end_quote_pos, stack_buf, STATIC_BUF_SIZE);
             GROW_JSON_STR(&str, buf_size);
@@ -860,6 +1195,15 @@ parse_string(json_context * ctx, uint level, uint flags) {
 
                   this_char = 4096 * u_bytes[0] + 256 * u_bytes[1] + 16 * u_bytes[2] + u_bytes[3];
 
+                  /* a surrogate pair is a single character */
+                  pair_char = peek_low_surrogate(ctx, this_char);
+                  if (pair_char) {
+                      for (i = 0; i < 6; i++) {
+                          NEXT_CHAR(ctx);
+                      }
+                      this_char = pair_char;
+                  }
+
                   break;
 
 
@@ -874,8 +1218,21 @@ parse_string(json_context * ctx, uint level, uint flags) {
         BREAK_ON_ERROR(ctx);
 
         u_bytes_len = UNICODE_TO_BYTES(ctx, this_char, u_bytes);
+        if (u_bytes_len != ctx->cur_char_len) {
+            /* converted bad char, so the original buffer can't be used as is */
+            SWITCH_FROM_STATIC(&str);
+        }
         MAYBE_APPEND_BYTES(&str, u_bytes, u_bytes_len);
 
+        /* copy everything up to the next quote or backslash in one go */
+        run_len = scan_plain_run(ctx, quote_char, &info);
+        if (run_len) {
+            MAYBE_APPEND_BYTES(&str, CUR_BUF(ctx), run_len);
+            char_count += info.chars;
+            skip_to_pos(ctx, BUF_POS(ctx) + run_len);
+            have_next = 1;
+        }
+
     }
     
     JSON_DEBUG("Error: got %c (0x%04x)", this_char, this_char);
@@ -885,97 +1242,251 @@ parse_string(json_context * ctx, uint level, uint flags) {
     return 0;
 }
 
-static int
-parse_array(json_context * ctx, uint level, uint flags) {
-    uint this_char = PEEK_CHAR(ctx);
-    int keep_going = 1;
-    int found_comma = 0;
+/* called with the current char being the '[' or '{' */
+static void
+set_size_hint(json_context * ctx) {
+    jsonevt_index_entry * entry = jsonevt_index_find(&ctx->index, CUR_POS(ctx));
 
-    SETUP_TRACE;
+    ctx->ext_ctx->size_hint = entry ? entry->count : 0;
+}
 
-    if (this_char != '[') {
-        return 0;
+/*
+  With a structural index, the parts of an array or hash between its
+  values go straight from one token to the next using the marks,
+  instead of eating whitespace a char at a time.  Anything the marks
+  can't answer (the end of the buffer, or something other than
+  whitespace after the current token) is left to the usual code,
+  which reports any syntax error.
+*/
+
+/* The position of the first token at or after pos, or 0 if there
+   isn't one.  Positions must be looked up in increasing order. */
+static JSONEVT_INLINE_FUNC uint
+index_next_mark(json_context * ctx, uint pos) {
+    jsonevt_struct_index * idx = &ctx->index;
+    uint i = idx->mark_cursor;
+
+    while (i < idx->num_marks && idx->marks[i] < pos) {
+        i++;
     }
+    idx->mark_cursor = i;
 
-    ctx->ext_ctx->array_count++;
+    return i < idx->num_marks ? idx->marks[i] : 0;
+}
 
-    DO_GEN_CALLBACK_WITH_RET(ctx, begin_array_cb, flags, level, "begin_array");
+/* Make the token at mark the current char.  It is always ascii, so
+   unlike skip_to_pos(), there is nothing to decode. */
+static JSONEVT_INLINE_FUNC void
+index_skip_to_mark(json_context * ctx, uint mark) {
+    ctx->cur_byte_pos = mark;
+    ctx->cur_char = (uint8_t)ctx->buf[mark];
+    ctx->cur_char_len = 1;
+    ctx->flags.have_char = 1;
+    ctx->pos = mark + 1;
+}
 
-    level++;
+/* The position of the current token, if there is only whitespace
+   between the current char and it, or 0 */
+static JSONEVT_INLINE_FUNC uint
+index_cur_token(json_context * ctx) {
+    uint pos = CUR_POS(ctx);
+    uint mark;
+    uint8_t c;
 
-    INCR_DATA_DEPTH(ctx, level);
+    mark = index_next_mark(ctx, pos);
+    if (mark == pos || mark == 0) {
+        return mark;
+    }
 
-    if (CUR_POS(ctx) == 0) {
-        NEXT_CHAR(ctx);
+    c = (uint8_t)ctx->buf[pos];
+    if (c == ' ' || (c >= 0x09 && c <= 0x0d)) {
+        return mark;
     }
 
-    NEXT_CHAR(ctx);
+    return 0;
+}
 
-    EAT_WHITESPACE(ctx, 0);
-    this_char = PEEK_CHAR(ctx);
-    if (this_char == ']') {
-        DO_GEN_CALLBACK_WITH_RET(ctx, end_array_cb, flags, level - 1, "end_array");
+/* The position of the first token after the one at mark that isn't
+   a comma, or 0 */
+static uint
+index_skip_commas(json_context * ctx, uint mark) {
+    do {
+        mark = index_next_mark(ctx, mark + 1);
+    } while (mark && ctx->buf[mark] == ',');
+
+    return mark;
+}
+
+/* Eat the closing bracket at mark, and any whitespace after it */
+static void
+index_eat_close(json_context * ctx, uint mark) {
+    uint next = index_next_mark(ctx, mark + 1);
+
+    if (next) {
+        index_skip_to_mark(ctx, next);
+    }
+    else {
+        index_skip_to_mark(ctx, mark);
         NEXT_CHAR(ctx);
         EAT_WHITESPACE(ctx, 0);
-        return 1;
     }
+}
 
-    if (AT_END_OF_BUF(ctx)) {
-        SET_ERROR(ctx, "array not terminated");
+/*
+  Arrays and hashes are parsed in parts: the opening bracket, then for
+  each element (or entry) the part before the value, the value, and
+  the part after it (up to the next member or through the closing
+  bracket).  That way jsonevt_parse_chunk() can stop between any two
+  tokens and pick up again later, at any depth.  The functions for
+  the opening bracket and for the part after a value return 0 on
+  error, 1 if there is another member to parse, and 2 once the closing
+  bracket has been eaten.  level and flags are those of the array or
+  hash itself.
+*/
+static int
+parse_array_start(json_context * ctx, uint level, uint flags) {
+    uint this_char = PEEK_CHAR(ctx);
+    uint mark;
+
+    if (this_char != '[') {
         return 0;
     }
 
-    while (keep_going) {
-        DO_GEN_CALLBACK_WITH_RET(ctx, begin_array_element_cb, 0, level, "begin_array_element");
+    ctx->ext_ctx->array_count++;
 
-        if (! parse_value(ctx, level, JSON_EVT_IS_ARRAY_ELEMENT)) {
-            JSON_DEBUG("parse_value() returned error");
-            return 0;
+    set_size_hint(ctx);
+    DO_GEN_CALLBACK_WITH_RET(ctx, begin_array_cb, flags, level, "begin_array");
+
+    level++;
+
+    INCR_DATA_DEPTH(ctx, level);
+
+    if (ctx->index.valid) {
+        mark = index_next_mark(ctx, CUR_POS(ctx) + 1);
+        if (mark) {
+            if (ctx->buf[mark] == ']') {
+                DO_GEN_CALLBACK_WITH_RET(ctx, end_array_cb, flags, level - 1, "end_array");
+                index_eat_close(ctx, mark);
+                return 2;
+            }
+
+            index_skip_to_mark(ctx, mark);
+            return 1;
         }
+    }
+
+    if (CUR_POS(ctx) == 0) {
+        NEXT_CHAR(ctx);
+    }
 
-        DO_GEN_CALLBACK_WITH_RET(ctx, end_array_element_cb, 0, level, "end_array_element");
+    NEXT_CHAR(ctx);
 
+    EAT_WHITESPACE(ctx, 0);
+    this_char = PEEK_CHAR(ctx);
+    if (this_char == ']') {
+        DO_GEN_CALLBACK_WITH_RET(ctx, end_array_cb, flags, level - 1, "end_array");
+        NEXT_CHAR(ctx);
         EAT_WHITESPACE(ctx, 0);
-        this_char = PEEK_CHAR(ctx);
+        return 2;
+    }
+
+    if (AT_END_OF_BUF(ctx)) {
+        SET_ERROR(ctx, "array not terminated");
+        return 0;
+    }
+
+    return 1;
+}
+
+static int
+parse_array_element_end(json_context * ctx, uint level, uint flags) {
+    uint this_char;
+    int found_comma = 0;
+    uint mark;
+
+    level++;
 
-        if (this_char == ',') {
-            EAT_WHITESPACE(ctx, 1);
-            found_comma = 1;
+    DO_GEN_CALLBACK_WITH_RET(ctx, end_array_element_cb, 0, level, "end_array_element");
+
+    mark = ctx->index.valid ? index_cur_token(ctx) : 0;
+    if (mark) {
+        if (ctx->buf[mark] == ',') {
+            mark = index_skip_commas(ctx, mark);
+            if (mark) {
+                index_skip_to_mark(ctx, mark);
+                return 1;
+            }
         }
-        else {
-            found_comma = 0;
+        else if (ctx->buf[mark] == ']') {
+            DO_GEN_CALLBACK_WITH_RET(ctx, end_array_cb, flags, level - 1, "end_array");
+            index_eat_close(ctx, mark);
+            return 2;
         }
+    }
 
-        switch (this_char) {
-          case ']':
-              /* end of the array */
-              DO_GEN_CALLBACK_WITH_RET(ctx, end_array_cb, flags, level - 1, "end_array");
-              NEXT_CHAR(ctx);
-              EAT_WHITESPACE(ctx, 0);
-              return 1;
-              break;
+    EAT_WHITESPACE(ctx, 0);
+    this_char = PEEK_CHAR(ctx);
 
-          default:
-              if (! found_comma) {
-                  /* error */
-                  JSON_DEBUG("didn't find comma for array, char is %c", this_char);
-                  SET_ERROR(ctx, "syntax error in array");
-                  return 0;
-              }
-              break;
-        }
-        
+    if (this_char == ',') {
+        EAT_WHITESPACE(ctx, 1);
+        found_comma = 1;
     }
-    
-    SET_ERROR(ctx, "unknown error in array");
-    return 0;
+    else {
+        found_comma = 0;
+    }
+
+    switch (this_char) {
+      case ']':
+          /* end of the array */
+          DO_GEN_CALLBACK_WITH_RET(ctx, end_array_cb, flags, level - 1, "end_array");
+          NEXT_CHAR(ctx);
+          EAT_WHITESPACE(ctx, 0);
+          return 2;
+          break;
+
+      default:
+          if (! found_comma) {
+              /* error */
+              JSON_DEBUG("didn't find comma for array, char is %c", this_char);
+              SET_ERROR(ctx, "syntax error in array");
+              return 0;
+          }
+          break;
+    }
+
+    return 1;
 }
 
 static int
-parse_hash(json_context * ctx, uint level, uint flags) {
+parse_array_element(json_context * ctx, uint level, uint flags) {
+    DO_GEN_CALLBACK_WITH_RET(ctx, begin_array_element_cb, 0, level + 1, "begin_array_element");
+
+    if (! parse_value(ctx, level + 1, JSON_EVT_IS_ARRAY_ELEMENT)) {
+        JSON_DEBUG("parse_value() returned error");
+        return 0;
+    }
+
+    return parse_array_element_end(ctx, level, flags);
+}
+
+static int
+parse_array(json_context * ctx, uint level, uint flags) {
+    int rv;
+
+    SETUP_TRACE;
+
+    rv = parse_array_start(ctx, level, flags);
+    while (rv == 1) {
+        rv = parse_array_element(ctx, level, flags);
+    }
+
+    return rv ? 1 : 0;
+}
+
+static int
+parse_hash_start(json_context * ctx, uint level, uint flags) {
     uint this_char = PEEK_CHAR(ctx);
-    int keep_going = 1;
-    int found_comma = 0;
+    uint mark;
 
     JSON_DEBUG("parse_hash() called");
 
@@ -988,6 +1499,7 @@ parse_hash(json_context * ctx, uint level, uint flags) {
 
     JSON_DEBUG("before begin_hash_cb call");
 
+    set_size_hint(ctx);
     DO_GEN_CALLBACK_WITH_RET(ctx, begin_hash_cb, flags, level, "begin_hash");
 
     level++;
@@ -995,6 +1507,21 @@ parse_hash(json_context * ctx, uint level, uint flags) {
 
     JSON_DEBUG("after begin_hash_cb call");
 
+    if (ctx->index.valid) {
+        /* extra commas are skipped here as well */
+        mark = index_skip_commas(ctx, CUR_POS(ctx));
+        if (mark) {
+            if (ctx->buf[mark] == '}') {
+                DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_cb, flags, level - 1, "end_hash");
+                index_eat_close(ctx, mark);
+                return 2;
+            }
+
+            index_skip_to_mark(ctx, mark);
+            return 1;
+        }
+    }
+
     if (CUR_POS(ctx) == 0) {
         NEXT_CHAR(ctx);
     }
@@ -1006,95 +1533,153 @@ parse_hash(json_context * ctx, uint level, uint flags) {
         DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_cb, flags, level - 1, "end_hash");
         NEXT_CHAR(ctx);
         EAT_WHITESPACE(ctx, 0);
-        return 1;
+        return 2;
     }
 
-    while (keep_going) {
-        EAT_WHITESPACE(ctx, 0);
-        this_char = PEEK_CHAR(ctx);
-        
-        DO_GEN_CALLBACK_WITH_RET(ctx, begin_hash_entry_cb, 0, level, "begin_hash_entry");
+    return 1;
+}
 
-        /* this should be parse_string() or parse_identifier */
-        if (this_char == '\'' || this_char == '"') {
-            if (! parse_string(ctx, level, JSON_EVT_IS_HASH_KEY)) {
-                JSON_DEBUG("parse_string() returned error");
-                return 0;
-            }
-        }
-        else {
-            if (! parse_word(ctx, 1, level, JSON_EVT_IS_HASH_KEY) ) {
-                JSON_DEBUG("parse_word() returned error");
-                return 0;
-            }
-        }
+/* the key and the ':' after it */
+static int
+parse_hash_entry_key(json_context * ctx, uint level, uint flags) {
+    uint this_char;
+    uint mark;
 
-        EAT_WHITESPACE(ctx, 0);
-        this_char = PEEK_CHAR(ctx);
+    level++;
 
-        if (this_char != ':') {
-            JSON_DEBUG("parse error");
-            SET_ERROR(ctx, "syntax error: bad object (missing ':')");
-            return 0;
-        }
+    EAT_WHITESPACE(ctx, 0);
+    this_char = PEEK_CHAR(ctx);
 
-        NEXT_CHAR(ctx);
-        EAT_WHITESPACE(ctx, 0);
+    DO_GEN_CALLBACK_WITH_RET(ctx, begin_hash_entry_cb, 0, level, "begin_hash_entry");
 
-        JSON_DEBUG("looking at 0x%02x ('%c'), pos %u", PEEK_CHAR(ctx), PEEK_CHAR(ctx), ctx->pos);
-        if (!parse_value(ctx, level, JSON_EVT_IS_HASH_VALUE)) {
-            JSON_DEBUG("parse error in object");
+    /* this should be parse_string() or parse_identifier */
+    if (this_char == '\'' || this_char == '"') {
+        if (! parse_string(ctx, level, JSON_EVT_IS_HASH_KEY)) {
+            JSON_DEBUG("parse_string() returned error");
             return 0;
         }
+    }
+    else {
+        if (! parse_word(ctx, 1, level, JSON_EVT_IS_HASH_KEY) ) {
+            JSON_DEBUG("parse_word() returned error");
+            return 0;
+        }
+    }
+
+    mark = ctx->index.valid ? index_cur_token(ctx) : 0;
+    if (mark && ctx->buf[mark] == ':') {
+        mark = index_next_mark(ctx, mark + 1);
+        if (mark) {
+            index_skip_to_mark(ctx, mark);
+            return 1;
+        }
+    }
 
-        DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_entry_cb, 0, level, "end_hash_entry");
+    EAT_WHITESPACE(ctx, 0);
+    this_char = PEEK_CHAR(ctx);
 
-        EAT_WHITESPACE(ctx, 0);
-        this_char = PEEK_CHAR(ctx);
+    if (this_char != ':') {
+        JSON_DEBUG("parse error");
+        SET_ERROR(ctx, "syntax error: bad object (missing ':')");
+        return 0;
+    }
+
+    NEXT_CHAR(ctx);
+    EAT_WHITESPACE(ctx, 0);
+
+    return 1;
+}
+
+static int
+parse_hash_entry_end(json_context * ctx, uint level, uint flags) {
+    uint this_char;
+    int found_comma = 0;
+    uint mark;
+
+    level++;
+
+    DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_entry_cb, 0, level, "end_hash_entry");
 
-        if (this_char == ',') {
-            found_comma = 1;
-            EAT_WHITESPACE(ctx, 1);
+    mark = ctx->index.valid ? index_cur_token(ctx) : 0;
+    if (mark && ctx->buf[mark] == ',') {
+        found_comma = 1;
+        mark = index_skip_commas(ctx, mark);
+    }
+
+    if (mark) {
+        if (ctx->buf[mark] == '}') {
+            DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_cb, flags, level - 1, "end_hash");
+            index_eat_close(ctx, mark);
+            return 2;
         }
-        else {
-            found_comma = 0;
+
+        if (found_comma) {
+            index_skip_to_mark(ctx, mark);
+            return 1;
         }
+    }
 
-        this_char = PEEK_CHAR(ctx);
-        switch (this_char) {
-          case '}':
-              DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_cb, flags, level - 1, "end_hash");
-              NEXT_CHAR(ctx);
-              EAT_WHITESPACE(ctx, 0);
-              return 1;
-              break;
+    EAT_WHITESPACE(ctx, 0);
+    this_char = PEEK_CHAR(ctx);
 
-          default:
-              if (! found_comma) {
-                  SET_ERROR(ctx, "syntax error: bad object (missing ',' or '}')");
-                  return 0;
-              }
-              break;
-        }
+    if (this_char == ',') {
+        found_comma = 1;
+        EAT_WHITESPACE(ctx, 1);
+    }
+    else {
+        found_comma = 0;
+    }
 
+    this_char = PEEK_CHAR(ctx);
+    switch (this_char) {
+      case '}':
+          DO_GEN_CALLBACK_WITH_RET(ctx, end_hash_cb, flags, level - 1, "end_hash");
+          NEXT_CHAR(ctx);
+          EAT_WHITESPACE(ctx, 0);
+          return 2;
+          break;
+
+      default:
+          if (! found_comma) {
+              SET_ERROR(ctx, "syntax error: bad object (missing ',' or '}')");
+              return 0;
+          }
+          break;
     }
-    SET_ERROR(ctx, "unknown error in parse_hash()");
-    return 0;
+
+    return 1;
 }
 
 static int
-parse_value(json_context * ctx, uint level, uint flags) {
-    uint this_char;
+parse_hash_entry(json_context * ctx, uint level, uint flags) {
+    if (! parse_hash_entry_key(ctx, level, flags)) {
+        return 0;
+    }
 
-    SETUP_TRACE;
-    PDB("HERE");
+    JSON_DEBUG("looking at 0x%02x ('%c'), pos %u", PEEK_CHAR(ctx), PEEK_CHAR(ctx), ctx->pos);
+    if (!parse_value(ctx, level + 1, JSON_EVT_IS_HASH_VALUE)) {
+        JSON_DEBUG("parse error in object");
+        return 0;
+    }
 
-    EAT_WHITESPACE(ctx, 0);
+    return parse_hash_entry_end(ctx, level, flags);
+}
 
-    this_char = PEEK_CHAR(ctx);
+static int
+parse_hash(json_context * ctx, uint level, uint flags) {
+    int rv;
 
-    PDB("HERE - char is %#04x", this_char);
+    rv = parse_hash_start(ctx, level, flags);
+    while (rv == 1) {
+        rv = parse_hash_entry(ctx, level, flags);
+    }
+
+    return rv ? 1 : 0;
+}
 
+/* parse the value starting with this_char, the current char */
+static int
+parse_value_at_char(json_context * ctx, uint this_char, uint level, uint flags) {
     /* JSON_DEBUG("parse_value() - pos %u, char %c", CUR_POS(ctx), this_char); */
     
     switch (this_char) {
@@ -1129,6 +1714,22 @@ parse_value(json_context * ctx, uint level, uint flags) {
     return 0;
 }
 
+static int
+parse_value(json_context * ctx, uint level, uint flags) {
+    uint this_char;
+
+    SETUP_TRACE;
+    PDB("HERE");
+
+    EAT_WHITESPACE(ctx, 0);
+
+    this_char = PEEK_CHAR(ctx);
+
+    PDB("HERE - char is %#04x", this_char);
+
+    return parse_value_at_char(ctx, this_char, level, flags);
+}
+
 jsonevt_ctx *
 jsonevt_new_ctx() {
     jsonevt_ctx *ctx;
@@ -1150,6 +1751,9 @@ jsonevt_free_ctx(jsonevt_ctx * ext_ctx) {
             ext_ctx->error = NULL;
         }
 
+        jsonevt_index_free(&ext_ctx->index);
+        jsonevt_push_buf_free(&ext_ctx->push);
+
         JSON_DEBUG("deallocating jsonevt_ctx %p", ext_ctx);        
         JSONEVT_FREE_MEM(ext_ctx);
         JSON_DEBUG("deallocated jsonevt_ctx %p", ext_ctx);
@@ -1169,12 +1773,15 @@ jsonevt_reset_ctx(jsonevt_ctx * ctx) {
     json_hash_begin_entry_cb begin_hash_entry_cb;
     json_hash_end_entry_cb end_hash_entry_cb;
     json_number_cb number_cb;
+    json_typed_number_cb typed_number_cb;
     json_bool_cb bool_cb;
     json_null_cb null_cb;
     json_comment_cb comment_cb;
 
     uint options;
     uint bad_char_policy;
+    jsonevt_struct_index saved_index;
+    jsonevt_push_buf saved_push;
 
     UNLESS (ctx) {
         return;
@@ -1194,12 +1801,15 @@ jsonevt_reset_ctx(jsonevt_ctx * ctx) {
     begin_hash_entry_cb = ctx->begin_hash_entry_cb;
     end_hash_entry_cb = ctx->end_hash_entry_cb;
     number_cb = ctx->number_cb;
+    typed_number_cb = ctx->typed_number_cb;
     bool_cb = ctx->bool_cb;
     null_cb = ctx->null_cb;
     comment_cb = ctx->comment_cb;
 
     options = ctx->options;
     bad_char_policy = ctx->bad_char_policy;
+    saved_index = ctx->index;
+    saved_push = ctx->push;
 
     if (ctx->error) {
         JSONEVT_FREE_MEM(ctx->error);
@@ -1220,6 +1830,7 @@ jsonevt_reset_ctx(jsonevt_ctx * ctx) {
     ctx->begin_hash_entry_cb = begin_hash_entry_cb;
     ctx->end_hash_entry_cb = end_hash_entry_cb;
     ctx->number_cb = number_cb;
+    ctx->typed_number_cb = typed_number_cb;
     ctx->bool_cb = bool_cb;
     ctx->null_cb = null_cb;
     ctx->comment_cb = comment_cb;
@@ -1227,6 +1838,11 @@ jsonevt_reset_ctx(jsonevt_ctx * ctx) {
     ctx->options = options;
     ctx->bad_char_policy = bad_char_policy;
 
+    ctx->index = saved_index;
+    ctx->index.valid = 0;
+
+    ctx->push = saved_push;
+
     ctx->cb_early_return_val = 0;
 }
 
@@ -1265,6 +1881,16 @@ jsonevt_set_number_cb(jsonevt_ctx * ctx, json_number_cb callback) {
     return 0;
 }
 
+int
+jsonevt_set_typed_number_cb(jsonevt_ctx * ctx, json_typed_number_cb callback) {
+    if (ctx) {
+        ctx->typed_number_cb = callback;
+        return 1;
+    }
+
+    return 0;
+}
+
 JSONEVT_INLINE_FUNC int
 jsonevt_set_begin_array_cb(jsonevt_ctx * ctx, json_array_begin_cb callback) {
     if (ctx) {
@@ -1374,14 +2000,12 @@ jsonevt_set_comment_cb(jsonevt_ctx * ctx, json_comment_cb callback) {
     return 0;
 }
 
-/*
 JSONEVT_INLINE_FUNC int
 jsonevt_set_options(jsonevt_ctx * ctx, uint options) {
     ctx->options = options;
 
     return 1;
 }
-*/
 
 JSONEVT_INLINE_FUNC int
 jsonevt_set_bad_char_policy(jsonevt_ctx * ctx, uint policy) {
@@ -1415,6 +2039,11 @@ jsonevt_get_error_byte_pos(jsonevt_ctx * ctx) {
     return ctx->error_byte_pos;
 }
 
+uint
+jsonevt_get_size_hint(jsonevt_ctx * ctx) {
+    return ctx->size_hint;
+}
+
 uint
 jsonevt_get_stats_string_count(jsonevt_ctx * ctx) {
     return ctx->string_count;
@@ -1460,8 +2089,29 @@ jsonevt_get_stats_deepest_level(jsonevt_ctx * ctx) {
     return ctx->deepest_level;
 }
 
+/* Lines and chars aren't counted while parsing, so count them from
+   the input in one pass.  jsonevt_parse() does this before it returns,
+   unless the caller asked for JSON_EVT_OPTION_LAZY_TEXT_STATS, in which
+   case it is done the first time one of them is asked for. */
+static void
+finish_text_stats(json_context * ctx) {
+    jsonevt_text_pos tp;
+
+    UNLESS (ctx->flags.text_stats_pending) {
+        return;
+    }
+
+    get_text_pos(ctx, CUR_POS(ctx), &tp);
+    ctx->line = tp.line;
+    ctx->char_count = get_cur_char_pos(ctx, &tp);
+
+    ctx->flags.text_stats_pending = 0;
+}
+
 uint
 jsonevt_get_stats_line_count(jsonevt_ctx * ctx) {
+    finish_text_stats(ctx);
+
     return ctx->line;
 }
 
@@ -1472,9 +2122,36 @@ jsonevt_get_stats_byte_count(jsonevt_ctx * ctx) {
 
 uint
 jsonevt_get_stats_char_count(jsonevt_ctx * ctx) {
+    finish_text_stats(ctx);
+
     return ctx->char_count;
 }
 
+void
+jsonevt_count_text_stats(const char * buf, uint len, uint byte_count, uint * lines,
+    uint * chars) {
+    json_context ctx;
+    jsonevt_text_pos tp;
+    uint char_len = 0;
+
+    ZERO_MEM((void *)&ctx, sizeof(ctx));
+    ctx.buf = buf;
+    ctx.len = len;
+    ctx.text_base.line = 1;
+
+    /* where next_char() leaves things after reading the last char */
+    ctx.cur_byte_pos = byte_count;
+    ctx.pos = byte_count;
+    if (byte_count < len) {
+        decode_char_at(&ctx, byte_count, &char_len);
+        ctx.pos += char_len;
+    }
+
+    get_text_pos(&ctx, byte_count, &tp);
+    *lines = tp.line;
+    *chars = get_cur_char_pos(&ctx, &tp);
+}
+
 /*
 JSONEVT_INLINE_FUNC uint
 jsonevt_get_line_num(jsonevt_ctx * ctx) {
@@ -1576,10 +2253,9 @@ jsonevt_parse(jsonevt_ctx * ext_ctx, const char * buf, uint len) {
     ctx->buf = buf;
     ctx->len = len;
     ctx->pos = 0;
-    ctx->char_pos = 0;
-    ctx->cur_line = 1;
+    ctx->text_base.line = 1;
 
-    ctx->line = ctx->cur_line;
+    ctx->line = 1;
     ctx->byte_count = 0;
     ctx->char_count = 0;
 
@@ -1587,6 +2263,10 @@ jsonevt_parse(jsonevt_ctx * ext_ctx, const char * buf, uint len) {
 
     /* ZERO_MEM( &(ctx->flags), sizeof(struct context_flags_struct) ); */
 
+    if (ctx->options & JSON_EVT_OPTION_STRUCTURAL_INDEX) {
+        jsonevt_index_build(&ctx->index, buf, len);
+    }
+
     if (check_bom(ctx)) {
         rv = parse_value(ctx, 0, 0);
         JSON_DEBUG("pos=%d, len=%d", ctx->pos, ctx->len);
@@ -1600,9 +2280,408 @@ jsonevt_parse(jsonevt_ctx * ext_ctx, const char * buf, uint len) {
         }
     }
 
-    ctx->line = ctx->cur_line;
     ctx->byte_count = ctx->cur_byte_pos;
-    ctx->char_count = ctx->cur_char_pos;
+    ctx->flags.text_stats_pending = 1;
+
+    /* the caller's buffer may be gone by the time the stats are read */
+    if (! rv || ! (ctx->options & JSON_EVT_OPTION_LAZY_TEXT_STATS)) {
+        finish_text_stats(ctx);
+    }
+
+    return rv;
+}
+
+/*
+  Parse one element of a top-level array that has been split up for
+  parsing on several threads (see ndjson.c).  buf starts with the byte
+  before the element, so the parser is never at position 0, and must
+  include the ',' or ']' after it, so a number is never at the very
+  end of the buffer.  The offset of that ',' or ']' is put in *end.
+  The element gets the same callbacks it would if the whole array
+  were parsed, but the array itself gets none.
+*/
+int
+jsonevt_parse_array_element(jsonevt_ctx * ext_ctx, const char * buf, uint len, uint * end) {
+    jsonevt_ctx * ctx = ext_ctx;
+    int rv = 0;
+
+    jsonevt_reset_ctx(ctx);
+
+    ctx->buf = buf;
+    ctx->len = len;
+    ctx->pos = 1;
+    ctx->text_base.line = 1;
+    ctx->line = 1;
+    ctx->ext_ctx = ctx;
+
+    NEXT_CHAR(ctx);
+
+    DO_GEN_CALLBACK_WITH_RET(ctx, begin_array_element_cb, 0, 1, "begin_array_element");
+
+    if (parse_value(ctx, 1, JSON_EVT_IS_ARRAY_ELEMENT)) {
+        DO_GEN_CALLBACK_WITH_RET(ctx, end_array_element_cb, 0, 1, "end_array_element");
+
+        EAT_WHITESPACE(ctx, 0);
+        if (! ERROR_IS_SET(ctx) && CUR_POS(ctx) < len
+            && (buf[CUR_POS(ctx)] == ',' || buf[CUR_POS(ctx)] == ']')) {
+            *end = CUR_POS(ctx);
+            rv = 1;
+        }
+        else {
+            SET_ERROR(ctx, "syntax error in array");
+        }
+    }
+
+    ctx->byte_count = ctx->cur_byte_pos;
+    ctx->flags.text_stats_pending = 1;
+
+    return rv;
+}
+
+/*
+  Push parsing.  The input is buffered in ctx->push, and parsed with
+  the same functions jsonevt_parse() uses, but one step at a time: the
+  opening bracket of an array or hash, the part of a member before its
+  value, the value (if it isn't another array or hash), or the part
+  after it.  Each step starts at (or just after) a token and eats no
+  more than that one token before the next one starts, so it can be
+  taken as soon as the framer in push_buf.c has seen the start of a
+  later token.  The arrays and hashes the parse is in the middle of
+  are kept on a stack of frames instead of the C stack, so the parse
+  can stop after any step, at any depth, and carry on when the next
+  chunk comes in.  Input that has been parsed is discarded from the
+  front of the buffer, so memory use is bounded by the largest token
+  (plus the chunk size), not by the size of any member.
+*/
+
+#define PUSH_STATE_NONE   0
+#define PUSH_STATE_START  1
+#define PUSH_STATE_VALUE  2 /* at the top-level value */
+#define PUSH_STATE_NESTED 3 /* in an array or hash -- see the frames */
+#define PUSH_STATE_DONE   4
+#define PUSH_STATE_ERROR  5
+
+#define PUSH_FRAME_ARRAY 0
+#define PUSH_FRAME_HASH  1
+
+/* what the next step for a frame is */
+#define PUSH_FRAME_MEMBER      0 /* start the next element or entry */
+#define PUSH_FRAME_VALUE       1 /* parse its value */
+#define PUSH_FRAME_AFTER_VALUE 2 /* the ',' or closing bracket after it */
+
+/* True if the next step of the parse only needs bytes we already
+   have.  A step can look at the char after the boundary it stops at
+   (to see whether a '/' starts a comment), so there must be room for
+   a whole utf-8 char after it.
+*/
+static int
+push_step_ready(json_context * ctx) {
+    jsonevt_push_buf * pb = &ctx->push;
+    uint this_char;
+
+    if (pb->boundaries == 0 || pb->len - pb->last_boundary <= 4) {
+        return 0;
+    }
+
+    switch (ctx->push_state) {
+      case PUSH_STATE_START:
+          /* check_bom() looks at up to 4 bytes */
+          return pb->len >= 4;
+          break;
+
+      case PUSH_STATE_VALUE:
+          /* a top-level string, number, or word is left for
+             jsonevt_parse_end() */
+          this_char = PEEK_CHAR(ctx);
+          if (this_char != '[' && this_char != '{') {
+              return 0;
+          }
+          return pb->last_boundary > CUR_POS(ctx);
+          break;
+
+      case PUSH_STATE_NESTED:
+          return pb->last_boundary > CUR_POS(ctx);
+          break;
+
+      default:
+          break;
+    }
+
+    return 0;
+}
+
+/* Parse the opening bracket of an array or hash value, and push a
+   frame for it unless it is empty.  Returns the same as
+   parse_array_start() and parse_hash_start(). */
+static int
+push_open_container(json_context * ctx, uint this_char, uint level, uint flags) {
+    jsonevt_push_frame * frame;
+    int rv;
+
+    if (this_char == '[') {
+        rv = parse_array_start(ctx, level, flags);
+    }
+    else {
+        rv = parse_hash_start(ctx, level, flags);
+    }
+
+    if (rv == 1) {
+        frame = jsonevt_push_buf_push_frame(&ctx->push);
+        frame->type = this_char == '[' ? PUSH_FRAME_ARRAY : PUSH_FRAME_HASH;
+        frame->state = PUSH_FRAME_MEMBER;
+        frame->level = level;
+        frame->flags = flags;
+    }
+
+    return rv;
+}
+
+/* Take the next step for the innermost array or hash */
+static int
+push_nested_step(json_context * ctx) {
+    jsonevt_push_buf * pb = &ctx->push;
+    jsonevt_push_frame * frame = &pb->frames[pb->num_frames - 1];
+    uint level = frame->level;
+    uint flags = frame->flags;
+    uint value_flags;
+    uint this_char;
+    int rv = 1;
+
+    switch (frame->state) {
+      case PUSH_FRAME_MEMBER:
+          if (frame->type == PUSH_FRAME_ARRAY) {
+              DO_GEN_CALLBACK_WITH_RET(ctx, begin_array_element_cb, 0, level + 1,
+                  "begin_array_element");
+          }
+          else {
+              rv = parse_hash_entry_key(ctx, level, flags);
+          }
+          frame->state = PUSH_FRAME_VALUE;
+          break;
+
+      case PUSH_FRAME_VALUE:
+          value_flags = frame->type == PUSH_FRAME_ARRAY ? JSON_EVT_IS_ARRAY_ELEMENT
+              : JSON_EVT_IS_HASH_VALUE;
+
+          /* set before a new frame is pushed, which may move this one */
+          frame->state = PUSH_FRAME_AFTER_VALUE;
+
+          EAT_WHITESPACE(ctx, 0);
+          this_char = PEEK_CHAR(ctx);
+
+          if (this_char == '[' || this_char == '{') {
+              rv = push_open_container(ctx, this_char, level + 1, value_flags);
+          }
+          else {
+              rv = parse_value_at_char(ctx, this_char, level + 1, value_flags);
+          }
+          break;
+
+      case PUSH_FRAME_AFTER_VALUE:
+          if (frame->type == PUSH_FRAME_ARRAY) {
+              rv = parse_array_element_end(ctx, level, flags);
+          }
+          else {
+              rv = parse_hash_entry_end(ctx, level, flags);
+          }
+
+          if (rv == 1) {
+              frame->state = PUSH_FRAME_MEMBER;
+          }
+          else if (rv == 2) {
+              /* the parent (if any) is already waiting for what comes
+                 after this value */
+              pb->num_frames--;
+              if (pb->num_frames == 0) {
+                  ctx->push_state = PUSH_STATE_DONE;
+              }
+          }
+          break;
+
+      default:
+          break;
+    }
+
+    return rv ? 1 : 0;
+}
+
+static int
+push_parse(json_context * ctx, int at_end) {
+    uint this_char;
+    int rv = 1;
+
+    while (ctx->push_state != PUSH_STATE_DONE && ctx->push_state != PUSH_STATE_ERROR) {
+        if (! at_end && ! push_step_ready(ctx)) {
+            return 1;
+        }
+
+        switch (ctx->push_state) {
+          case PUSH_STATE_START:
+              rv = check_bom(ctx);
+              if (rv) {
+                  EAT_WHITESPACE(ctx, 0);
+                  ctx->push_state = PUSH_STATE_VALUE;
+              }
+              break;
+
+          case PUSH_STATE_VALUE:
+              this_char = PEEK_CHAR(ctx);
+              if (this_char == '[' || this_char == '{') {
+                  rv = push_open_container(ctx, this_char, 0, 0);
+                  ctx->push_state = rv == 1 ? PUSH_STATE_NESTED : PUSH_STATE_DONE;
+              }
+              else {
+                  rv = parse_value_at_char(ctx, this_char, 0, 0);
+                  ctx->push_state = PUSH_STATE_DONE;
+              }
+              break;
+
+          case PUSH_STATE_NESTED:
+              rv = push_nested_step(ctx);
+              break;
+
+          default:
+              break;
+        }
+
+        if (rv == 0) {
+            ctx->push_state = PUSH_STATE_ERROR;
+        }
+    }
+
+    return ctx->push_state == PUSH_STATE_DONE;
+}
+
+static void
+push_finish(json_context * ctx) {
+    ctx->byte_count = CUR_ABS_POS(ctx);
+    ctx->flags.text_stats_pending = 1;
+}
+
+/* Drop the input that has already been parsed.  The byte before the
+   current char is kept, since a few places treat position 0 as the
+   start of the input. */
+static void
+push_discard_parsed(json_context * ctx) {
+    jsonevt_push_buf * pb = &ctx->push;
+    uint amt;
+
+    if (ctx->push_state != PUSH_STATE_VALUE && ctx->push_state != PUSH_STATE_NESTED) {
+        return;
+    }
+
+    if (CUR_POS(ctx) < 2) {
+        return;
+    }
+
+    amt = CUR_POS(ctx) - 1;
+    if (amt < pb->len / 2) {
+        /* not worth moving the rest of the buffer yet */
+        return;
+    }
+
+    /* lines and chars are counted from here on */
+    get_text_pos(ctx, CUR_POS(ctx), &ctx->text_base);
+    ctx->text_base.byte_pos -= amt;
+
+    jsonevt_push_buf_discard(pb, amt);
+
+    ctx->buf = pb->buf;
+    ctx->len = pb->len;
+    ctx->pos -= amt;
+    ctx->cur_byte_pos -= amt;
+    ctx->base_byte_pos += amt;
+}
+
+int
+jsonevt_parse_begin(jsonevt_ctx * ext_ctx) {
+    jsonevt_ctx * ctx = ext_ctx;
+
+    jsonevt_reset_ctx(ctx);
+    jsonevt_push_buf_reset(&ctx->push);
+
+    ctx->buf = ctx->push.buf;
+    ctx->len = 0;
+    ctx->pos = 0;
+    ctx->text_base.line = 1;
+    ctx->line = 1;
+
+    ctx->ext_ctx = ctx;
+    ctx->push_state = PUSH_STATE_START;
+
+    return 1;
+}
+
+int
+jsonevt_parse_chunk(jsonevt_ctx * ext_ctx, const char * buf, uint len) {
+    jsonevt_ctx * ctx = ext_ctx;
+    int rv;
+
+    if (ctx->push_state == PUSH_STATE_NONE) {
+        SET_ERROR(ctx, "jsonevt_parse_chunk() called before jsonevt_parse_begin()");
+        return 0;
+    }
+
+    if (ctx->push_state == PUSH_STATE_ERROR) {
+        return 0;
+    }
+
+    jsonevt_push_buf_append(&ctx->push, buf, len);
+    jsonevt_push_buf_scan(&ctx->push);
+
+    ctx->buf = ctx->push.buf;
+    ctx->len = ctx->push.len;
+
+    rv = push_parse(ctx, 0);
+    if (rv) {
+        push_discard_parsed(ctx);
+    }
+    else {
+        push_finish(ctx);
+    }
+
+    return rv;
+}
+
+int
+jsonevt_parse_fail(jsonevt_ctx * ext_ctx, const char * error) {
+    jsonevt_ctx * ctx = ext_ctx;
+
+    if (ctx->push_state == PUSH_STATE_NONE) {
+        SET_ERROR(ctx, "jsonevt_parse_fail() called before jsonevt_parse_begin()");
+        return 0;
+    }
+
+    SET_ERROR(ctx, "%s", error);
+    ctx->push_state = PUSH_STATE_ERROR;
+
+    return 0;
+}
+
+int
+jsonevt_parse_end(jsonevt_ctx * ext_ctx) {
+    jsonevt_ctx * ctx = ext_ctx;
+    int rv;
+
+    if (ctx->push_state == PUSH_STATE_NONE) {
+        SET_ERROR(ctx, "jsonevt_parse_end() called before jsonevt_parse_begin()");
+        return 0;
+    }
+
+    rv = push_parse(ctx, 1);
+
+    if (rv && ctx->pos < ctx->len) {
+        EAT_WHITESPACE(ctx, 0);
+        if (ctx->pos < ctx->len) {
+            /* garbage at end */
+            SET_ERROR(ctx, "syntax error - garbage at end of JSON");
+            rv = 0;
+        }
+    }
+
+    push_finish(ctx);
+
+    ctx->push_state = PUSH_STATE_NONE;
 
     return rv;
 }
@@ -1701,6 +2780,9 @@ jsonevt_parse_file(jsonevt_ctx * ext_ctx, const char * file) {
 
     rv = jsonevt_parse(ext_ctx, buf, (uint)file_size);
 
+    /* buf is about to go away */
+    finish_text_stats(ext_ctx);
+
 #ifdef USE_MMAP
     if (munmap(buf, file_size)) {
         JSON_DEBUG("munmap failed.\n");
@@ -88,6 +88,27 @@ char * jsonevt_get_error(jsonevt_ctx * ctx);
 int jsonevt_parse(jsonevt_ctx * ctx, const char * buf, uint len);
 int jsonevt_parse_file(jsonevt_ctx * ctx, const char * file);
 
+/* Incremental parsing: call jsonevt_parse_begin(), then pass the
+   input to jsonevt_parse_chunk() in pieces of any size as it comes in
+   (they may split tokens and utf-8 sequences), then call
+   jsonevt_parse_end().  The callbacks for each token, at any depth,
+   are called once the start of the next token has been seen (so a
+   top-level string, number, or word, and the closing brackets at the
+   very end, wait for jsonevt_parse_end()).  Input is discarded as it
+   is parsed, so memory use is bounded by the largest token, not the
+   size of the document.  Each returns 0 on error, after which any
+   further chunks are ignored.
+*/
+int jsonevt_parse_begin(jsonevt_ctx * ctx);
+int jsonevt_parse_chunk(jsonevt_ctx * ctx, const char * buf, uint len);
+int jsonevt_parse_end(jsonevt_ctx * ctx);
+
+/* Stops an incremental parse with the given error, e.g., when reading
+   the input failed.  Returns 0.  jsonevt_parse_end() still needs to
+   be called, and will return 0 with this error.
+*/
+int jsonevt_parse_fail(jsonevt_ctx * ctx, const char * error);
+
 typedef int (*json_gen_cb)(void * cb_data, uint flags, uint level);
 
 typedef int (*json_string_cb)(void * cb_data, const char * data, uint data_len,
@@ -95,6 +116,31 @@ typedef int (*json_string_cb)(void * cb_data, const char * data, uint data_len,
 typedef int (*json_number_cb)(void * cb_data, const char * data, uint data_len,
     uint flags, uint level);
 typedef int (*json_bool_cb)(void * cb_data, uint bool_val, uint flags, uint level);
+
+#define JSON_EVT_NUMBER_INT64  1
+#define JSON_EVT_NUMBER_UINT64 2
+#define JSON_EVT_NUMBER_DOUBLE 3
+
+/* The value of a number, as worked out by the parser while scanning
+   it.  Integers get JSON_EVT_NUMBER_UINT64, or JSON_EVT_NUMBER_INT64
+   if negative, and anything with a decimal point or exponent gets
+   JSON_EVT_NUMBER_DOUBLE.  An integer too big for its type is given
+   as a double, with JSON_EVT_PARSE_NUMBER_OVERFLOW set in the flags
+   passed to the callback, as is a double that overflows to infinity.
+*/
+typedef struct {
+    uint type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } val;
+} jsonevt_number;
+
+/* Gets the same data as json_number_cb, plus the value.  If set, it
+   is called instead of the number callback. */
+typedef int (*json_typed_number_cb)(void * cb_data, const char * data, uint data_len,
+    const jsonevt_number * num, uint flags, uint level);
 typedef int (*json_comment_cb)(void * cb_data, const char * data, uint data_len,
     uint flags, uint level);
 
@@ -138,6 +184,7 @@ int jsonevt_set_cb_data(jsonevt_ctx * ctx, void * data);
 
 int jsonevt_set_string_cb(jsonevt_ctx * ctx, json_string_cb callback);
 int jsonevt_set_number_cb(jsonevt_ctx * ctx, json_number_cb callback);
+int jsonevt_set_typed_number_cb(jsonevt_ctx * ctx, json_typed_number_cb callback);
 int jsonevt_set_begin_array_cb(jsonevt_ctx * ctx, json_array_begin_cb callback);
 int jsonevt_set_end_array_cb(jsonevt_ctx * ctx, json_array_end_cb callback);
 int jsonevt_set_begin_array_element_cb(jsonevt_ctx * ctx, json_array_begin_element_cb callback);
@@ -150,9 +197,17 @@ int jsonevt_set_bool_cb(jsonevt_ctx * ctx, json_bool_cb callback);
 int jsonevt_set_null_cb(jsonevt_ctx * ctx, json_null_cb callback);
 int jsonevt_set_comment_cb(jsonevt_ctx * ctx, json_comment_cb callback);
 
-/* int jsonevt_set_options(jsonevt_ctx * ctx, uint options); */
+int jsonevt_set_options(jsonevt_ctx * ctx, uint options);
 int jsonevt_set_bad_char_policy(jsonevt_ctx * ctx, uint policy);
 
+/* From inside a begin_array or begin_hash callback, the number of
+   elements or entries the array or hash has, so it can be allocated at
+   its full size.  This is only known with
+   JSON_EVT_OPTION_STRUCTURAL_INDEX -- otherwise it is 0.  Extra
+   commas (e.g., in [1,,2,]) are skipped like whitespace, so they don't
+   count. */
+uint jsonevt_get_size_hint(jsonevt_ctx * ctx);
+
 /* use these to find out where an error occurred or where a callback
    terminated the parse early
 */
@@ -162,6 +217,12 @@ uint jsonevt_get_error_byte_col(jsonevt_ctx * ctx);
 uint jsonevt_get_error_char_pos(jsonevt_ctx * ctx);
 uint jsonevt_get_error_byte_pos(jsonevt_ctx * ctx);
 
+/* The line and char counts are worked out from the input in one pass
+   at the end of jsonevt_parse(), rather than as each char is parsed,
+   so the buffer passed to it may be freed as soon as it returns.  With
+   JSON_EVT_OPTION_LAZY_TEXT_STATS, that pass is put off until the line
+   or char count is asked for.
+*/
 uint jsonevt_get_stats_string_count(jsonevt_ctx * ctx);
 uint jsonevt_get_stats_longest_string_bytes(jsonevt_ctx * ctx);
 uint jsonevt_get_stats_longest_string_chars(jsonevt_ctx * ctx);
@@ -175,6 +236,14 @@ uint jsonevt_get_stats_line_count(jsonevt_ctx * ctx);
 uint jsonevt_get_stats_byte_count(jsonevt_ctx * ctx);
 uint jsonevt_get_stats_char_count(jsonevt_ctx * ctx);
 
+/* Count the lines and chars in buf the same way the getters above do
+   after jsonevt_parse() has succeeded on it, where byte_count is what
+   jsonevt_get_stats_byte_count() returned.  This is for a caller using
+   JSON_EVT_OPTION_LAZY_TEXT_STATS that keeps its own copy of the input
+   instead of the ctx. */
+void jsonevt_count_text_stats(const char * buf, uint len, uint byte_count, uint * lines,
+    uint * chars);
+
 void jsonevt_get_version(uint *major, uint *minor, uint *patch);
 
 typedef struct {
@@ -196,6 +265,192 @@ int jsonevt_util_parse_hash(const char *json_str, uint json_str_size, jsonevt_he
 
 void jsonevt_util_free_hash(jsonevt_he_pair *hash);
 
+/* Parse a whole document into a jsonevt_doc, a flat tape of nodes with
+   all the strings in one arena, for random access after parsing.  Any
+   callbacks set on ctx are cleared.  Returns NULL on error,
+   in which case the error is available from ctx as usual.  Free the
+   document with jsonevt_doc_free().
+
+   Nodes are given by their index in the tape, and 0 means there isn't
+   one (e.g., the end of an array has been reached, or a key wasn't
+   found).  The children of a hash are its keys and values in turn, so
+   for a key node, jsonevt_doc_next_sibling() gives its value.  Numbers
+   are stored as converted by the parser (see jsonevt_number), so a
+   number too big for its type is stored as a double.
+*/
+typedef struct jsonevt_doc_struct jsonevt_doc;
+
+#define JSON_EVT_DOC_NONE   0
+#define JSON_EVT_DOC_NULL   1
+#define JSON_EVT_DOC_BOOL   2
+#define JSON_EVT_DOC_INT64  3
+#define JSON_EVT_DOC_UINT64 4
+#define JSON_EVT_DOC_DOUBLE 5
+#define JSON_EVT_DOC_STRING 6
+#define JSON_EVT_DOC_ARRAY  7
+#define JSON_EVT_DOC_HASH   8
+
+jsonevt_doc * jsonevt_doc_parse(jsonevt_ctx * ctx, const char * buf, uint len);
+void jsonevt_doc_free(jsonevt_doc * doc);
+
+uint jsonevt_doc_root(const jsonevt_doc * doc);
+uint jsonevt_doc_type(const jsonevt_doc * doc, uint node);
+
+/* These return 0 if the node isn't a number or its value doesn't fit. */
+int jsonevt_doc_get_int64(const jsonevt_doc * doc, uint node, int64_t * val);
+int jsonevt_doc_get_uint64(const jsonevt_doc * doc, uint node, uint64_t * val);
+int jsonevt_doc_get_double(const jsonevt_doc * doc, uint node, double * val);
+
+int jsonevt_doc_get_bool(const jsonevt_doc * doc, uint node);
+
+/* NUL-terminated, but may also contain NULs, so use *len */
+const char * jsonevt_doc_get_string(const jsonevt_doc * doc, uint node, uint * len);
+
+/* number of elements in an array, or entries in a hash */
+uint jsonevt_doc_get_size(const jsonevt_doc * doc, uint node);
+
+uint jsonevt_doc_first_child(const jsonevt_doc * doc, uint node);
+uint jsonevt_doc_next_sibling(const jsonevt_doc * doc, uint node);
+
+/* These walk the children from the first one, so jsonevt_doc_array_get()
+   is O(i) and jsonevt_doc_hash_get() O(entries).  To go through every
+   element, use jsonevt_doc_first_child() and jsonevt_doc_next_sibling()
+   instead of calling jsonevt_doc_array_get() for each index. */
+uint jsonevt_doc_array_get(const jsonevt_doc * doc, uint node, uint i);
+uint jsonevt_doc_hash_get(const jsonevt_doc * doc, uint node, const char * key, uint key_len);
+
+/* A pull-style alternative to the callbacks.  Each call to
+   jsonevt_cursor_next() returns the next token in buf, which must stay
+   around until the cursor is done with it.  Strings and numbers are
+   not decoded until asked for with the jsonevt_cursor_get_*()
+   functions, which apply to the last token returned.
+
+   jsonevt_cursor_skip() is the same as jsonevt_cursor_next(), except
+   that if the next value is an array or hash, all of it is skipped
+   without being parsed (only brackets, quotes, and comments are looked
+   at), and the BEGIN token is returned.  After a KEY token, this skips
+   the value for that key.  jsonevt_cursor_skip_rest() skips to the end
+   of the array or hash the cursor is in and returns the END token.
+   Skipped data is not checked for errors.
+
+   Strings are passed through as they are in the input, except for
+   escapes -- no check is made for malformed UTF-8.  The end of the
+   data is JSON_EVT_CURSOR_END, and after an error, every call returns
+   JSON_EVT_CURSOR_ERROR and the message is available from
+   jsonevt_cursor_get_error().
+*/
+typedef struct jsonevt_cursor_struct jsonevt_cursor;
+
+#define JSON_EVT_CURSOR_END         0
+#define JSON_EVT_CURSOR_ERROR       1
+#define JSON_EVT_CURSOR_BEGIN_ARRAY 2
+#define JSON_EVT_CURSOR_END_ARRAY   3
+#define JSON_EVT_CURSOR_BEGIN_HASH  4
+#define JSON_EVT_CURSOR_END_HASH    5
+#define JSON_EVT_CURSOR_KEY         6
+#define JSON_EVT_CURSOR_STRING      7
+#define JSON_EVT_CURSOR_NUMBER      8
+#define JSON_EVT_CURSOR_BOOL        9
+#define JSON_EVT_CURSOR_NULL        10
+
+jsonevt_cursor * jsonevt_cursor_new(const char * buf, uint len);
+void jsonevt_cursor_reset(jsonevt_cursor * cur, const char * buf, uint len);
+void jsonevt_cursor_free(jsonevt_cursor * cur);
+
+uint jsonevt_cursor_next(jsonevt_cursor * cur);
+uint jsonevt_cursor_skip(jsonevt_cursor * cur);
+uint jsonevt_cursor_skip_rest(jsonevt_cursor * cur);
+
+/* number of arrays and hashes the cursor is inside of */
+uint jsonevt_cursor_depth(jsonevt_cursor * cur);
+
+/* For STRING and KEY tokens.  Not NUL-terminated unless there were
+   escapes to decode.  Returns NULL on a bad \x or \u escape. */
+const char * jsonevt_cursor_get_string(jsonevt_cursor * cur, uint * len);
+
+/* true if the last token was a KEY equal to key */
+int jsonevt_cursor_key_is(jsonevt_cursor * cur, const char * key, uint key_len);
+
+/* the number as it appears in the input */
+const char * jsonevt_cursor_get_number_str(jsonevt_cursor * cur, uint * len);
+
+/* converted the same way as for the typed number callback */
+int jsonevt_cursor_get_number(jsonevt_cursor * cur, jsonevt_number * num);
+
+int jsonevt_cursor_get_bool(jsonevt_cursor * cur);
+
+const char * jsonevt_cursor_get_error(jsonevt_cursor * cur);
+
+/* Parse newline-delimited JSON (one document per line) on a pool of
+   worker threads.  Each worker has its own jsonevt_ctx, which is passed
+   to the ctx callback, if set, before parsing starts -- set the parse
+   callbacks and their cb_data there.  Those callbacks are called on
+   the worker threads, so cb_data should be per worker.
+
+   After each line, the record callback gets the line number (starting
+   at 1), the document if jsonevt_ndjson_set_make_docs() was turned
+   on, and the error message if the line couldn't be parsed.  The
+   callback owns the document and must free it with
+   jsonevt_doc_free().  A bad line doesn't stop the parse, but a
+   non-zero return from the record callback does.  Blank lines are
+   skipped.
+
+   By default, records are delivered from the worker threads as soon
+   as they are parsed (though never two at once).  With
+   jsonevt_ndjson_set_ordered(), they are delivered in line order on
+   the calling thread.  The number of threads defaults to the number
+   of CPUs.
+
+   jsonevt_ndjson_parse() and jsonevt_ndjson_parse_file() return 0 if
+   the file couldn't be read or the record callback asked to stop.
+
+   The same object can parse one big top-level array with
+   jsonevt_ndjson_parse_array(), with the elements as the records and
+   the element index (starting at 0) in place of the line number.  The
+   parse callbacks get each element at level 1 between its
+   begin_array_element and end_array_element callbacks, but the array
+   itself is never begun or ended.  Error positions are relative to
+   the element.  A bad element is a bad record, but brackets or quotes
+   that don't match up for the array as a whole make the parse fail
+   before any elements are parsed.
+
+   With jsonevt_ndjson_set_merge_docs(), the elements are put back
+   together into a single document for the whole array instead, which
+   jsonevt_ndjson_take_doc() hands over after the parse (the caller
+   frees it).  The record callback is not called, and any bad element
+   makes the parse fail.
+*/
+typedef struct jsonevt_ndjson_struct jsonevt_ndjson;
+
+typedef void (*jsonevt_ndjson_ctx_cb)(void * cb_data, jsonevt_ctx * ctx, uint worker);
+typedef int (*jsonevt_ndjson_record_cb)(void * cb_data, uint64_t line_num, jsonevt_doc * doc,
+    const char * error);
+
+jsonevt_ndjson * jsonevt_ndjson_new(void);
+void jsonevt_ndjson_free(jsonevt_ndjson * nd);
+
+void jsonevt_ndjson_set_threads(jsonevt_ndjson * nd, uint num_threads);
+void jsonevt_ndjson_set_ordered(jsonevt_ndjson * nd, int ordered);
+void jsonevt_ndjson_set_make_docs(jsonevt_ndjson * nd, int make_docs);
+void jsonevt_ndjson_set_merge_docs(jsonevt_ndjson * nd, int merge_docs);
+void jsonevt_ndjson_set_cb_data(jsonevt_ndjson * nd, void * cb_data);
+void jsonevt_ndjson_set_ctx_cb(jsonevt_ndjson * nd, jsonevt_ndjson_ctx_cb callback);
+void jsonevt_ndjson_set_record_cb(jsonevt_ndjson * nd, jsonevt_ndjson_record_cb callback);
+
+int jsonevt_ndjson_parse(jsonevt_ndjson * nd, const char * buf, size_t len);
+int jsonevt_ndjson_parse_file(jsonevt_ndjson * nd, const char * file);
+int jsonevt_ndjson_parse_array(jsonevt_ndjson * nd, const char * buf, size_t len);
+int jsonevt_ndjson_parse_array_file(jsonevt_ndjson * nd, const char * file);
+
+jsonevt_doc * jsonevt_ndjson_take_doc(jsonevt_ndjson * nd);
+
+const char * jsonevt_ndjson_get_error(jsonevt_ndjson * nd);
+
+/* lines (not counting blank ones) or elements parsed, and how many
+   of them had errors */
+uint64_t jsonevt_ndjson_get_record_count(jsonevt_ndjson * nd);
+uint64_t jsonevt_ndjson_get_bad_record_count(jsonevt_ndjson * nd);
+
 /* Use these inside a callback to find out where the parser is in the buffer/file. */
 /* These will be implemented later. */
 /*
@@ -217,6 +472,8 @@ uint jsonevt_get_byte_pos(json_ctx * ctx);
 #define JSON_EVT_IS_CPLUSPLUS_COMMENT (1 << 7)
 #define JSON_EVT_IS_PERL_COMMENT      (1 << 8)
 
+#define JSON_EVT_PARSE_NUMBER_OVERFLOW (1 << 9)
+
 /* print names of the above flags that are in "flags" to stderr */
 int jsonevt_print_flags(uint flags, FILE *fp);
 
@@ -227,6 +484,18 @@ int jsonevt_print_flags(uint flags, FILE *fp);
 #define JSON_EVT_OPTION_BAD_CHAR_POLICY_PASS    (1 << 1)
 #define JSON_EVT_OPTION_ASCII                   (1 << 2)
 
+/* Build an index of strings, arrays, and hashes in a first pass over
+   the buffer, so string bodies can be skipped over instead of being
+   stepped through one character at a time.  Falls back to the normal
+   parse if the buffer has comments. */
+#define JSON_EVT_OPTION_STRUCTURAL_INDEX        (1 << 3)
+
+/* Don't count lines and chars at the end of jsonevt_parse() -- the
+   caller promises that the buffer is still there until the line and
+   char counts have been asked for (or the ctx is reset or freed).  They
+   are still worked out right away if there is an error. */
+#define JSON_EVT_OPTION_LAZY_TEXT_STATS         (1 << 4)
+
 /* #define JSON_EVT_OPTION_CONVERT_BOOL             1 */
 
 #define JSONEVT_ERR_UNEXPECTED_HASH 1000
@@ -27,6 +27,9 @@
 #include "utf8.h"
 #include "print.h"
 #include "jsonevt_utils.h"
+#include "struct_index.h"
+#include "push_buf.h"
+#include "number.h"
 
 JSON_DO_CPLUSPLUS_WRAP_BEGIN
 
@@ -39,16 +42,28 @@ typedef struct {
 
 struct context_flags_struct {
     int have_char:1;
-    int pad:7;
+    int text_stats_pending:1; /* line and char counts not worked out yet */
+    int pad:6;
 };
 
+/* Line, column, and char position of a byte offset in the input.
+   Only the byte offset is kept up to date while parsing -- the rest is
+   worked out from the input when it is needed (see get_text_pos() in
+   jsonevt.c). */
+typedef struct {
+    uint byte_pos; /* offset into the current buffer */
+    uint char_pos;
+    uint line;
+    uint byte_col;
+    uint char_col;
+} jsonevt_text_pos;
+
 typedef struct json_extern_ctx json_context;
 
 struct json_extern_ctx {
     const char * buf;
     uint len;
     uint pos;
-    uint char_pos;
 
     char * error;
     uint error_byte_pos;
@@ -67,6 +82,7 @@ struct json_extern_ctx {
     json_hash_begin_entry_cb begin_hash_entry_cb;
     json_hash_end_entry_cb end_hash_entry_cb;
     json_number_cb number_cb;
+    json_typed_number_cb typed_number_cb;
     json_bool_cb bool_cb;
     json_null_cb null_cb;
     json_comment_cb comment_cb;
@@ -90,15 +106,25 @@ struct json_extern_ctx {
     uint cur_char;
     uint cur_char_len;
     uint cur_byte_pos;
-    uint cur_char_pos;
-    uint cur_line;
-    uint cur_byte_col;
-    uint cur_char_col;
+
+    /* where counting lines and chars starts from -- the start of the
+       input, unless some of it has been discarded from the push buffer */
+    jsonevt_text_pos text_base;
 
     struct context_flags_struct flags;
     jsonevt_ctx * ext_ctx;
 
     int cb_early_return_val;
+
+    /* for the begin_array and begin_hash callbacks -- see jsonevt_get_size_hint() */
+    uint size_hint;
+
+    /* kept across resets so the memory can be reused */
+    jsonevt_struct_index index;
+    jsonevt_push_buf push;
+
+    uint push_state;
+    uint base_byte_pos; /* bytes of input already discarded from the push buffer */
 };
 
 /*
@@ -238,11 +264,8 @@ int js_asprintf(char ** ret, const char * fmt, ...);
 #define USING_STACK_BUF(s) ((s)->stack_buf && (s)->buf == (s)->stack_buf)
 #define USING_ORIG_BUF(s) ((s)->flags.using_orig)
 #define CUR_POS(c) ((c)->cur_byte_pos)
+#define CUR_ABS_POS(c) ((c)->cur_byte_pos + (c)->base_byte_pos)
 #define CUR_CHAR(c) ( (c)->cur_char )
-#define CUR_CHAR_POS(c) ((c)->cur_char_pos)
-#define CUR_LINE(ctx) ((ctx)->cur_line)
-#define CUR_COL(ctx) ((ctx)->cur_char_col)
-#define CUR_BYTE_COL(ctx) ((ctx)->cur_byte_col)
 #define CUR_BUF(c) (&c->buf[c->pos])
 #define BUF_POS(c) ( (c)->pos )
 #define BYTES_LEFT(c) ((c)->len - (c)->pos)
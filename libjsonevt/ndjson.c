@@ -0,0 +1,1265 @@
+/* Creation date: 2026-10-18T02:03:51Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+
+/* $Revision$ */
+#include "ndjson.h"
+#include "scan.h"
+#include "print.h"
+#include "jsonevt_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifndef JSONEVT_ON_WINDOWS
+#define USE_MMAP
+#endif
+
+#ifdef USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <stdio.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define UNLESS(stuff) if (! stuff)
+
+#ifndef NDJSON_NO_THREADS
+#define NDJSON_LOCK(nd)   pthread_mutex_lock(&(nd)->lock)
+#define NDJSON_UNLOCK(nd) pthread_mutex_unlock(&(nd)->lock)
+#define NDJSON_WAIT(nd)   pthread_cond_wait(&(nd)->cond, &(nd)->lock)
+#define NDJSON_WAKE(nd)   pthread_cond_broadcast(&(nd)->cond)
+#define NDJSON_DELIVER_LOCK(nd)   pthread_mutex_lock(&(nd)->deliver_lock)
+#define NDJSON_DELIVER_UNLOCK(nd) pthread_mutex_unlock(&(nd)->deliver_lock)
+#else
+/* everything runs on the calling thread, so nothing ever has to wait */
+#define NDJSON_LOCK(nd)
+#define NDJSON_UNLOCK(nd)
+#define NDJSON_WAIT(nd)
+#define NDJSON_WAKE(nd)
+#define NDJSON_DELIVER_LOCK(nd)
+#define NDJSON_DELIVER_UNLOCK(nd)
+#endif
+
+/* nd->abort is only set with nd->lock held, but the workers also look
+   at it between records without the lock.  It only ever goes from 0
+   to 1 during a parse, so a stale read just means stopping a record
+   later.  Every access goes through these, with or without the lock,
+   so none of them is a plain load racing with the store. */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define NDJSON_SET_ABORT(nd)   __atomic_store_n(&(nd)->abort, 1, __ATOMIC_RELAXED)
+#define NDJSON_CLEAR_ABORT(nd) __atomic_store_n(&(nd)->abort, 0, __ATOMIC_RELAXED)
+#define NDJSON_ABORTED(nd)     __atomic_load_n(&(nd)->abort, __ATOMIC_RELAXED)
+#else
+#define NDJSON_SET_ABORT(nd)   ((nd)->abort = 1)
+#define NDJSON_CLEAR_ABORT(nd) ((nd)->abort = 0)
+#define NDJSON_ABORTED(nd)     ((nd)->abort)
+#endif
+
+typedef struct {
+    jsonevt_ndjson * nd;
+    jsonevt_ctx * ctx;
+} ndjson_worker;
+
+static void
+set_error(jsonevt_ndjson * nd, const char * fmt, const char * arg) {
+    UNLESS (nd->error) {
+        js_asprintf(&nd->error, fmt, arg);
+    }
+}
+
+/* for errors found by the pre-scan of an array */
+static void
+set_error_at(jsonevt_ndjson * nd, size_t pos, const char * msg) {
+    UNLESS (nd->error) {
+        js_asprintf(&nd->error, "byte %lu - %s", (unsigned long)pos, msg);
+    }
+}
+
+static char *
+copy_str(const char * str) {
+    size_t len = strlen(str);
+    char * copy;
+
+    JSONEVT_NEW(copy, len + 1, char);
+    memcpy(copy, str, len + 1);
+
+    return copy;
+}
+
+static uint
+get_num_cpus(void) {
+#if !defined(NDJSON_NO_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n > 0) {
+        return (uint)n;
+    }
+#endif
+
+    return 1;
+}
+
+/* Cut the input into batches that end just after a newline. */
+static void
+make_batches(jsonevt_ndjson * nd) {
+    size_t start = 0;
+    size_t end;
+    uint size = 16;
+    const char * nl;
+
+    nd->num_batches = 0;
+    JSONEVT_NEW(nd->batches, size, ndjson_batch);
+
+    while (start < nd->len) {
+        end = start + NDJSON_BATCH_SIZE;
+        if (end >= nd->len) {
+            end = nd->len;
+        }
+        else {
+            nl = (const char *)memchr(nd->buf + end - 1, '\n', nd->len - end + 1);
+            end = nl ? (size_t)(nl - nd->buf) + 1 : nd->len;
+        }
+
+        if (nd->num_batches >= size) {
+            size *= 2;
+            JSONEVT_RENEW(nd->batches, size, ndjson_batch);
+        }
+
+        memset(&nd->batches[nd->num_batches], 0, sizeof(ndjson_batch));
+        nd->batches[nd->num_batches].start = start;
+        nd->batches[nd->num_batches].end = end;
+        nd->num_batches++;
+
+        start = end;
+    }
+}
+
+static uint64_t
+count_lines(const char * buf, size_t start, size_t end) {
+    uint64_t count = 0;
+    const char * p = buf + start;
+    const char * stop = buf + end;
+
+    /* memchr() is vectorized in any libc worth using */
+    while (p < stop && (p = (const char *)memchr(p, '\n', stop - p))) {
+        count++;
+        p++;
+    }
+
+    /* a last line without a newline */
+    if (end > start && buf[end - 1] != '\n') {
+        count++;
+    }
+
+    return count;
+}
+
+static void
+free_records(ndjson_batch * b) {
+    uint i;
+
+    for (i = 0; i < b->num_records; i++) {
+        if (b->records[i].doc) {
+            jsonevt_doc_free(b->records[i].doc);
+        }
+        if (b->records[i].error) {
+            JSONEVT_FREE_MEM(b->records[i].error);
+        }
+    }
+
+    if (b->records) {
+        JSONEVT_FREE_MEM(b->records);
+    }
+
+    b->records = NULL;
+    b->num_records = 0;
+    b->records_size = 0;
+}
+
+/* returns 0 if the record callback asked to stop */
+static int
+deliver(jsonevt_ndjson * nd, uint64_t num, jsonevt_doc * doc, const char * error) {
+    UNLESS (nd->record_cb) {
+        if (doc) {
+            jsonevt_doc_free(doc);
+        }
+        return 1;
+    }
+
+    if (nd->record_cb(nd->cb_data, num, doc, error)) {
+        NDJSON_LOCK(nd);
+        NDJSON_SET_ABORT(nd);
+        set_error(nd, "early termination from %s callback", "record");
+        NDJSON_WAKE(nd);
+        NDJSON_UNLOCK(nd);
+
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Keep the record for delivery in order, or hand it to the callback
+   now if the order doesn't matter. */
+static void
+add_record(jsonevt_ndjson * nd, ndjson_batch * b, uint64_t num, jsonevt_doc * doc,
+    const char * error) {
+    ndjson_record * rec;
+
+    b->parsed++;
+    if (error) {
+        b->bad++;
+    }
+
+    if (nd->ordered) {
+        if (b->num_records >= b->records_size) {
+            b->records_size = b->records_size ? b->records_size * 2 : 64;
+            JSONEVT_RENEW(b->records, b->records_size, ndjson_record);
+        }
+
+        rec = &b->records[b->num_records++];
+        rec->num = num;
+        rec->doc = doc;
+        rec->error = error ? copy_str(error) : NULL;
+    }
+    else {
+        /* the record callback is never called from two threads at once */
+        NDJSON_DELIVER_LOCK(nd);
+        UNLESS (NDJSON_ABORTED(nd)) {
+            deliver(nd, num, doc, error);
+        }
+        else if (doc) {
+            jsonevt_doc_free(doc);
+        }
+        NDJSON_DELIVER_UNLOCK(nd);
+    }
+}
+
+static void
+parse_lines(ndjson_worker * w, ndjson_batch * b) {
+    jsonevt_ndjson * nd = w->nd;
+    const char * buf = nd->buf;
+    size_t pos = b->start;
+    size_t line_end;
+    uint64_t line_num = b->first_num;
+    const char * nl;
+    const char * error;
+    jsonevt_doc * doc;
+    uint len;
+    int ok;
+
+    for (; pos < b->end && ! NDJSON_ABORTED(nd); pos = line_end + 1, line_num++) {
+        nl = (const char *)memchr(buf + pos, '\n', b->end - pos);
+        line_end = nl ? (size_t)(nl - buf) : b->end;
+
+        /* blank lines are not records */
+        if (line_end - pos <= ~(uint)0
+            && jsonevt_scan_space(buf + pos, (uint)(line_end - pos)) == line_end - pos) {
+            continue;
+        }
+
+        doc = NULL;
+        error = NULL;
+        jsonevt_reset_ctx(w->ctx);
+
+        if (line_end - pos > ~(uint)0) {
+            error = "line too long";
+        }
+        else {
+            len = (uint)(line_end - pos);
+            if (nd->make_docs) {
+                doc = jsonevt_doc_parse(w->ctx, buf + pos, len);
+                ok = doc != NULL;
+            }
+            else {
+                ok = jsonevt_parse(w->ctx, buf + pos, len);
+            }
+
+            UNLESS (ok) {
+                error = jsonevt_get_error(w->ctx);
+            }
+        }
+
+        add_record(nd, b, line_num, doc, error);
+    }
+}
+
+/* Top-level arrays */
+
+static uint
+unicode_space_len(const unsigned char * s, size_t left) {
+    if (left >= 2 && s[0] == 0xc2 && (s[1] == 0x85 || s[1] == 0xa0)) {
+        /* NEL, NBSP */
+        return 2;
+    }
+
+    if (left >= 3 && s[0] == 0xe2) {
+        if (s[1] == 0x80 && (s[2] == 0x8b || s[2] == 0xa8 || s[2] == 0xa9)) {
+            /* ZWSP, LS, PS */
+            return 3;
+        }
+        if (s[1] == 0x81 && s[2] == 0xa0) {
+            /* WJ */
+            return 3;
+        }
+    }
+
+    return 0;
+}
+
+/* Step over the comment starting at pos and return the position after
+   it, or pos itself if there is a '/' by itself. */
+static size_t
+skip_comment(const char * buf, size_t len, size_t pos) {
+    const unsigned char * s = (const unsigned char *)buf;
+    size_t i = pos;
+
+    if (s[i] == '/') {
+        i++;
+        if (i < len && s[i] == '*') {
+            for (i++; i + 1 < len; i++) {
+                if (s[i] == '*' && s[i + 1] == '/') {
+                    return i + 2;
+                }
+            }
+
+            /* runs to the end of the buffer */
+            return len;
+        }
+
+        if (i >= len || s[i] != '/') {
+            return pos;
+        }
+    }
+
+    /* '#' or "//" -- up to and including the end of the line */
+    for (; i < len; i++) {
+        if (s[i] == '\n') {
+            return i + 1;
+        }
+
+        if (s[i] == 0xc2 && i + 1 < len && s[i + 1] == 0x85) {
+            return i + 2;
+        }
+
+        if (s[i] == 0xe2 && i + 2 < len && s[i + 1] == 0x80 && s[i + 2] == 0xa8) {
+            return i + 3;
+        }
+    }
+
+    return len;
+}
+
+/* Return the position of the first byte at or after pos that is not
+   whitespace or part of a comment. */
+static size_t
+skip_space(const char * buf, size_t len, size_t pos) {
+    size_t left;
+    size_t next;
+    uint n;
+    unsigned char c;
+
+    while (pos < len) {
+        left = len - pos;
+        pos += jsonevt_scan_space(buf + pos, left > ~(uint)0 ? ~(uint)0 : (uint)left);
+        if (pos >= len) {
+            break;
+        }
+
+        c = (unsigned char)buf[pos];
+        if (c == '#' || c == '/') {
+            next = skip_comment(buf, len, pos);
+            if (next == pos) {
+                /* a '/' by itself is left for the parser to complain about */
+                break;
+            }
+            pos = next;
+        }
+        else if (c >= 0x80
+            && (n = unicode_space_len((const unsigned char *)buf + pos, len - pos))) {
+            pos += n;
+        }
+        else {
+            break;
+        }
+    }
+
+    return pos;
+}
+
+/* Return the position of the quote that ends the string starting at
+   pos (just after the opening quote), or len if it isn't terminated. */
+static size_t
+find_string_end(const char * buf, size_t len, size_t pos, char quote_char) {
+    size_t left;
+    int have_high = 0;
+
+    while (pos < len) {
+        left = len - pos;
+        pos += jsonevt_scan_string(buf + pos, left > ~(uint)0 ? ~(uint)0 : (uint)left,
+            quote_char, &have_high);
+        if (pos >= len) {
+            break;
+        }
+
+        if (buf[pos] == quote_char) {
+            return pos;
+        }
+
+        /* backslash -- skip it and the char it escapes */
+        pos += 2;
+    }
+
+    return len;
+}
+
+/*
+  Return the position of the ',' or ']' that ends the array element
+  starting at pos, using the block classifiers to get to the next
+  bracket, quote, comma, or comment.  Only the bracket depth is kept
+  track of, so mismatched brackets inside the element are left for
+  the parser to find.  On error, *error is set and len is returned.
+*/
+static size_t
+next_separator(const char * buf, size_t len, size_t pos, const char ** error) {
+    size_t base = pos;
+    size_t next;
+    uint depth = 0;
+    int restart;
+    jsonevt_scan_masks m;
+    uint64_t cand;
+    char c;
+
+    while (base < len) {
+        if (len - base >= JSONEVT_SCAN_BLOCK_SIZE) {
+            jsonevt_scan_block(buf + base, &m);
+        }
+        else {
+            jsonevt_scan_partial_block(buf + base, (uint)(len - base), &m);
+        }
+
+        cand = m.quote | m.squote | m.structural | m.comment;
+        restart = 0;
+
+        while (cand) {
+            pos = base + JSONEVT_CTZ64(cand);
+            cand = JSONEVT_CLEAR_LOWEST_BIT(cand);
+            c = buf[pos];
+            next = pos;
+
+            switch (c) {
+              case '[':
+              case '{':
+                  depth++;
+                  break;
+
+              case ']':
+              case '}':
+                  UNLESS (depth) {
+                      if (c == ']') {
+                          return pos;
+                      }
+
+                      *error = "syntax error in array";
+                      return len;
+                  }
+                  depth--;
+                  break;
+
+              case ',':
+                  UNLESS (depth) {
+                      return pos;
+                  }
+                  break;
+
+              case '"':
+              case '\'':
+                  next = find_string_end(buf, len, pos + 1, c);
+                  if (next >= len) {
+                      *error = "unterminated string";
+                      return len;
+                  }
+                  next++;
+                  break;
+
+              case '#':
+              case '/':
+                  next = skip_comment(buf, len, pos);
+                  break;
+
+              default:
+                  /* ':' */
+                  break;
+            }
+
+            if (next > pos) {
+                /* a string or comment -- drop the candidates inside it,
+                   or go on from the end of it if it runs past this
+                   block */
+                if (next - base < JSONEVT_SCAN_BLOCK_SIZE) {
+                    cand &= ~(uint64_t)0 << (next - base);
+                }
+                else {
+                    base = next;
+                    restart = 1;
+                    break;
+                }
+            }
+        }
+
+        UNLESS (restart) {
+            base += JSONEVT_SCAN_BLOCK_SIZE;
+        }
+    }
+
+    *error = "array not terminated";
+
+    return len;
+}
+
+static ndjson_batch *
+add_batch(jsonevt_ndjson * nd, uint * size, size_t start) {
+    ndjson_batch * b;
+
+    if (nd->num_batches >= *size) {
+        *size *= 2;
+        JSONEVT_RENEW(nd->batches, *size, ndjson_batch);
+    }
+
+    b = &nd->batches[nd->num_batches++];
+    memset(b, 0, sizeof(ndjson_batch));
+    b->start = start;
+    b->counted = 1;
+
+    return b;
+}
+
+/*
+  Cut the top-level array into batches of whole elements, and count
+  the elements in each, so each batch knows the index of its first
+  element before any of them are parsed.  This only checks the
+  structure of the array itself -- the elements are checked when they
+  are parsed.
+*/
+static int
+make_array_batches(jsonevt_ndjson * nd) {
+    const char * buf = nd->buf;
+    size_t len = nd->len;
+    size_t pos = 0;
+    size_t sep;
+    uint size = 16;
+    uint64_t num = 0;
+    ndjson_batch * b = NULL;
+    const char * error = NULL;
+    int first = 1;
+
+    nd->num_batches = 0;
+    JSONEVT_NEW(nd->batches, size, ndjson_batch);
+
+    /* byte order mark */
+    if (len >= 3 && (unsigned char)buf[0] == 0xef && (unsigned char)buf[1] == 0xbb
+        && (unsigned char)buf[2] == 0xbf) {
+        pos = 3;
+    }
+
+    pos = skip_space(buf, len, pos);
+    if (pos >= len || buf[pos] != '[') {
+        set_error_at(nd, pos, "top-level value is not an array");
+        return 0;
+    }
+
+    sep = pos;
+    for (;;) {
+        pos = skip_space(buf, len, sep + 1);
+        if (first) {
+            if (pos < len && buf[pos] == ',') {
+                set_error_at(nd, pos, "syntax error in array");
+                return 0;
+            }
+        }
+        else {
+            while (pos < len && buf[pos] == ',') {
+                pos = skip_space(buf, len, pos + 1);
+            }
+        }
+
+        if (pos >= len) {
+            set_error_at(nd, pos, "array not terminated");
+            return 0;
+        }
+
+        if (buf[pos] == ']') {
+            if (first) {
+                /* empty array */
+                sep = pos;
+                break;
+            }
+
+            /* trailing comma */
+            set_error_at(nd, pos, "syntax error in array");
+            return 0;
+        }
+
+        UNLESS (b) {
+            b = add_batch(nd, &size, sep);
+            b->first_num = num;
+        }
+
+        sep = next_separator(buf, len, pos, &error);
+        if (error) {
+            set_error_at(nd, pos, error);
+            return 0;
+        }
+
+        b->count++;
+        num++;
+        first = 0;
+
+        if (buf[sep] == ']') {
+            b->end = sep;
+            break;
+        }
+
+        if (sep - b->start >= NDJSON_BATCH_SIZE) {
+            b->end = sep;
+            b = NULL;
+        }
+    }
+
+    pos = skip_space(buf, len, sep + 1);
+    if (pos < len) {
+        set_error_at(nd, pos, "syntax error - garbage at end of JSON");
+        return 0;
+    }
+
+    return 1;
+}
+
+static void
+parse_elements(ndjson_worker * w, ndjson_batch * b) {
+    jsonevt_ndjson * nd = w->nd;
+    const char * buf = nd->buf;
+    size_t len = nd->len;
+    size_t sep = b->start;
+    size_t pos;
+    uint64_t num = b->first_num;
+    uint64_t i;
+    const char * error;
+    const char * dummy = NULL;
+    jsonevt_doc * doc;
+    doc_builder elem;
+    uint win_len;
+    uint end = 0;
+    int ok;
+
+    if (nd->merge_docs) {
+        jsonevt_doc_builder_init(&b->part,
+            b->end - b->start > ~(uint)0 ? ~(uint)0 : (uint)(b->end - b->start), 0);
+        jsonevt_doc_builder_attach(w->ctx, &b->part);
+    }
+
+    for (i = 0; i < b->count && ! NDJSON_ABORTED(nd); i++, num++) {
+        /* the pre-scan already checked all of this */
+        pos = skip_space(buf, len, sep + 1);
+        while (buf[pos] == ',') {
+            pos = skip_space(buf, len, pos + 1);
+        }
+
+        doc = NULL;
+        error = NULL;
+        ok = 0;
+
+        /* The parser gets the rest of the batch, starting with the byte
+           before the element, and stops at the separator after it.
+           Batches are cut not long after NDJSON_BATCH_SIZE, so only a
+           single element can make this too big. */
+        if (pos >= b->end) {
+            /* the parser and the pre-scan disagree about an earlier element */
+            error = "syntax error in array";
+        }
+        else if (b->end - pos + 2 > ~(uint)0) {
+            error = "element too large";
+        }
+        else {
+            win_len = (uint)(b->end - pos + 2);
+
+            if (nd->merge_docs) {
+                ok = jsonevt_parse_array_element(w->ctx, buf + pos - 1, win_len, &end);
+            }
+            else if (nd->make_docs) {
+                jsonevt_doc_builder_init(&elem, 0, 1);
+                jsonevt_doc_builder_attach(w->ctx, &elem);
+
+                ok = jsonevt_parse_array_element(w->ctx, buf + pos - 1, win_len, &end);
+                if (ok) {
+                    doc = jsonevt_doc_builder_finish(&elem);
+                }
+
+                jsonevt_doc_builder_attach(w->ctx, NULL);
+                jsonevt_doc_builder_free(&elem);
+            }
+            else {
+                ok = jsonevt_parse_array_element(w->ctx, buf + pos - 1, win_len, &end);
+            }
+
+            UNLESS (ok) {
+                error = jsonevt_get_error(w->ctx);
+            }
+        }
+
+        if (ok) {
+            sep = pos - 1 + end;
+        }
+        else if (pos >= b->end) {
+            sep = b->end;
+        }
+        else {
+            /* find the next element the same way the pre-scan did */
+            sep = next_separator(buf, len, pos, &dummy);
+        }
+
+        if (nd->merge_docs) {
+            b->parsed++;
+            if (error) {
+                /* there's no document without all of the elements */
+                b->bad++;
+                NDJSON_LOCK(nd);
+                UNLESS (nd->error) {
+                    js_asprintf(&nd->error, "element %lu: %s", (unsigned long)num, error);
+                }
+                NDJSON_SET_ABORT(nd);
+                NDJSON_WAKE(nd);
+                NDJSON_UNLOCK(nd);
+            }
+        }
+        else {
+            add_record(nd, b, num, doc, error);
+        }
+    }
+
+    if (nd->merge_docs) {
+        jsonevt_doc_builder_attach(w->ctx, NULL);
+    }
+}
+
+static void *
+worker_main(void * arg) {
+    ndjson_worker * w = (ndjson_worker *)arg;
+    jsonevt_ndjson * nd = w->nd;
+    ndjson_batch * b;
+    uint i;
+
+    NDJSON_LOCK(nd);
+
+    for (;;) {
+        while (nd->ordered && ! NDJSON_ABORTED(nd) && nd->next_batch < nd->num_batches
+            && nd->next_batch >= nd->delivered + nd->max_ahead) {
+            NDJSON_WAIT(nd);
+        }
+
+        if (NDJSON_ABORTED(nd) || nd->next_batch >= nd->num_batches) {
+            break;
+        }
+
+        i = nd->next_batch++;
+        b = &nd->batches[i];
+
+        /* the elements of an array were counted by the pre-scan */
+        if (nd->mode == NDJSON_MODE_LINES) {
+            NDJSON_UNLOCK(nd);
+            b->count = count_lines(nd->buf, b->start, b->end);
+            NDJSON_LOCK(nd);
+
+            b->counted = 1;
+            while (nd->counted_upto < nd->num_batches && nd->batches[nd->counted_upto].counted) {
+                nd->batches[nd->counted_upto].first_num = nd->next_num;
+                nd->next_num += nd->batches[nd->counted_upto].count;
+                nd->counted_upto++;
+            }
+            NDJSON_WAKE(nd);
+
+            /* earlier batches were taken first, so this is a short wait */
+            while (nd->counted_upto <= i) {
+                NDJSON_WAIT(nd);
+            }
+        }
+
+        NDJSON_UNLOCK(nd);
+        if (nd->mode == NDJSON_MODE_LINES) {
+            parse_lines(w, b);
+        }
+        else {
+            parse_elements(w, b);
+        }
+        NDJSON_LOCK(nd);
+
+        nd->num_records += b->parsed;
+        nd->num_bad_records += b->bad;
+        b->done = 1;
+        NDJSON_WAKE(nd);
+    }
+
+    NDJSON_UNLOCK(nd);
+
+    return NULL;
+}
+
+/* ordered mode -- hand the records to the callback a batch at a time */
+static void
+deliver_in_order(jsonevt_ndjson * nd) {
+    ndjson_batch * b;
+    ndjson_record * rec;
+    uint i;
+
+    NDJSON_LOCK(nd);
+
+    while (nd->delivered < nd->num_batches && ! NDJSON_ABORTED(nd)) {
+        b = &nd->batches[nd->delivered];
+        while (! b->done && ! NDJSON_ABORTED(nd)) {
+            NDJSON_WAIT(nd);
+        }
+
+        if (NDJSON_ABORTED(nd)) {
+            break;
+        }
+
+        NDJSON_UNLOCK(nd);
+
+        for (i = 0; i < b->num_records; i++) {
+            rec = &b->records[i];
+            if (deliver(nd, rec->num, rec->doc, rec->error)) {
+                /* the callback owns the doc now */
+                rec->doc = NULL;
+            }
+            else {
+                rec->doc = NULL;
+                break;
+            }
+        }
+        free_records(b);
+
+        NDJSON_LOCK(nd);
+        nd->delivered++;
+        NDJSON_WAKE(nd);
+    }
+
+    NDJSON_UNLOCK(nd);
+}
+
+jsonevt_ndjson *
+jsonevt_ndjson_new(void) {
+    jsonevt_ndjson * nd;
+
+    JSONEVT_NEW(nd, 1, jsonevt_ndjson);
+    memset(nd, 0, sizeof(*nd));
+
+    /* worker_main() takes the locks even when it's the only worker, so
+       they're set up for as long as nd is around, not just for a parse
+       that starts threads */
+#ifndef NDJSON_NO_THREADS
+    pthread_mutex_init(&nd->lock, NULL);
+    pthread_mutex_init(&nd->deliver_lock, NULL);
+    pthread_cond_init(&nd->cond, NULL);
+#endif
+
+    return nd;
+}
+
+void
+jsonevt_ndjson_free(jsonevt_ndjson * nd) {
+    UNLESS (nd) {
+        return;
+    }
+
+    if (nd->error) {
+        JSONEVT_FREE_MEM(nd->error);
+    }
+
+    if (nd->doc) {
+        jsonevt_doc_free(nd->doc);
+    }
+
+#ifndef NDJSON_NO_THREADS
+    pthread_cond_destroy(&nd->cond);
+    pthread_mutex_destroy(&nd->deliver_lock);
+    pthread_mutex_destroy(&nd->lock);
+#endif
+
+    JSONEVT_FREE_MEM(nd);
+}
+
+void
+jsonevt_ndjson_set_threads(jsonevt_ndjson * nd, uint num_threads) {
+    nd->num_threads = num_threads;
+}
+
+void
+jsonevt_ndjson_set_ordered(jsonevt_ndjson * nd, int ordered) {
+    nd->ordered = ordered;
+}
+
+void
+jsonevt_ndjson_set_make_docs(jsonevt_ndjson * nd, int make_docs) {
+    nd->make_docs = make_docs;
+}
+
+void
+jsonevt_ndjson_set_merge_docs(jsonevt_ndjson * nd, int merge_docs) {
+    nd->merge_docs = merge_docs;
+}
+
+void
+jsonevt_ndjson_set_cb_data(jsonevt_ndjson * nd, void * cb_data) {
+    nd->cb_data = cb_data;
+}
+
+void
+jsonevt_ndjson_set_ctx_cb(jsonevt_ndjson * nd, jsonevt_ndjson_ctx_cb callback) {
+    nd->ctx_cb = callback;
+}
+
+void
+jsonevt_ndjson_set_record_cb(jsonevt_ndjson * nd, jsonevt_ndjson_record_cb callback) {
+    nd->record_cb = callback;
+}
+
+static void
+start_parse(jsonevt_ndjson * nd, int mode, const char * buf, size_t len) {
+    if (nd->error) {
+        JSONEVT_FREE_MEM(nd->error);
+        nd->error = NULL;
+    }
+
+    if (nd->doc) {
+        jsonevt_doc_free(nd->doc);
+        nd->doc = NULL;
+    }
+
+    nd->num_records = 0;
+    nd->num_bad_records = 0;
+
+    nd->mode = mode;
+    nd->buf = buf;
+    nd->len = len;
+    nd->next_batch = 0;
+    nd->counted_upto = 0;
+    nd->next_num = mode == NDJSON_MODE_LINES ? 1 : 0;
+    nd->delivered = 0;
+    NDJSON_CLEAR_ABORT(nd);
+}
+
+static void
+finish_parse(jsonevt_ndjson * nd) {
+    uint i;
+
+    /* anything not delivered because of an early termination */
+    for (i = 0; i < nd->num_batches; i++) {
+        free_records(&nd->batches[i]);
+        jsonevt_doc_builder_free(&nd->batches[i].part);
+    }
+    JSONEVT_FREE_MEM(nd->batches);
+    nd->batches = NULL;
+    nd->num_batches = 0;
+
+    nd->buf = NULL;
+    nd->len = 0;
+}
+
+/* Parse the batches already set up in nd with a pool of workers. */
+static void
+run_workers(jsonevt_ndjson * nd) {
+    ndjson_worker * workers;
+    uint num_workers = nd->num_threads ? nd->num_threads : get_num_cpus();
+    uint i;
+    int ordered;
+#ifndef NDJSON_NO_THREADS
+    pthread_t * threads;
+    uint num_started = 0;
+#endif
+
+    if (num_workers > nd->num_batches) {
+        num_workers = nd->num_batches ? nd->num_batches : 1;
+    }
+#ifdef NDJSON_NO_THREADS
+    num_workers = 1;
+#endif
+
+    nd->max_ahead = num_workers * NDJSON_BATCHES_PER_THREAD;
+
+    JSONEVT_NEW(workers, num_workers, ndjson_worker);
+    for (i = 0; i < num_workers; i++) {
+        workers[i].nd = nd;
+        workers[i].ctx = jsonevt_new_ctx();
+        if (nd->ctx_cb) {
+            nd->ctx_cb(nd->cb_data, workers[i].ctx, i);
+        }
+    }
+
+    /* one worker on this thread delivers the records in order anyway */
+    ordered = nd->ordered;
+    if (num_workers == 1) {
+        nd->ordered = 0;
+    }
+
+#ifndef NDJSON_NO_THREADS
+    if (num_workers > 1) {
+        JSONEVT_NEW(threads, num_workers, pthread_t);
+        for (i = 0; i < num_workers; i++) {
+            if (pthread_create(&threads[i], NULL, worker_main, &workers[i])) {
+                break;
+            }
+            num_started++;
+        }
+
+        if (num_started) {
+            if (nd->ordered) {
+                deliver_in_order(nd);
+            }
+
+            for (i = 0; i < num_started; i++) {
+                pthread_join(threads[i], NULL);
+            }
+        }
+        else {
+            nd->ordered = 0;
+            worker_main(&workers[0]);
+        }
+
+        JSONEVT_FREE_MEM(threads);
+    }
+    else {
+        worker_main(&workers[0]);
+    }
+#else
+    worker_main(&workers[0]);
+#endif
+
+    nd->ordered = ordered;
+
+    for (i = 0; i < num_workers; i++) {
+        jsonevt_free_ctx(workers[i].ctx);
+    }
+    JSONEVT_FREE_MEM(workers);
+}
+
+int
+jsonevt_ndjson_parse(jsonevt_ndjson * nd, const char * buf, size_t len) {
+    start_parse(nd, NDJSON_MODE_LINES, buf, len);
+
+    make_batches(nd);
+    run_workers(nd);
+
+    finish_parse(nd);
+
+    return NDJSON_ABORTED(nd) ? 0 : 1;
+}
+
+int
+jsonevt_ndjson_parse_array(jsonevt_ndjson * nd, const char * buf, size_t len) {
+    doc_builder ** parts;
+    uint i;
+    int rv = 0;
+
+    start_parse(nd, NDJSON_MODE_ARRAY, buf, len);
+
+    if (make_array_batches(nd)) {
+        nd->counted_upto = nd->num_batches;
+        run_workers(nd);
+
+        rv = NDJSON_ABORTED(nd) ? 0 : 1;
+    }
+
+    if (rv && nd->merge_docs) {
+        JSONEVT_NEW(parts, nd->num_batches + 1, doc_builder *);
+        for (i = 0; i < nd->num_batches; i++) {
+            parts[i] = &nd->batches[i].part;
+        }
+
+        nd->doc = jsonevt_doc_merge_array(parts, nd->num_batches, nd->num_records);
+        JSONEVT_FREE_MEM(parts);
+
+        UNLESS (nd->doc) {
+            set_error(nd, "%s", "array too large for a document");
+            rv = 0;
+        }
+    }
+
+    finish_parse(nd);
+
+    return rv;
+}
+
+typedef struct {
+    char * buf;
+    size_t size;
+#ifdef USE_MMAP
+    int fd;
+#else
+    FILE * fp;
+#endif
+} ndjson_input;
+
+/* Map or read in the whole file. */
+static int
+open_input(jsonevt_ndjson * nd, const char * file, ndjson_input * in) {
+#ifdef USE_MMAP
+    struct stat file_info;
+
+    in->buf = (char *)0;
+
+    in->fd = open(file, O_RDONLY, 0);
+    if (in->fd < 0) {
+        set_error(nd, "couldn't open input file %s", file);
+        return 0;
+    }
+
+    if (fstat(in->fd, &file_info)) {
+        set_error(nd, "couldn't stat %s", file);
+        close(in->fd);
+        return 0;
+    }
+
+    in->size = file_info.st_size;
+
+    if (in->size == 0) {
+        return 1;
+    }
+
+#ifndef MAP_PRIVATE
+#define MAP_PRIVATE 2
+#endif
+    in->buf = (char *)mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+    if (in->buf == MAP_FAILED) {
+        set_error(nd, "mmap call failed for file %s", file);
+        close(in->fd);
+        return 0;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    madvise(in->buf, in->size, MADV_SEQUENTIAL);
+#endif
+#else
+    size_t amtread;
+
+    in->fp = fopen(file, "rb");
+    UNLESS (in->fp) {
+        set_error(nd, "couldn't open input file %s", file);
+        return 0;
+    }
+
+    fseek(in->fp, 0, SEEK_END);
+    in->size = ftell(in->fp);
+    fseek(in->fp, 0, SEEK_SET);
+
+    JSONEVT_NEW(in->buf, in->size + 1, char);
+
+    amtread = fread((void *)in->buf, 1, in->size, in->fp);
+    if (amtread != in->size) {
+        JSONEVT_FREE_MEM(in->buf);
+        fclose(in->fp);
+        set_error(nd, "got short read while slurping input file %s", file);
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+static void
+close_input(ndjson_input * in) {
+#ifdef USE_MMAP
+    if (in->size) {
+        munmap(in->buf, in->size);
+    }
+    close(in->fd);
+#else
+    JSONEVT_FREE_MEM(in->buf);
+    fclose(in->fp);
+#endif
+}
+
+int
+jsonevt_ndjson_parse_file(jsonevt_ndjson * nd, const char * file) {
+    ndjson_input in;
+    int rv;
+
+    if (nd->error) {
+        JSONEVT_FREE_MEM(nd->error);
+        nd->error = NULL;
+    }
+
+    UNLESS (open_input(nd, file, &in)) {
+        return 0;
+    }
+
+    rv = jsonevt_ndjson_parse(nd, in.size ? in.buf : "", in.size);
+    close_input(&in);
+
+    return rv;
+}
+
+int
+jsonevt_ndjson_parse_array_file(jsonevt_ndjson * nd, const char * file) {
+    ndjson_input in;
+    int rv;
+
+    if (nd->error) {
+        JSONEVT_FREE_MEM(nd->error);
+        nd->error = NULL;
+    }
+
+    UNLESS (open_input(nd, file, &in)) {
+        return 0;
+    }
+
+    rv = jsonevt_ndjson_parse_array(nd, in.size ? in.buf : "", in.size);
+    close_input(&in);
+
+    return rv;
+}
+
+jsonevt_doc *
+jsonevt_ndjson_take_doc(jsonevt_ndjson * nd) {
+    jsonevt_doc * doc = nd->doc;
+
+    nd->doc = NULL;
+
+    return doc;
+}
+
+const char *
+jsonevt_ndjson_get_error(jsonevt_ndjson * nd) {
+    return nd->error;
+}
+
+uint64_t
+jsonevt_ndjson_get_record_count(jsonevt_ndjson * nd) {
+    return nd->num_records;
+}
+
+uint64_t
+jsonevt_ndjson_get_bad_record_count(jsonevt_ndjson * nd) {
+    return nd->num_bad_records;
+}
@@ -0,0 +1,136 @@
+/* Creation date: 2026-10-18T02:03:51Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+
+/* $Revision$ */
+
+/*
+  Parsing of newline-delimited JSON on a pool of worker threads.  The
+  input is cut into batches of whole lines, which the workers take in
+  order.  Each worker counts the lines in its batch before parsing it,
+  so that line numbers are known without a serial pass over the whole
+  input.  In ordered mode, the records for a batch are kept until every
+  earlier batch has been delivered, and no more than
+  NDJSON_BATCHES_PER_THREAD batches per worker are taken ahead of the
+  one being delivered, to bound the memory held.
+
+  A single top-level array is done the same way, with the elements as
+  the records.  The array is split into batches of elements by a serial
+  pre-scan that only looks at brackets, quotes, commas, and comments,
+  so the element counts (and so the indexes) are known up front.  Each
+  element is parsed by itself with jsonevt_parse_array_element(),
+  which also finds where the next one starts.  For a merged document,
+  each batch is built into its own part, and the parts are put
+  together by jsonevt_doc_merge_array() at the end.
+*/
+
+#ifndef JSONEVT_NDJSON_H
+#define JSONEVT_NDJSON_H
+
+#include "jsonevt.h"
+#include "doc.h"
+
+#ifdef JSONEVT_ON_WINDOWS
+#define NDJSON_NO_THREADS
+#endif
+
+#ifndef NDJSON_NO_THREADS
+#include <pthread.h>
+#endif
+
+#include <stddef.h>
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+#define NDJSON_BATCH_SIZE (1024 * 1024)
+#define NDJSON_BATCHES_PER_THREAD 4
+
+#define NDJSON_MODE_LINES 0
+#define NDJSON_MODE_ARRAY 1
+
+typedef struct {
+    uint64_t num;
+    jsonevt_doc * doc;
+    char * error;
+} ndjson_record;
+
+typedef struct {
+    /* for arrays, start is the '[' or ',' before the first element,
+       and end is the ',' or ']' after the last one */
+    size_t start;
+    size_t end;
+
+    uint64_t first_num;   /* line number or element index of the first record */
+    uint64_t count;       /* lines or elements */
+    int counted;
+    int done;
+
+    /* kept for delivery in ordered mode */
+    ndjson_record * records;
+    uint num_records;
+    uint records_size;
+
+    uint64_t parsed;
+    uint64_t bad;
+
+    doc_builder part;     /* for a merged document */
+} ndjson_batch;
+
+struct jsonevt_ndjson_struct {
+    uint num_threads;
+    int ordered;
+    int make_docs;
+    int merge_docs;
+    void * cb_data;
+    jsonevt_ndjson_ctx_cb ctx_cb;
+    jsonevt_ndjson_record_cb record_cb;
+
+    char * error;
+    uint64_t num_records;
+    uint64_t num_bad_records;
+    jsonevt_doc * doc;
+
+    /* the rest is only valid during a parse */
+    int mode;
+    const char * buf;
+    size_t len;
+
+    ndjson_batch * batches;
+    uint num_batches;
+    uint next_batch;      /* the next one to be taken by a worker */
+    uint counted_upto;    /* batches before this one have first_num set */
+    uint64_t next_num;
+    uint delivered;       /* ordered mode: batches passed to record_cb */
+    uint max_ahead;
+    volatile int abort;
+
+#ifndef NDJSON_NO_THREADS
+    pthread_mutex_t lock;
+    pthread_mutex_t deliver_lock;
+    pthread_cond_t cond;
+#endif
+};
+
+/* in jsonevt.c */
+int jsonevt_parse_array_element(jsonevt_ctx * ctx, const char * buf, uint len, uint * end);
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_NDJSON_H */
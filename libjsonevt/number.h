@@ -0,0 +1,89 @@
+/* Creation date: 2026-10-17T13:20:08Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Conversion of numbers to int64, uint64, or double values for the
+  typed number callback.  The digits are added up as the parser steps
+  over them (8 at a time where possible), and the result is turned
+  into a correctly rounded double with the Eisel-Lemire algorithm.
+  Only numbers with more than 19 significant digits go through
+  strtod().
+
+  The other direction is here too: integers are written two digits
+  at a time, and doubles are written with the fewest digits that read
+  back as the same double (Grisu3, using the same table of powers,
+  with a slower exact search for the cases it can't settle).
+*/
+
+#ifndef JSONEVT_NUMBER_H
+#define JSONEVT_NUMBER_H
+
+#include "jsonevt.h"
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+#define JSONEVT_NUMBER_INT_PART      0
+#define JSONEVT_NUMBER_FRACTION_PART 1
+#define JSONEVT_NUMBER_EXPONENT_PART 2
+
+typedef struct {
+    uint64_t mantissa;  /* up to 19 significant digits */
+    int exponent;       /* power of 10 the mantissa is off by, not counting explicit_exp */
+    uint explicit_exp;  /* the part after the 'e' (capped) */
+    int exp_negative;
+    uint digits;        /* significant digits in mantissa */
+    int truncated;      /* non-zero digits were left out of the mantissa */
+} jsonevt_number_acc;
+
+/* Return the number of ASCII digits at the start of buf, looking at
+   no more than len bytes, and add them to acc as the given part of the
+   number. */
+uint jsonevt_number_scan_digits(const char * buf, uint len, jsonevt_number_acc * acc, uint part);
+
+/* Fill in num from acc.  buf and len are the number as it appears in
+   the input, used if there are too many digits to do it exactly from
+   acc.  *flags has the JSON_EVT_PARSE_NUMBER_* flags for the number,
+   and JSON_EVT_PARSE_NUMBER_OVERFLOW gets added to it if the value
+   doesn't fit the type it would normally get. */
+void jsonevt_number_finish(jsonevt_number_acc * acc, const char * buf, uint len, uint * flags,
+    jsonevt_number * num);
+
+/* big enough for any of the jsonevt_format_*() functions, plus a NUL */
+#define JSONEVT_NUMBER_BUF_SIZE 32
+
+/* Write val in decimal to buf (which must have room for
+   JSONEVT_NUMBER_BUF_SIZE bytes) followed by a NUL.  Returns the
+   length, not counting the NUL. */
+uint jsonevt_format_int(int64_t val, char * buf);
+uint jsonevt_format_uint(uint64_t val, char * buf);
+
+/* Same, for the shortest string that converts back to val.  Numbers
+   from 1e-6 up to (but not including) 1e21 are written without an
+   exponent, like JavaScript's Number.prototype.toString(), e.g.,
+   "0.1", "3", "-0", "1e+21", "1.5e-7".  Returns 0 (and writes
+   nothing) if val is infinite or NaN, as JSON has no way to write
+   those. */
+uint jsonevt_format_double(double val, char * buf);
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_NUMBER_H */
@@ -0,0 +1,266 @@
+/* Creation date: 2026-10-17T11:05:31Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+#include "push_buf.h"
+#include "scan.h"
+#include "jsonevt_utils.h"
+
+#include <string.h>
+
+#define UNLESS(stuff) if (! stuff)
+
+#define PUSH_BUF_INITIAL_SIZE 4096
+
+#define PUSH_LEX_NONE          0
+#define PUSH_LEX_STRING        1
+#define PUSH_LEX_SLASH         2 /* saw a '/' that may start a comment */
+#define PUSH_LEX_LINE_COMMENT  3
+#define PUSH_LEX_BLOCK_COMMENT 4
+#define PUSH_LEX_BLOCK_STAR    5 /* saw a '*' in a block comment */
+#define PUSH_LEX_WORD          6 /* a number, true, false, null, or bare key */
+
+#define PUSH_FRAMES_INITIAL_SIZE 16
+
+void
+jsonevt_push_buf_reset(jsonevt_push_buf * pb) {
+    char * buf = pb->buf;
+    uint size = pb->size;
+    jsonevt_push_frame * frames = pb->frames;
+    uint frames_size = pb->frames_size;
+
+    UNLESS (buf) {
+        size = PUSH_BUF_INITIAL_SIZE;
+        JSONEVT_NEW(buf, size, char);
+    }
+
+    UNLESS (frames) {
+        frames_size = PUSH_FRAMES_INITIAL_SIZE;
+        JSONEVT_NEW(frames, frames_size, jsonevt_push_frame);
+    }
+
+    memset((void *)pb, 0, sizeof(*pb));
+    pb->buf = buf;
+    pb->size = size;
+    pb->frames = frames;
+    pb->frames_size = frames_size;
+}
+
+void
+jsonevt_push_buf_append(jsonevt_push_buf * pb, const char * buf, uint len) {
+    if (pb->len + len > pb->size) {
+        while (pb->len + len > pb->size) {
+            pb->size *= 2;
+        }
+        JSONEVT_RENEW(pb->buf, pb->size, char);
+    }
+
+    memcpy((void *)&pb->buf[pb->len], (const void *)buf, len);
+    pb->len += len;
+}
+
+/* Returns true if the byte at pos ends a line comment, i.e., it is a
+   line feed, or the last byte of U+0085 (NEL) or U+2028 (LS) */
+static int
+is_comment_eol(jsonevt_push_buf * pb, uint8_t c) {
+    uint prev = pb->prev_bytes & 0xff;
+
+    return c == 0x0a || (c == 0x85 && prev == 0xc2)
+        || (c == 0xa8 && prev == 0x80 && (pb->prev_bytes >> 8) == 0xe2);
+}
+
+/* Record a boundary at byte offset pos */
+#define PUSH_BOUNDARY(pb, pos) ((pb)->boundaries++, (pb)->last_boundary = (pos))
+
+void
+jsonevt_push_buf_scan(jsonevt_push_buf * pb) {
+    const char * buf = pb->buf;
+    uint len = pb->len;
+    uint i = pb->scan_pos;
+    uint8_t c;
+    int have_high;
+
+    while (i < len) {
+        c = (uint8_t)buf[i];
+
+        switch (pb->lex) {
+          case PUSH_LEX_STRING:
+              if (pb->escape) {
+                  pb->escape = 0;
+              }
+              else if (c == '\\') {
+                  pb->escape = 1;
+              }
+              else if (c == pb->quote_char) {
+                  pb->lex = PUSH_LEX_NONE;
+              }
+              else {
+                  i += jsonevt_scan_string(&buf[i], len - i, (char)pb->quote_char, &have_high);
+                  continue;
+              }
+              i++;
+              continue;
+              break;
+
+          case PUSH_LEX_WORD:
+              /* The parser stops a word at the first char that can't
+                 be in an identifier or number, so ending it only at
+                 whitespace, punctuation, or the start of a string or
+                 comment is never too soon.  Anything non-ascii is
+                 kept in the word for the same reason. */
+              if (c == ' ' || (c >= 0x09 && c <= 0x0d) || c == ',' || c == ':'
+                  || c == '[' || c == ']' || c == '{' || c == '}'
+                  || c == '"' || c == '\'' || c == '/' || c == '#') {
+                  pb->lex = PUSH_LEX_NONE;
+                  break;
+              }
+              i++;
+              continue;
+              break;
+
+          case PUSH_LEX_SLASH:
+              if (c == '/' || c == '*') {
+                  pb->lex = c == '/' ? PUSH_LEX_LINE_COMMENT : PUSH_LEX_BLOCK_COMMENT;
+                  pb->prev_bytes = 0;
+                  i++;
+                  continue;
+              }
+
+              /* A '/' by itself is a syntax error the parser will
+                 report, so it is the start of a token as far as we are
+                 concerned. */
+              pb->lex = PUSH_LEX_NONE;
+              PUSH_BOUNDARY(pb, i - 1);
+              continue;
+              break;
+
+          case PUSH_LEX_LINE_COMMENT:
+              if (is_comment_eol(pb, c)) {
+                  pb->lex = PUSH_LEX_NONE;
+              }
+              pb->prev_bytes = ((pb->prev_bytes << 8) | c) & 0xffff;
+              i++;
+              continue;
+              break;
+
+          case PUSH_LEX_BLOCK_COMMENT:
+          case PUSH_LEX_BLOCK_STAR:
+              if (c == '/' && pb->lex == PUSH_LEX_BLOCK_STAR) {
+                  pb->lex = PUSH_LEX_NONE;
+              }
+              else {
+                  pb->lex = c == '*' ? PUSH_LEX_BLOCK_STAR : PUSH_LEX_BLOCK_COMMENT;
+              }
+              i++;
+              continue;
+              break;
+
+          default:
+              break;
+        }
+
+        i++;
+
+        /* Whitespace, and anything non-ascii (which is either
+           whitespace the parser skips or a syntax error at the start
+           of a token), never starts a token here. */
+        if (c == ' ' || (c >= 0x09 && c <= 0x0d) || (c & 0x80)) {
+            continue;
+        }
+
+        switch (c) {
+          case '/':
+              pb->lex = PUSH_LEX_SLASH;
+              break;
+
+          case '#':
+              pb->lex = PUSH_LEX_LINE_COMMENT;
+              pb->prev_bytes = 0;
+              break;
+
+          case ',':
+          case ':':
+          case ']':
+          case '}':
+              break;
+
+          case '"':
+          case '\'':
+              PUSH_BOUNDARY(pb, i - 1);
+              pb->lex = PUSH_LEX_STRING;
+              pb->quote_char = c;
+              pb->escape = 0;
+              break;
+
+          case '[':
+          case '{':
+              PUSH_BOUNDARY(pb, i - 1);
+              break;
+
+          default:
+              PUSH_BOUNDARY(pb, i - 1);
+              pb->lex = PUSH_LEX_WORD;
+              break;
+        }
+    }
+
+    pb->scan_pos = i;
+}
+
+/* Remove len bytes from the front of the buffer.  The caller is
+   responsible for adjusting any offsets it has into the buffer. */
+void
+jsonevt_push_buf_discard(jsonevt_push_buf * pb, uint len) {
+    if (len > pb->len) {
+        len = pb->len;
+    }
+
+    memmove((void *)pb->buf, (const void *)&pb->buf[len], pb->len - len);
+    pb->len -= len;
+    pb->scan_pos -= len;
+    pb->last_boundary = pb->last_boundary >= len ? pb->last_boundary - len : 0;
+}
+
+/* Returns a new frame on top of the stack, growing it if needed */
+jsonevt_push_frame *
+jsonevt_push_buf_push_frame(jsonevt_push_buf * pb) {
+    if (pb->num_frames == pb->frames_size) {
+        pb->frames_size *= 2;
+        JSONEVT_RENEW(pb->frames, pb->frames_size, jsonevt_push_frame);
+    }
+
+    memset((void *)&pb->frames[pb->num_frames], 0, sizeof(jsonevt_push_frame));
+
+    return &pb->frames[pb->num_frames++];
+}
+
+void
+jsonevt_push_buf_free(jsonevt_push_buf * pb) {
+    if (pb->buf) {
+        JSONEVT_FREE_MEM(pb->buf);
+    }
+
+    if (pb->frames) {
+        JSONEVT_FREE_MEM(pb->frames);
+    }
+
+    memset((void *)pb, 0, sizeof(*pb));
+}
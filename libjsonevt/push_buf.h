@@ -0,0 +1,86 @@
+/* Creation date: 2026-10-17T11:05:31Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Input buffer for jsonevt_parse_chunk().  Chunks are appended as they
+  come in, and a framer runs over the new bytes keeping track of
+  strings, comments, and bare words (numbers, true, etc.), so the
+  parser can tell when the next token has started to arrive.  The
+  framer keeps its place in the middle of a string, comment, or word
+  from one chunk to the next, so each byte is only looked at once.
+
+  A "boundary" is the first byte of a token that can start a value or
+  a hash key, at any depth: a '[' or '{', a quote, or the first char of
+  a word.  Commas, colons, and closing brackets are not boundaries.
+  The parser only goes on to the next step once it has seen a boundary
+  past where it is, so everything up to that boundary (the rest of the
+  current token, and any whitespace, comments, and punctuation after
+  it) is in the buffer, and it never runs into the end of a partial
+  buffer.
+
+  The containers the parser is in the middle of are kept on a stack of
+  frames here as well, so that nothing is lost between chunks.  The
+  fields of a frame belong to the push parser in jsonevt.c.
+*/
+
+#ifndef JSONEVT_PUSH_BUF_H
+#define JSONEVT_PUSH_BUF_H
+
+#include "jsonevt.h"
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+typedef struct {
+    uint type;          /* PUSH_FRAME_* in jsonevt.c */
+    uint state;
+    uint level;         /* level and flags of the array or hash */
+    uint flags;
+} jsonevt_push_frame;
+
+typedef struct {
+    char * buf;
+    uint len;
+    uint size;
+
+    uint scan_pos;      /* next byte for the framer to look at */
+    uint boundaries;    /* number of boundaries seen so far */
+    uint last_boundary; /* byte offset of the most recent one */
+    uint lex;           /* PUSH_LEX_* in push_buf.c */
+    uint quote_char;
+    uint prev_bytes;    /* last two bytes seen in a comment */
+    int escape;
+
+    jsonevt_push_frame * frames;
+    uint num_frames;
+    uint frames_size;
+} jsonevt_push_buf;
+
+void jsonevt_push_buf_reset(jsonevt_push_buf * pb);
+void jsonevt_push_buf_append(jsonevt_push_buf * pb, const char * buf, uint len);
+void jsonevt_push_buf_scan(jsonevt_push_buf * pb);
+void jsonevt_push_buf_discard(jsonevt_push_buf * pb, uint len);
+jsonevt_push_frame * jsonevt_push_buf_push_frame(jsonevt_push_buf * pb);
+void jsonevt_push_buf_free(jsonevt_push_buf * pb);
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_PUSH_BUF_H */
@@ -0,0 +1,338 @@
+/* Creation date: 2026-10-17T09:12:40Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+#include "scan.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#define JSONEVT_SCAN_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSONEVT_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#define IS_ASCII_SPACE(c) ( (c) == ' ' || ((c) >= 0x09 && (c) <= 0x0d) )
+
+#if defined(__GNUC__)
+#define CTZ32(mask) ((uint)__builtin_ctz(mask))
+#else
+uint
+jsonevt_ctz64(uint64_t mask) {
+    uint i = 0;
+
+    while (! (mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+
+    return i;
+}
+
+#define CTZ32(mask) jsonevt_ctz64((uint64_t)(mask))
+#endif
+
+#if defined(JSONEVT_SCAN_AVX2)
+
+#define SCAN_EQ(v, c) ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))))
+
+static void
+scan_32(const char * p, jsonevt_scan_masks * m, uint shift) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(0x09));
+    uint64_t ctl;
+
+    /* 0x09-0x0d, compared unsigned */
+    ctl = (uint64_t)(uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(0x04)), t));
+
+    m->quote |= SCAN_EQ(v, '"') << shift;
+    m->squote |= SCAN_EQ(v, '\'') << shift;
+    m->backslash |= SCAN_EQ(v, '\\') << shift;
+    m->structural |= (SCAN_EQ(v, '{') | SCAN_EQ(v, '}') | SCAN_EQ(v, '[') | SCAN_EQ(v, ']')
+        | SCAN_EQ(v, ':') | SCAN_EQ(v, ',')) << shift;
+    m->comment |= (SCAN_EQ(v, '/') | SCAN_EQ(v, '#')) << shift;
+    m->space |= (SCAN_EQ(v, ' ') | ctl) << shift;
+    m->high |= (uint64_t)(uint32_t)_mm256_movemask_epi8(v) << shift;
+}
+
+void
+jsonevt_scan_block(const char * block, jsonevt_scan_masks * masks) {
+    memset((void *)masks, 0, sizeof(*masks));
+    scan_32(block, masks, 0);
+    scan_32(block + 32, masks, 32);
+}
+
+const char *
+jsonevt_scan_impl_name(void) {
+    return "avx2";
+}
+
+#elif defined(JSONEVT_SCAN_SSE2)
+
+#define SCAN_EQ(v, c) ((uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))))
+
+static void
+scan_16(const char * p, jsonevt_scan_masks * m, uint shift) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(0x09));
+    uint64_t ctl;
+
+    /* 0x09-0x0d, compared unsigned */
+    ctl = (uint64_t)(uint16_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(0x04)), t));
+
+    m->quote |= SCAN_EQ(v, '"') << shift;
+    m->squote |= SCAN_EQ(v, '\'') << shift;
+    m->backslash |= SCAN_EQ(v, '\\') << shift;
+    m->structural |= (SCAN_EQ(v, '{') | SCAN_EQ(v, '}') | SCAN_EQ(v, '[') | SCAN_EQ(v, ']')
+        | SCAN_EQ(v, ':') | SCAN_EQ(v, ',')) << shift;
+    m->comment |= (SCAN_EQ(v, '/') | SCAN_EQ(v, '#')) << shift;
+    m->space |= (SCAN_EQ(v, ' ') | ctl) << shift;
+    m->high |= (uint64_t)(uint16_t)_mm_movemask_epi8(v) << shift;
+}
+
+void
+jsonevt_scan_block(const char * block, jsonevt_scan_masks * masks) {
+    memset((void *)masks, 0, sizeof(*masks));
+    scan_16(block, masks, 0);
+    scan_16(block + 16, masks, 16);
+    scan_16(block + 32, masks, 32);
+    scan_16(block + 48, masks, 48);
+}
+
+const char *
+jsonevt_scan_impl_name(void) {
+    return "sse2";
+}
+
+#else
+
+void
+jsonevt_scan_block(const char * block, jsonevt_scan_masks * masks) {
+    const unsigned char * p = (const unsigned char *)block;
+    uint i;
+    uint64_t bit;
+
+    memset((void *)masks, 0, sizeof(*masks));
+
+    for (i = 0; i < JSONEVT_SCAN_BLOCK_SIZE; i++) {
+        bit = (uint64_t)1 << i;
+
+        if (p[i] & 0x80) {
+            masks->high |= bit;
+            continue;
+        }
+
+        switch (p[i]) {
+          case '"':
+              masks->quote |= bit;
+              break;
+
+          case '\'':
+              masks->squote |= bit;
+              break;
+
+          case '\\':
+              masks->backslash |= bit;
+              break;
+
+          case '{':
+          case '}':
+          case '[':
+          case ']':
+          case ':':
+          case ',':
+              masks->structural |= bit;
+              break;
+
+          case '/':
+          case '#':
+              masks->comment |= bit;
+              break;
+
+          case ' ':
+          case 0x09:
+          case 0x0a:
+          case 0x0b:
+          case 0x0c:
+          case 0x0d:
+              masks->space |= bit;
+              break;
+
+          default:
+              break;
+        }
+    }
+}
+
+const char *
+jsonevt_scan_impl_name(void) {
+    return "scalar";
+}
+
+#endif
+
+void
+jsonevt_scan_partial_block(const char * block, uint len, jsonevt_scan_masks * masks) {
+    char tmp_buf[JSONEVT_SCAN_BLOCK_SIZE];
+
+    memset((void *)tmp_buf, 0, JSONEVT_SCAN_BLOCK_SIZE);
+    if (len > JSONEVT_SCAN_BLOCK_SIZE) {
+        len = JSONEVT_SCAN_BLOCK_SIZE;
+    }
+    memcpy((void *)tmp_buf, (const void *)block, len);
+
+    jsonevt_scan_block(tmp_buf, masks);
+}
+
+uint
+jsonevt_scan_space(const char * buf, uint len) {
+    const unsigned char * s = (const unsigned char *)buf;
+    uint i = 0;
+#if defined(JSONEVT_SCAN_AVX2) || defined(JSONEVT_SCAN_SSE2)
+    __m128i v;
+    __m128i t;
+    uint32_t space_mask;
+
+    while (len - i >= 16) {
+        v = _mm_loadu_si128((const __m128i *)(s + i));
+        t = _mm_sub_epi8(v, _mm_set1_epi8(0x09));
+
+        space_mask = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(0x04)), t)));
+
+        if (space_mask != 0xffff) {
+            return i + CTZ32(~space_mask);
+        }
+
+        i += 16;
+    }
+#endif
+
+    while (i < len && IS_ASCII_SPACE(s[i])) {
+        i++;
+    }
+
+    return i;
+}
+
+uint
+jsonevt_scan_string(const char * buf, uint len, char quote_char, int * have_high) {
+    const unsigned char * s = (const unsigned char *)buf;
+    uint i = 0;
+    uint high = 0;
+#if defined(JSONEVT_SCAN_AVX2) || defined(JSONEVT_SCAN_SSE2)
+    __m128i v;
+    uint32_t stop_mask;
+
+    while (len - i >= 16) {
+        v = _mm_loadu_si128((const __m128i *)(s + i));
+
+        stop_mask = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote_char)),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+
+        if (stop_mask) {
+            high |= (uint32_t)_mm_movemask_epi8(v) & ((1U << CTZ32(stop_mask)) - 1);
+            *have_high = high ? 1 : 0;
+            return i + CTZ32(stop_mask);
+        }
+
+        high |= (uint32_t)_mm_movemask_epi8(v);
+        i += 16;
+    }
+#endif
+
+    while (i < len && s[i] != (unsigned char)quote_char && s[i] != '\\') {
+        high |= s[i] & 0x80;
+        i++;
+    }
+
+    *have_high = high ? 1 : 0;
+
+    return i;
+}
+
+size_t
+jsonevt_scan_escape(const char * buf, size_t len, uint flags) {
+    const unsigned char * s = (const unsigned char *)buf;
+    size_t i = 0;
+    int want_solidus = (flags & JSONEVT_SCAN_ESC_SOLIDUS) ? 1 : 0;
+    int want_high = (flags & JSONEVT_SCAN_ESC_HIGH) ? 1 : 0;
+#if defined(JSONEVT_SCAN_AVX2) || defined(JSONEVT_SCAN_SSE2)
+    __m128i v;
+    /* without JSONEVT_SCAN_ESC_SOLIDUS, look for '"' twice instead */
+    __m128i solidus = _mm_set1_epi8(want_solidus ? '/' : '"');
+    uint32_t high_mask = want_high ? 0xffff : 0;
+    uint32_t stop_mask;
+
+    while (len - i >= 16) {
+        v = _mm_loadu_si128((const __m128i *)(s + i));
+
+        /* control characters are 0x00-0x1f, compared unsigned */
+        stop_mask = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, solidus),
+                    _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v))));
+        stop_mask |= (uint32_t)_mm_movemask_epi8(v) & high_mask;
+
+        if (stop_mask) {
+            return i + CTZ32(stop_mask);
+        }
+
+        i += 16;
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (s[i] < 0x20 || s[i] == '"' || s[i] == '\\'
+            || (s[i] == '/' && want_solidus) || (s[i] >= 0x80 && want_high)) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+uint
+jsonevt_u_escape(uint32_t code_point, char * buf) {
+    static const char hex_digits[] = "0123456789abcdef";
+    uint num_digits = 4;
+    uint i;
+
+    while (num_digits < 8 && (code_point >> (num_digits * 4)) != 0) {
+        num_digits++;
+    }
+
+    buf[0] = '\\';
+    buf[1] = 'u';
+    for (i = 0; i < num_digits; i++) {
+        buf[2 + i] = hex_digits[(code_point >> ((num_digits - 1 - i) * 4)) & 0x0f];
+    }
+
+    return num_digits + 2;
+}
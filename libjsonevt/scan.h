@@ -0,0 +1,102 @@
+/* Creation date: 2026-10-17T09:12:40Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Block classifiers used by the parser fast paths.  The input is
+  looked at 64 bytes at a time, and each byte class of interest comes
+  back as a 64-bit mask where bit i is set if byte i of the block is
+  in that class.  SSE2 or AVX2 is used when the compiler has it
+  enabled, otherwise a table-driven version is used.
+
+  jsonevt_scan_escape() and jsonevt_u_escape() are the other
+  direction -- they are shared by the string escaping in the C writer
+  and in the Perl encoder.
+*/
+
+#ifndef JSONEVT_SCAN_H
+#define JSONEVT_SCAN_H
+
+#include "jsonevt.h"
+#include "int_defs.h"
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+#define JSONEVT_SCAN_BLOCK_SIZE 64
+
+typedef struct {
+    uint64_t quote;      /* '"' */
+    uint64_t squote;     /* '\'' */
+    uint64_t backslash;  /* '\\' */
+    uint64_t structural; /* { } [ ] : , */
+    uint64_t comment;    /* '/' and '#' */
+    uint64_t space;      /* space, \t, \n, \v, \f, \r */
+    uint64_t high;       /* high bit set, i.e., part of a multi-byte sequence */
+} jsonevt_scan_masks;
+
+/* classify exactly JSONEVT_SCAN_BLOCK_SIZE bytes starting at block */
+void jsonevt_scan_block(const char * block, jsonevt_scan_masks * masks);
+
+/* classify the first len bytes (len < JSONEVT_SCAN_BLOCK_SIZE) -- the
+   rest of the block is treated as NUL bytes, which are in no class */
+void jsonevt_scan_partial_block(const char * block, uint len, jsonevt_scan_masks * masks);
+
+/* Return the number of ASCII whitespace bytes at the start of buf,
+   looking at no more than len bytes. */
+uint jsonevt_scan_space(const char * buf, uint len);
+
+/* Return the offset of the first quote_char or backslash in buf, or
+   len if there isn't one.  *have_high is set if any of the bytes
+   before it has the high bit set. */
+uint jsonevt_scan_string(const char * buf, uint len, char quote_char, int * have_high);
+
+/* flags for jsonevt_scan_escape() */
+#define JSONEVT_SCAN_ESC_SOLIDUS 1 /* '/' gets escaped */
+#define JSONEVT_SCAN_ESC_HIGH    2 /* bytes with the high bit set need a closer look */
+
+/* Return the number of bytes at the start of buf that can be copied
+   into a JSON string as they are, i.e., the offset of the first '"',
+   backslash, or control character, or len if there isn't one.  The
+   flags add '/' and bytes with the high bit set to the ones that stop
+   the scan. */
+size_t jsonevt_scan_escape(const char * buf, size_t len, uint flags);
+
+/* Write the \u escape for code_point (at least 4 lowercase hex
+   digits, like "\\u%04x") to buf, which must have room for 10 bytes.
+   Returns the number of bytes written. */
+uint jsonevt_u_escape(uint32_t code_point, char * buf);
+
+/* index of the lowest set bit -- mask must be non-zero */
+#if defined(__GNUC__)
+#define JSONEVT_CTZ64(mask) ((uint)__builtin_ctzll(mask))
+#else
+uint jsonevt_ctz64(uint64_t mask);
+#define JSONEVT_CTZ64(mask) jsonevt_ctz64(mask)
+#endif
+
+#define JSONEVT_CLEAR_LOWEST_BIT(mask) ((mask) & ((mask) - 1))
+
+/* name of the implementation compiled in: "avx2", "sse2", or "scalar" */
+const char * jsonevt_scan_impl_name(void);
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_SCAN_H */
@@ -0,0 +1,295 @@
+/* Creation date: 2026-10-17T09:40:02Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+#include "struct_index.h"
+#include "scan.h"
+#include "jsonevt_utils.h"
+
+#include <string.h>
+
+#define UNLESS(stuff) if (! stuff)
+
+#define INDEX_INITIAL_SIZE 256
+#define INDEX_INITIAL_STACK_SIZE 64
+#define INDEX_INITIAL_MARKS_SIZE 1024
+
+static uint
+add_entry(jsonevt_struct_index * idx, uint start, uint flags) {
+    jsonevt_index_entry * e;
+
+    if (idx->num_entries >= idx->size) {
+        idx->size = idx->size ? idx->size * 2 : INDEX_INITIAL_SIZE;
+        JSONEVT_RENEW(idx->entries, idx->size, jsonevt_index_entry);
+    }
+
+    e = &idx->entries[idx->num_entries];
+    e->start = start;
+    e->end = 0;
+    e->flags = flags;
+    e->count = 0;
+
+    return idx->num_entries++;
+}
+
+/* room is made for a block's worth of marks before each block */
+#define ADD_MARK(idx, pos) ((idx)->marks[(idx)->num_marks++] = (pos))
+
+/* True if no value ends just before the comma or close bracket about
+   to be marked, i.e., the token before it is a comma or the open
+   bracket of the container.  The parser skips extra commas like
+   whitespace, so [1,,,2] has 2 elements, not 4. */
+#define NO_VALUE_BEFORE(idx, buf, e) \
+    ( (idx)->marks[(idx)->num_marks - 1] == (e)->start \
+        || (buf)[(idx)->marks[(idx)->num_marks - 1]] == ',' )
+
+/*
+  Stage one.  Candidate bytes come from the block classifier; the
+  walk over them only has to track whether we are inside a string (and
+  which quote opened it) and which byte, if any, was escaped by a
+  backslash.  Outside of strings, the first byte of each run of bytes
+  that are in no class (a number, true, false, null, or bare key) is
+  a candidate as well, so every token gets a mark.  Returns 0 and
+  leaves the index invalid if the buffer can't be indexed.
+*/
+int
+jsonevt_index_build(jsonevt_struct_index * idx, const char * buf, uint len) {
+    jsonevt_scan_masks m;
+    uint64_t cand;
+    uint64_t out_cand;
+    uint64_t word;
+    uint64_t prev_word = 0;
+    uint base;
+    uint pos;
+    uint depth = 0;
+    uint cur_string = 0;
+    int in_string = 0;
+    char quote_char = '"';
+    uint escape_pos = 0;
+    int have_escape = 0;
+    jsonevt_index_entry * e;
+    char c;
+
+    idx->num_entries = 0;
+    idx->num_marks = 0;
+    idx->cursor = 0;
+    idx->mark_cursor = 0;
+    idx->valid = 0;
+
+    UNLESS (idx->stack) {
+        idx->stack_size = INDEX_INITIAL_STACK_SIZE;
+        JSONEVT_NEW(idx->stack, idx->stack_size, uint);
+    }
+
+    for (base = 0; base < len; base += JSONEVT_SCAN_BLOCK_SIZE) {
+        if (idx->num_marks + JSONEVT_SCAN_BLOCK_SIZE > idx->marks_size) {
+            idx->marks_size = idx->marks_size ? idx->marks_size * 2 : INDEX_INITIAL_MARKS_SIZE;
+            JSONEVT_RENEW(idx->marks, idx->marks_size, uint);
+        }
+
+        if (len - base >= JSONEVT_SCAN_BLOCK_SIZE) {
+            jsonevt_scan_block(buf + base, &m);
+            word = ~(m.quote | m.squote | m.backslash | m.structural | m.comment | m.space
+                | m.high);
+        }
+        else {
+            jsonevt_scan_partial_block(buf + base, len - base, &m);
+            word = ~(m.quote | m.squote | m.backslash | m.structural | m.comment | m.space
+                | m.high) & ~(~(uint64_t)0 << (len - base));
+        }
+
+        /* Bytes with the high bit set outside of strings could be
+           whitespace the parser skips (e.g., U+00A0) or a syntax
+           error, so they are a reason to give up like comments. */
+        out_cand = m.quote | m.squote | m.backslash | m.structural | m.comment | m.high
+            | (word & ~(word << 1 | prev_word >> 63));
+        prev_word = word;
+
+        if (in_string) {
+            cand = (quote_char == '"' ? m.quote : m.squote) | m.backslash;
+        }
+        else {
+            cand = out_cand;
+        }
+
+        while (cand) {
+            pos = base + JSONEVT_CTZ64(cand);
+            cand = JSONEVT_CLEAR_LOWEST_BIT(cand);
+            c = buf[pos];
+
+            if (in_string) {
+                if (have_escape && pos == escape_pos) {
+                    have_escape = 0;
+                    continue;
+                }
+
+                if (c == '\\') {
+                    escape_pos = pos + 1;
+                    have_escape = 1;
+                    idx->entries[cur_string].flags |= JSONEVT_INDEX_HAS_ESCAPE;
+                }
+                else if (c == quote_char) {
+                    idx->entries[cur_string].end = pos;
+                    in_string = 0;
+
+                    /* the rest of the block has to be looked at again
+                       with the out-of-string candidates */
+                    cand = out_cand & ~(uint64_t)0 << (pos - base) << 1;
+                }
+                continue;
+            }
+
+            switch (c) {
+              case '"':
+              case '\'':
+                  ADD_MARK(idx, pos);
+                  cur_string = add_entry(idx, pos, JSONEVT_INDEX_STRING);
+                  in_string = 1;
+                  quote_char = c;
+                  have_escape = 0;
+
+                  cand &= (c == '"' ? m.quote : m.squote) | m.backslash;
+                  break;
+
+              case '[':
+              case '{':
+                  ADD_MARK(idx, pos);
+                  if (depth >= idx->stack_size) {
+                      idx->stack_size *= 2;
+                      JSONEVT_RENEW(idx->stack, idx->stack_size, uint);
+                  }
+                  idx->stack[depth++] = add_entry(idx, pos,
+                      c == '[' ? JSONEVT_INDEX_ARRAY : JSONEVT_INDEX_HASH);
+                  break;
+
+              case ']':
+              case '}':
+                  if (depth == 0) {
+                      return 0;
+                  }
+
+                  e = &idx->entries[idx->stack[--depth]];
+                  if (! (e->flags & (c == ']' ? JSONEVT_INDEX_ARRAY : JSONEVT_INDEX_HASH))) {
+                      return 0;
+                  }
+                  e->end = pos;
+
+                  /* count is the number of values followed by a comma
+                     so far, plus the last one if there is one */
+                  UNLESS (NO_VALUE_BEFORE(idx, buf, e)) {
+                      e->count++;
+                  }
+                  ADD_MARK(idx, pos);
+                  break;
+
+              case ',':
+                  if (depth) {
+                      e = &idx->entries[idx->stack[depth - 1]];
+                      UNLESS (NO_VALUE_BEFORE(idx, buf, e)) {
+                          e->count++;
+                      }
+                  }
+                  ADD_MARK(idx, pos);
+                  break;
+
+              case ':':
+                  ADD_MARK(idx, pos);
+                  break;
+
+              case '/':
+              case '#':
+              case '\\':
+                  /* Comments can contain anything, and a backslash
+                     outside of a string is a syntax error the parser
+                     should report, so give up on the index. */
+                  return 0;
+                  break;
+
+              default:
+                  if (c & 0x80) {
+                      return 0;
+                  }
+
+                  /* start of a number or word */
+                  ADD_MARK(idx, pos);
+                  break;
+            }
+        }
+    }
+
+    if (in_string || depth) {
+        return 0;
+    }
+
+    idx->valid = 1;
+
+    return 1;
+}
+
+/* Return the entry starting at byte offset pos, if any.  Positions
+   must be looked up in increasing order.
+*/
+jsonevt_index_entry *
+jsonevt_index_find(jsonevt_struct_index * idx, uint pos) {
+    uint i = idx->cursor;
+
+    UNLESS (idx->valid) {
+        return NULL;
+    }
+
+    while (i < idx->num_entries && idx->entries[i].start < pos) {
+        i++;
+    }
+    idx->cursor = i;
+
+    if (i < idx->num_entries && idx->entries[i].start == pos) {
+        return &idx->entries[i];
+    }
+
+    return NULL;
+}
+
+void
+jsonevt_index_free(jsonevt_struct_index * idx) {
+    if (idx->entries) {
+        JSONEVT_FREE_MEM(idx->entries);
+        idx->entries = NULL;
+    }
+
+    if (idx->stack) {
+        JSONEVT_FREE_MEM(idx->stack);
+        idx->stack = NULL;
+    }
+
+    if (idx->marks) {
+        JSONEVT_FREE_MEM(idx->marks);
+        idx->marks = NULL;
+    }
+
+    idx->num_entries = 0;
+    idx->size = 0;
+    idx->stack_size = 0;
+    idx->num_marks = 0;
+    idx->marks_size = 0;
+    idx->cursor = 0;
+    idx->mark_cursor = 0;
+    idx->valid = 0;
+}
@@ -0,0 +1,81 @@
+/* Creation date: 2026-10-17T09:40:02Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Structural index built by a first pass over the whole buffer when
+  JSON_EVT_OPTION_STRUCTURAL_INDEX is set.  There is one entry per
+  string, array, and hash, in the order they start in the buffer, with
+  the position of the matching close quote or bracket.  Arrays and
+  hashes also get the number of elements or entries, so whatever is
+  built from them can be sized up front.
+
+  There is also a mark for every token: each '[', ']', '{', '}', ',',
+  and ':', and the first byte of each string, number, and word.
+  Anything between one mark and the next is either the rest of the
+  token at the first one or whitespace, so the parser can go from one
+  token to the next without looking at the bytes in between.
+
+  If the buffer has comments, non-ascii chars outside of strings, or
+  unbalanced brackets/quotes, no index is built and the parser works
+  as if the option were not set.
+*/
+
+#ifndef JSONEVT_STRUCT_INDEX_H
+#define JSONEVT_STRUCT_INDEX_H
+
+#include "jsonevt.h"
+
+JSON_DO_CPLUSPLUS_WRAP_BEGIN
+
+#define JSONEVT_INDEX_STRING     1
+#define JSONEVT_INDEX_HAS_ESCAPE (1 << 1)
+#define JSONEVT_INDEX_ARRAY      (1 << 2)
+#define JSONEVT_INDEX_HASH       (1 << 3)
+
+typedef struct {
+    uint start; /* byte offset of the opening quote, '[', or '{' */
+    uint end;   /* byte offset of the matching quote, ']', or '}' */
+    uint flags;
+    uint count; /* elements or entries, for arrays and hashes */
+} jsonevt_index_entry;
+
+typedef struct {
+    jsonevt_index_entry * entries;
+    uint num_entries;
+    uint size;
+    uint cursor;  /* lookups only move forward through the buffer */
+    uint * stack; /* containers open while building */
+    uint stack_size;
+    uint * marks; /* byte offset of each token */
+    uint num_marks;
+    uint marks_size;
+    uint mark_cursor; /* marks are looked up in order, like entries */
+    int valid;
+} jsonevt_struct_index;
+
+int jsonevt_index_build(jsonevt_struct_index * idx, const char * buf, uint len);
+jsonevt_index_entry * jsonevt_index_find(jsonevt_struct_index * idx, uint pos);
+void jsonevt_index_free(jsonevt_struct_index * idx);
+
+JSON_DO_CPLUSPLUS_WRAP_END
+
+#endif /* JSONEVT_STRUCT_INDEX_H */
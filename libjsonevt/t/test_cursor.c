@@ -0,0 +1,443 @@
+/* Creation date: 2026-10-18T13:11:52Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Tests for the cursor in cursor.c: the tokens it returns agree with
+  the callbacks from jsonevt_parse(), including on the inputs the
+  parser is lenient about, errors are reported the same way, and
+  jsonevt_cursor_skip() and jsonevt_cursor_skip_rest() land in the
+  right place.
+*/
+
+#include <jsonevt.h>
+
+#include <stdlib.h>
+
+#include "test_util.h"
+
+#define EVENTS_SIZE 4096
+
+typedef struct {
+    char buf[EVENTS_SIZE];
+    uint len;
+} events;
+
+static void
+add_event(events * ev, const char * name, const char * data, uint data_len) {
+    int n;
+
+    if (data) {
+        n = snprintf(&ev->buf[ev->len], EVENTS_SIZE - ev->len, "%s(%.*s) ", name, (int)data_len,
+            data);
+    }
+    else {
+        n = snprintf(&ev->buf[ev->len], EVENTS_SIZE - ev->len, "%s ", name);
+    }
+
+    if (n > 0 && ev->len + n < EVENTS_SIZE) {
+        ev->len += n;
+    }
+}
+
+static void
+add_number(events * ev, const char * data, uint data_len, const jsonevt_number * num) {
+    char tmp[64];
+
+    add_event(ev, "num", data, data_len);
+
+    switch (num->type) {
+      case JSON_EVT_NUMBER_INT64:
+          snprintf(tmp, sizeof(tmp), "i%lld", (long long)num->val.i);
+          break;
+
+      case JSON_EVT_NUMBER_UINT64:
+          snprintf(tmp, sizeof(tmp), "u%llu", (unsigned long long)num->val.u);
+          break;
+
+      default:
+          snprintf(tmp, sizeof(tmp), "d%.17g", num->val.d);
+          break;
+    }
+
+    add_event(ev, tmp, NULL, 0);
+}
+
+/* jsonevt_parse() callbacks, named the same as the cursor tokens */
+
+static int
+cb_string(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    add_event((events *)cb_data, flags & JSON_EVT_IS_HASH_KEY ? "key" : "str", data, data_len);
+    return 0;
+}
+
+static int
+cb_number(void * cb_data, const char * data, uint data_len, const jsonevt_number * num,
+    uint flags, uint level) {
+    add_number((events *)cb_data, data, data_len, num);
+    return 0;
+}
+
+static int
+cb_bool(void * cb_data, uint bool_val, uint flags, uint level) {
+    add_event((events *)cb_data, bool_val ? "true" : "false", NULL, 0);
+    return 0;
+}
+
+#define CB_GEN(name, event)                                     \
+    static int                                                  \
+    cb_##name(void * cb_data, uint flags, uint level) {         \
+        add_event((events *)cb_data, event, NULL, 0);           \
+        return 0;                                               \
+    }
+
+CB_GEN(null, "null")
+CB_GEN(begin_array, "[")
+CB_GEN(end_array, "]")
+CB_GEN(begin_hash, "{")
+CB_GEN(end_hash, "}")
+
+static int
+parse_events(const char * json, events * ev, char * error, uint error_size) {
+    jsonevt_ctx * ctx = jsonevt_new_ctx();
+    int rv;
+
+    ev->len = 0;
+    ev->buf[0] = '\x00';
+    error[0] = '\x00';
+
+    jsonevt_set_cb_data(ctx, ev);
+    jsonevt_set_string_cb(ctx, cb_string);
+    jsonevt_set_typed_number_cb(ctx, cb_number);
+    jsonevt_set_bool_cb(ctx, cb_bool);
+    jsonevt_set_null_cb(ctx, cb_null);
+    jsonevt_set_begin_array_cb(ctx, cb_begin_array);
+    jsonevt_set_end_array_cb(ctx, cb_end_array);
+    jsonevt_set_begin_hash_cb(ctx, cb_begin_hash);
+    jsonevt_set_end_hash_cb(ctx, cb_end_hash);
+
+    rv = jsonevt_parse(ctx, json, (uint)strlen(json));
+    if (! rv) {
+        snprintf(error, error_size, "%s", jsonevt_get_error(ctx));
+    }
+
+    jsonevt_free_ctx(ctx);
+
+    return rv;
+}
+
+/* the same events from the cursor */
+static int
+cursor_events(const char * json, events * ev, char * error, uint error_size) {
+    jsonevt_cursor * cur = jsonevt_cursor_new(json, (uint)strlen(json));
+    const char * s;
+    uint len;
+    uint tok;
+    jsonevt_number num;
+    int rv = 1;
+
+    ev->len = 0;
+    ev->buf[0] = '\x00';
+    error[0] = '\x00';
+
+    while ((tok = jsonevt_cursor_next(cur)) != JSON_EVT_CURSOR_END) {
+        switch (tok) {
+          case JSON_EVT_CURSOR_ERROR:
+              snprintf(error, error_size, "%s", jsonevt_cursor_get_error(cur));
+              rv = 0;
+              break;
+
+          case JSON_EVT_CURSOR_BEGIN_ARRAY:
+              add_event(ev, "[", NULL, 0);
+              break;
+
+          case JSON_EVT_CURSOR_END_ARRAY:
+              add_event(ev, "]", NULL, 0);
+              break;
+
+          case JSON_EVT_CURSOR_BEGIN_HASH:
+              add_event(ev, "{", NULL, 0);
+              break;
+
+          case JSON_EVT_CURSOR_END_HASH:
+              add_event(ev, "}", NULL, 0);
+              break;
+
+          case JSON_EVT_CURSOR_KEY:
+          case JSON_EVT_CURSOR_STRING:
+              s = jsonevt_cursor_get_string(cur, &len);
+              add_event(ev, tok == JSON_EVT_CURSOR_KEY ? "key" : "str", s, len);
+              break;
+
+          case JSON_EVT_CURSOR_NUMBER:
+              s = jsonevt_cursor_get_number_str(cur, &len);
+              jsonevt_cursor_get_number(cur, &num);
+              add_number(ev, s, len, &num);
+              break;
+
+          case JSON_EVT_CURSOR_BOOL:
+              add_event(ev, jsonevt_cursor_get_bool(cur) ? "true" : "false", NULL, 0);
+              break;
+
+          case JSON_EVT_CURSOR_NULL:
+              add_event(ev, "null", NULL, 0);
+              break;
+        }
+
+        if (! rv) {
+            break;
+        }
+    }
+
+    jsonevt_cursor_free(cur);
+
+    return rv;
+}
+
+/* inputs both take, with the same tokens */
+static const char * good_inputs[] = {
+    "[]",
+    "{}",
+    "  [ 1 , [ 2 , [ ] ] , { } ]  ",
+    "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\"}}",
+    "\"top\"",
+    "-5",
+    "[0,-0,1.5,-1.5e-7,1E+3,18446744073709551615,18446744073709551616,-9223372036854775808]",
+    "[\"a\\nb\\tc\\\"d\\\\e\\/f\\bg\\fh\\r\",\"\\u00e9\\x41\",\"\\ud834\\udd1e\"]",
+    "{\"esc\\u00e9\":1,'single':2,bare_key:3}",
+    "[1, /* c ] */ 2, // ]\n 3, # ]\n 4]",
+    "\xef\xbb\xbf[1]",
+    /* the parser is lenient about these, and the cursor must be too */
+    "{\"a\":1,}",
+    "[1,,2]",
+    "{,\"a\":1}",
+    "{\"a\":1,,\"b\":2}",
+    NULL
+};
+
+/* inputs both reject, with the same error */
+static const char * bad_inputs[] = {
+    "",
+    "[1,]",
+    "[1,2,]",
+    "[,1]",
+    "[[1,],2]",
+    "[1 2]",
+    "{\"a\" 1}",
+    "{\"a\":1 \"b\":2}",
+    "[] []",
+    "[1,/* c */]",
+    NULL
+};
+
+/* inputs jsonevt_parse() takes, as it stops early without noticing
+   what follows, but the cursor doesn't */
+static const char * parser_only_inputs[] = {
+    "nul",
+    "[1] x",
+    NULL
+};
+
+static void
+test_agreement(void) {
+    const char ** json;
+    events parser_ev;
+    events cursor_ev;
+    char parser_error[256];
+    char cursor_error[256];
+    char name[128];
+    int parser_rv;
+    int cursor_rv;
+
+    for (json = good_inputs; *json; json++) {
+        parser_rv = parse_events(*json, &parser_ev, parser_error, sizeof(parser_error));
+        cursor_rv = cursor_events(*json, &cursor_ev, cursor_error, sizeof(cursor_error));
+
+        snprintf(name, sizeof(name), "both take: %s", *json);
+        if (! OK(parser_rv && cursor_rv, name)) {
+            printf("#   parser: %s\n#   cursor: %s\n", parser_error, cursor_error);
+        }
+
+        snprintf(name, sizeof(name), "same tokens: %s", *json);
+        IS_STR(cursor_ev.buf, parser_ev.buf, name);
+    }
+
+    for (json = bad_inputs; *json; json++) {
+        parser_rv = parse_events(*json, &parser_ev, parser_error, sizeof(parser_error));
+        cursor_rv = cursor_events(*json, &cursor_ev, cursor_error, sizeof(cursor_error));
+
+        snprintf(name, sizeof(name), "both fail: '%s'", *json);
+        OK(! parser_rv && ! cursor_rv, name);
+
+        snprintf(name, sizeof(name), "same error: '%s'", *json);
+        IS_STR(cursor_error, parser_error, name);
+
+        snprintf(name, sizeof(name), "same tokens before the error: '%s'", *json);
+        IS_STR(cursor_ev.buf, parser_ev.buf, name);
+    }
+
+    for (json = parser_only_inputs; *json; json++) {
+        parser_rv = parse_events(*json, &parser_ev, parser_error, sizeof(parser_error));
+        cursor_rv = cursor_events(*json, &cursor_ev, cursor_error, sizeof(cursor_error));
+
+        snprintf(name, sizeof(name), "only the parser takes: %s", *json);
+        OK(parser_rv && ! cursor_rv, name);
+    }
+
+    /* both reject whitespace alone, though the parser gives the position
+       of the last space rather than the end */
+    parser_rv = parse_events("   ", &parser_ev, parser_error, sizeof(parser_error));
+    cursor_rv = cursor_events("   ", &cursor_ev, cursor_error, sizeof(cursor_error));
+    OK(! parser_rv && ! cursor_rv && strstr(cursor_error, "- syntax error"),
+        "both fail: whitespace only");
+}
+
+static void
+test_skip(void) {
+    static const char json[] = "{\"a\":[1,{\"b\":\"]\"}],\"b\":{\"c\":\"}\\\"\",\"d\":[/* } */]},"
+        "\"c\":3,\"d\":\"str\"}";
+    jsonevt_cursor * cur = jsonevt_cursor_new(json, (uint)strlen(json));
+    jsonevt_number num;
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_BEGIN_HASH, "skip - begin hash");
+
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_KEY, "skip - at a key returns the key");
+    OK(jsonevt_cursor_key_is(cur, "a", 1), "skip - key a");
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_BEGIN_ARRAY, "skip - array value");
+    IS_UINT(jsonevt_cursor_depth(cur), 1, "skip - the array was stepped over");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_KEY, "skip - key after the array");
+    OK(jsonevt_cursor_key_is(cur, "b", 1), "skip - key b");
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_BEGIN_HASH,
+        "skip - hash with brackets in strings and comments");
+    IS_UINT(jsonevt_cursor_depth(cur), 1, "skip - the hash was stepped over");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_KEY, "skip - key c");
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_NUMBER, "skip - a scalar is just returned");
+    OK(jsonevt_cursor_get_number(cur, &num) && num.type == JSON_EVT_NUMBER_UINT64
+        && num.val.u == 3, "skip - the scalar can be read");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_KEY, "skip - key d");
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_STRING, "skip - string d");
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_END_HASH, "skip - at the end of a hash");
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_END, "skip - at the end");
+
+    /* skipping the top-level value */
+    jsonevt_cursor_reset(cur, json, (uint)strlen(json));
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_BEGIN_HASH, "skip - top-level hash");
+    IS_UINT(jsonevt_cursor_depth(cur), 0, "skip - depth after the top-level hash");
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_END, "skip - nothing after it");
+
+    jsonevt_cursor_free(cur);
+}
+
+static void
+test_skip_rest(void) {
+    static const char json[] = "[1,[2,\"]\",[3]],{\"k\":[4]},5] ";
+    jsonevt_cursor * cur = jsonevt_cursor_new(json, (uint)strlen(json));
+    const char * s;
+    uint len;
+
+    jsonevt_cursor_next(cur);
+    jsonevt_cursor_next(cur);
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_BEGIN_ARRAY, "skip_rest - inner array");
+    jsonevt_cursor_next(cur);
+    IS_UINT(jsonevt_cursor_skip_rest(cur), JSON_EVT_CURSOR_END_ARRAY,
+        "skip_rest - end of the inner array");
+    IS_UINT(jsonevt_cursor_depth(cur), 1, "skip_rest - back in the outer array");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_BEGIN_HASH, "skip_rest - hash");
+    IS_UINT(jsonevt_cursor_skip_rest(cur), JSON_EVT_CURSOR_END_HASH,
+        "skip_rest - whole hash before reading anything");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_NUMBER, "skip_rest - element after the hash");
+    s = jsonevt_cursor_get_number_str(cur, &len);
+    OK(s && len == 1 && *s == '5', "skip_rest - the right element");
+
+    IS_UINT(jsonevt_cursor_skip_rest(cur), JSON_EVT_CURSOR_END_ARRAY, "skip_rest - outer array");
+    IS_UINT(jsonevt_cursor_depth(cur), 0, "skip_rest - depth 0");
+    IS_UINT(jsonevt_cursor_skip_rest(cur), JSON_EVT_CURSOR_END, "skip_rest - at the top level");
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_END, "skip_rest - still at the end");
+
+    /* skipped data isn't checked, but a container that doesn't end is an error */
+    jsonevt_cursor_reset(cur, "[1,[2,3", 7);
+    jsonevt_cursor_next(cur);
+    jsonevt_cursor_next(cur);
+    IS_UINT(jsonevt_cursor_skip_rest(cur), JSON_EVT_CURSOR_ERROR, "skip_rest - unterminated");
+    OK(jsonevt_cursor_get_error(cur) != NULL
+        && strstr(jsonevt_cursor_get_error(cur), "array not terminated"),
+        "skip_rest - unterminated error");
+
+    jsonevt_cursor_reset(cur, "{\"a\":\"}", 7);
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_ERROR, "skip - unterminated string");
+
+    jsonevt_cursor_free(cur);
+}
+
+static void
+test_errors(void) {
+    jsonevt_cursor * cur = jsonevt_cursor_new("[1,\"\\u12g4\",x]", 14);
+    const char * error;
+
+    OK(jsonevt_cursor_get_error(cur) == NULL, "errors - none to start with");
+
+    jsonevt_cursor_next(cur);
+    jsonevt_cursor_next(cur);
+    IS_STR(jsonevt_cursor_get_string(cur, NULL), NULL, "errors - get_string on a number");
+    OK(! jsonevt_cursor_key_is(cur, "1", 1), "errors - key_is on a number");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_STRING, "errors - bad escape is a string token");
+    IS_STR(jsonevt_cursor_get_string(cur, NULL), NULL, "errors - bad \\u escape");
+    error = jsonevt_cursor_get_error(cur);
+    OK(error && strstr(error, "bad unicode character specification") && strstr(error, "byte 6"),
+        "errors - bad escape message and position");
+
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_ERROR, "errors - error state after a bad escape");
+
+    jsonevt_cursor_reset(cur, "[1,x]", 5);
+    OK(jsonevt_cursor_get_error(cur) == NULL, "errors - reset clears the error");
+    jsonevt_cursor_next(cur);
+    jsonevt_cursor_next(cur);
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_ERROR, "errors - bad word");
+    error = jsonevt_cursor_get_error(cur);
+    OK(error && strstr(error, "byte 3"), "errors - position of the bad word");
+    IS_UINT(jsonevt_cursor_next(cur), JSON_EVT_CURSOR_ERROR, "errors - next stays in error");
+    IS_UINT(jsonevt_cursor_skip(cur), JSON_EVT_CURSOR_ERROR, "errors - skip stays in error");
+    IS_UINT(jsonevt_cursor_skip_rest(cur), JSON_EVT_CURSOR_ERROR, "errors - skip_rest stays in error");
+
+    jsonevt_cursor_reset(cur, "[1,\n  2,\n  y]", 13);
+    while (jsonevt_cursor_next(cur) > JSON_EVT_CURSOR_ERROR) {
+    }
+    error = jsonevt_cursor_get_error(cur);
+    OK(error && strstr(error, "line 3"), "errors - line number");
+
+    jsonevt_cursor_free(cur);
+}
+
+int
+main() {
+    test_agreement();
+    test_skip();
+    test_skip_rest();
+    test_errors();
+
+    return tests_done();
+}
@@ -0,0 +1,275 @@
+/* Creation date: 2026-10-18T12:02:16Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Tests for jsonevt_doc_parse() and the accessors in doc.c.
+*/
+
+#include <jsonevt.h>
+
+#include <stdlib.h>
+
+#include "test_util.h"
+
+static jsonevt_doc *
+parse_doc(jsonevt_ctx * ctx, const char * json) {
+    return jsonevt_doc_parse(ctx, json, (uint)strlen(json));
+}
+
+static void
+test_types(jsonevt_ctx * ctx) {
+    static const char * json = "[null,true,false,-3,18446744073709551615,1.5,\"s\",[],{}]";
+    static const uint expected[] = { JSON_EVT_DOC_NULL, JSON_EVT_DOC_BOOL, JSON_EVT_DOC_BOOL,
+                                     JSON_EVT_DOC_INT64, JSON_EVT_DOC_UINT64, JSON_EVT_DOC_DOUBLE,
+                                     JSON_EVT_DOC_STRING, JSON_EVT_DOC_ARRAY, JSON_EVT_DOC_HASH };
+    jsonevt_doc * doc = parse_doc(ctx, json);
+    uint root;
+    uint node;
+    uint i;
+    char name[64];
+
+    if (! OK(doc != NULL, "types - parse")) {
+        return;
+    }
+
+    root = jsonevt_doc_root(doc);
+    IS_UINT(jsonevt_doc_type(doc, root), JSON_EVT_DOC_ARRAY, "types - root is an array");
+    IS_UINT(jsonevt_doc_get_size(doc, root), 9, "types - size");
+
+    /* walking the children and indexing should agree */
+    for (i = 0, node = jsonevt_doc_first_child(doc, root); i < 9;
+         i++, node = jsonevt_doc_next_sibling(doc, node)) {
+        snprintf(name, sizeof(name), "types - element %u", i);
+        IS_UINT(jsonevt_doc_type(doc, node), expected[i], name);
+
+        snprintf(name, sizeof(name), "types - array_get %u", i);
+        IS_UINT(jsonevt_doc_array_get(doc, root, i), node, name);
+    }
+    IS_UINT(node, 0, "types - no sibling after the last element");
+    IS_UINT(jsonevt_doc_array_get(doc, root, 9), 0, "types - array_get past the end");
+
+    OK(! jsonevt_doc_get_bool(doc, jsonevt_doc_array_get(doc, root, 0)), "types - null isn't true");
+    OK(jsonevt_doc_get_bool(doc, jsonevt_doc_array_get(doc, root, 1)), "types - true");
+    OK(! jsonevt_doc_get_bool(doc, jsonevt_doc_array_get(doc, root, 2)), "types - false");
+    IS_UINT(jsonevt_doc_first_child(doc, jsonevt_doc_array_get(doc, root, 7)), 0,
+        "types - empty array has no children");
+    IS_UINT(jsonevt_doc_get_size(doc, jsonevt_doc_array_get(doc, root, 8)), 0,
+        "types - empty hash");
+
+    /* node 0 and nodes past the end are not nodes */
+    IS_UINT(jsonevt_doc_type(doc, 0), JSON_EVT_DOC_NONE, "types - node 0");
+    IS_UINT(jsonevt_doc_type(doc, 100000), JSON_EVT_DOC_NONE, "types - node past the tape");
+    IS_UINT(jsonevt_doc_next_sibling(doc, 0), 0, "types - no sibling for node 0");
+
+    jsonevt_doc_free(doc);
+}
+
+static void
+test_numbers(jsonevt_ctx * ctx) {
+    jsonevt_doc * doc = parse_doc(ctx, "[-9223372036854775808,18446744073709551615,4.0,0.5,\"1\"]");
+    uint root;
+    int64_t i;
+    uint64_t u;
+    double d;
+
+    if (! OK(doc != NULL, "numbers - parse")) {
+        return;
+    }
+
+    root = jsonevt_doc_root(doc);
+
+    OK(jsonevt_doc_get_int64(doc, jsonevt_doc_array_get(doc, root, 0), &i)
+        && i == INT64_MIN, "numbers - int64 min");
+    OK(! jsonevt_doc_get_uint64(doc, jsonevt_doc_array_get(doc, root, 0), &u),
+        "numbers - negative doesn't fit in uint64");
+
+    OK(jsonevt_doc_get_uint64(doc, jsonevt_doc_array_get(doc, root, 1), &u)
+        && u == UINT64_MAX, "numbers - uint64 max");
+    OK(! jsonevt_doc_get_int64(doc, jsonevt_doc_array_get(doc, root, 1), &i),
+        "numbers - uint64 max doesn't fit in int64");
+
+    OK(jsonevt_doc_get_int64(doc, jsonevt_doc_array_get(doc, root, 2), &i) && i == 4,
+        "numbers - whole double as int64");
+    OK(! jsonevt_doc_get_int64(doc, jsonevt_doc_array_get(doc, root, 3), &i),
+        "numbers - fraction isn't an int64");
+    OK(jsonevt_doc_get_double(doc, jsonevt_doc_array_get(doc, root, 3), &d) && d == 0.5,
+        "numbers - double");
+    OK(jsonevt_doc_get_double(doc, jsonevt_doc_array_get(doc, root, 0), &d)
+        && d == -9223372036854775808.0, "numbers - int64 as double");
+
+    OK(! jsonevt_doc_get_double(doc, jsonevt_doc_array_get(doc, root, 4), &d),
+        "numbers - string isn't a number");
+    IS_STR(jsonevt_doc_get_string(doc, jsonevt_doc_array_get(doc, root, 0), NULL), NULL,
+        "numbers - number isn't a string");
+
+    jsonevt_doc_free(doc);
+}
+
+static void
+test_hash(jsonevt_ctx * ctx) {
+    static const char json[] = "{\"a\":1,\"nested\":{\"b\":[1,{\"c\":\"deep\"}]},\"a\\u0000b\":\"nul\","
+        "\"\":\"empty\",\"last\":null}";
+    jsonevt_doc * doc = parse_doc(ctx, json);
+    uint root;
+    uint node;
+    uint len;
+    const char * s;
+    int64_t i;
+
+    if (! OK(doc != NULL, "hash - parse")) {
+        return;
+    }
+
+    root = jsonevt_doc_root(doc);
+    IS_UINT(jsonevt_doc_type(doc, root), JSON_EVT_DOC_HASH, "hash - root is a hash");
+    IS_UINT(jsonevt_doc_get_size(doc, root), 5, "hash - size counts entries");
+
+    OK(jsonevt_doc_get_int64(doc, jsonevt_doc_hash_get(doc, root, "a", 1), &i) && i == 1,
+        "hash - get a");
+
+    node = jsonevt_doc_hash_get(doc, root, "nested", 6);
+    node = jsonevt_doc_hash_get(doc, node, "b", 1);
+    node = jsonevt_doc_array_get(doc, node, 1);
+    node = jsonevt_doc_hash_get(doc, node, "c", 1);
+    IS_STR(jsonevt_doc_get_string(doc, node, NULL), "deep", "hash - nested get");
+
+    s = jsonevt_doc_get_string(doc, jsonevt_doc_hash_get(doc, root, "a\0b", 3), &len);
+    IS_STR(s, "nul", "hash - key with a NUL");
+
+    s = jsonevt_doc_get_string(doc, jsonevt_doc_hash_get(doc, root, "", 0), &len);
+    IS_STR(s, "empty", "hash - empty key");
+
+    IS_UINT(jsonevt_doc_type(doc, jsonevt_doc_hash_get(doc, root, "last", 4)), JSON_EVT_DOC_NULL,
+        "hash - last entry");
+
+    /* values are not keys, and prefixes don't match */
+    IS_UINT(jsonevt_doc_hash_get(doc, root, "nul", 3), 0, "hash - a value isn't a key");
+    IS_UINT(jsonevt_doc_hash_get(doc, root, "las", 3), 0, "hash - prefix of a key");
+    IS_UINT(jsonevt_doc_hash_get(doc, root, "missing", 7), 0, "hash - missing key");
+
+    /* the children are keys and values in turn */
+    node = jsonevt_doc_first_child(doc, root);
+    s = jsonevt_doc_get_string(doc, node, &len);
+    IS_STR(s, "a", "hash - first child is a key");
+    node = jsonevt_doc_next_sibling(doc, node);
+    OK(jsonevt_doc_get_int64(doc, node, &i) && i == 1, "hash - its sibling is the value");
+
+    /* the wrong kind of container */
+    IS_UINT(jsonevt_doc_array_get(doc, root, 0), 0, "hash - array_get on a hash");
+    IS_UINT(jsonevt_doc_hash_get(doc, jsonevt_doc_hash_get(doc, root, "a", 1), "a", 1), 0,
+        "hash - hash_get on a number");
+
+    jsonevt_doc_free(doc);
+}
+
+static void
+test_strings(jsonevt_ctx * ctx) {
+    jsonevt_doc * doc = parse_doc(ctx, "\"caf\\u00e9 \\ud834\\udd1e \\\"q\\\"\"");
+    uint len = 0;
+
+    if (! OK(doc != NULL, "strings - parse")) {
+        return;
+    }
+
+    IS_STR(jsonevt_doc_get_string(doc, jsonevt_doc_root(doc), &len),
+        "caf\xc3\xa9 \xf0\x9d\x84\x9e \"q\"", "strings - top-level string with escapes");
+    IS_UINT(len, 14, "strings - length");
+    IS_UINT(jsonevt_doc_first_child(doc, jsonevt_doc_root(doc)), 0,
+        "strings - a string has no children");
+
+    jsonevt_doc_free(doc);
+}
+
+static void
+test_big_array(jsonevt_ctx * ctx) {
+    uint num = 5000;
+    char * json = (char *)malloc(num * 2 + 2);
+    jsonevt_doc * doc;
+    int64_t val;
+    uint i;
+
+    json[0] = '[';
+    for (i = 0; i < num; i++) {
+        json[i * 2 + 1] = (char)('0' + i % 10);
+        json[i * 2 + 2] = ',';
+    }
+    json[num * 2] = ']';
+    json[num * 2 + 1] = '\x00';
+
+    doc = parse_doc(ctx, json);
+    free(json);
+
+    if (! OK(doc != NULL, "big array - parse")) {
+        return;
+    }
+
+    IS_UINT(jsonevt_doc_get_size(doc, jsonevt_doc_root(doc)), num, "big array - size");
+    OK(jsonevt_doc_get_int64(doc, jsonevt_doc_array_get(doc, jsonevt_doc_root(doc), num - 1), &val)
+        && val == (num - 1) % 10, "big array - last element");
+    IS_UINT(jsonevt_doc_array_get(doc, jsonevt_doc_root(doc), num), 0, "big array - past the end");
+
+    jsonevt_doc_free(doc);
+}
+
+static void
+test_errors(jsonevt_ctx * ctx) {
+    static const char * bad[] = { "", "[1,2", "{\"a\":}", "[\"x\" 1]", "{\"a\":1", NULL };
+    const char ** json;
+    jsonevt_doc * doc;
+    char name[64];
+    int64_t val;
+
+    for (json = bad; *json; json++) {
+        snprintf(name, sizeof(name), "errors - %s", *json);
+        doc = parse_doc(ctx, *json);
+        OK(doc == NULL && jsonevt_get_error(ctx) != NULL, name);
+        jsonevt_doc_free(doc);
+        jsonevt_reset_ctx(ctx);
+    }
+
+    /* the ctx is still good after an error */
+    doc = parse_doc(ctx, "[7]");
+    OK(doc && jsonevt_doc_get_int64(doc, jsonevt_doc_array_get(doc, jsonevt_doc_root(doc), 0), &val)
+        && val == 7, "errors - parse after an error");
+    jsonevt_doc_free(doc);
+}
+
+int
+main() {
+    jsonevt_ctx * ctx = jsonevt_new_ctx();
+
+    test_types(ctx);
+    jsonevt_reset_ctx(ctx);
+    test_numbers(ctx);
+    jsonevt_reset_ctx(ctx);
+    test_hash(ctx);
+    jsonevt_reset_ctx(ctx);
+    test_strings(ctx);
+    jsonevt_reset_ctx(ctx);
+    test_big_array(ctx);
+    jsonevt_reset_ctx(ctx);
+    test_errors(ctx);
+
+    jsonevt_free_ctx(ctx);
+
+    return tests_done();
+}
@@ -0,0 +1,616 @@
+/* Creation date: 2026-10-18T14:03:27Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Tests for jsonevt_ndjson_parse() and jsonevt_ndjson_parse_file(),
+  with input big enough to be split into several batches, on 1 to 8
+  threads, delivered in order and as parsed.  Every record must be
+  delivered exactly once, with the right line number, document, and
+  error, and the counts must add up.
+
+  The same for jsonevt_ndjson_parse_array(), where a merged document
+  must be the same, word for word, as jsonevt_doc_parse() gives for
+  the whole array.
+*/
+
+#include <jsonevt.h>
+#include <doc.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "test_util.h"
+
+/* enough lines for several batches */
+#define NUM_LINES 120000
+
+#define LINE_GOOD  0
+#define LINE_BAD   1
+#define LINE_BLANK 2
+
+typedef struct {
+    unsigned char * kinds;     /* LINE_* for each line, by line number */
+    uint64_t num_lines;
+
+    unsigned char * seen;      /* times each line was delivered */
+    uint64_t last_line;
+    int out_of_order;
+    int wrong_doc;
+    int wrong_error;
+
+    uint num_ctxs;
+    uint64_t stop_at;          /* ask to stop after this line, if set */
+} results;
+
+static char *
+make_input(results * r, size_t * len) {
+    size_t size = (size_t)NUM_LINES * 64;
+    char * buf = (char *)malloc(size);
+    size_t pos = 0;
+    uint64_t line;
+
+    r->num_lines = NUM_LINES;
+    r->kinds = (unsigned char *)calloc(NUM_LINES + 1, 1);
+
+    for (line = 1; line <= NUM_LINES; line++) {
+        if (line % 1000 == 0) {
+            r->kinds[line] = LINE_BLANK;
+            pos += snprintf(buf + pos, size - pos, line % 2000 ? "\n" : "   \t\n");
+        }
+        else if (line % 997 == 0) {
+            r->kinds[line] = LINE_BAD;
+            pos += snprintf(buf + pos, size - pos, "{\"line\":%llu,\"bad\":\n",
+                (unsigned long long)line);
+        }
+        else {
+            r->kinds[line] = LINE_GOOD;
+            pos += snprintf(buf + pos, size - pos, "{\"line\":%llu,\"s\":\"some padding\",\"a\":[1,2]}\n",
+                (unsigned long long)line);
+        }
+    }
+
+    /* no newline after the last line */
+    pos--;
+
+    *len = pos;
+    return buf;
+}
+
+static void
+count_kinds(results * r, uint64_t * good, uint64_t * bad) {
+    uint64_t line;
+
+    *good = 0;
+    *bad = 0;
+    for (line = 1; line <= r->num_lines; line++) {
+        if (r->kinds[line] == LINE_GOOD) {
+            (*good)++;
+        }
+        else if (r->kinds[line] == LINE_BAD) {
+            (*bad)++;
+        }
+    }
+}
+
+/* the same cut as make_batches() in ndjson.c */
+static uint
+count_batches(const char * buf, size_t len) {
+    size_t start = 0;
+    size_t end;
+    const char * nl;
+    uint count = 0;
+
+    while (start < len) {
+        end = start + 1024 * 1024;
+        if (end >= len) {
+            end = len;
+        }
+        else {
+            nl = (const char *)memchr(buf + end - 1, '\n', len - end + 1);
+            end = nl ? (size_t)(nl - buf) + 1 : len;
+        }
+
+        count++;
+        start = end;
+    }
+
+    return count;
+}
+
+static void
+ctx_cb(void * cb_data, jsonevt_ctx * ctx, uint worker) {
+    ((results *)cb_data)->num_ctxs++;
+}
+
+/* never called from two threads at once */
+static int
+record_cb(void * cb_data, uint64_t line_num, jsonevt_doc * doc, const char * error) {
+    results * r = (results *)cb_data;
+    int64_t val;
+
+    if (line_num < 1 || line_num > r->num_lines) {
+        r->wrong_doc++;
+        jsonevt_doc_free(doc);
+        return 0;
+    }
+
+    r->seen[line_num]++;
+
+    if (line_num <= r->last_line) {
+        r->out_of_order++;
+    }
+    r->last_line = line_num;
+
+    if (r->kinds[line_num] == LINE_GOOD) {
+        if (error || ! doc
+            || ! jsonevt_doc_get_int64(doc, jsonevt_doc_hash_get(doc, jsonevt_doc_root(doc), "line", 4),
+                &val)
+            || (uint64_t)val != line_num) {
+            r->wrong_doc++;
+        }
+    }
+    else if (! error || doc) {
+        r->wrong_error++;
+    }
+
+    jsonevt_doc_free(doc);
+
+    return r->stop_at && line_num >= r->stop_at;
+}
+
+static void
+reset_results(results * r) {
+    memset(r->seen, 0, r->num_lines + 1);
+    r->last_line = 0;
+    r->out_of_order = 0;
+    r->wrong_doc = 0;
+    r->wrong_error = 0;
+    r->num_ctxs = 0;
+    r->stop_at = 0;
+}
+
+/* every non-blank line delivered exactly once */
+static int
+all_seen_once(results * r) {
+    uint64_t line;
+
+    for (line = 1; line <= r->num_lines; line++) {
+        if (r->seen[line] != (r->kinds[line] == LINE_BLANK ? 0 : 1)) {
+            printf("# line %llu delivered %u times\n", (unsigned long long)line, r->seen[line]);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void
+test_threads(results * r, const char * buf, size_t len) {
+    static const uint thread_counts[] = { 1, 2, 4, 8 };
+    jsonevt_ndjson * nd = jsonevt_ndjson_new();
+    uint64_t good;
+    uint64_t bad;
+    uint num_batches = count_batches(buf, len);
+    uint expected_ctxs;
+    uint i;
+    int ordered;
+    char name[128];
+
+    count_kinds(r, &good, &bad);
+    OK(num_batches > 4, "input is split into more batches than 4 threads");
+
+    jsonevt_ndjson_set_make_docs(nd, 1);
+    jsonevt_ndjson_set_cb_data(nd, r);
+    jsonevt_ndjson_set_ctx_cb(nd, ctx_cb);
+    jsonevt_ndjson_set_record_cb(nd, record_cb);
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        for (ordered = 0; ordered <= 1; ordered++) {
+            reset_results(r);
+            jsonevt_ndjson_set_threads(nd, thread_counts[i]);
+            jsonevt_ndjson_set_ordered(nd, ordered);
+
+#define NAME(what) (snprintf(name, sizeof(name), "%u threads, %s - %s", thread_counts[i], \
+                        ordered ? "ordered" : "unordered", what), name)
+
+            OK(jsonevt_ndjson_parse(nd, buf, len), NAME("parse"));
+            OK(jsonevt_ndjson_get_error(nd) == NULL, NAME("no error"));
+            IS_UINT(jsonevt_ndjson_get_record_count(nd), good + bad, NAME("record count"));
+            IS_UINT(jsonevt_ndjson_get_bad_record_count(nd), bad, NAME("bad record count"));
+            OK(all_seen_once(r), NAME("every record delivered once"));
+            IS_UINT(r->wrong_doc, 0, NAME("docs match their lines"));
+            IS_UINT(r->wrong_error, 0, NAME("errors for the bad lines"));
+
+            /* one ctx per worker, and no more workers than batches */
+            expected_ctxs = thread_counts[i] < num_batches ? thread_counts[i] : num_batches;
+            IS_UINT(r->num_ctxs, expected_ctxs, NAME("number of workers"));
+
+            if (ordered) {
+                IS_UINT(r->out_of_order, 0, NAME("in line order"));
+            }
+
+#undef NAME
+        }
+    }
+
+    jsonevt_ndjson_free(nd);
+}
+
+static void
+test_stop(results * r, const char * buf, size_t len) {
+    jsonevt_ndjson * nd = jsonevt_ndjson_new();
+    const char * error;
+    uint64_t line;
+    int after = 0;
+
+    jsonevt_ndjson_set_cb_data(nd, r);
+    jsonevt_ndjson_set_record_cb(nd, record_cb);
+    jsonevt_ndjson_set_threads(nd, 4);
+    jsonevt_ndjson_set_ordered(nd, 1);
+
+    reset_results(r);
+    r->stop_at = 49999;
+
+    OK(! jsonevt_ndjson_parse(nd, buf, len), "stop - parse returns 0");
+    error = jsonevt_ndjson_get_error(nd);
+    OK(error && strstr(error, "early termination from record callback"), "stop - error");
+
+    for (line = r->stop_at + 1; line <= r->num_lines; line++) {
+        after += r->seen[line];
+    }
+    IS_UINT(after, 0, "stop - nothing delivered after the stop, in order");
+    IS_UINT(r->seen[r->stop_at], 1, "stop - the line that asked to stop");
+
+    /* the same object is fine for another parse */
+    reset_results(r);
+    OK(jsonevt_ndjson_parse(nd, buf, len) && jsonevt_ndjson_get_error(nd) == NULL,
+        "stop - parse again after a stop");
+    OK(all_seen_once(r), "stop - every record the second time");
+
+    jsonevt_ndjson_free(nd);
+}
+
+static void
+test_file(results * r, const char * buf, size_t len) {
+    jsonevt_ndjson * nd = jsonevt_ndjson_new();
+    char file[] = "/tmp/jsonevt_test_ndjson.XXXXXX";
+    uint64_t good;
+    uint64_t bad;
+    int fd;
+
+    count_kinds(r, &good, &bad);
+
+    jsonevt_ndjson_set_cb_data(nd, r);
+    jsonevt_ndjson_set_record_cb(nd, record_cb);
+    jsonevt_ndjson_set_make_docs(nd, 1);
+    jsonevt_ndjson_set_threads(nd, 3);
+    jsonevt_ndjson_set_ordered(nd, 1);
+
+    fd = mkstemp(file);
+    if (! OK(fd >= 0 && write(fd, buf, len) == (ssize_t)len, "file - write")) {
+        jsonevt_ndjson_free(nd);
+        return;
+    }
+    close(fd);
+
+    reset_results(r);
+    OK(jsonevt_ndjson_parse_file(nd, file), "file - parse");
+    IS_UINT(jsonevt_ndjson_get_bad_record_count(nd), bad, "file - bad record count");
+    OK(all_seen_once(r) && ! r->wrong_doc && ! r->wrong_error && ! r->out_of_order,
+        "file - same records as from memory");
+
+    unlink(file);
+
+    OK(! jsonevt_ndjson_parse_file(nd, file) && jsonevt_ndjson_get_error(nd) != NULL,
+        "file - missing file");
+
+    jsonevt_ndjson_free(nd);
+}
+
+static void
+test_small(results * r) {
+    jsonevt_ndjson * nd = jsonevt_ndjson_new();
+
+    jsonevt_ndjson_set_cb_data(nd, r);
+    jsonevt_ndjson_set_ctx_cb(nd, ctx_cb);
+    jsonevt_ndjson_set_threads(nd, 8);
+
+    reset_results(r);
+    OK(jsonevt_ndjson_parse(nd, "", 0), "small - empty input");
+    IS_UINT(jsonevt_ndjson_get_record_count(nd), 0, "small - no records");
+
+    /* no record callback -- just the counts */
+    reset_results(r);
+    OK(jsonevt_ndjson_parse(nd, "[1]\n\nx\n{}\n", 10), "small - without a record callback");
+    IS_UINT(jsonevt_ndjson_get_record_count(nd), 3, "small - record count");
+    IS_UINT(jsonevt_ndjson_get_bad_record_count(nd), 1, "small - bad record count");
+    IS_UINT(r->num_ctxs, 1, "small - one batch, one worker");
+
+    jsonevt_ndjson_free(nd);
+}
+
+/* Top-level arrays */
+
+#define NUM_ELEMENTS 150000
+
+/* one of each kind of value, with brackets, commas, and quotes in
+   strings and comments that the batching has to step over */
+static const char * element_forms[] = {
+    "{\"i\":%u,\"s\":\"a ] , } \\\" string\",\"a\":[1,-2.5e3,true,false,null,[],{}]}",
+    "[%u,\"caf\\u00e9 \\ud834\\udd1e\",{\"k\":[[[\"deep\"]]]}]",
+    "  %u  ",
+    "\"%u\"",
+    "{'single':%u,bare:\"x\"} /* ] */",
+    "%u.5",
+    "18446744073709551615 // %u ]\n",
+    NULL
+};
+
+/* element bad_index, if there is one, is bad instead */
+static char *
+make_array(uint num, uint bad_index, const char * bad, size_t * len) {
+    size_t size = (size_t)num * 128 + 16;
+    char * buf = (char *)malloc(size);
+    size_t pos = 0;
+    uint num_forms = 0;
+    uint i;
+
+    while (element_forms[num_forms]) {
+        num_forms++;
+    }
+
+    buf[pos++] = '[';
+    for (i = 0; i < num; i++) {
+        if (i) {
+            buf[pos++] = ',';
+            if (i % 10 == 0) {
+                buf[pos++] = '\n';
+            }
+        }
+
+        if (bad && i == bad_index) {
+            pos += snprintf(buf + pos, size - pos, "%s", bad);
+        }
+        else {
+            pos += snprintf(buf + pos, size - pos, element_forms[i % num_forms], i);
+        }
+    }
+    buf[pos++] = ']';
+    buf[pos] = '\x00';
+
+    *len = pos;
+    return buf;
+}
+
+/* the same tape and arena, word for word */
+static int
+same_doc(const jsonevt_doc * got, const jsonevt_doc * expected) {
+    if (! got || ! expected) {
+        return 0;
+    }
+
+    if (got->tape_len != expected->tape_len || got->arena_len != expected->arena_len) {
+        printf("# tape %u vs %u words, arena %u vs %u bytes\n", got->tape_len, expected->tape_len,
+            got->arena_len, expected->arena_len);
+        return 0;
+    }
+
+    return memcmp(got->tape, expected->tape, got->tape_len * sizeof(got->tape[0])) == 0
+        && memcmp(got->arena, expected->arena, got->arena_len) == 0;
+}
+
+static jsonevt_doc *
+whole_doc(const char * buf, size_t len) {
+    jsonevt_ctx * ctx = jsonevt_new_ctx();
+    jsonevt_doc * doc = jsonevt_doc_parse(ctx, buf, (uint)len);
+
+    jsonevt_free_ctx(ctx);
+
+    return doc;
+}
+
+static const uint thread_counts[] = { 1, 2, 4, 8 };
+
+#define NUM_THREAD_COUNTS (sizeof(thread_counts) / sizeof(thread_counts[0]))
+
+static void
+test_merge(void) {
+    static const char * small_arrays[] = { "[]", " [ 1 ] ", "[[]]", "[1,,2]", "[{},{\"a\":[]}]",
+                                           NULL };
+    jsonevt_ndjson * nd = jsonevt_ndjson_new();
+    jsonevt_doc * expected;
+    jsonevt_doc * doc;
+    const char ** json;
+    size_t len;
+    char * buf = make_array(NUM_ELEMENTS, 0, NULL, &len);
+    uint64_t val;
+    uint last;
+    uint i;
+    char name[128];
+
+    expected = whole_doc(buf, len);
+    OK(expected != NULL, "merge - jsonevt_doc_parse() of the whole array");
+    OK(len > 4 * 1024 * 1024, "merge - array is big enough for several batches");
+
+    jsonevt_ndjson_set_merge_docs(nd, 1);
+
+    for (i = 0; i < NUM_THREAD_COUNTS; i++) {
+        jsonevt_ndjson_set_threads(nd, thread_counts[i]);
+
+        snprintf(name, sizeof(name), "merge - %u threads - parse", thread_counts[i]);
+        OK(jsonevt_ndjson_parse_array(nd, buf, len), name);
+
+        snprintf(name, sizeof(name), "merge - %u threads - element count", thread_counts[i]);
+        OK(jsonevt_ndjson_get_record_count(nd) == NUM_ELEMENTS
+            && jsonevt_ndjson_get_bad_record_count(nd) == 0, name);
+
+        doc = jsonevt_ndjson_take_doc(nd);
+        snprintf(name, sizeof(name), "merge - %u threads - same document", thread_counts[i]);
+        OK(same_doc(doc, expected), name);
+
+        /* and through the accessors, in case both are wrong the same way */
+        last = NUM_ELEMENTS - 1 - (NUM_ELEMENTS - 1) % 7;
+        snprintf(name, sizeof(name), "merge - %u threads - accessors", thread_counts[i]);
+        OK(doc && jsonevt_doc_get_size(doc, jsonevt_doc_root(doc)) == NUM_ELEMENTS
+            && jsonevt_doc_get_uint64(doc, jsonevt_doc_hash_get(doc,
+                jsonevt_doc_array_get(doc, jsonevt_doc_root(doc), last), "i", 1), &val)
+            && val == last, name);
+
+        OK(jsonevt_ndjson_take_doc(nd) == NULL, "merge - the document is only handed over once");
+        jsonevt_doc_free(doc);
+    }
+
+    jsonevt_doc_free(expected);
+    free(buf);
+
+    jsonevt_ndjson_set_threads(nd, 4);
+    for (json = small_arrays; *json; json++) {
+        len = strlen(*json);
+        expected = whole_doc(*json, len);
+
+        snprintf(name, sizeof(name), "merge - %s", *json);
+        OK(jsonevt_ndjson_parse_array(nd, *json, len), name);
+        doc = jsonevt_ndjson_take_doc(nd);
+        OK(same_doc(doc, expected), name);
+
+        jsonevt_doc_free(doc);
+        jsonevt_doc_free(expected);
+    }
+
+    jsonevt_ndjson_free(nd);
+}
+
+typedef struct {
+    uint64_t num_records;
+    uint64_t bad_index;
+    int wrong;
+} array_results;
+
+static int
+array_record_cb(void * cb_data, uint64_t index, jsonevt_doc * doc, const char * error) {
+    array_results * r = (array_results *)cb_data;
+
+    r->num_records++;
+    if ((index == r->bad_index) != (error != NULL) || (error != NULL) == (doc != NULL)) {
+        r->wrong++;
+    }
+
+    jsonevt_doc_free(doc);
+
+    return 0;
+}
+
+static void
+test_bad_elements(void) {
+    static const char * bad_elements[] = { "{\"a\":}", "[1 2]", "@", "{\"a\" 1}", "\"\\u12g4\"",
+                                           NULL };
+    static const char * bad_arrays[] = { "[1,2", "[1,2,]", "[,1]", "{\"a\":1}", "[1] x", "[\"]",
+                                         "[/* ]", "", NULL };
+    jsonevt_ndjson * nd = jsonevt_ndjson_new();
+    array_results r;
+    const char ** bad;
+    const char * error;
+    char * buf;
+    size_t len;
+    uint bad_index = NUM_ELEMENTS / 2 + 3;
+    uint i;
+    char name[160];
+    char expected_error[64];
+
+    jsonevt_ndjson_set_cb_data(nd, &r);
+    jsonevt_ndjson_set_record_cb(nd, array_record_cb);
+    jsonevt_ndjson_set_make_docs(nd, 1);
+
+    snprintf(expected_error, sizeof(expected_error), "element %u: ", bad_index);
+
+    for (bad = bad_elements; *bad; bad++) {
+        buf = make_array(NUM_ELEMENTS, bad_index, *bad, &len);
+
+        for (i = 0; i < NUM_THREAD_COUNTS; i++) {
+            jsonevt_ndjson_set_threads(nd, thread_counts[i]);
+
+            /* as records, only the bad element has an error */
+            jsonevt_ndjson_set_merge_docs(nd, 0);
+            memset(&r, 0, sizeof(r));
+            r.bad_index = bad_index;
+
+            snprintf(name, sizeof(name), "bad element %s - %u threads - records", *bad,
+                thread_counts[i]);
+            OK(jsonevt_ndjson_parse_array(nd, buf, len) && r.num_records == NUM_ELEMENTS
+                && ! r.wrong && jsonevt_ndjson_get_bad_record_count(nd) == 1, name);
+
+            /* merged, there's no document */
+            jsonevt_ndjson_set_merge_docs(nd, 1);
+            snprintf(name, sizeof(name), "bad element %s - %u threads - merge fails", *bad,
+                thread_counts[i]);
+            OK(! jsonevt_ndjson_parse_array(nd, buf, len) && jsonevt_ndjson_take_doc(nd) == NULL,
+                name);
+
+            error = jsonevt_ndjson_get_error(nd);
+            snprintf(name, sizeof(name), "bad element %s - %u threads - merge error", *bad,
+                thread_counts[i]);
+            if (! OK(error && strncmp(error, expected_error, strlen(expected_error)) == 0, name)) {
+                printf("# got '%s'\n", error ? error : "(null)");
+            }
+        }
+
+        free(buf);
+    }
+
+    /* the array itself is bad, so nothing gets parsed */
+    jsonevt_ndjson_set_merge_docs(nd, 0);
+    jsonevt_ndjson_set_threads(nd, 4);
+    for (bad = bad_arrays; *bad; bad++) {
+        memset(&r, 0, sizeof(r));
+        r.bad_index = ~(uint64_t)0;
+
+        snprintf(name, sizeof(name), "bad array %s", *bad);
+        OK(! jsonevt_ndjson_parse_array(nd, *bad, strlen(*bad)) && jsonevt_ndjson_get_error(nd)
+            && r.num_records == 0, name);
+    }
+
+    jsonevt_ndjson_free(nd);
+}
+
+int
+main() {
+    results r;
+    size_t len;
+    char * buf;
+
+    memset(&r, 0, sizeof(r));
+    buf = make_input(&r, &len);
+    r.seen = (unsigned char *)calloc(r.num_lines + 1, 1);
+
+    test_threads(&r, buf, len);
+    test_stop(&r, buf, len);
+    test_file(&r, buf, len);
+    test_small(&r);
+    test_merge();
+    test_bad_elements();
+
+    free(r.seen);
+    free(r.kinds);
+    free(buf);
+
+    return tests_done();
+}
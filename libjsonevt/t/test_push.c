@@ -0,0 +1,336 @@
+/* Creation date: 2026-10-18T18:12:09Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Tests for jsonevt_parse_begin(), jsonevt_parse_chunk(), and
+  jsonevt_parse_end(): the callbacks for a value nested inside a
+  single big member are called as the chunks come in, not all at the
+  end, and input split anywhere (down to one byte at a time) gives the
+  same callbacks and errors as jsonevt_parse() on the whole thing.
+*/
+
+#include <jsonevt.h>
+
+#include <stdlib.h>
+
+#include "test_util.h"
+
+#define EVENTS_SIZE 4096
+#define CHUNK_SIZE 4096
+
+/* elements in the array inside the one member of the big hash */
+#define NUM_ELEMENTS 100000
+
+typedef struct {
+    char buf[EVENTS_SIZE];
+    uint len;
+
+    uint elements;     /* elements of the array at level 2 finished */
+    uint string_len;   /* length of the longest string seen */
+} events;
+
+static void
+add_event(events * ev, const char * name, const char * data, uint data_len) {
+    int n;
+
+    if (data) {
+        n = snprintf(&ev->buf[ev->len], EVENTS_SIZE - ev->len, "%s(%.*s) ", name, (int)data_len,
+            data);
+    }
+    else {
+        n = snprintf(&ev->buf[ev->len], EVENTS_SIZE - ev->len, "%s ", name);
+    }
+
+    if (n > 0 && ev->len + n < EVENTS_SIZE) {
+        ev->len += n;
+    }
+}
+
+static int
+cb_string(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    events * ev = (events *)cb_data;
+
+    if (data_len > ev->string_len) {
+        ev->string_len = data_len;
+    }
+
+    add_event(ev, flags & JSON_EVT_IS_HASH_KEY ? "key" : "str", data_len > 32 ? "..." : data,
+        data_len > 32 ? 3 : data_len);
+    return 0;
+}
+
+static int
+cb_number(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    add_event((events *)cb_data, "num", data, data_len);
+    return 0;
+}
+
+static int
+cb_bool(void * cb_data, uint bool_val, uint flags, uint level) {
+    add_event((events *)cb_data, bool_val ? "true" : "false", NULL, 0);
+    return 0;
+}
+
+static int
+cb_comment(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    add_event((events *)cb_data, "comment", data, data_len);
+    return 0;
+}
+
+static int
+cb_end_array_element(void * cb_data, uint flags, uint level) {
+    events * ev = (events *)cb_data;
+
+    if (level == 2) {
+        ev->elements++;
+    }
+
+    add_event(ev, ">", NULL, 0);
+    return 0;
+}
+
+#define CB_GEN(name, event)                                     \
+    static int                                                  \
+    cb_##name(void * cb_data, uint flags, uint level) {         \
+        char tmp[32];                                           \
+        snprintf(tmp, sizeof(tmp), "%s%u/%u", event, level, flags); \
+        add_event((events *)cb_data, tmp, NULL, 0);             \
+        return 0;                                               \
+    }
+
+CB_GEN(null, "null")
+CB_GEN(begin_array, "[")
+CB_GEN(end_array, "]")
+CB_GEN(begin_array_element, "<")
+CB_GEN(begin_hash, "{")
+CB_GEN(end_hash, "}")
+CB_GEN(begin_hash_entry, "(")
+CB_GEN(end_hash_entry, ")")
+
+static jsonevt_ctx *
+new_ctx(events * ev) {
+    jsonevt_ctx * ctx = jsonevt_new_ctx();
+
+    memset((void *)ev, 0, sizeof(*ev));
+
+    jsonevt_set_cb_data(ctx, ev);
+    jsonevt_set_string_cb(ctx, cb_string);
+    jsonevt_set_number_cb(ctx, cb_number);
+    jsonevt_set_bool_cb(ctx, cb_bool);
+    jsonevt_set_null_cb(ctx, cb_null);
+    jsonevt_set_comment_cb(ctx, cb_comment);
+    jsonevt_set_begin_array_cb(ctx, cb_begin_array);
+    jsonevt_set_end_array_cb(ctx, cb_end_array);
+    jsonevt_set_begin_array_element_cb(ctx, cb_begin_array_element);
+    jsonevt_set_end_array_element_cb(ctx, cb_end_array_element);
+    jsonevt_set_begin_hash_cb(ctx, cb_begin_hash);
+    jsonevt_set_end_hash_cb(ctx, cb_end_hash);
+    jsonevt_set_begin_hash_entry_cb(ctx, cb_begin_hash_entry);
+    jsonevt_set_end_hash_entry_cb(ctx, cb_end_hash_entry);
+
+    return ctx;
+}
+
+/* {"data":[{"id":0,"name":"item 0"},...]} -- one member holding everything */
+static void
+test_large_member(void) {
+    size_t size = (size_t)NUM_ELEMENTS * 48 + 64;
+    char * buf = (char *)malloc(size);
+    size_t len = 0;
+    size_t pos;
+    uint i;
+    uint at_half = 0;
+    events ev;
+    jsonevt_ctx * ctx = new_ctx(&ev);
+    int rv;
+
+    len += snprintf(buf + len, size - len, "{\"data\":[");
+    for (i = 0; i < NUM_ELEMENTS; i++) {
+        len += snprintf(buf + len, size - len, "%s{\"id\":%u,\"name\":\"item %u\"}", i ? "," : "",
+            i, i);
+    }
+    len += snprintf(buf + len, size - len, "]}");
+
+    rv = jsonevt_parse_begin(ctx);
+    for (pos = 0; rv && pos < len; pos += CHUNK_SIZE) {
+        rv = jsonevt_parse_chunk(ctx, buf + pos, len - pos < CHUNK_SIZE ? len - pos : CHUNK_SIZE);
+        if (pos < len / 2) {
+            at_half = ev.elements;
+        }
+    }
+
+    OK(rv, "large member - every chunk parses");
+    OK(at_half > NUM_ELEMENTS / 4, "large member - elements parsed before the member is done");
+
+    /* the last element ends at the closing brackets, which could be
+       followed by a comment in a chunk still to come */
+    IS_UINT(ev.elements, NUM_ELEMENTS - 1,
+        "large member - all but the last element before jsonevt_parse_end()");
+
+    OK(jsonevt_parse_end(ctx), "large member - jsonevt_parse_end()");
+    IS_UINT(ev.elements, NUM_ELEMENTS, "large member - last element at the end");
+    IS_UINT(jsonevt_get_stats_deepest_level(ctx), 3, "large member - deepest level");
+
+    jsonevt_free_ctx(ctx);
+    free(buf);
+}
+
+/* a string bigger than a chunk, a few levels down -- it can be parsed
+   once the start of the string after it has come in */
+static void
+test_large_string(void) {
+    uint str_len = 1024 * 1024;
+    size_t size = str_len + 64;
+    char * buf = (char *)malloc(size);
+    size_t len = 0;
+    size_t pos;
+    events ev;
+    jsonevt_ctx * ctx = new_ctx(&ev);
+    int rv;
+
+    len += snprintf(buf + len, size - len, "[{\"a\":[\"");
+    memset(buf + len, 'x', str_len);
+    len += str_len;
+    len += snprintf(buf + len, size - len, "\", \"after\"]}]");
+
+    rv = jsonevt_parse_begin(ctx);
+    for (pos = 0; rv && pos < len; pos += CHUNK_SIZE) {
+        rv = jsonevt_parse_chunk(ctx, buf + pos, len - pos < CHUNK_SIZE ? len - pos : CHUNK_SIZE);
+    }
+
+    OK(rv, "large string - every chunk parses");
+    IS_UINT(ev.string_len, str_len, "large string - parsed before jsonevt_parse_end()");
+    OK(jsonevt_parse_end(ctx), "large string - jsonevt_parse_end()");
+
+    jsonevt_free_ctx(ctx);
+    free(buf);
+}
+
+static int
+parse_whole(const char * json, events * ev, char * error, uint error_size) {
+    jsonevt_ctx * ctx = new_ctx(ev);
+    int rv;
+
+    error[0] = '\x00';
+
+    rv = jsonevt_parse(ctx, json, (uint)strlen(json));
+    if (! rv) {
+        snprintf(error, error_size, "%s at byte %u", jsonevt_get_error(ctx),
+            jsonevt_get_error_byte_pos(ctx));
+    }
+
+    jsonevt_free_ctx(ctx);
+
+    return rv;
+}
+
+static int
+parse_pieces(const char * json, uint piece_size, events * ev, char * error, uint error_size) {
+    jsonevt_ctx * ctx = new_ctx(ev);
+    uint len = (uint)strlen(json);
+    uint pos;
+    int rv;
+
+    error[0] = '\x00';
+
+    rv = jsonevt_parse_begin(ctx);
+    for (pos = 0; rv && pos < len; pos += piece_size) {
+        rv = jsonevt_parse_chunk(ctx, json + pos, len - pos < piece_size ? len - pos : piece_size);
+    }
+
+    rv = jsonevt_parse_end(ctx);
+    if (! rv) {
+        snprintf(error, error_size, "%s at byte %u", jsonevt_get_error(ctx),
+            jsonevt_get_error_byte_pos(ctx));
+    }
+
+    jsonevt_free_ctx(ctx);
+
+    return rv;
+}
+
+static void
+test_agreement(void) {
+    static const char * inputs[] = {
+        "[1,2,3]",
+        "  [ 1 , 2 ]  ",
+        "{\"a\":{\"b\":[true,false,null,{\"c\":\"d\"}]}}",
+        "[[[[[[1]]]]],[],{},[{}],{\"x\":[]}]",
+        "{a:1, b_2 : 'two', $c:[-1.5e+3]}",
+        "[\"esc \\\" \\\\ \\/ quote\", 'single \\' quote']",
+        "[1, /* block */ 2, // line\n 3, # hash\n 4]",
+        "{/* before key */\"k\" /* after */ : /* value */ \"v\" // end\n}",
+        "[\"\xc3\xa9\xe2\x80\xa8\", 1]",
+        "[1,,2,]",
+        "\"just a string\"",
+        "12345",
+        "[1 2]",
+        "{\"a\" 1}",
+        "{\"a\":1 \"b\":2}",
+        "[[1,],2]",
+        "[1,2",
+        "{\"a\":[1,{\"b\":",
+        "[1] x",
+        "[tru, nul]",
+        "[1/2]",
+        NULL
+    };
+    static const uint piece_sizes[] = { 1, 2, 3, 7 };
+    events expected;
+    events got;
+    char expected_error[256];
+    char got_error[256];
+    char name[128];
+    int expected_rv;
+    int rv;
+    uint i;
+    uint j;
+    uint k;
+
+    for (i = 0; inputs[i]; i++) {
+        expected_rv = parse_whole(inputs[i], &expected, expected_error, sizeof(expected_error));
+
+        for (j = 0; j < sizeof(piece_sizes) / sizeof(piece_sizes[0]); j++) {
+            rv = parse_pieces(inputs[i], piece_sizes[j], &got, got_error, sizeof(got_error));
+
+            snprintf(name, sizeof(name), "agreement - %u byte pieces - %s", piece_sizes[j],
+                inputs[i]);
+            for (k = 0; name[k]; k++) {
+                if (name[k] == '\n') {
+                    name[k] = ' ';
+                }
+            }
+
+            OK(rv == expected_rv && strcmp(expected.buf, got.buf) == 0, name);
+            IS_STR(got_error, expected_error, name);
+        }
+    }
+}
+
+int
+main() {
+    test_large_member();
+    test_large_string();
+    test_agreement();
+
+    return tests_done();
+}
@@ -0,0 +1,307 @@
+/* Creation date: 2026-10-18T10:21:47Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Runs jsonevt_parse() and jsonevt::parse() from jsonevt_sax.h over
+  the same inputs and checks that they give the same events, with the
+  same flags and levels, and succeed or fail together.
+*/
+
+#include <jsonevt.h>
+#include "c++/jsonevt_sax.h"
+
+#include <string>
+
+#include "test_util.h"
+
+static void
+add_event(std::string * events, const char * name, const char * data, size_t data_len,
+    uint flags, uint level) {
+    char tmp[64];
+
+    events->append(name);
+    if (data) {
+        events->append("(");
+        events->append(data, data_len);
+        events->append(")");
+    }
+
+    snprintf(tmp, sizeof(tmp), ":%u:%u ", flags, level);
+    events->append(tmp);
+}
+
+/* for test names */
+static std::string
+printable(const std::string & json) {
+    std::string out;
+    size_t i;
+
+    for (i = 0; i < json.size(); i++) {
+        if (json[i] == '\n') {
+            out += "\\n";
+        }
+        else if (json[i] == '\r') {
+            out += "\\r";
+        }
+        else {
+            out += json[i];
+        }
+    }
+
+    return out;
+}
+
+/* jsonevt_parse() callbacks */
+
+static int
+c_string(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    add_event((std::string *)cb_data, "str", data, data_len, flags, level);
+    return 0;
+}
+
+static int
+c_number(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    add_event((std::string *)cb_data, "num", data, data_len, flags, level);
+    return 0;
+}
+
+static int
+c_bool(void * cb_data, uint bool_val, uint flags, uint level) {
+    add_event((std::string *)cb_data, bool_val ? "true" : "false", NULL, 0, flags, level);
+    return 0;
+}
+
+static int
+c_comment(void * cb_data, const char * data, uint data_len, uint flags, uint level) {
+    add_event((std::string *)cb_data, "comment", data, data_len, flags, level);
+    return 0;
+}
+
+#define C_GEN_CB(name)                                                  \
+    static int                                                          \
+    c_##name(void * cb_data, uint flags, uint level) {                  \
+        add_event((std::string *)cb_data, #name, NULL, 0, flags, level); \
+        return 0;                                                       \
+    }
+
+C_GEN_CB(null)
+C_GEN_CB(begin_array)
+C_GEN_CB(end_array)
+C_GEN_CB(begin_array_element)
+C_GEN_CB(end_array_element)
+C_GEN_CB(begin_hash)
+C_GEN_CB(end_hash)
+C_GEN_CB(begin_hash_entry)
+C_GEN_CB(end_hash_entry)
+
+/* the same events from the handler */
+
+struct recorder {
+    std::string events;
+
+    void on_string(std::string_view s, uint flags, uint level) {
+        add_event(&events, "str", s.data(), s.size(), flags, level);
+    }
+    void on_number(std::string_view s, uint flags, uint level) {
+        add_event(&events, "num", s.data(), s.size(), flags, level);
+    }
+    void on_bool(bool val, uint flags, uint level) {
+        add_event(&events, val ? "true" : "false", NULL, 0, flags, level);
+    }
+    void on_comment(std::string_view s, uint flags, uint level) {
+        add_event(&events, "comment", s.data(), s.size(), flags, level);
+    }
+    void on_null(uint flags, uint level) {
+        add_event(&events, "null", NULL, 0, flags, level);
+    }
+    void on_begin_array(uint flags, uint level) {
+        add_event(&events, "begin_array", NULL, 0, flags, level);
+    }
+    void on_end_array(uint flags, uint level) {
+        add_event(&events, "end_array", NULL, 0, flags, level);
+    }
+    void on_begin_array_element(uint flags, uint level) {
+        add_event(&events, "begin_array_element", NULL, 0, flags, level);
+    }
+    void on_end_array_element(uint flags, uint level) {
+        add_event(&events, "end_array_element", NULL, 0, flags, level);
+    }
+    void on_begin_hash(uint flags, uint level) {
+        add_event(&events, "begin_hash", NULL, 0, flags, level);
+    }
+    void on_end_hash(uint flags, uint level) {
+        add_event(&events, "end_hash", NULL, 0, flags, level);
+    }
+    void on_begin_hash_entry(uint flags, uint level) {
+        add_event(&events, "begin_hash_entry", NULL, 0, flags, level);
+    }
+    void on_end_hash_entry(uint flags, uint level) {
+        add_event(&events, "end_hash_entry", NULL, 0, flags, level);
+    }
+};
+
+static int
+c_parse(const std::string & json, std::string * events) {
+    jsonevt_ctx * ctx = jsonevt_new_ctx();
+    int rv;
+
+    jsonevt_set_cb_data(ctx, events);
+    jsonevt_set_string_cb(ctx, c_string);
+    jsonevt_set_number_cb(ctx, c_number);
+    jsonevt_set_bool_cb(ctx, c_bool);
+    jsonevt_set_null_cb(ctx, c_null);
+    jsonevt_set_comment_cb(ctx, c_comment);
+    jsonevt_set_begin_array_cb(ctx, c_begin_array);
+    jsonevt_set_end_array_cb(ctx, c_end_array);
+    jsonevt_set_begin_array_element_cb(ctx, c_begin_array_element);
+    jsonevt_set_end_array_element_cb(ctx, c_end_array_element);
+    jsonevt_set_begin_hash_cb(ctx, c_begin_hash);
+    jsonevt_set_end_hash_cb(ctx, c_end_hash);
+    jsonevt_set_begin_hash_entry_cb(ctx, c_begin_hash_entry);
+    jsonevt_set_end_hash_entry_cb(ctx, c_end_hash_entry);
+
+    rv = jsonevt_parse(ctx, json.data(), (uint)json.size());
+
+    jsonevt_free_ctx(ctx);
+
+    return rv;
+}
+
+/* inputs both parsers take */
+static const char * good_inputs[] = {
+    "[]",
+    "{}",
+    "[1,2,3]",
+    "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\"}}",
+    "  [ [ [ ] , { } ] ]  ",
+    "\"top-level string\"",
+    "-12.5e3",
+    "-5",
+    "true",
+    "[0,-0,1.5,-1.5e-7,1E+3,123456789012345678901234567890,-9223372036854775808]",
+    "[\"a\\nb\\tc\\\"d\\\\e\\/f\\bg\\fh\\r\"]",
+    "[\"\\u00e9\\u20ac\\u0041\"]",
+    "[\"\\ud834\\udd1e\",\"x\\uD83D\\uDE00y\"]",
+    "[\"lone \\ud834 surrogate\"]",
+    "[\"\\ud834\\u0041\",\"\\udd1e\\ud834\",\"\\ud834\\\\udd1e\"]",
+    "{\"\\ud834\\udd1e\":\"\\ud834\"}",
+    "[\"caf\xc3\xa9\",\"\xe2\x82\xac\",\"\xf0\x9d\x84\x9e\"]",
+    "{'single':'quoted \"strings\"'}",
+    "{bare_key:1,another_key:[2]}",
+    "{\"a\":1,}",
+    "[1,,2]",
+    "[1, /* c comment */ 2]",
+    "// line comment\n[1]",
+    "# perl comment\n{\"a\":1}",
+    "{\"a\" /* before colon */ : /* after */ 1}",
+    "[1 // trailing\n]",
+    "[\n\"line\\nbreaks\",\r\n 2\r\n]",
+    "[\"unknown escape \\q\"]",
+    "/* leading */ [1]",
+    "[1] // at the end",
+    "[1, # several\n # comments\n 2]",
+    NULL
+};
+
+/* inputs both parsers reject */
+static const char * bad_inputs[] = {
+    "",
+    "[1,2",
+    "{\"a\"}",
+    "{\"a\":}",
+    "{\"a\":1 \"b\":2}",
+    "\"unterminated",
+    "[1,2,]",
+    "[\"bad \\u escape \\u12g4\"]",
+    "[\"bad utf-8 \xe9\"]",
+    "[1 2]",
+    "/* unterminated comment",
+    NULL
+};
+
+/* inputs only jsonevt_parse() takes, as it stops early without
+   noticing what follows */
+static const char * c_only_inputs[] = {
+    "nul",
+    "[1] x",
+    NULL
+};
+
+int
+main() {
+    const char ** input;
+    std::string name;
+
+    for (input = good_inputs; *input; input++) {
+        std::string json(*input);
+        std::string c_events;
+        recorder r;
+        jsonevt::parse_error err;
+        int c_rv = c_parse(json, &c_events);
+        bool cpp_rv = jsonevt::parse(json, r, &err);
+
+        name = "parses: " + printable(json);
+        OK(c_rv && cpp_rv, name.c_str());
+        if (! cpp_rv) {
+            printf("#   %s\n", err.message.c_str());
+        }
+
+        name = "same events: " + printable(json);
+        IS_STR(r.events.c_str(), c_events.c_str(), name.c_str());
+    }
+
+    for (input = bad_inputs; *input; input++) {
+        std::string json(*input);
+        std::string c_events;
+        recorder r;
+        jsonevt::parse_error err;
+
+        name = "C parser fails: " + printable(json);
+        OK(! c_parse(json, &c_events), name.c_str());
+
+        name = "C++ parser fails: " + printable(json);
+        OK(! jsonevt::parse(json, r, &err) && ! err.message.empty(), name.c_str());
+    }
+
+    for (input = c_only_inputs; *input; input++) {
+        std::string json(*input);
+        std::string c_events;
+        recorder r;
+        jsonevt::parse_error err;
+
+        name = "C parser takes: " + printable(json);
+        OK(c_parse(json, &c_events), name.c_str());
+
+        name = "C++ parser fails: " + printable(json);
+        OK(! jsonevt::parse(json, r, &err) && ! err.message.empty(), name.c_str());
+    }
+
+    /* a surrogate pair comes out as a single 4-byte character */
+    {
+        std::string c_events;
+
+        c_parse("\"\\ud834\\udd1e\"", &c_events);
+        IS_STR(c_events.c_str(), "str(\xf0\x9d\x84\x9e):0:0 ", "surrogate pair as utf-8");
+    }
+
+    return tests_done();
+}
@@ -0,0 +1,104 @@
+/* Creation date: 2026-10-18T10:05:31Z
+ * Authors: Don
+ */
+
+/*
+
+ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
+
+ This is free software; you can redistribute it and/or modify it under
+ the Perl Artistic license.  You should have received a copy of the
+ Artistic license with this distribution, in the file named
+ "Artistic".  You may also obtain a copy from
+ http://regexguy.com/license/Artistic
+
+ This program is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*/
+
+/* $Revision$ */
+
+/*
+  Minimal test output for the libjsonevt test programs, in the same
+  "ok N - name" format as the Perl tests.  Each program returns
+  tests_done() from main(), which is non-zero if anything failed, so
+  "make test" stops there.
+*/
+
+#ifndef JSONEVT_TEST_UTIL_H
+#define JSONEVT_TEST_UTIL_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_num = 0;
+static int test_failures = 0;
+
+static int
+test_ok(int ok, const char * name, const char * file, int line) {
+    test_num++;
+
+    if (ok) {
+        printf("ok %d - %s\n", test_num, name);
+    }
+    else {
+        test_failures++;
+        printf("not ok %d - %s\n#   at %s line %d\n", test_num, name, file, line);
+    }
+
+    return ok;
+}
+
+static int
+test_is_str(const char * got, const char * expected, const char * name, const char * file,
+    int line) {
+    int ok;
+
+    if (got == NULL || expected == NULL) {
+        ok = got == expected;
+    }
+    else {
+        ok = strcmp(got, expected) == 0;
+    }
+
+    if (! test_ok(ok, name, file, line)) {
+        printf("#          got: %s\n#     expected: %s\n", got ? got : "(null)",
+            expected ? expected : "(null)");
+    }
+
+    return ok;
+}
+
+static int
+test_is_uint(unsigned long got, unsigned long expected, const char * name, const char * file,
+    int line) {
+    if (! test_ok(got == expected, name, file, line)) {
+        printf("#          got: %lu\n#     expected: %lu\n", got, expected);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int
+tests_done(void) {
+    /* not every program uses every check */
+    (void)test_is_str;
+    (void)test_is_uint;
+
+    printf("1..%d\n", test_num);
+    if (test_failures) {
+        printf("# failed %d of %d tests\n", test_failures, test_num);
+    }
+
+    return test_failures ? 1 : 0;
+}
+
+#define OK(cond, name) test_ok((cond) != 0, name, __FILE__, __LINE__)
+#define IS_STR(got, expected, name) test_is_str(got, expected, name, __FILE__, __LINE__)
+#define IS_UINT(got, expected, name) \
+    test_is_uint((unsigned long)(got), (unsigned long)(expected), name, __FILE__, __LINE__)
+
+#endif /* JSONEVT_TEST_UTIL_H */
@@ -130,3 +130,12 @@ utf16_unicode_to_bytes(uint32_t cp, uint8_t *out_buf, uint32_t output_little_end
 }
 
 
+
+uint32_t
+utf16_surrogate_pair_to_unicode(uint32_t high, uint32_t low) {
+    if (high < 0xd800 || high > 0xdbff || low < 0xdc00 || low > 0xdfff) {
+        return 0;
+    }
+
+    return 0x010000 + ((high - 0xd800) << 10) + (low - 0xdc00);
+}
@@ -35,6 +35,9 @@ uint32_t utf16_bytes_to_unicode(const uint8_t *orig_buf, uint32_t buf_len, uint3
 uint32_t utf16_unicode_to_bytes(uint32_t code_point, uint8_t *out_buf,
     uint32_t output_little_endian);
 
+/* the code point for a high and a low surrogate, or 0 if they aren't a pair */
+uint32_t utf16_surrogate_pair_to_unicode(uint32_t high, uint32_t low);
+
 UNI_DO_CPLUSPLUS_WRAP_END
 
 #endif /* UTF16_H */
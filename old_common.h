@@ -35,11 +35,58 @@ Copyright (c) 2007-2010 Don Owens <don@regexguy.com>.  All rights reserved.
 #define kBareSolidus (1 << 5)
 #define kMinimalEscaping (1 << 6)
 #define kSortKeys (1 << 7)
+#define kDetectCircularRefs (1 << 8)
+#define kConvertBlessed (1 << 9)
 
 #define kBadCharError 0
 #define kBadCharConvert 1
 #define kBadCharPassThrough 2
 
+/* the arrays and hashes output so far, for detect_circular_refs --
+   open addressing with linear probing, keyed on the AV/HV pointer */
+typedef struct {
+    void ** slots; /* NULL for an empty slot */
+    STRLEN mask;   /* number of slots - 1 (always a power of 2) */
+    STRLEN count;
+} ref_set;
+
+/* how objects of a class are output, worked out the first time one
+   is seen in a call -- see get_class_dispatch() */
+#define kClassPlain 0  /* as whatever it refers to */
+#define kClassBool 1   /* JSON::DWIW::Boolean */
+#define kClassBigNum 2 /* Math::BigInt or Math::BigFloat */
+#define kClassToJSON 3 /* whatever its TO_JSON method returns (convert_blessed) */
+
+typedef struct {
+    HV * stash;   /* NULL for an empty slot */
+    int kind;
+    CV * to_json_cv;
+} class_dispatch;
+
+/* open addressing with linear probing, keyed on the stash pointer */
+typedef struct {
+    class_dispatch * slots;
+    STRLEN mask;   /* number of slots - 1 (always a power of 2) */
+    STRLEN count;
+} class_cache;
+
+/* a hash key as it was last output, for cache_keys -- see
+   _encode_hash_entry() */
+#define KEY_CACHE_SIZE 1024 /* entries -- must be a power of 2 */
+#define KEY_CACHE_MAX_KEY 48
+#define KEY_CACHE_MAX_JSON 96
+
+typedef struct {
+    U32 hash;      /* HEK_HASH() of the key -- 0 for an empty entry */
+    int options;   /* the encoder options the JSON was made with */
+    U8 key_type;   /* kStrBytes, kStrUTF8, or kStrLatin1 */
+    U8 is_string;  /* the key was quoted, i.e., not bare */
+    U8 key_len;
+    U8 json_len;
+    char key[KEY_CACHE_MAX_KEY];
+    char json[KEY_CACHE_MAX_JSON]; /* the key followed by ':' */
+} key_cache_entry;
+
 /* for converting to JSON */
 typedef struct {
     SV * error;
@@ -59,7 +106,15 @@ typedef struct {
     unsigned int array_count;
     unsigned int deepest_level;
 
-    HV * ref_track;
+    ref_set ref_track;
+    class_cache classes;
+    AV * to_json_results; /* kept until the end, for detect_circular_refs */
+    key_cache_entry * key_cache; /* if cache_keys is on */
+
+    SV * out;     /* the JSON being built */
+    SV * scratch; /* for stringifying numbers without changing them */
+
+    PerlIO * out_fp; /* if set, out is written here whenever it fills up */
 } self_context;
 
 #define kHaveModuleNotChecked 0
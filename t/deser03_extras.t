@@ -12,7 +12,7 @@ use Test;
     use JSON::DWIW;
 
     if (JSON::DWIW->has_deserialize) {
-        plan tests => 21;
+        plan tests => 26;
     }
     else {
         plan tests => 1;
@@ -122,7 +122,25 @@ use Test;
     }
     ok($data and ord($data->{var}) == 0xe9);
 
-    
+    # the converted char takes more bytes than the original, so the
+    # rest of the string can't be used as is either
+    $json_str = qq{{"\xe9":"caf\xe9 au lait"}};
+    {
+        local $SIG{__WARN__} = sub { };
+        $data = JSON::DWIW::deserialize($json_str, { bad_char_policy => 'convert' });
+    }
+    ok($data and join(',', %$data) eq "\xe9,caf\xe9 au lait");
+
+    # bad utf-8 inside comments used to loop forever
+    foreach my $comment ("# caf\xe9\n", "// caf\xe9\n", "/* caf\xe9 */") {
+        $json_str = qq{{"var":1 $comment}};
+        $data = JSON::DWIW::deserialize($json_str);
+        ok(not $data and JSON::DWIW->get_error_string =~ /bad utf-8/);
+    }
+
+    # C style comment at the very start of the input
+    $data = JSON::DWIW::deserialize('/* comment */ [1]');
+    ok(ref($data) eq 'ARRAY' and $data->[0] == 1);
     
                                    
 }
@@ -11,7 +11,7 @@ use Test;
     use JSON::DWIW;
 
     if (JSON::DWIW->has_deserialize) {
-        plan tests => 4;
+        plan tests => 9;
     }
     else {
         plan tests => 1;
@@ -45,6 +45,22 @@ use Test;
     $data = JSON::DWIW::deserialize($str);
     $bool = $data->{var1};
     ok(not ref($bool));
+
+    # the same objects are handed out for every true and false value
+    $str = '[true,false,true,false,{"a":true}]';
+    $data = JSON::DWIW::deserialize($str, { convert_bool => 1 });
+    ok(join(",", map { $_ ? 1 : 0 } @$data[0 .. 3], $data->[4]{a}) eq "1,0,1,0,1");
+    ok(JSON::DWIW->to_json($data) eq '[true,false,true,false,{"a":true}]');
+    ok(JSON::DWIW->to_json($data, { detect_circular_refs => 1 })
+       eq '[true,false,true,false,{"a":true}]');
+
+    # ... so they can't be changed
+    eval { ${$data->[0]} = 0; };
+    ok($@ and $data->[2]);
+
+    # but the values holding them can
+    $data->[0] = 5;
+    ok($data->[2] and ref($data->[2]) eq 'JSON::DWIW::Boolean');
 }
 
 exit 0;
@@ -5,7 +5,7 @@ use Test;
 use JSON::DWIW;
 
 if (JSON::DWIW->has_deserialize) {
-    plan tests => 24;
+    plan tests => 44;
 }
 else {
     plan tests => 1;
@@ -60,3 +60,73 @@ ok($stats->{numbers} == 0);
 ok($stats->{bools} == 2);
 ok($stats->{nulls} == 1);
 
+# lines and chars are counted from the input after the parse, so the
+# input has to still be around -- deserialize_file() unmaps it first
+$str = qq{[\n  "caf\xc3\xa9",\n  "\xe2\x82\xac"\n]};
+$data = JSON::DWIW::deserialize($str);
+$stats = JSON::DWIW->get_stats;
+
+ok($stats->{lines} == 4);
+ok($stats->{chars} == 18);
+ok($stats->{bytes} == 21);
+
+my $file = "t/deser08_stats.tmp";
+open(my $out_fh, '>', $file) or die "couldn't open $file: $!";
+print $out_fh $str;
+close $out_fh;
+
+$data = JSON::DWIW::deserialize_file($file);
+$stats = JSON::DWIW->get_stats;
+unlink $file;
+
+ok($stats->{lines} == 4);
+ok($stats->{chars} == 18);
+ok($stats->{bytes} == 21);
+
+# the stats hash is built when $JSON::DWIW::Last_Stats is read, so it
+# has to be for the last parse no matter how it is read
+JSON::DWIW::deserialize('[1,2,"three"]');
+ok($JSON::DWIW::Last_Stats->{numbers} == 2);
+
+JSON::DWIW::deserialize('[1,');
+ok(not defined(JSON::DWIW->get_stats));
+ok(defined($JSON::DWIW::LastError));
+
+JSON::DWIW::deserialize('[null]');
+ok(JSON::DWIW->get_stats->{nulls} == 1);
+ok(not defined($JSON::DWIW::LastError));
+
+JSON::DWIW::deserialize('[null,null]');
+$JSON::DWIW::Last_Stats = 'assigned';
+ok(JSON::DWIW->get_stats eq 'assigned');
+
+JSON::DWIW::deserialize('[true]');
+{
+    local $JSON::DWIW::Last_Stats;
+    JSON::DWIW::deserialize('[true,false]');
+}
+ok(JSON::DWIW->get_stats->{bools} == 1);
+
+# lines and chars aren't counted until one of them is read, from a copy
+# of the input, so it doesn't matter what happens to the input first
+$str = qq{[\n  "caf\xc3\xa9",\n  "\xe2\x82\xac"\n]};
+JSON::DWIW::deserialize($str);
+$str = "[1]";
+$stats = JSON::DWIW->get_stats;
+ok($stats->{lines} == 4);
+ok($stats->{chars} == 18);
+
+my $json_obj = JSON::DWIW->new;
+{
+    my $tmp = qq{[\n1,\n2]};
+    $json_obj->from_json($tmp);
+}
+JSON::DWIW::deserialize('[1]');
+$stats = $json_obj->get_stats;
+ok($stats->{chars} == 6);
+ok($stats->{lines} == 3);
+ok(JSON::DWIW->get_stats->{lines} == 1);
+
+$stats->{lines} = 10;
+ok($stats->{lines} == 10);
+ok($stats->{chars} == 6);
@@ -8,7 +8,7 @@ use warnings;
 
 use Test;
 
-BEGIN { plan tests => 2 }
+BEGIN { plan tests => 12 }
 
 use JSON::DWIW;
 
@@ -25,3 +25,29 @@ $str = qq{{"var":"\xe9"}};
 $data = JSON::DWIW::deserialize($str);
 ok(not $data and JSON::DWIW->get_error_string =~ /bad utf-8/);
 
+
+# hash keys
+$str = qq{{"plain":1,"caf\xc3\xa9":2,"\xe2\x82\xac":3,"esc\\u00e9":4,"q\\"":{"plain":[5]}}};
+$data = JSON::DWIW::deserialize($str);
+
+ok($data->{plain} == 1);
+ok($data->{"caf\x{e9}"} == 2);
+ok($data->{"\x{20ac}"} == 3);
+ok($data->{"esc\x{e9}"} == 4);
+ok($data->{'q"'}{plain}[0] == 5);
+
+# surrogate pairs are a single character, as a value or a key
+$str = qq{["\\ud834\\udd1e","x\\uD83D\\uDE00y",{"\\ud834\\udd1e":1}]};
+$data = JSON::DWIW::deserialize($str);
+
+ok($data->[0] eq "\x{1d11e}");
+ok($data->[1] eq "x\x{1f600}y");
+ok($data->[2]{"\x{1d11e}"} == 1);
+
+# halves that aren't a pair are left alone
+{
+    no warnings 'utf8';
+    $data = JSON::DWIW::deserialize(qq{["\\ud834 \\udd1e","\\ud834\\u0041"]});
+    ok($data->[0] eq "\x{d834} \x{dd1e}");
+    ok($data->[1] eq "\x{d834}A");
+}
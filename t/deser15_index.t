@@ -0,0 +1,87 @@
+#!/usr/bin/env perl
+
+# Original authors: don
+# $Revision: $
+
+# Parsing with the structural_index option should give exactly the
+# same data, errors, and stats as parsing without it.
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use B ();
+use JSON::DWIW;
+
+my $long = 'x' x 70;
+my $pad = ' ' x 61;
+my $big_array = '[' . join(',', 1 .. 1000) . ']';
+my $big_hash = '{' . join(',', map { qq{"k$_":[$_,{}]} } 1 .. 200) . '}';
+
+my @tests = (
+             [ 'simple hash', '{"key":"val","num":4}' ],
+             [ 'top-level string', '"just a string"' ],
+             [ 'empty strings', '{"":"","a":[""]}' ],
+             [ 'single quotes', qq{{'it"s':'a "quoted" value'}} ],
+             [ 'escapes', '["tab\\there","quote\\"","back\\\\slash","\\u00e9\\x41"]' ],
+             [ 'escape at block boundary', '[' . $pad . '"\\\\", "\\"]"]' ],
+             [ 'long strings', qq{["$long","$long\\n$long",{"$long":"$long"}]} ],
+             [ 'utf-8', qq{["caf\xc3\xa9","\xe2\x82\xac$long","\xf0\x9d\x84\x9e"]} ],
+             [ 'newlines in strings', qq{["line1\nline2",\n "a\xe2\x80\xa8b", x]} ],
+             [ 'overlong utf-8', qq{["\xc1\x81"]} ],
+             [ 'bad utf-8', qq{["ok", "\xe9t\xe9"]} ],
+             [ 'comments', qq{{"a":1, // "unbalanced [\n "b":"c"}} ],
+             [ 'unbalanced', '{"a":["b"}' ],
+             [ 'unterminated', '["a", "b' ],
+             [ 'garbage at end', '["a"] "b"' ],
+             [ 'nested', '[[[[{"a":[{"b":"c"},[],{}]}]]]]' ],
+             [ 'empty containers', qq{[[], [ ], {}, {\n\t}, [[ ]], [""], {"":0}]} ],
+             [ 'trailing comma', '[1,2,[3,],{"a":1,},]' ],
+             [ 'repeated commas', qq{[,1,,,, 2,[,,3,,],{,"a":1,,\n,"b":[],},,]} ],
+             [ 'big containers', "[$big_array,$big_hash,$big_array]" ],
+            );
+
+plan tests => 3 * scalar(@tests) + 7;
+
+foreach my $test (@tests) {
+    my ($name, $json) = @$test;
+
+    my $plain = JSON::DWIW::deserialize($json);
+    my $plain_error = JSON::DWIW->get_error_data;
+    my $plain_stats = JSON::DWIW->get_stats;
+
+    my $indexed = JSON::DWIW::deserialize($json, { structural_index => 1 });
+    my $indexed_error = JSON::DWIW->get_error_data;
+    my $indexed_stats = JSON::DWIW->get_stats;
+
+    is_deeply($indexed, $plain, "$name - data");
+    is_deeply($indexed_error, $plain_error, "$name - error");
+    is_deeply($indexed_stats, $plain_stats, "$name - stats");
+}
+
+my $json = JSON::DWIW->new({ structural_index => 1 });
+my $data = $json->from_json('{"a":["b","c"]}');
+is_deeply($data, { a => [ 'b', 'c' ] }, 'option from new()');
+
+$data = JSON::DWIW::deserialize(qq{["\xe9"]}, { structural_index => 1,
+                                              bad_char_policy => 'convert' });
+is($data->[0], "\xe9", 'bad_char_policy convert');
+
+# the array the start_depth_handler takes elements from isn't sized
+# for all of them, but that shouldn't change anything
+my @seen;
+JSON::DWIW::deserialize("[$big_array,[1]]", { structural_index => 1, start_depth => 1,
+                                             start_depth_handler => sub { push @seen, $_[0]; 1 } });
+is_deeply(\@seen, [ [ 1 .. 1000 ], [ 1 ] ], 'start_depth_handler');
+
+# extra commas are skipped like whitespace, so they don't count toward
+# the size an array or hash is allocated at
+my $commas = ',' x 10000;
+$data = JSON::DWIW::deserialize("[1$commas 2]", { structural_index => 1 });
+is_deeply($data, [ 1, 2 ], 'repeated commas in an array');
+ok(B::svref_2object($data)->MAX < 10, 'repeated commas - array not sized by commas');
+
+$data = JSON::DWIW::deserialize(qq{{"a":1$commas"b":2$commas}}, { structural_index => 1 });
+is_deeply($data, { a => 1, b => 2 }, 'repeated commas in a hash');
+ok(B::svref_2object($data)->MAX < 64, 'repeated commas - hash not sized by commas');
@@ -0,0 +1,97 @@
+#!/usr/bin/env perl
+
+# Original authors: don
+# $Revision: $
+
+# Parsing from a filehandle a few bytes at a time should give
+# exactly the same data, errors, and stats as parsing the whole
+# string at once.
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use JSON::DWIW;
+
+my $long_array = '[' . join(",\n", map { qq{{"id":$_,"name":"caf\xc3\xa9 $_"}} } 1 .. 200) . ']';
+(my $long_error = $long_array) =~ s/"id":190/"id":190 "x"/;
+
+my @tests = (
+             [ 'simple hash', '{"key":"val","num":4}' ],
+             [ 'simple array', '[1,"two",true,null,{"a":[]}]' ],
+             [ 'top-level string', '"just a string"' ],
+             [ 'top-level number', ' -12.5e3 ' ],
+             [ 'empty containers', '[[],{},[{}]]' ],
+             [ 'empty top-level', ' [ ] ' ],
+             [ 'bare keys and extra commas', '{a:1,,b:[1,,2,],}' ],
+             [ 'comments', qq{/* start */ [1, # one\n 2 // two\n, /* three */ 3]} ],
+             [ 'utf-8', qq{["caf\xc3\xa9","\xe2\x82\xac","\xf0\x9d\x84\x9e",\xc2\xa0"nbsp"]} ],
+             [ 'bom', qq{\xef\xbb\xbf{"a":"b"}} ],
+             [ 'escapes', '["tab\\there","quote\\"]","\\u00e9"]' ],
+             [ 'bad utf-8', qq{["ok", "\xe9t\xe9"]} ],
+             [ 'unterminated', '["a", "b' ],
+             [ 'missing comma', '[1 2, 3]' ],
+             [ 'garbage at end', '["a"] "b"' ],
+             [ 'lone slash', '[1, / 2]' ],
+             [ 'long array', $long_array ],
+             [ 'error late in long array', $long_error ],
+            );
+
+my @read_sizes = (1, 2, 3, 7, 64, undef);
+
+plan tests => 3 * scalar(@tests) * scalar(@read_sizes) + 6;
+
+foreach my $test (@tests) {
+    my ($name, $json) = @$test;
+
+    my $data = JSON::DWIW::deserialize($json);
+    my $error = JSON::DWIW->get_error_data;
+    my $stats = JSON::DWIW->get_stats;
+
+    foreach my $read_size (@read_sizes) {
+        my $size_name = defined($read_size) ? $read_size : 'default';
+        my $options = defined($read_size) ? { read_size => $read_size } : { };
+
+        open(my $fh, '<', \$json) or die "couldn't open in-memory file: $!";
+        my $fh_data = JSON::DWIW::deserialize_fh($fh, $options);
+        close $fh;
+
+        is_deeply($fh_data, $data, "$name ($size_name) - data");
+        is_deeply(JSON::DWIW->get_error_data, $error, "$name ($size_name) - error");
+        is_deeply(JSON::DWIW->get_stats, $stats, "$name ($size_name) - stats");
+    }
+}
+
+my @ids;
+open(my $fh, '<', \$long_array) or die "couldn't open in-memory file: $!";
+my $data = JSON::DWIW::deserialize_fh($fh, { read_size => 5, start_depth => 1,
+                                             start_depth_handler => sub { push @ids, $_[0]->{id}; 1 } });
+close $fh;
+is(scalar(@ids), 200, 'start_depth_handler called for each element');
+is_deeply([ @ids[0, 199] ], [ 1, 200 ], 'start_depth_handler called in order');
+
+# the big array is the only member of the top-level hash, so the
+# handler has to be called from inside it, before the input runs out
+my $nested = qq{{"data":$long_array}};
+my @read_pos;
+open($fh, '<', \$nested) or die "couldn't open in-memory file: $!";
+$data = JSON::DWIW::deserialize_fh($fh, { read_size => 5, start_depth => 2,
+                                          start_depth_handler => sub { push @read_pos, tell($fh); 1 } });
+close $fh;
+is(scalar(@read_pos), 200, 'start_depth_handler called for each element of a nested array');
+ok($read_pos[0] < length($nested) / 10, 'start_depth_handler called before the nested array is read');
+
+my $file = "t/deser16_fh.$$.json";
+END { unlink $file if defined $file }
+
+open(my $out_fh, '>', $file) or die "couldn't open $file: $!";
+$data = JSON::DWIW::deserialize_fh($out_fh);
+close $out_fh;
+ok(! defined($data) && JSON::DWIW->get_error_string =~ /error reading input/, 'read error');
+
+open($fh, '<', \$long_array) or die "couldn't open in-memory file: $!";
+eval { JSON::DWIW::deserialize_fh($fh, { read_size => 5, start_depth => 1,
+                                         start_depth_handler => sub { die "handler died\n" } }) };
+close $fh;
+is($@, "handler died\n", 'exception from start_depth_handler');
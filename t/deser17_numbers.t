@@ -0,0 +1,64 @@
+#!/usr/bin/env perl
+
+# Original authors: don
+# $Revision: $
+
+# Numbers are converted by the parser as it goes, so make sure the
+# values come out the same as converting the text would.
+
+use strict;
+use warnings;
+
+use Test::More;
+use Config;
+
+use JSON::DWIW;
+
+unless (JSON::DWIW->has_deserialize) {
+    plan skip_all => 'deserialize not implemented on this platform';
+}
+
+my @tests = (
+             [ '0', 0 ],
+             [ '-0', 0 ],
+             [ '42', 42 ],
+             [ '-42', -42 ],
+             [ '5e1', 50 ],
+             [ '1.5', 1.5 ],
+             [ '-2.25E-2', -0.0225 ],
+             [ '0.1', 0.1 ],
+             [ '123456.789012', 123456.789012 ],
+             [ '2.2250738585e-308', 2.2250738585e-308 ],
+             [ '1.797693134e308', 1.797693134e308 ],
+             [ '4.9e-324', 4.9e-324 ],
+             [ '1e-400', 0 ],
+             [ '0.000000000000001', 1e-15 ],
+             [ '9007199254740993', 9007199254740993 ],
+            );
+
+plan tests => 2 * scalar(@tests) + 4;
+
+foreach my $test (@tests) {
+    my ($str, $expected) = @$test;
+
+    my $data = JSON::DWIW::deserialize("[$str]");
+    cmp_ok($data->[0], '==', $expected, "$str in an array");
+
+    $data = JSON::DWIW::deserialize(qq{{"a":$str}});
+    cmp_ok($data->{a}, '==', $expected, "$str in a hash");
+}
+
+SKIP: {
+    skip('perl has 32-bit integers', 2) unless $Config{ivsize} >= 8;
+
+    my $data = JSON::DWIW::deserialize('[-9223372036854775808,18446744073709551615]');
+    is($data->[0], '-9223372036854775808', 'smallest 64-bit integer');
+    is($data->[1], '18446744073709551615', 'largest 64-bit unsigned integer');
+}
+
+my $data = JSON::DWIW::deserialize('[1e400]');
+ok($data->[0] > 1e308, 'overflow to infinity');
+
+my $seen;
+$data = JSON::DWIW::deserialize('[1.25]', { parse_number => sub { $seen = shift; return 'n' } });
+is($seen, '1.25', 'parse_number still gets the text');
@@ -0,0 +1,127 @@
+#!/usr/bin/env perl
+
+# Original authors: don
+# $Revision: $
+
+# A JSON::DWIW::Decoder used over and over should give the same data,
+# errors, and stats as deserialize() with the same options.
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use JSON::DWIW;
+use JSON::DWIW::Decoder;
+
+# deeper than the initial size of the stack
+my $deep = ('[' x 80) . '1' . (']' x 80);
+
+# JSON::DWIW::Boolean objects can't be compared by is_deeply()
+sub plain {
+    my $val = shift;
+
+    if (UNIVERSAL::isa($val, 'JSON::DWIW::Boolean')) {
+        return $val ? 'bool:true' : 'bool:false';
+    }
+    elsif (ref($val) eq 'ARRAY') {
+        return [ map { plain($_) } @$val ];
+    }
+    elsif (ref($val) eq 'HASH') {
+        return { map { ($_ => plain($val->{$_})) } keys %$val };
+    }
+
+    return $val;
+}
+
+my @docs = (
+            '{"key":"val","num":4}',
+            '[1,"two",true,null,{"a":[]}]',
+            '"just a string"',
+            '["a", "b',
+            '[1 2, 3]',
+            $deep,
+            '{"after":["errors","and",{"deep":"docs"}]}',
+            '{"x":',
+           );
+
+my @option_sets = (
+                   { },
+                   { convert_bool => 1 },
+                   { parse_constant => sub { return "const:$_[0]" } },
+                   { parse_number => sub { return "num:$_[0]" } },
+                   { bad_char_policy => 'convert' },
+                  );
+
+my $num_short = grep { length($_) <= 100 } @docs;
+plan tests => (3 * scalar(@docs) + 2 * $num_short) * scalar(@option_sets) + 11;
+
+foreach my $options (@option_sets) {
+    my $decoder = JSON::DWIW::Decoder->new($options);
+    my $name = join(',', sort keys %$options) || 'no options';
+
+    # twice, so each doc is decoded after every other one
+    foreach my $pass (1, 2) {
+        foreach my $json (@docs) {
+            next if $pass == 2 and length($json) > 100;
+
+            my $data = plain(JSON::DWIW::deserialize($json, $options));
+            my $error = JSON::DWIW->get_error_data;
+            my $stats = JSON::DWIW->get_stats;
+
+            my $dec_data = plain($decoder->decode($json));
+            my $short = substr($json, 0, 20);
+
+            is_deeply($dec_data, $data, "$name - $short - data");
+            is_deeply(JSON::DWIW->get_error_data, $error, "$name - $short - error");
+            is_deeply(JSON::DWIW->get_stats, $stats, "$name - $short - stats") if $pass == 1;
+        }
+    }
+}
+
+my $decoder = JSON::DWIW::Decoder->new;
+is($decoder->decode(''), '', 'empty string');
+
+# options are read once, when the decoder is created
+my $options = { convert_bool => 1 };
+$decoder = JSON::DWIW::Decoder->new($options);
+$options->{convert_bool} = 0;
+ok(ref($decoder->decode('[true]')->[0]), 'options are compiled in');
+
+# a JSON::DWIW object works as the options
+$decoder = JSON::DWIW::Decoder->new(JSON::DWIW->new({ convert_bool => 1 }));
+ok(ref($decoder->decode('[false]')->[0]), 'JSON::DWIW object as options');
+
+$decoder = JSON::DWIW::Decoder->new({ use_exceptions => 1 });
+my $data = eval { $decoder->decode('[1,') };
+ok($@, 'use_exceptions');
+is_deeply($decoder->decode('[1]'), [ 1 ], 'decode after an exception');
+
+my @seen;
+$decoder = JSON::DWIW::Decoder->new({ start_depth => 1,
+                                      start_depth_handler => sub { push @seen, $_[0]; return 1 } });
+$decoder->decode('[{"a":1},{"b":2}]');
+$decoder->decode('[3]');
+is_deeply(\@seen, [ { a => 1 }, { b => 2 }, 3 ], 'start_depth_handler');
+
+# a callback that dies leaves the decoder usable
+$decoder = JSON::DWIW::Decoder->new({ parse_number => sub { die "no numbers\n" if $_[0] == 2;
+                                                            return $_[0] } });
+$data = eval { $decoder->decode('[1,2,3]') };
+is($@, "no numbers\n", 'callback died');
+is_deeply($decoder->decode('{"x":[1]}'), { x => [ 1 ] }, 'decode after a callback died');
+
+# a decoder can't be used from inside its own callbacks
+my $inner;
+$decoder = JSON::DWIW::Decoder->new({ parse_constant => sub { return $inner->decode('[1]') } });
+$inner = $decoder;
+$data = eval { $decoder->decode('[true]') };
+like($@, qr/already parsing/, 'no reentry');
+undef $inner;
+
+$decoder = JSON::DWIW::Decoder->new;
+my $file = 't/parse_file/pass1.json';
+is_deeply($decoder->decode_file($file), JSON::DWIW::deserialize_file($file), 'decode_file');
+
+eval { JSON::DWIW::Decoder::decode('JSON::DWIW::Decoder', '[1]') };
+ok($@, 'decode as a class method');
@@ -0,0 +1,87 @@
+#!/usr/bin/env perl
+
+# Original authors: don
+# $Revision: $
+
+# String bodies are scanned 16 bytes at a time, and the structural
+# index classifies the input 64 bytes at a time.  Put the interesting
+# bytes of a string on either side of those boundaries, with and
+# without the index.
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use JSON::DWIW;
+
+my @offsets = (15, 16, 31, 32, 63);
+
+# the string body starts at byte 2 + $pad of the input
+my @pads = (0, 1, 14);
+
+# [ name, sub returning (json body, expected value) given an offset ]
+my @cases = (
+             [ 'closing quote', sub { ('a' x $_[0], 'a' x $_[0]) } ],
+             [ 'backslash', sub { ('a' x $_[0] . '\\n' . 'b' x 20, 'a' x $_[0] . "\n" . 'b' x 20) } ],
+             [ 'escaped quote', sub { ('a' x $_[0] . '\\"bc', 'a' x $_[0] . '"bc') } ],
+             [ 'unicode escape', sub { ('a' x $_[0] . '\\u00e9', 'a' x $_[0] . "\x{e9}") } ],
+             [ '2 byte char split', sub { ('a' x ($_[0] - 1) . "\xc3\xa9z", 'a' x ($_[0] - 1) . "\x{e9}z") } ],
+             [ '3 byte char split', sub { ('a' x ($_[0] - 2) . "\xe2\x82\xacz", 'a' x ($_[0] - 2) . "\x{20ac}z") } ],
+             [ '4 byte char split', sub { ('a' x ($_[0] - 1) . "\xf0\x9d\x84\x9ez", 'a' x ($_[0] - 1) . "\x{1d11e}z") } ],
+             [ 'char before quote', sub { ('a' x ($_[0] - 2) . "\xc3\xa9", 'a' x ($_[0] - 2) . "\x{e9}") } ],
+            );
+
+my @bad_cases = (
+                 [ 'bad byte', sub { 'a' x $_[0] . "\xe9zz" } ],
+                 [ 'bad byte before quote', sub { 'a' x ($_[0] - 1) . "\xe9" } ],
+                 [ 'truncated char', sub { 'a' x ($_[0] - 1) . "\xe2\x82" } ],
+                );
+
+plan tests => scalar(@offsets) * scalar(@pads) * (4 * scalar(@cases) + 5 * scalar(@bad_cases));
+
+foreach my $offset (@offsets) {
+    foreach my $pad (@pads) {
+        my $where = "offset $offset, pad $pad";
+
+        foreach my $case (@cases) {
+            my ($name, $make) = @$case;
+            my ($body, $expected) = $make->($offset);
+
+            # the same string as a value and as a key
+            my $json = '[' . (' ' x $pad) . qq{"$body", {"$body":1}]};
+
+            foreach my $index (0, 1) {
+                my $data = JSON::DWIW::deserialize($json, { structural_index => $index });
+                is(ref($data) ? $data->[0] : JSON::DWIW->get_error_string, $expected,
+                   "$name - $where - index $index - value");
+                is(ref($data) ? join(',', keys %{$data->[1]}) : JSON::DWIW->get_error_string,
+                   $expected, "$name - $where - index $index - key");
+            }
+        }
+
+        foreach my $case (@bad_cases) {
+            my ($name, $make) = @$case;
+            my $body = $make->($offset);
+            my $json = '[' . (' ' x $pad) . qq{"$body"]};
+
+            my $plain = JSON::DWIW::deserialize($json);
+            my $plain_error = JSON::DWIW->get_error_data;
+            ok(! defined($plain) && JSON::DWIW->get_error_string =~ /bad utf-8/,
+               "$name - $where - error");
+
+            my $indexed = JSON::DWIW::deserialize($json, { structural_index => 1 });
+            is_deeply([ $indexed, JSON::DWIW->get_error_data ], [ $plain, $plain_error ],
+                      "$name - $where - same error with the index");
+
+            my @converted;
+            foreach my $index (0, 1) {
+                my $data = JSON::DWIW::deserialize($json, { structural_index => $index,
+                                                            bad_char_policy => 'convert' });
+                push @converted, $data;
+                ok(ref($data) && length($data->[0]) >= $offset, "$name - $where - index $index - convert");
+            }
+            is_deeply($converted[1], $converted[0], "$name - $where - same conversion with the index");
+        }
+    }
+}
@@ -8,7 +8,7 @@ use warnings;
 
 use Test;
 
-BEGIN { plan tests => 4 }
+BEGIN { plan tests => 30 }
 
 use JSON::DWIW;
 
@@ -33,3 +33,180 @@ ok(defined($str));
 my $r_data = JSON::DWIW::deserialize($str);
 ok(not defined(JSON::DWIW->get_error_string));
 
+
+# keys that came from JSON are stored downgraded, so sort_keys has
+# to use the hash entry's flag, not the SV made from the key
+my $h = JSON::DWIW::deserialize(qq({"caf\xc3\xa9":1,"b\xc3\xa8":2}));
+ok(JSON::DWIW->to_json($h, { sort_keys => 1 }), qq({"b\x{e8}":2,"caf\x{e9}":1}));
+
+# bigger than the initial output buffer
+my $big = [ map { { id => $_, name => "item $_", tags => [ 'a' .. 'e' ] } } 1 .. 500 ];
+$str = JSON::DWIW->to_json($big, { pretty => 1, sort_keys => 1 });
+ok(length($str) > 10000);
+ok(JSON::DWIW->to_json(JSON::DWIW::deserialize($str), { pretty => 1, sort_keys => 1 }), $str);
+
+# strings are scanned in blocks, so put each kind of character that
+# needs a closer look at each position around the block boundaries
+my %escapes = ('"' => '\\"', '\\' => '\\\\', '/' => '\\/', "\n" => '\\n', "\x01" => '\\u0001',
+               "\x{e9}" => "\x{e9}", "\x{263a}" => "\x{263a}");
+my @bad;
+foreach my $char (sort keys %escapes) {
+    foreach my $pos (0 .. 40) {
+        my $val = ('a' x $pos) . $char . ('b' x (40 - $pos));
+        utf8::upgrade($val);
+        my $expect = '["' . ('a' x $pos) . $escapes{$char} . ('b' x (40 - $pos)) . '"]';
+        push @bad, "$pos:" . ord($char) unless JSON::DWIW->to_json([ $val ]) eq $expect;
+    }
+}
+ok(join(',', @bad), '');
+
+ok(JSON::DWIW->to_json([ ('x' x 20) . "\x{263a}\x{e9}" ], { escape_multi_byte => 1 }),
+   '["' . ('x' x 20) . '\\u263a\\u00e9"]');
+
+# key stored as utf-8
+ok(JSON::DWIW->to_json({ "\x{263a} key/" => 1 }), qq({"\x{263a} key\\/":1}));
+
+# numbers
+ok(JSON::DWIW->to_json([ 0.1, 0.1 + 0.2, 1e21, 1e-7, 3.0, -1.5 ]),
+   '[0.1,0.30000000000000004,1e+21,1e-7,3,-1.5]');
+
+# the shortest digits for these are exactly halfway to the next double,
+# and only read back as this one because its mantissa is even
+ok(JSON::DWIW->to_json([ 5e22, 1e23, 1.78104e22, 8.2529e20 ]),
+   '[5e+22,1e+23,1.78104e+22,825290000000000000000]');
+
+$str = JSON::DWIW->to_json([ 1 / 3 ]);
+ok($str =~ /\A\[(.+)\]\z/ and $1 == 1 / 3);
+
+ok(JSON::DWIW->to_json([ -9223372036854775807 - 1, 18446744073709551615, 0, -7 ]),
+   '[-9223372036854775808,18446744073709551615,0,-7]');
+
+my $neg_zero = 0.0 * -1;
+ok(JSON::DWIW->to_json([ $neg_zero ]) =~ /\A\[-?0\]\z/);
+
+# circular refs -- only arrays and hashes are tracked, so a shared
+# boolean (as made by convert_bool) is not one
+my $bools = JSON::DWIW->new({ convert_bool => 1 })->from_json('[true,true,false,false]');
+ok(JSON::DWIW->to_json($bools, { detect_circular_refs => 1 }), '[true,true,false,false]');
+
+my $shared = [ 1 ];
+my $loop = { shared => $shared };
+$loop->{self} = $loop;
+$str = JSON::DWIW->to_json([ $loop, $shared, [ map { [ $_ ] } 1 .. 200 ] ],
+                           { detect_circular_refs => 1, sort_keys => 1 });
+ok($str =~ /\A\[\{"self":"circular ref: HASH\(0x[0-9a-f]+\)","shared":\[1\]\},"circular ref: ARRAY\(0x[0-9a-f]+\)",\[\[1\],/);
+
+# sort_keys orders by code point, whether the key is stored as utf-8,
+# as Latin-1, or as plain bytes -- also past the number of entries
+# sorted on the stack
+my %mixed = map { my $k = $_; utf8::upgrade($k); ($k => 1) } "b", "a", "\x{e9}", "\x{263a}", "\x{ff}z", "\x{100}", "";
+$mixed{"k$_"} = 1 for 1 .. 40;
+my @order = map { scalar(JSON::DWIW->to_json($_)) } sort keys %mixed;
+ok(JSON::DWIW->to_json(\%mixed, { sort_keys => 1 }), '{' . join(',', map { "$_:1" } @order) . '}');
+
+# tied hashes are sorted too
+{
+    package TestTiedHash;
+    require Tie::Hash;
+    our @ISA = ('Tie::StdHash');
+}
+tie my %tied, 'TestTiedHash';
+%tied = (c => 'z', a => 'x', b => 'y');
+ok(JSON::DWIW->to_json(\%tied, { sort_keys => 1 }), '{"a":"x","b":"y","c":"z"}');
+
+# cache_keys -- the same key is output differently with different
+# options, and a Latin-1 key is not the same as its utf-8 bytes
+my $latin1 = "caf\x{e9}/";
+utf8::upgrade($latin1);
+my $key_data = [ map { { $latin1 => 1, "caf\xc3\xa9/" => 2, plain_key => 3, "\x{263a}" => 4 } } 1 .. 3 ];
+my @cache_bad;
+foreach my $options ({ }, { bare_keys => 1 }, { escape_multi_byte => 1, bare_solidus => 1 }, { }) {
+    my $expected = JSON::DWIW->to_json($key_data, { %$options, sort_keys => 1 });
+    my $got = JSON::DWIW->to_json($key_data, { %$options, sort_keys => 1, cache_keys => 1 });
+    push @cache_bad, join(',', %$options) unless $got eq $expected;
+}
+ok(join(';', @cache_bad), '');
+
+# arrays of hashes with the same keys are output from a template made
+# from the first one -- rows that don't match go the usual way
+my @rows = map { { id => $_ + 0, "na/me" => "n$_", score => [ $_ + 0 ] } } 1 .. 4;
+splice(@rows, 2, 0, { id => 9, "na/me" => 'x', other => 1 }, undef);
+ok(JSON::DWIW->to_json(\@rows, { sort_keys => 1 }),
+   '[{"id":1,"na\/me":"n1","score":[1]},{"id":2,"na\/me":"n2","score":[2]},'
+   . '{"id":9,"na\/me":"x","other":1},null,{"id":3,"na\/me":"n3","score":[3]},'
+   . '{"id":4,"na\/me":"n4","score":[4]}]');
+
+# without sort_keys, every row matching the template has its keys in
+# the same order
+@rows = map { my $i = $_; +{ map { ("k$_" => $i) } 1 .. 20 } } 1 .. 50;
+my @key_orders = map { join(',', /"(k\d+)"/g) } JSON::DWIW->to_json(\@rows) =~ /\{[^}]+\}/g;
+ok(scalar(@key_orders) == 50 and not grep { $_ ne $key_orders[0] } @key_orders);
+
+# a key deleted from a restricted hash leaves a placeholder behind
+require Hash::Util;
+@rows = map { { a => $_, b => $_, c => $_ } } 1 .. 3;
+Hash::Util::lock_ref_keys($rows[1]);
+delete $rows[1]{b};
+ok(JSON::DWIW->to_json(\@rows, { sort_keys => 1 }),
+   '[{"a":1,"b":1,"c":1},{"a":2,"c":2},{"a":3,"b":3,"c":3}]');
+
+# convert_blessed
+{
+    package TestPoint;
+    sub new { my ($class, $x, $y) = @_; return bless { x => $x, y => $y, cache => {} }, $class }
+    sub TO_JSON { my $self = shift; return [ $self->{x}, $self->{y} ] }
+
+    package TestPoint3D;
+    our @ISA = ('TestPoint');
+
+    package TestLine;
+    sub TO_JSON { return { from => TestPoint->new(1, 2), to => TestPoint3D->new(3, 4) } }
+
+    package TestDies;
+    sub TO_JSON { die "can't do it\n" }
+
+    package TestSelf;
+    sub TO_JSON { return $_[0] }
+}
+
+my $objs = [ TestPoint->new(1, 2), bless({}, 'TestLine'), bless({ a => 1 }, 'TestPlain'),
+             JSON::DWIW::Boolean->true, TestPoint->new(5, 6) ];
+ok(JSON::DWIW->to_json($objs, { convert_blessed => 1, sort_keys => 1 }),
+   '[[1,2],{"from":[1,2],"to":[3,4]},{"a":1},true,[5,6]]');
+ok(JSON::DWIW->to_json([ TestPoint->new(1, 2) ], { sort_keys => 1 }), '[{"cache":{},"x":1,"y":2}]');
+
+$@ = 'untouched';
+my ($json, $err) = JSON::DWIW->to_json([ bless({}, 'TestDies') ], { convert_blessed => 1 });
+ok(! defined($json) && $err =~ /TestDies::TO_JSON died: can't do it\z/ && $@ eq 'untouched');
+
+($json, $err) = JSON::DWIW->to_json([ bless({}, 'TestSelf') ], { convert_blessed => 1 });
+ok(! defined($json) && $err =~ /TestSelf::TO_JSON returned the object it was called on/);
+
+# with detect_circular_refs, what TO_JSON returns is kept until the
+# end, so the next result can't show up at the same address and be
+# taken for one already output
+{
+    package TestWrapArray;
+    sub new { my ($class, $x) = @_; return bless { x => $x }, $class }
+    sub TO_JSON { return [ $_[0]{x} ] }
+
+    package TestWrapHash;
+    our @ISA = ('TestWrapArray');
+    sub TO_JSON { return { x => $_[0]{x} } }
+
+    package TestWrapShared;
+    our $shared = [ 1 ];
+    sub TO_JSON { return $shared }
+}
+
+ok(JSON::DWIW->to_json([ map { TestWrapArray->new($_) } 1 .. 6 ],
+       { convert_blessed => 1, detect_circular_refs => 1 }),
+   '[[1],[2],[3],[4],[5],[6]]');
+ok(JSON::DWIW->to_json([ map { TestWrapHash->new($_) } 1 .. 6 ],
+       { convert_blessed => 1, detect_circular_refs => 1 }),
+   '[{"x":1},{"x":2},{"x":3},{"x":4},{"x":5},{"x":6}]');
+
+# the same array returned twice is still caught
+$json = JSON::DWIW->to_json([ bless({}, 'TestWrapShared'), bless({}, 'TestWrapShared') ],
+    { convert_blessed => 1, detect_circular_refs => 1 });
+ok($json =~ /\A\[\[1\],"circular ref: ARRAY\(0x[0-9a-f]+\)"\]\z/);
@@ -0,0 +1,97 @@
+#!/usr/bin/env perl
+
+# Original authors: don
+# $Revision: $
+
+# Writing to a filehandle a piece at a time should give exactly the
+# same bytes, errors, and stats as to_json() followed by a print.
+
+use strict;
+use warnings;
+
+use Test::More;
+
+use JSON::DWIW;
+
+my $file = "t/encode02_fh.$$.json";
+END { unlink $file if defined $file }
+
+my $wide = "caf\x{e9} \x{263a}";
+my $big = [ map { { id => $_, name => "item $_ $wide", vals => [ $_ * 1.5, undef, "a/b" ] } } 1 .. 300 ];
+
+my @tests = (
+             [ 'simple hash', { key => 'val', num => 4 } ],
+             [ 'top-level string', $wide ],
+             [ 'top-level number', -12.5 ],
+             [ 'no strings', [ 1, 2, [ 3 ] ] ],
+             [ 'big array', $big ],
+             [ 'bad utf-8', [ 'ok', "bad \xe9" ] ],
+            );
+
+my @option_sets = (
+                   { },
+                   { write_size => 7 },
+                   { pretty => 1, write_size => 100 },
+                   { escape_multi_byte => 1, sort_keys => 1 },
+                  );
+
+plan tests => 4 * scalar(@tests) * scalar(@option_sets) + 6;
+
+sub slurp {
+    my $in_fh;
+    open($in_fh, '<', $file) or die "couldn't open $file: $!";
+    binmode($in_fh);
+    local $/;
+    my $str = <$in_fh>;
+    close $in_fh;
+
+    return defined($str) ? $str : '';
+}
+
+foreach my $options (@option_sets) {
+    my $name = join(',', map { "$_=$options->{$_}" } sort keys %$options) || 'no options';
+
+    foreach my $test (@tests) {
+        my ($test_name, $data) = @$test;
+
+        my ($expected, $error) = JSON::DWIW->to_json($data, $options);
+        my $stats = JSON::DWIW->get_stats;
+        if (defined($expected)) {
+            utf8::encode($expected) if utf8::is_utf8($expected);
+        }
+
+        my ($ok, $file_error) = JSON::DWIW->to_json_file($data, $file, $options);
+        is(slurp(), defined($error) ? '' : $expected, "$name - $test_name - file");
+        is($file_error, $error, "$name - $test_name - file error");
+        is_deeply(JSON::DWIW->get_stats, $stats, "$name - $test_name - stats");
+
+        my $out = '';
+        my $out_fh;
+        open($out_fh, '>', \$out) or die "couldn't open in-memory filehandle";
+        JSON::DWIW->to_json_fh($data, $out_fh, $options);
+        close $out_fh;
+
+        if (defined($error)) {
+            # whatever came before the error was written
+            ok(length($out) < length(JSON::DWIW->to_json($data, { %$options, bad_char_policy => 'convert' })),
+               "$name - $test_name - fh");
+        }
+        else {
+            is($out, $expected, "$name - $test_name - fh");
+        }
+    }
+}
+
+my $json_obj = JSON::DWIW->new({ write_size => 10 });
+ok($json_obj->to_json_file([ 1 .. 10 ], $file), 'to_json_file as a method');
+is(slurp(), '[1,2,3,4,5,6,7,8,9,10]', 'output from method');
+
+my ($ok, $error) = JSON::DWIW->to_json_file([ 1 ], "t/no/such/dir/out.json");
+ok(! $ok && $error =~ /couldn't open/, 'bad file name');
+
+eval { JSON::DWIW->to_json_fh([ 1 ], \*STDIN) };
+like($@, qr/not open for writing/, 'read-only filehandle');
+
+eval { JSON::DWIW->to_json_file([ "\xe9" ], $file, { use_exceptions => 1 }) };
+like($@, qr/bad utf8/, 'use_exceptions');
+is(slurp(), '', 'file is empty after an exception');